@@ -0,0 +1,2642 @@
+//
+//  AccuracyCheck.cpp
+//  3dmath-bench
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "AccuracyCheck.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "MathUtil.h"
+#include "Vector3.hpp"
+#include "EulerAngles.hpp"
+#include "Matrix4x3.hpp"
+#include "Quaternion.hpp"
+#include "PackedQuaternion.hpp"
+#include "QuaternionBlend.hpp"
+#include "QuaternionStream.hpp"
+#include "RotationMatrix.hpp"
+#include "Vector3Stream.hpp"
+#include "DualQuaternion.hpp"
+#include "Skinning.hpp"
+#include "AABB3.hpp"
+#include "Frustum.hpp"
+#include "BVH.hpp"
+#include "AnimationClip.hpp"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// double参考实现
+//
+// 按与库相同的约定（左手坐标系、行向量乘矩阵、heading-pitch-bank）用double重新计算，
+// 输入是float的输入原样转换为double，所以参考结果只差double的舍入
+//
+/////////////////////////////////////////////////////////////////////////////
+
+struct RefVector {
+    double x, y, z;
+};
+
+struct RefQuaternion {
+    double w, x, y, z;
+};
+
+// 与Matrix4x3相同的约定：p' = p * m + t
+struct RefMatrix {
+    double m[3][3];
+    double t[3];
+};
+
+static RefVector toRef(const Vector3& v) {
+    RefVector r = {v.x, v.y, v.z};
+    return r;
+}
+
+static RefQuaternion toRef(const Quaternion& q) {
+    RefQuaternion r = {q.w, q.x, q.y, q.z};
+    return r;
+}
+
+static RefMatrix toRef(const Matrix4x3& a) {
+    RefMatrix r = {
+        {{a.m11, a.m12, a.m13}, {a.m21, a.m22, a.m23}, {a.m31, a.m32, a.m33}},
+        {a.tx, a.ty, a.tz}
+    };
+    return r;
+}
+
+static RefMatrix toRef(const RotationMatrix& a) {
+    RefMatrix r = {
+        {{a.m11, a.m12, a.m13}, {a.m21, a.m22, a.m23}, {a.m31, a.m32, a.m33}},
+        {0.0, 0.0, 0.0}
+    };
+    return r;
+}
+
+static Quaternion toFloat(const RefQuaternion& q) {
+    Quaternion r;
+    r.w = (float)q.w;
+    r.x = (float)q.x;
+    r.y = (float)q.y;
+    r.z = (float)q.z;
+    return r;
+}
+
+static Matrix4x3 toFloat(const RefMatrix& a, TransformClass transformClass) {
+    Matrix4x3 r;
+    r.m11 = (float)a.m[0][0]; r.m12 = (float)a.m[0][1]; r.m13 = (float)a.m[0][2];
+    r.m21 = (float)a.m[1][0]; r.m22 = (float)a.m[1][1]; r.m23 = (float)a.m[1][2];
+    r.m31 = (float)a.m[2][0]; r.m32 = (float)a.m[2][1]; r.m33 = (float)a.m[2][2];
+    r.tx = (float)a.t[0]; r.ty = (float)a.t[1]; r.tz = (float)a.t[2];
+    r.transformClass = transformClass;
+    return r;
+}
+
+static RotationMatrix toRotationMatrix(const RefMatrix& a) {
+    RotationMatrix r;
+    r.m11 = (float)a.m[0][0]; r.m12 = (float)a.m[0][1]; r.m13 = (float)a.m[0][2];
+    r.m21 = (float)a.m[1][0]; r.m22 = (float)a.m[1][1]; r.m23 = (float)a.m[1][2];
+    r.m31 = (float)a.m[2][0]; r.m32 = (float)a.m[2][1]; r.m33 = (float)a.m[2][2];
+    return r;
+}
+
+static double refDot(const RefVector& a, const RefVector& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static double refLength(const RefVector& a) {
+    return sqrt(refDot(a, a));
+}
+
+static RefVector refCross(const RefVector& a, const RefVector& b) {
+    RefVector r = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    return r;
+}
+
+static RefVector refNormalize(const RefVector& a) {
+    double k = 1.0 / refLength(a);
+    RefVector r = {a.x * k, a.y * k, a.z * k};
+    return r;
+}
+
+static RefVector refTransform(const RefVector& p, const RefMatrix& a, bool translate) {
+    RefVector r = {
+        p.x * a.m[0][0] + p.y * a.m[1][0] + p.z * a.m[2][0],
+        p.x * a.m[0][1] + p.y * a.m[1][1] + p.z * a.m[2][1],
+        p.x * a.m[0][2] + p.y * a.m[1][2] + p.z * a.m[2][2]
+    };
+    if (translate) {
+        r.x += a.t[0];
+        r.y += a.t[1];
+        r.z += a.t[2];
+    }
+    return r;
+}
+
+// 3x3部分转置，平移为0
+static RefMatrix refTranspose(const RefMatrix& a) {
+    RefMatrix r;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            r.m[i][j] = a.m[j][i];
+        }
+        r.t[i] = 0.0;
+    }
+    return r;
+}
+
+/*
+    与orthonormalizeN相同的方法，参看9.3.3
+    前两行各减去对方投影的一半，正则化后第三行取两者的叉乘，再正则化
+ */
+static RefMatrix refOrthonormalize(const RefMatrix& a) {
+    RefVector r1 = {a.m[0][0], a.m[0][1], a.m[0][2]};
+    RefVector r2 = {a.m[1][0], a.m[1][1], a.m[1][2]};
+    double halfError = 0.5 * refDot(r1, r2);
+    RefVector rows[3] = {
+        {r1.x - halfError * r2.x, r1.y - halfError * r2.y, r1.z - halfError * r2.z},
+        {r2.x - halfError * r1.x, r2.y - halfError * r1.y, r2.z - halfError * r1.z}
+    };
+    rows[2] = refCross(refNormalize(rows[0]), refNormalize(rows[1]));
+    RefMatrix r;
+    for (int i = 0; i < 3; ++i) {
+        RefVector row = refNormalize(rows[i]);
+        r.m[i][0] = row.x;
+        r.m[i][1] = row.y;
+        r.m[i][2] = row.z;
+        r.t[i] = 0.0;
+    }
+    return r;
+}
+
+// 先做a再做b
+static RefMatrix refConcatenate(const RefMatrix& a, const RefMatrix& b) {
+    RefMatrix r;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j];
+        }
+    }
+    for (int j = 0; j < 3; ++j) {
+        r.t[j] = a.t[0] * b.m[0][j] + a.t[1] * b.m[1][j] + a.t[2] * b.m[2][j] + b.t[j];
+    }
+    return r;
+}
+
+static double refDeterminant(const RefMatrix& a) {
+    return a.m[0][0] * (a.m[1][1] * a.m[2][2] - a.m[1][2] * a.m[2][1])
+         + a.m[0][1] * (a.m[1][2] * a.m[2][0] - a.m[1][0] * a.m[2][2])
+         + a.m[0][2] * (a.m[1][0] * a.m[2][1] - a.m[1][1] * a.m[2][0]);
+}
+
+static RefMatrix refInverse(const RefMatrix& a) {
+    double oneOverDet = 1.0 / refDeterminant(a);
+    RefMatrix r;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            // 伴随矩阵：余子式转置
+            int i1 = (j + 1) % 3, i2 = (j + 2) % 3;
+            int j1 = (i + 1) % 3, j2 = (i + 2) % 3;
+            r.m[i][j] = (a.m[i1][j1] * a.m[i2][j2] - a.m[i1][j2] * a.m[i2][j1]) * oneOverDet;
+        }
+    }
+    for (int j = 0; j < 3; ++j) {
+        r.t[j] = -(a.t[0] * r.m[0][j] + a.t[1] * r.m[1][j] + a.t[2] * r.m[2][j]);
+    }
+    return r;
+}
+
+// 与Quaternion::operator*相同的乘法顺序
+static RefQuaternion refMultiply(const RefQuaternion& a, const RefQuaternion& b) {
+    RefQuaternion r = {
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+        a.w * b.x + a.x * b.w + a.z * b.y - a.y * b.z,
+        a.w * b.y + a.y * b.w + a.x * b.z - a.z * b.x,
+        a.w * b.z + a.z * b.w + a.y * b.x - a.x * b.y
+    };
+    return r;
+}
+
+static const RefQuaternion kRefIdentity = {1.0, 0.0, 0.0, 0.0};
+
+static RefQuaternion refConjugate(const RefQuaternion& q) {
+    RefQuaternion r = {q.w, -q.x, -q.y, -q.z};
+    return r;
+}
+
+static RefQuaternion refScale(const RefQuaternion& q, double k) {
+    RefQuaternion r = {q.w * k, q.x * k, q.y * k, q.z * k};
+    return r;
+}
+
+static RefQuaternion refNormalize(const RefQuaternion& q) {
+    double k = 1.0 / sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+    RefQuaternion r = {q.w * k, q.x * k, q.y * k, q.z * k};
+    return r;
+}
+
+// 物体-惯性四元数，参看10.6.5
+static RefQuaternion refObjectToInertial(double heading, double pitch, double bank) {
+    double sh = sin(heading * 0.5), ch = cos(heading * 0.5);
+    double sp = sin(pitch * 0.5), cp = cos(pitch * 0.5);
+    double sb = sin(bank * 0.5), cb = cos(bank * 0.5);
+    RefQuaternion r = {
+        ch * cp * cb + sh * sp * sb,
+        ch * sp * cb + sh * cp * sb,
+        -ch * sp * sb + sh * cp * cb,
+        -sh * sp * cb + ch * cp * sb
+    };
+    return r;
+}
+
+static RefQuaternion refObjectToInertial(const EulerAngles& e) {
+    return refObjectToInertial(e.heading, e.pitch, e.bank);
+}
+
+// 与Matrix4x3::fromQuaternion相同的约定，参看10.6.3
+static RefMatrix refFromQuaternion(const RefQuaternion& q) {
+    double ww = q.w, x = q.x, y = q.y, z = q.z;
+    RefMatrix r = {
+        {
+            {1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y + ww * z), 2.0 * (x * z - ww * y)},
+            {2.0 * (x * y - ww * z), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z + ww * x)},
+            {2.0 * (x * z + ww * y), 2.0 * (y * z - ww * x), 1.0 - 2.0 * (x * x + y * y)}
+        },
+        {0.0, 0.0, 0.0}
+    };
+    return r;
+}
+
+// refFromQuaternion的逆，选最大的分量先开方，参看10.6.3
+static RefQuaternion refQuaternionFromMatrix(const RefMatrix& a) {
+    double trace = a.m[0][0] + a.m[1][1] + a.m[2][2];
+    double candidates[4] = {
+        trace,
+        a.m[0][0] - a.m[1][1] - a.m[2][2],
+        a.m[1][1] - a.m[0][0] - a.m[2][2],
+        a.m[2][2] - a.m[0][0] - a.m[1][1]
+    };
+    int biggest = (int)(std::max_element(candidates, candidates + 4) - candidates);
+    double big = sqrt(candidates[biggest] + 1.0) * 0.5;
+    double mult = 0.25 / big;
+
+    RefQuaternion r;
+    switch (biggest) {
+        case 0:
+            r.w = big;
+            r.x = (a.m[1][2] - a.m[2][1]) * mult;
+            r.y = (a.m[2][0] - a.m[0][2]) * mult;
+            r.z = (a.m[0][1] - a.m[1][0]) * mult;
+            break;
+        case 1:
+            r.x = big;
+            r.w = (a.m[1][2] - a.m[2][1]) * mult;
+            r.y = (a.m[0][1] + a.m[1][0]) * mult;
+            r.z = (a.m[2][0] + a.m[0][2]) * mult;
+            break;
+        case 2:
+            r.y = big;
+            r.w = (a.m[2][0] - a.m[0][2]) * mult;
+            r.x = (a.m[0][1] + a.m[1][0]) * mult;
+            r.z = (a.m[1][2] + a.m[2][1]) * mult;
+            break;
+        default:
+            r.z = big;
+            r.w = (a.m[0][1] - a.m[1][0]) * mult;
+            r.x = (a.m[2][0] + a.m[0][2]) * mult;
+            r.y = (a.m[1][2] + a.m[2][1]) * mult;
+            break;
+    }
+    return refNormalize(r);
+}
+
+// 半角，用atan2计算，在接近0和接近pi时都不损失精度
+static double refHalfAngle(const RefQuaternion& q) {
+    return atan2(sqrt(q.x * q.x + q.y * q.y + q.z * q.z), q.w);
+}
+
+// q^exponent，与pow()相同：保持q的符号，半角乘以指数
+static RefQuaternion refPow(const RefQuaternion& q, double exponent) {
+    double sinAlpha = sqrt(q.x * q.x + q.y * q.y + q.z * q.z);
+    if (sinAlpha == 0.0) {
+        return q;
+    }
+    double newAlpha = refHalfAngle(q) * exponent;
+    double mult = sin(newAlpha) / sinAlpha;
+    RefQuaternion r = {cos(newAlpha), q.x * mult, q.y * mult, q.z * mult};
+    return r;
+}
+
+// 沿最短弧插值，与slerp()相同
+static RefQuaternion refSlerp(const RefQuaternion& a, const RefQuaternion& b, double t) {
+    RefQuaternion d = refMultiply(refConjugate(a), b);
+    if (d.w < 0.0) {
+        d.w = -d.w;
+        d.x = -d.x;
+        d.y = -d.y;
+        d.z = -d.z;
+    }
+    return refMultiply(a, refPow(refNormalize(d), t));
+}
+
+/*
+    加权平均四元数：M = sum(w * q * q^T)的最大特征向量
+    用Jacobi方法迭代到非对角元在double中可以忽略，ratio返回第二大与最大特征值之比，即问题的病态程度
+ */
+static RefQuaternion refBlend(const RefQuaternion* q, const double* w, int count, double* ratio) {
+    double a[4][4] = {}, v[4][4] = {};
+    for (int k = 0; k < count; ++k) {
+        double c[4] = {q[k].w, q[k].x, q[k].y, q[k].z};
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                a[i][j] += w[k] * c[i] * c[j];
+            }
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        v[i][i] = 1.0;
+    }
+
+    for (int sweep = 0; sweep < 30; ++sweep) {
+        double off = 0.0;
+        for (int p = 0; p < 3; ++p) {
+            for (int r = p + 1; r < 4; ++r) {
+                off += a[p][r] * a[p][r];
+            }
+        }
+        if (off < 1e-60) {
+            break;
+        }
+        for (int p = 0; p < 3; ++p) {
+            for (int r = p + 1; r < 4; ++r) {
+                double apr = a[p][r];
+                if (apr == 0.0) {
+                    continue;
+                }
+                double theta = (a[r][r] - a[p][p]) / (2.0 * apr);
+                double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0);
+                double s = t * c;
+                for (int k = 0; k < 4; ++k) {
+                    if (k != p && k != r) {
+                        double akp = a[k][p], akr = a[k][r];
+                        a[k][p] = a[p][k] = c * akp - s * akr;
+                        a[k][r] = a[r][k] = s * akp + c * akr;
+                    }
+                    double vkp = v[k][p], vkr = v[k][r];
+                    v[k][p] = c * vkp - s * vkr;
+                    v[k][r] = s * vkp + c * vkr;
+                }
+                a[p][p] -= t * apr;
+                a[r][r] += t * apr;
+                a[p][r] = a[r][p] = 0.0;
+            }
+        }
+    }
+
+    int best = 0;
+    for (int i = 1; i < 4; ++i) {
+        best = a[i][i] > a[best][best] ? i : best;
+    }
+    double second = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        second = i != best ? std::max(second, a[i][i]) : second;
+    }
+    *ratio = a[best][best] > 0.0 ? second / a[best][best] : 1.0;
+    RefQuaternion r = {v[0][best], v[1][best], v[2][best], v[3][best]};
+    return r;
+}
+
+// 两个旋转之间的夹角，q和-q是同一个旋转
+static double angleBetween(const RefQuaternion& a, const RefQuaternion& b) {
+    RefQuaternion d = refMultiply(refConjugate(refNormalize(a)), refNormalize(b));
+    return 2.0 * atan2(sqrt(d.x * d.x + d.y * d.y + d.z * d.z), fabs(d.w));
+}
+
+// 与DualQuaternion相同的约定：dual = 0.5 * t * real（Hamilton乘积），即本库的real * t * 0.5
+struct RefDualQuaternion {
+    RefQuaternion real;
+    RefQuaternion dual;
+};
+
+static RefDualQuaternion toRef(const DualQuaternion& dq) {
+    RefDualQuaternion r = {toRef(dq.real), toRef(dq.dual)};
+    return r;
+}
+
+static DualQuaternion toFloat(const RefDualQuaternion& dq) {
+    DualQuaternion r;
+    r.real = toFloat(dq.real);
+    r.dual = toFloat(dq.dual);
+    return r;
+}
+
+static RefDualQuaternion refDualQuaternion(const RefQuaternion& q, const RefVector& t) {
+    RefQuaternion pure = {0.0, t.x, t.y, t.z};
+    RefDualQuaternion r = {q, refScale(refMultiply(q, pure), 0.5)};
+    return r;
+}
+
+// 先做a再做b，与DualQuaternion::operator*相同
+static RefDualQuaternion refMultiply(const RefDualQuaternion& a, const RefDualQuaternion& b) {
+    RefQuaternion d0 = refMultiply(a.dual, b.real), d1 = refMultiply(a.real, b.dual);
+    RefDualQuaternion r = {refMultiply(a.real, b.real), {d0.w + d1.w, d0.x + d1.x, d0.y + d1.y, d0.z + d1.z}};
+    return r;
+}
+
+/*
+    对应的矩阵，real不必是单位四元数：先除以real的模，平移为2 * real^-1 * dual的虚部（本库的乘法顺序）
+    dual与real不正交时与skinVertices的正则化相同，只取平移部分
+ */
+static RefMatrix refFromDualQuaternion(const RefDualQuaternion& dq) {
+    double k = 1.0 / sqrt(dq.real.w * dq.real.w + dq.real.x * dq.real.x + dq.real.y * dq.real.y + dq.real.z * dq.real.z);
+    RefQuaternion real = refScale(dq.real, k), dual = refScale(dq.dual, k);
+    RefMatrix r = refFromQuaternion(real);
+    RefQuaternion t = refMultiply(refConjugate(real), dual);
+    r.t[0] = 2.0 * t.x;
+    r.t[1] = 2.0 * t.y;
+    r.t[2] = 2.0 * t.z;
+    return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 误差
+//
+/////////////////////////////////////////////////////////////////////////////
+
+enum ErrorUnit {
+    kErrorUlp,
+    kErrorRadians,
+    kErrorAbsolute
+};
+
+/*
+    以弧度计的项没有单独给出上限时使用的上限
+    库中有记录的最大旋转误差是万向锁附近提取欧拉角的约1.4e-3（参看EulerAngles.cpp的kGimbalLockSin），
+    超过2e-3的旋转误差不是舍入造成的，而是算法错误，比如万向锁时heading和bank的合并方向错了
+ */
+static const double kRotationBound = 2e-3;
+
+// canonize把pitch离±90°不超过1e-4的情况按万向锁处理，bank合并到heading后旋转最多偏差约2e-4
+static const double kCanonizeBound = 2.5e-4;
+
+// 切变矩阵的元素是精确的，变换一个点只有两次舍入
+static const double kShearBound = 2.0;
+
+/*
+    只报告误差的大小，不检查上限，用于头文件中没有给出上限的近似（比如各姿态相差很大时的nlerp）
+    结果错误时（比如空的边界框变换后不再为空）误差记为无穷大，NaN同样按无穷大计，仍然报告FAIL
+ */
+static const double kReportOnly = DBL_MAX;
+
+static const char* unitName(ErrorUnit unit) {
+    static const char* names[] = {"ulp", "rad", "abs"};
+    return names[unit];
+}
+
+// x在float中的ULP，接近0时取最小正规数的ULP
+static double floatUlp(double x) {
+    float f = std::max((float)fabs(x), FLT_MIN);
+    return (double)nextafterf(f, FLT_MAX) - (double)f;
+}
+
+static double scalarUlp(float r, double ref) {
+    return fabs((double)r - ref) / floatUlp(ref);
+}
+
+static double vectorUlp(const Vector3& r, const RefVector& ref) {
+    double e = std::max(std::max(fabs(r.x - ref.x), fabs(r.y - ref.y)), fabs(r.z - ref.z));
+    return e / floatUlp(refLength(ref));
+}
+
+static double quaternionUlp(const Quaternion& r, const RefQuaternion& ref) {
+    double e = std::max(std::max(fabs(r.w - ref.w), fabs(r.x - ref.x)), std::max(fabs(r.y - ref.y), fabs(r.z - ref.z)));
+    return e / floatUlp(sqrt(ref.w * ref.w + ref.x * ref.x + ref.y * ref.y + ref.z * ref.z));
+}
+
+// 3x3部分按其中最大元素的ULP，平移部分按平移向量长度的ULP，取较大者
+static double matrixUlp(const RefMatrix& r, const RefMatrix& ref) {
+    double e = 0.0, size = 0.0;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            e = std::max(e, fabs(r.m[i][j] - ref.m[i][j]));
+            size = std::max(size, fabs(ref.m[i][j]));
+        }
+    }
+    RefVector t = {ref.t[0], ref.t[1], ref.t[2]};
+    double te = std::max(std::max(fabs(r.t[0] - ref.t[0]), fabs(r.t[1] - ref.t[1])), fabs(r.t[2] - ref.t[2]));
+    return std::max(e / floatUlp(size), te / floatUlp(refLength(t)));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 报告
+//
+/////////////////////////////////////////////////////////////////////////////
+
+struct AccuracyRow {
+    std::string kernel;
+    std::string inputs;
+    size_t samples;
+    double maxError;
+    double meanError;
+    ErrorUnit unit;
+    double nsPerElement;
+    double bound;
+    bool failed;
+};
+
+class AccuracyReport {
+
+public:
+    explicit AccuracyReport(const char* f) : filter(f) {}
+
+    bool enabled(const char* kernel) const {
+        return filter == NULL || strstr(kernel, filter) != NULL;
+    }
+
+    /*
+        run()处理全部n个输入，error(i)返回第i个结果的误差
+        先计时，最后一次运行的结果用来计算误差；最大误差超过bound记为失败
+        bound为0时以弧度计的项按kRotationBound检查，其他单位不检查
+     */
+    template <typename Run, typename Error>
+    void check(const char* kernel, const char* inputs, ErrorUnit unit, size_t n, Run run, Error error,
+               double bound = 0.0) {
+        if (!enabled(kernel)) {
+            return;
+        }
+
+        AccuracyRow row;
+        row.kernel = kernel;
+        row.inputs = inputs;
+        row.samples = n;
+        row.unit = unit;
+        if (bound <= 0.0 && unit == kErrorRadians) {
+            bound = kRotationBound;
+        }
+        row.bound = bound;
+        row.nsPerElement = timeKernel(n, run);
+
+        double maxError = 0.0, sum = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            double e = error(i);
+            // NaN按无穷大计
+            if (!(e == e)) {
+                e = INFINITY;
+            }
+            maxError = std::max(maxError, e);
+            sum += e;
+        }
+        row.maxError = maxError;
+        row.meanError = n > 0 ? sum / (double)n : 0.0;
+        row.failed = bound > 0.0 && !(maxError <= bound);
+        rows.push_back(row);
+
+        printf("%-50s %-16s %10.3g %10.3g %-3s %9.2f ns%s\n", kernel, inputs, row.maxError, row.meanError,
+               unitName(unit), row.nsPerElement, row.failed ? "  FAIL" : "");
+        fflush(stdout);
+    }
+
+    int failures() const {
+        int count = 0;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            count += rows[i].failed ? 1 : 0;
+        }
+        return count;
+    }
+
+    void writeCsv(FILE* file) const {
+        fprintf(file, "kernel,inputs,samples,max_error,mean_error,unit,ns_per_element,bound\n");
+        for (size_t i = 0; i < rows.size(); ++i) {
+            const AccuracyRow& r = rows[i];
+            fprintf(file, "%s,%s,%zu,%.6g,%.6g,%s,%.4f,%.6g\n", r.kernel.c_str(), r.inputs.c_str(), r.samples,
+                    r.maxError, r.meanError, unitName(r.unit), r.nsPerElement, r.bound);
+        }
+    }
+
+private:
+    const char* filter;
+    std::vector<AccuracyRow> rows;
+
+    // 与性能测试相同：遍数加倍到至少5ms，取三次中最快的一次
+    template <typename Run>
+    static double timeKernel(size_t n, Run& run) {
+        run();
+        double best = 0.0;
+        long passes = 1;
+        int trial = 0;
+        while (trial < 3) {
+            auto start = std::chrono::steady_clock::now();
+            for (long p = 0; p < passes; ++p) {
+                run();
+            }
+            auto end = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(end - start).count();
+            if (trial == 0 && seconds < 0.005 && passes < (1L << 30)) {
+                passes *= 2;
+                continue;
+            }
+            double ns = seconds * 1e9 / ((double)n * passes);
+            best = trial == 0 ? ns : std::min(best, ns);
+            ++trial;
+        }
+        return best;
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 输入
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static unsigned long long randomState = 0x9E3779B97F4A7C15ull;
+
+static double random01() {
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return (double)((randomState * 0x2545F4914F6CDD1Dull) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double randomRange(double lo, double hi) {
+    return lo + (hi - lo) * random01();
+}
+
+// 10^lo到10^hi之间按数量级均匀分布
+static double randomLog(double lo, double hi) {
+    return pow(10.0, randomRange(lo, hi));
+}
+
+static double randomSign() {
+    return random01() < 0.5 ? -1.0 : 1.0;
+}
+
+static RefVector randomDirection() {
+    RefVector v;
+    double length;
+    do {
+        v.x = randomRange(-1.0, 1.0);
+        v.y = randomRange(-1.0, 1.0);
+        v.z = randomRange(-1.0, 1.0);
+        length = refLength(v);
+    } while (length > 1.0 || length < 1e-3);
+    v.x /= length;
+    v.y /= length;
+    v.z /= length;
+    return v;
+}
+
+static RefQuaternion axisAngle(const RefVector& axis, double theta) {
+    double s = sin(theta * 0.5);
+    RefQuaternion q = {cos(theta * 0.5), axis.x * s, axis.y * s, axis.z * s};
+    return q;
+}
+
+static Vector3 toFloatVector(const RefVector& v) {
+    return Vector3((float)v.x, (float)v.y, (float)v.z);
+}
+
+static Vector3 randomPoint(double range) {
+    return Vector3((float)randomRange(-range, range), (float)randomRange(-range, range), (float)randomRange(-range, range));
+}
+
+// 欧拉角：随机的限制集欧拉角，或者pitch在±90°附近（包括正好为±90°）
+static std::vector<EulerAngles> makeEulerAngles(bool gimbalLock, size_t n) {
+    std::vector<EulerAngles> result(n);
+    for (size_t i = 0; i < n; ++i) {
+        double pitch = randomRange(-kPi * 0.5, kPi * 0.5);
+        if (gimbalLock) {
+            double delta = i % 8 == 0 ? 0.0 : randomLog(-7.0, -2.0);
+            pitch = randomSign() * (kPi * 0.5 - delta);
+        }
+        result[i] = EulerAngles((float)randomRange(-kPi, kPi), (float)pitch, (float)randomRange(-kPi, kPi));
+    }
+    return result;
+}
+
+enum QuaternionInputs {
+    kQuaternionRandom,
+    kQuaternionNearIdentity,
+    kQuaternionNear180,
+    kQuaternionGimbalLock,
+    kQuaternionInputCount
+};
+
+static const char* quaternionInputName(int kind) {
+    static const char* names[] = {"random", "near identity", "near 180deg", "gimbal lock"};
+    return names[kind];
+}
+
+static RefQuaternion makeRefQuaternion(int kind) {
+    switch (kind) {
+        case kQuaternionNearIdentity:
+            return axisAngle(randomDirection(), randomSign() * randomLog(-7.0, -2.0));
+        case kQuaternionNear180:
+            return axisAngle(randomDirection(), kPi + randomSign() * randomLog(-6.0, -1.0));
+        case kQuaternionGimbalLock: {
+            double pitch = randomSign() * (kPi * 0.5 - randomLog(-7.0, -2.0));
+            return refObjectToInertial(randomRange(-kPi, kPi), pitch, randomRange(-kPi, kPi));
+        }
+        default:
+            return axisAngle(randomDirection(), randomRange(0.0, 2.0 * kPi));
+    }
+}
+
+static std::vector<Quaternion> makeQuaternions(int kind, size_t n) {
+    std::vector<Quaternion> result(n);
+    for (size_t i = 0; i < n; ++i) {
+        result[i] = toFloat(makeRefQuaternion(kind));
+    }
+    return result;
+}
+
+enum MatrixInputs {
+    kMatrixRigid,
+    kMatrixUniformScale,
+    kMatrixGeneral,
+    kMatrixNearSingular,
+    kMatrixInputCount
+};
+
+static const char* matrixInputName(int kind) {
+    static const char* names[] = {"rigid", "uniform scale", "general", "near singular"};
+    return names[kind];
+}
+
+/*
+    刚体和均匀缩放按对应的变换分类标记，走inverse()的快速路径；
+    一般矩阵为R1 * diag(s) * R2，接近奇异时s有一个分量在1e-4到1e-2之间
+ */
+static Matrix4x3 makeMatrix(int kind) {
+    RefMatrix a = refFromQuaternion(makeRefQuaternion(kQuaternionRandom));
+    TransformClass transformClass = kTransformRigid;
+
+    if (kind == kMatrixUniformScale) {
+        double k = randomRange(0.5, 2.0);
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                a.m[i][j] *= k;
+            }
+        }
+        transformClass = kTransformUniformScale;
+    } else if (kind == kMatrixGeneral || kind == kMatrixNearSingular) {
+        RefMatrix scale = {{{randomRange(0.5, 2.0), 0.0, 0.0}, {0.0, randomRange(0.5, 2.0), 0.0},
+                            {0.0, 0.0, randomRange(0.5, 2.0)}}, {0.0, 0.0, 0.0}};
+        if (kind == kMatrixNearSingular) {
+            int axis = (int)(random01() * 3.0) % 3;
+            scale.m[axis][axis] = randomLog(-4.0, -2.0);
+        }
+        a = refConcatenate(refConcatenate(a, scale), refFromQuaternion(makeRefQuaternion(kQuaternionRandom)));
+        transformClass = kTransformGeneral;
+    }
+
+    for (int j = 0; j < 3; ++j) {
+        a.t[j] = randomRange(-10.0, 10.0);
+    }
+    return toFloat(a, transformClass);
+}
+
+static std::vector<Matrix4x3> makeMatrices(int kind, size_t n) {
+    std::vector<Matrix4x3> result(n);
+    for (size_t i = 0; i < n; ++i) {
+        result[i] = makeMatrix(kind);
+    }
+    return result;
+}
+
+// 由欧拉角在double中构造的矩阵，舍入为float，作为提取欧拉角和四元数的输入
+static RefMatrix refObjectToWorld(const EulerAngles& e) {
+    return refFromQuaternion(refObjectToInertial(e));
+}
+
+static RefMatrix refWorldToObject(const EulerAngles& e) {
+    return refFromQuaternion(refConjugate(refObjectToInertial(e)));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Vector3和Vector3Stream
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void checkVector3(AccuracyReport& report, size_t n) {
+    std::vector<Vector3> a(n), b(n), parallel(n), out(n);
+    std::vector<float> scalars(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = randomPoint(10.0);
+        b[i] = randomPoint(10.0);
+        // 几乎平行：叉乘的结果远小于输入的大小
+        float k = (float)randomRange(0.5, 2.0);
+        float e = (float)randomLog(-5.0, -2.0);
+        parallel[i] = Vector3(a[i].x * k + e, a[i].y * k - e, a[i].z * k);
+    }
+
+    Vector3Stream sa(n), sb(n), sp(n), sout(n);
+    sa.fromVector3Array(&a[0], n);
+    sb.fromVector3Array(&b[0], n);
+    sp.fromVector3Array(&parallel[0], n);
+
+    // 标准化的参考结果
+    auto normalizeError = [&](size_t i, const Vector3& r) {
+        RefVector v = toRef(a[i]);
+        double k = 1.0 / refLength(v);
+        RefVector ref = {v.x * k, v.y * k, v.z * k};
+        return vectorUlp(r, ref);
+    };
+
+    report.check("Vector3::normalize", "random", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = a[i];
+            out[i].normalize();
+        }
+    }, [&](size_t i) { return normalizeError(i, out[i]); });
+
+    // 就地标准化，每次先复制输入，计时包括复制
+    report.check("normalize (Vector3Stream)", "random", kErrorUlp, n, [&]() {
+        sout = sa;
+        normalize(sout);
+    }, [&](size_t i) { return normalizeError(i, sout.get(i)); });
+
+    report.check("vectorMag", "random", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            scalars[i] = vectorMag(a[i]);
+        }
+    }, [&](size_t i) { return scalarUlp(scalars[i], refLength(toRef(a[i]))); });
+
+    report.check("vectorMag (Vector3Stream)", "random", kErrorUlp, n, [&]() {
+        vectorMag(sa, &scalars[0]);
+    }, [&](size_t i) { return scalarUlp(scalars[i], refLength(toRef(a[i]))); });
+
+    report.check("Vector3::operator* (dot)", "random", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            scalars[i] = a[i] * b[i];
+        }
+    }, [&](size_t i) { return scalarUlp(scalars[i], refDot(toRef(a[i]), toRef(b[i]))); });
+
+    report.check("dotProduct (Vector3Stream)", "random", kErrorUlp, n, [&]() {
+        dotProduct(sa, sb, &scalars[0]);
+    }, [&](size_t i) { return scalarUlp(scalars[i], refDot(toRef(a[i]), toRef(b[i]))); });
+
+    report.check("distance", "random", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            scalars[i] = distance(a[i], b[i]);
+        }
+    }, [&](size_t i) {
+        RefVector d = {(double)a[i].x - b[i].x, (double)a[i].y - b[i].y, (double)a[i].z - b[i].z};
+        return scalarUlp(scalars[i], refLength(d));
+    });
+
+    report.check("distance (Vector3Stream)", "random", kErrorUlp, n, [&]() {
+        distance(sa, sb, &scalars[0]);
+    }, [&](size_t i) {
+        RefVector d = {(double)a[i].x - b[i].x, (double)a[i].y - b[i].y, (double)a[i].z - b[i].z};
+        return scalarUlp(scalars[i], refLength(d));
+    });
+
+    // 叉乘的误差相对于结果的大小，几乎平行时受输入舍入的限制
+    for (int set = 0; set < 2; ++set) {
+        const std::vector<Vector3>& other = set == 0 ? b : parallel;
+        const Vector3Stream& otherStream = set == 0 ? sb : sp;
+        const char* inputs = set == 0 ? "random" : "near parallel";
+
+        report.check("crossProduct", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = crossProduct(a[i], other[i]);
+            }
+        }, [&](size_t i) { return vectorUlp(out[i], refCross(toRef(a[i]), toRef(other[i]))); });
+
+        report.check("crossProduct (Vector3Stream)", inputs, kErrorUlp, n, [&]() {
+            crossProduct(sa, otherStream, sout);
+        }, [&](size_t i) { return vectorUlp(sout.get(i), refCross(toRef(a[i]), toRef(other[i]))); });
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Matrix4x3
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void checkMatrix4x3(AccuracyReport& report, size_t n) {
+    std::vector<Vector3> points(n), out(n);
+    for (size_t i = 0; i < n; ++i) {
+        points[i] = randomPoint(100.0);
+    }
+    Vector3Stream streamIn(n), sout(n);
+    streamIn.fromVector3Array(&points[0], n);
+
+    // 变换点和方向：所有点用同一个一般矩阵
+    Matrix4x3 m = makeMatrix(kMatrixGeneral);
+    RefMatrix refM = toRef(m);
+
+    for (int translate = 1; translate >= 0; --translate) {
+        bool t = translate != 0;
+        auto error = [&](size_t i, const Vector3& r) { return vectorUlp(r, refTransform(toRef(points[i]), refM, t)); };
+
+        if (t) {
+            report.check("operator* (Vector3 * Matrix4x3)", "random", kErrorUlp, n, [&]() {
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = points[i] * m;
+                }
+            }, [&](size_t i) { return error(i, out[i]); });
+        }
+
+        report.check(t ? "transformPoints (array)" : "transformDirections (array)", "random", kErrorUlp, n, [&]() {
+            if (t) {
+                transformPoints(m, &points[0], &out[0], n);
+            } else {
+                transformDirections(m, &points[0], &out[0], n);
+            }
+        }, [&](size_t i) { return error(i, out[i]); });
+
+        report.check(t ? "transformPoints (Vector3Stream)" : "transformDirections (Vector3Stream)", "random",
+                     kErrorUlp, n, [&]() {
+            if (t) {
+                transformPoints(m, streamIn, sout);
+            } else {
+                transformDirections(m, streamIn, sout);
+            }
+        }, [&](size_t i) { return error(i, sout.get(i)); });
+    }
+
+    // 矩阵乘法
+    std::vector<Matrix4x3> a = makeMatrices(kMatrixGeneral, n);
+    std::vector<Matrix4x3> b = makeMatrices(kMatrixGeneral, n);
+    std::vector<Matrix4x3> result(n);
+
+    report.check("operator* (Matrix4x3 * Matrix4x3)", "general", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            result[i] = a[i] * b[i];
+        }
+    }, [&](size_t i) { return matrixUlp(toRef(result[i]), refConcatenate(toRef(a[i]), toRef(b[i]))); });
+
+    report.check("concatenate", "general", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            concatenate(a[i], b[i], result[i]);
+        }
+    }, [&](size_t i) { return matrixUlp(toRef(result[i]), refConcatenate(toRef(a[i]), toRef(b[i]))); });
+
+    // 求逆和行列式，按变换分类走不同的路径；接近奇异时误差随条件数增大
+    std::vector<float> det(n);
+    for (int kind = 0; kind < kMatrixInputCount; ++kind) {
+        std::vector<Matrix4x3> input = makeMatrices(kind, n);
+
+        report.check("inverse (Matrix4x3)", matrixInputName(kind), kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                result[i] = inverse(input[i]);
+            }
+        }, [&](size_t i) { return matrixUlp(toRef(result[i]), refInverse(toRef(input[i]))); });
+
+        if (kind >= kMatrixGeneral) {
+            report.check("determinant", matrixInputName(kind), kErrorUlp, n, [&]() {
+                for (size_t i = 0; i < n; ++i) {
+                    det[i] = determinant(input[i]);
+                }
+            }, [&](size_t i) { return scalarUlp(det[i], refDeterminant(toRef(input[i]))); });
+        }
+    }
+
+    // 由四元数和欧拉角构造
+    for (int kind = 0; kind < kQuaternionInputCount; ++kind) {
+        std::vector<Quaternion> q = makeQuaternions(kind, n);
+        auto error = [&](size_t i) { return matrixUlp(toRef(result[i]), refFromQuaternion(toRef(q[i]))); };
+
+        report.check("Matrix4x3::fromQuaternion", quaternionInputName(kind), kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                result[i].fromQuaternion(q[i]);
+            }
+        }, error);
+
+        report.check("fromQuaternionN", quaternionInputName(kind), kErrorUlp, n, [&]() {
+            fromQuaternionN(&q[0], &result[0], n);
+        }, error);
+    }
+
+    for (int gimbal = 0; gimbal < 2; ++gimbal) {
+        std::vector<EulerAngles> e = makeEulerAngles(gimbal != 0, n);
+        const char* inputs = gimbal ? "gimbal lock" : "random";
+        Vector3 pos(1.0f, -2.0f, 3.0f);
+
+        report.check("Matrix4x3::setupLocalToParent (EulerAngles)", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                result[i].setupLocalToParent(pos, e[i]);
+            }
+        }, [&](size_t i) {
+            RefMatrix ref = refObjectToWorld(e[i]);
+            ref.t[0] = pos.x;
+            ref.t[1] = pos.y;
+            ref.t[2] = pos.z;
+            return matrixUlp(toRef(result[i]), ref);
+        });
+
+        report.check("Matrix4x3::setupParentToLocal (EulerAngles)", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                result[i].setupParentToLocal(pos, e[i]);
+            }
+        }, [&](size_t i) {
+            RefMatrix ref = refObjectToWorld(e[i]);
+            ref.t[0] = pos.x;
+            ref.t[1] = pos.y;
+            ref.t[2] = pos.z;
+            return matrixUlp(toRef(result[i]), refInverse(ref));
+        });
+    }
+
+    // 切变按头文件中的伪代码直接计算参考结果，三个轴各检查一次，分支遗漏break时结果完全错误
+    std::vector<float> shearS(n), shearT(n);
+    for (size_t i = 0; i < n; ++i) {
+        shearS[i] = (float)randomRange(-2.0, 2.0);
+        shearT[i] = (float)randomRange(-2.0, 2.0);
+    }
+    static const char* const shearInputs[3] = {"axis 1 (x)", "axis 2 (y)", "axis 3 (z)"};
+    for (int axis = 1; axis <= 3; ++axis) {
+        report.check("Matrix4x3::setupShear", shearInputs[axis - 1], kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                result[i].setupShear(axis, shearS[i], shearT[i]);
+            }
+        }, [&](size_t i) {
+            RefVector p = toRef(points[i]);
+            double s = shearS[i], t = shearT[i];
+            RefVector ref = p;
+            if (axis == 1) {
+                ref.y += s * p.x;
+                ref.z += t * p.x;
+            } else if (axis == 2) {
+                ref.x += s * p.y;
+                ref.z += t * p.y;
+            } else {
+                ref.x += s * p.z;
+                ref.y += t * p.z;
+            }
+            return vectorUlp(points[i] * result[i], ref);
+        }, kShearBound);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Quaternion
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void checkQuaternion(AccuracyReport& report, size_t n) {
+    std::vector<Quaternion> out(n);
+
+    // 由欧拉角构造
+    for (int gimbal = 0; gimbal < 2; ++gimbal) {
+        std::vector<EulerAngles> e = makeEulerAngles(gimbal != 0, n);
+        const char* inputs = gimbal ? "gimbal lock" : "random";
+        auto objectToInertialError = [&](size_t i) { return angleBetween(toRef(out[i]), refObjectToInertial(e[i])); };
+        auto inertialToObjectError = [&](size_t i) {
+            return angleBetween(toRef(out[i]), refConjugate(refObjectToInertial(e[i])));
+        };
+
+        report.check("Quaternion::setToRotateObjectToInertial", inputs, kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].setToRotateObjectToInertial(e[i]);
+            }
+        }, objectToInertialError);
+        report.check("setToRotateObjectToInertialN", inputs, kErrorRadians, n, [&]() {
+            setToRotateObjectToInertialN(&e[0], &out[0], n);
+        }, objectToInertialError);
+        report.check("Quaternion::setToRotateInertialToObject", inputs, kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].setToRotateInertialToObject(e[i]);
+            }
+        }, inertialToObjectError);
+        report.check("setToRotateInertialToObjectN", inputs, kErrorRadians, n, [&]() {
+            setToRotateInertialToObjectN(&e[0], &out[0], n);
+        }, inertialToObjectError);
+    }
+
+    // 从矩阵提取，接近180°时迹接近-1，必须选别的分量开方
+    for (int kind = 0; kind < kQuaternionInputCount - 1; ++kind) {
+        std::vector<Matrix4x3> m(n);
+        for (size_t i = 0; i < n; ++i) {
+            m[i] = toFloat(refFromQuaternion(makeRefQuaternion(kind)), kTransformRigid);
+        }
+        report.check("Quaternion::fromMatrix", quaternionInputName(kind), kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].fromMatrix(m[i]);
+            }
+        }, [&](size_t i) { return angleBetween(toRef(out[i]), refQuaternionFromMatrix(toRef(m[i]))); });
+    }
+
+    std::vector<Quaternion> a = makeQuaternions(kQuaternionRandom, n);
+    std::vector<Quaternion> b = makeQuaternions(kQuaternionRandom, n);
+
+    report.check("Quaternion::operator*", "random", kErrorRadians, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = a[i] * b[i];
+        }
+    }, [&](size_t i) { return angleBetween(toRef(out[i]), refMultiply(toRef(a[i]), toRef(b[i]))); });
+
+    report.check("inverse (Quaternion)", "random", kErrorRadians, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = inverse(a[i]);
+        }
+    }, [&](size_t i) { return angleBetween(toRef(out[i]), refConjugate(toRef(a[i]))); });
+
+    report.check("diff", "random", kErrorRadians, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = diff(a[i], b[i]);
+        }
+    }, [&](size_t i) { return angleBetween(toRef(out[i]), refMultiply(refConjugate(toRef(a[i])), toRef(b[i]))); });
+
+    // 正则化：输入为长度在0.5到2之间的四元数
+    std::vector<Quaternion> scaled(a);
+    for (size_t i = 0; i < n; ++i) {
+        float k = (float)randomRange(0.5, 2.0);
+        scaled[i].w *= k;
+        scaled[i].x *= k;
+        scaled[i].y *= k;
+        scaled[i].z *= k;
+    }
+    report.check("Quaternion::normalize", "scaled", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = scaled[i];
+            out[i].normalize();
+        }
+    }, [&](size_t i) { return quaternionUlp(out[i], refNormalize(toRef(scaled[i]))); });
+
+    // slerp：随机的两个方位、几乎相同的方位、在相反半球（需要取-q1走最短弧）
+    std::vector<float> t(n);
+    for (size_t i = 0; i < n; ++i) {
+        t[i] = (float)random01();
+    }
+    for (int set = 0; set < 3; ++set) {
+        std::vector<Quaternion> target(b);
+        const char* inputs = "random";
+        if (set > 0) {
+            for (size_t i = 0; i < n; ++i) {
+                double theta = set == 1 ? randomLog(-6.0, -2.0) : randomRange(0.0, kPi);
+                RefQuaternion r = refMultiply(toRef(a[i]), axisAngle(randomDirection(), theta));
+                if (set == 2 && r.w * a[i].w + r.x * a[i].x + r.y * a[i].y + r.z * a[i].z > 0.0) {
+                    r = {-r.w, -r.x, -r.y, -r.z};
+                }
+                target[i] = toFloat(r);
+            }
+            inputs = set == 1 ? "near identical" : "opposite signs";
+        }
+        auto error = [&](size_t i) { return angleBetween(toRef(out[i]), refSlerp(toRef(a[i]), toRef(target[i]), t[i])); };
+
+        report.check("slerp", inputs, kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = slerp(a[i], target[i], t[i]);
+            }
+        }, error);
+        report.check("slerpN (exact)", inputs, kErrorRadians, n, [&]() {
+            slerpN(&a[0], &target[0], &t[0], &out[0], n, kSlerpExact);
+        }, error);
+        report.check("slerpN (fast)", inputs, kErrorRadians, n, [&]() {
+            slerpN(&a[0], &target[0], &t[0], &out[0], n, kSlerpFast);
+        }, error, SLERP_FAST_MAX_ERROR);
+    }
+
+    // 幂、旋转角和旋转轴，接近单位四元数时半角很小
+    std::vector<float> exponent(n), angle(n);
+    std::vector<Vector3> axis(n);
+    for (size_t i = 0; i < n; ++i) {
+        exponent[i] = (float)randomRange(-1.0, 2.0);
+    }
+    for (int kind = 0; kind < 2; ++kind) {
+        std::vector<Quaternion> q = makeQuaternions(kind, n);
+        const char* inputs = quaternionInputName(kind);
+
+        report.check("pow", inputs, kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = pow(q[i], exponent[i]);
+            }
+        }, [&](size_t i) { return angleBetween(toRef(out[i]), refPow(toRef(q[i]), exponent[i])); });
+
+        report.check("Quaternion::getRotationAngles", inputs, kErrorAbsolute, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                angle[i] = q[i].getRotationAngles();
+            }
+        }, [&](size_t i) { return fabs(angle[i] - 2.0 * refHalfAngle(toRef(q[i]))); });
+
+        // 旋转轴按方向的夹角比较
+        report.check("Quaternion::getRotationAxis", inputs, kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                axis[i] = q[i].getRotationAxis();
+            }
+        }, [&](size_t i) {
+            RefVector ref = {q[i].x, q[i].y, q[i].z};
+            RefVector r = toRef(axis[i]);
+            return atan2(refLength(refCross(r, ref)), refDot(r, ref));
+        });
+    }
+
+    // 旋转向量
+    std::vector<Vector3> v(n), rotated(n);
+    for (size_t i = 0; i < n; ++i) {
+        v[i] = randomPoint(10.0);
+    }
+    Vector3Stream sv(n), sout(n);
+    sv.fromVector3Array(&v[0], n);
+    const Quaternion& shared = a[0];
+    RefMatrix sharedMatrix = refFromQuaternion(toRef(shared));
+
+    report.check("rotate", "random", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            rotated[i] = rotate(a[i], v[i]);
+        }
+    }, [&](size_t i) { return vectorUlp(rotated[i], refTransform(toRef(v[i]), refFromQuaternion(toRef(a[i])), false)); });
+
+    report.check("rotateN (per-element quaternion)", "random", kErrorUlp, n, [&]() {
+        rotateN(&a[0], &v[0], &rotated[0], n);
+    }, [&](size_t i) { return vectorUlp(rotated[i], refTransform(toRef(v[i]), refFromQuaternion(toRef(a[i])), false)); });
+
+    report.check("rotateN (shared quaternion array)", "random", kErrorUlp, n, [&]() {
+        rotateN(shared, &v[0], &rotated[0], n);
+    }, [&](size_t i) { return vectorUlp(rotated[i], refTransform(toRef(v[i]), sharedMatrix, false)); });
+
+    report.check("rotateN (shared quaternion Vector3Stream)", "random", kErrorUlp, n, [&]() {
+        rotateN(shared, sv, sout);
+    }, [&](size_t i) { return vectorUlp(sout.get(i), refTransform(toRef(v[i]), sharedMatrix, false)); });
+}
+
+/*
+    压缩四元数编码再解码后与原四元数的夹角，按头文件中给出的最大误差检查
+    四个分量都接近±0.5时最大分量由另外三个的量化误差累积得到，是误差最大的情况
+ */
+template <typename Packed>
+static void checkPackedFormat(AccuracyReport& report, const char* scalarName, const char* batchName, double bound,
+                              const std::vector<Quaternion>& q, const char* inputs) {
+    size_t n = q.size();
+    std::vector<Packed> packed(n);
+    std::vector<Quaternion> out(n);
+    auto error = [&](size_t i) { return angleBetween(toRef(out[i]), toRef(q[i])); };
+
+    report.check(scalarName, inputs, kErrorRadians, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            packed[i].pack(q[i]);
+            out[i] = packed[i].unpack();
+        }
+    }, error, bound);
+    report.check(batchName, inputs, kErrorRadians, n, [&]() {
+        packN(&q[0], &packed[0], n);
+        unpackN(&packed[0], &out[0], n);
+    }, error, bound);
+}
+
+static void checkPackedQuaternion(AccuracyReport& report, size_t n) {
+    for (int set = 0; set < 2; ++set) {
+        std::vector<Quaternion> q = makeQuaternions(kQuaternionRandom, n);
+        if (set == 1) {
+            for (size_t i = 0; i < n; ++i) {
+                RefQuaternion r = {
+                    randomSign() * 0.5 + randomRange(-1e-3, 1e-3), randomSign() * 0.5 + randomRange(-1e-3, 1e-3),
+                    randomSign() * 0.5 + randomRange(-1e-3, 1e-3), randomSign() * 0.5 + randomRange(-1e-3, 1e-3)
+                };
+                q[i] = toFloat(refNormalize(r));
+            }
+        }
+        const char* inputs = set == 0 ? "random" : "all near 0.5";
+        checkPackedFormat<PackedQuaternion32>(report, "PackedQuaternion32 pack/unpack", "packN/unpackN (32)",
+                                              PACKED_QUATERNION32_MAX_ERROR, q, inputs);
+        checkPackedFormat<PackedQuaternion48>(report, "PackedQuaternion48 pack/unpack", "packN/unpackN (48)",
+                                              PACKED_QUATERNION48_MAX_ERROR, q, inputs);
+        checkPackedFormat<PackedQuaternion64>(report, "PackedQuaternion64 pack/unpack", "packN/unpackN (64)",
+                                              PACKED_QUATERNION64_MAX_ERROR, q, inputs);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// QuaternionBlend
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/*
+    blendN：4、8、16个在整个旋转空间中均匀分布的姿态，以及在一个方位附近0.2弧度以内、符号随机的姿态，权重随机
+    参考结果都是双精度的加权平均四元数（refBlend）
+    各姿态相差很大时最大的两个特征值常常接近，正是幂迭代不收敛的情况；
+    lambda2 / lambda1超过0.99的骨骼重新生成，这时平均值本身是病态的，不在头文件给出的上限之内
+    快速模式（nlerp）只在姿态接近时近似平均值，分布很广时只报告误差
+ */
+static void checkBlend(AccuracyReport& report, size_t n) {
+    static const int kPoseCounts[] = {4, 8, 16, 4, 8};
+    static const char* inputNames[] = {"4 spread poses", "8 spread poses", "16 spread poses",
+                                       "4 close poses", "8 close poses"};
+    std::vector<Quaternion> out(n);
+    std::vector<RefQuaternion> ref(n);
+
+    for (int set = 0; set < 5; ++set) {
+        int poseCount = kPoseCounts[set];
+        bool spread = set < 3;
+        std::vector<std::vector<Quaternion> > poses(poseCount, std::vector<Quaternion>(n));
+        std::vector<const Quaternion*> posePointers(poseCount);
+        std::vector<float> weights(poseCount);
+        std::vector<double> refWeights(poseCount);
+        for (int k = 0; k < poseCount; ++k) {
+            weights[k] = (float)randomRange(0.1, 1.0);
+            refWeights[k] = weights[k];
+            posePointers[k] = &poses[k][0];
+        }
+
+        std::vector<RefQuaternion> q(poseCount);
+        for (size_t i = 0; i < n; ++i) {
+            double ratio;
+            do {
+                RefQuaternion center = spread ? kRefIdentity : makeRefQuaternion(kQuaternionRandom);
+                for (int k = 0; k < poseCount; ++k) {
+                    RefQuaternion pose;
+                    if (spread) {
+                        pose = makeRefQuaternion(kQuaternionRandom);
+                    } else {
+                        RefQuaternion offset = axisAngle(randomDirection(), randomRange(0.0, 0.2));
+                        pose = refScale(refMultiply(center, offset), randomSign());
+                    }
+                    poses[k][i] = toFloat(pose);
+                    q[k] = toRef(poses[k][i]);
+                }
+                ref[i] = refBlend(&q[0], &refWeights[0], poseCount, &ratio);
+            } while (ratio > 0.99);
+        }
+        auto error = [&](size_t i) { return angleBetween(toRef(out[i]), ref[i]); };
+
+        report.check("blendN (fast)", inputNames[set], kErrorRadians, n, [&]() {
+            blendN(&posePointers[0], &weights[0], poseCount, &out[0], n, kBlendFast);
+        }, error, spread ? kReportOnly : 0.0);
+        report.check("blendN (accurate)", inputNames[set], kErrorRadians, n, [&]() {
+            blendN(&posePointers[0], &weights[0], poseCount, &out[0], n, kBlendAccurate);
+        }, error, BLEND_ACCURATE_MAX_ERROR);
+    }
+
+    // 叠加层：pose = reference * delta，delta分别为随机旋转、接近单位四元数和接近180°的旋转
+    for (int kind = 0; kind < kQuaternionGimbalLock; ++kind) {
+        const char* inputs = quaternionInputName(kind);
+        std::vector<Quaternion> reference = makeQuaternions(kQuaternionRandom, n), pose(n), delta(n);
+        std::vector<RefQuaternion> refDelta(n);
+        for (size_t i = 0; i < n; ++i) {
+            pose[i] = toFloat(refMultiply(toRef(reference[i]), makeRefQuaternion(kind)));
+            RefQuaternion d = refMultiply(refConjugate(toRef(reference[i])), toRef(pose[i]));
+            refDelta[i] = d.w < 0.0 ? refScale(d, -1.0) : d;
+            delta[i] = toFloat(refNormalize(refDelta[i]));
+        }
+
+        // w必须不为负，否则叠加时沿长路径缩放
+        report.check("additiveDeltaN", inputs, kErrorRadians, n, [&]() {
+            additiveDeltaN(&reference[0], &pose[0], &out[0], n);
+        }, [&](size_t i) { return out[i].w < 0.0f ? INFINITY : angleBetween(toRef(out[i]), refDelta[i]); });
+
+        const float weight = 0.35f;
+        for (size_t i = 0; i < n; ++i) {
+            ref[i] = refMultiply(toRef(reference[i]), refPow(toRef(delta[i]), weight));
+        }
+        report.check("blendAdditiveN (weight 0.35)", inputs, kErrorRadians, n, [&]() {
+            blendAdditiveN(&reference[0], &delta[0], weight, &out[0], n);
+        }, [&](size_t i) { return angleBetween(toRef(out[i]), ref[i]); });
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// QuaternionStream
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// renormalize的默认容差，没有修正的四元数模长平方与1相差不超过它，另外加上计算模长平方时的舍入
+static const float kRenormalizeTolerance = 1e-5f;
+static const double kRenormalizeBound = kRenormalizeTolerance + 1e-6;
+
+static double magnitudeSquaredError(const Quaternion& q) {
+    RefQuaternion r = toRef(q);
+    return fabs(r.w * r.w + r.x * r.x + r.y * r.y + r.z * r.z - 1.0);
+}
+
+/*
+    正则化的输入模长在0.5到2之间；漂移修正的输入模长平方与1相差1e-7到1e-2，一部分在容差以内
+    积分的参考结果在double中按同样的方法计算一步：一阶积分为q + 0.5 * dt * (q * w)，指数映射为q * exp(0.5 * dt * w)
+    输入为每帧1/60秒的一般角速度、每步转过约1弧度以上的大步长，以及接近0的角速度（指数映射的小角度分支）
+ */
+static void checkQuaternionStream(AccuracyReport& report, size_t n) {
+    std::vector<Quaternion> q = makeQuaternions(kQuaternionRandom, n), drifted(n);
+    std::vector<RefQuaternion> ref(n), expected(n);
+    for (size_t i = 0; i < n; ++i) {
+        ref[i] = toRef(q[i]);
+        drifted[i] = toFloat(refScale(ref[i], randomRange(0.5, 2.0)));
+    }
+    QuaternionStream input(n), sout(n);
+    input.fromQuaternionArray(&drifted[0], n);
+
+    report.check("normalize (QuaternionStream)", "|q| in [0.5, 2]", kErrorUlp, n, [&]() {
+        sout = input;
+        normalize(sout);
+    }, [&](size_t i) { return quaternionUlp(sout.get(i), refNormalize(toRef(drifted[i]))); });
+
+    for (size_t i = 0; i < n; ++i) {
+        drifted[i] = toFloat(refScale(ref[i], sqrt(1.0 + randomSign() * randomLog(-7.0, -2.0))));
+    }
+    input.fromQuaternionArray(&drifted[0], n);
+    report.check("renormalize", "|q|^2 - 1 < 1e-2", kErrorAbsolute, n, [&]() {
+        sout = input;
+        renormalize(sout, kRenormalizeTolerance);
+    }, [&](size_t i) { return magnitudeSquaredError(sout.get(i)); }, kRenormalizeBound);
+
+    static const char* inputNames[] = {"dt 1/60", "|w| * dt > 1", "|w| < 1e-5"};
+    static const char* methodNames[] = {"integrateOrientations (first order)", "integrateOrientations (exponential)"};
+    input.fromQuaternionArray(&q[0], n);
+    std::vector<Vector3> omega(n);
+    for (int set = 0; set < 3; ++set) {
+        float dt = set == 1 ? 0.1f : 1.0f / 60.0f;
+        for (size_t i = 0; i < n; ++i) {
+            double speed = set == 0 ? randomRange(0.0, 20.0) : set == 1 ? randomRange(10.0, 30.0) : randomLog(-9.0, -5.0);
+            RefVector axis = randomDirection();
+            omega[i] = Vector3((float)(axis.x * speed), (float)(axis.y * speed), (float)(axis.z * speed));
+        }
+        Vector3Stream omegaStream(n);
+        omegaStream.fromVector3Array(&omega[0], n);
+
+        for (int method = kIntegrateFirstOrder; method <= kIntegrateExponential; ++method) {
+            for (size_t i = 0; i < n; ++i) {
+                RefVector w = toRef(omega[i]);
+                if (method == kIntegrateFirstOrder) {
+                    RefQuaternion pure = {0.0, w.x, w.y, w.z};
+                    RefQuaternion d = refMultiply(ref[i], pure);
+                    double halfDt = 0.5 * dt;
+                    RefQuaternion r = {ref[i].w + halfDt * d.w, ref[i].x + halfDt * d.x,
+                                       ref[i].y + halfDt * d.y, ref[i].z + halfDt * d.z};
+                    expected[i] = r;
+                } else {
+                    double speed = refLength(w);
+                    RefVector axis = {w.x / speed, w.y / speed, w.z / speed};
+                    expected[i] = refMultiply(ref[i], axisAngle(axis, speed * dt));
+                }
+            }
+
+            // 角度误差与模长无关，一阶积分的参考结果不必正则化
+            report.check(methodNames[method], inputNames[set], kErrorRadians, n, [&]() {
+                sout = input;
+                integrateOrientations(sout, omegaStream, dt, (OrientationIntegration)method, kRenormalizeTolerance);
+            }, [&](size_t i) { return angleBetween(toRef(sout.get(i)), expected[i]); });
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// EulerAngles和RotationMatrix
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void checkEulerAngles(AccuracyReport& report, size_t n) {
+    std::vector<EulerAngles> out(n);
+
+    // 结果的欧拉角与输入表示的旋转之间的夹角
+    for (int kind = 0; kind < kQuaternionInputCount; ++kind) {
+        std::vector<Quaternion> q = makeQuaternions(kind, n);
+        const char* inputs = quaternionInputName(kind);
+        auto objectToInertialError = [&](size_t i) { return angleBetween(refObjectToInertial(out[i]), toRef(q[i])); };
+        auto inertialToObjectError = [&](size_t i) {
+            return angleBetween(refConjugate(refObjectToInertial(out[i])), toRef(q[i]));
+        };
+
+        report.check("EulerAngles::fromObjectToInertialQuaternion", inputs, kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].fromObjectToInertialQuaternion(q[i]);
+            }
+        }, objectToInertialError);
+        report.check("fromObjectToInertialQuaternionN (EulerAngles)", inputs, kErrorRadians, n, [&]() {
+            fromObjectToInertialQuaternionN(&q[0], &out[0], n);
+        }, objectToInertialError);
+        report.check("EulerAngles::fromInertialToObjectQuaternion", inputs, kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].fromInertialToObjectQuaternion(q[i]);
+            }
+        }, inertialToObjectError);
+        report.check("fromInertialToObjectQuaternionN (EulerAngles)", inputs, kErrorRadians, n, [&]() {
+            fromInertialToObjectQuaternionN(&q[0], &out[0], n);
+        }, inertialToObjectError);
+    }
+
+    for (int gimbal = 0; gimbal < 2; ++gimbal) {
+        std::vector<EulerAngles> e = makeEulerAngles(gimbal != 0, n);
+        const char* inputs = gimbal ? "gimbal lock" : "random";
+        std::vector<Matrix4x3> objectToWorld(n), worldToObject(n);
+        std::vector<RotationMatrix> rotation(n);
+        for (size_t i = 0; i < n; ++i) {
+            objectToWorld[i] = toFloat(refObjectToWorld(e[i]), kTransformRigid);
+            worldToObject[i] = toFloat(refWorldToObject(e[i]), kTransformRigid);
+            rotation[i] = toRotationMatrix(refWorldToObject(e[i]));
+        }
+        auto objectToWorldError = [&](size_t i) {
+            return angleBetween(refObjectToInertial(out[i]), refQuaternionFromMatrix(toRef(objectToWorld[i])));
+        };
+        auto worldToObjectError = [&](size_t i) {
+            return angleBetween(refConjugate(refObjectToInertial(out[i])), refQuaternionFromMatrix(toRef(worldToObject[i])));
+        };
+        auto rotationError = [&](size_t i) {
+            return angleBetween(refConjugate(refObjectToInertial(out[i])), refQuaternionFromMatrix(toRef(rotation[i])));
+        };
+
+        report.check("EulerAngles::fromObjectToWorldMatrix", inputs, kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].fromObjectToWorldMatrix(objectToWorld[i]);
+            }
+        }, objectToWorldError);
+        report.check("fromObjectToWorldMatrixN", inputs, kErrorRadians, n, [&]() {
+            fromObjectToWorldMatrixN(&objectToWorld[0], &out[0], n);
+        }, objectToWorldError);
+        report.check("EulerAngles::fromWorldToObjectMatrix", inputs, kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].fromWorldToObjectMatrix(worldToObject[i]);
+            }
+        }, worldToObjectError);
+        report.check("fromWorldToObjectMatrixN", inputs, kErrorRadians, n, [&]() {
+            fromWorldToObjectMatrixN(&worldToObject[0], &out[0], n);
+        }, worldToObjectError);
+        report.check("EulerAngles::fromRotationMatrix", inputs, kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].fromRotationMatrix(rotation[i]);
+            }
+        }, rotationError);
+        report.check("fromRotationMatrixN", inputs, kErrorRadians, n, [&]() {
+            fromRotationMatrixN(&rotation[0], &out[0], n);
+        }, rotationError);
+    }
+
+    // 变换为限制集不应改变表示的旋转；万向锁附近pitch为±90°加上2pi的整数倍，两种符号都要覆盖
+    for (int gimbal = 0; gimbal < 2; ++gimbal) {
+        std::vector<EulerAngles> wide(n);
+        for (size_t i = 0; i < n; ++i) {
+            double pitch = randomRange(-4.0 * kPi, 4.0 * kPi);
+            if (gimbal) {
+                double delta = i % 4 == 0 ? 0.0 : randomLog(-7.0, -4.0) * randomSign();
+                pitch = randomSign() * kPi * 0.5 + delta + 2.0 * kPi * (double)((int)randomRange(-2.0, 2.0));
+            }
+            wide[i] = EulerAngles((float)randomRange(-4.0 * kPi, 4.0 * kPi), (float)pitch,
+                                  (float)randomRange(-4.0 * kPi, 4.0 * kPi));
+        }
+        report.check("EulerAngles::canonize", gimbal ? "gimbal lock" : "[-4pi, 4pi]", kErrorRadians, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = wide[i];
+                out[i].canonize();
+            }
+        }, [&](size_t i) { return angleBetween(refObjectToInertial(out[i]), refObjectToInertial(wide[i])); },
+        kCanonizeBound);
+    }
+}
+
+static void checkRotationMatrix(AccuracyReport& report, size_t n) {
+    std::vector<RotationMatrix> out(n);
+
+    for (int gimbal = 0; gimbal < 2; ++gimbal) {
+        std::vector<EulerAngles> e = makeEulerAngles(gimbal != 0, n);
+        const char* inputs = gimbal ? "gimbal lock" : "random";
+        auto error = [&](size_t i) { return matrixUlp(toRef(out[i]), refWorldToObject(e[i])); };
+
+        report.check("RotationMatrix::setup", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].setup(e[i]);
+            }
+        }, error);
+        report.check("setupN", inputs, kErrorUlp, n, [&]() {
+            setupN(&e[0], &out[0], n);
+        }, error);
+    }
+
+    std::vector<Vector3> v(n), rotated(n);
+    for (size_t i = 0; i < n; ++i) {
+        v[i] = randomPoint(10.0);
+    }
+    RotationMatrix m = toRotationMatrix(refFromQuaternion(makeRefQuaternion(kQuaternionRandom)));
+    RefMatrix refM = toRef(m);
+
+    report.check("RotationMatrix::inertialToObject", "random", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            rotated[i] = m.inertialToObject(v[i]);
+        }
+    }, [&](size_t i) { return vectorUlp(rotated[i], refTransform(toRef(v[i]), refM, false)); });
+
+    report.check("inertialToObjectN (shared matrix array)", "random", kErrorUlp, n, [&]() {
+        inertialToObjectN(m, &v[0], &rotated[0], n);
+    }, [&](size_t i) { return vectorUlp(rotated[i], refTransform(toRef(v[i]), refM, false)); });
+
+    // 其余的批量变换：Vector3Stream和每个向量各自的矩阵，物体-惯性变换乘以转置
+    Vector3Stream streamIn(n), sout(n);
+    streamIn.fromVector3Array(&v[0], n);
+    std::vector<RotationMatrix> matrices(n);
+    for (size_t i = 0; i < n; ++i) {
+        matrices[i] = toRotationMatrix(refFromQuaternion(makeRefQuaternion(kQuaternionRandom)));
+    }
+    RefMatrix refTransposeM = refTranspose(refM);
+    auto inertialToObjectError = [&](size_t i, const Vector3& r) {
+        return vectorUlp(r, refTransform(toRef(v[i]), refM, false));
+    };
+    auto objectToInertialError = [&](size_t i, const Vector3& r) {
+        return vectorUlp(r, refTransform(toRef(v[i]), refTransposeM, false));
+    };
+
+    report.check("inertialToObjectN (Vector3Stream)", "random", kErrorUlp, n, [&]() {
+        inertialToObjectN(m, streamIn, sout);
+    }, [&](size_t i) { return inertialToObjectError(i, sout.get(i)); });
+    report.check("inertialToObjectN (matrix per vector)", "random", kErrorUlp, n, [&]() {
+        inertialToObjectN(&matrices[0], &v[0], &rotated[0], n);
+    }, [&](size_t i) { return vectorUlp(rotated[i], refTransform(toRef(v[i]), toRef(matrices[i]), false)); });
+    report.check("RotationMatrix::objectToInertial", "random", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            rotated[i] = m.objectToInertial(v[i]);
+        }
+    }, [&](size_t i) { return objectToInertialError(i, rotated[i]); });
+    report.check("objectToInertialN (shared matrix array)", "random", kErrorUlp, n, [&]() {
+        objectToInertialN(m, &v[0], &rotated[0], n);
+    }, [&](size_t i) { return objectToInertialError(i, rotated[i]); });
+    report.check("objectToInertialN (Vector3Stream)", "random", kErrorUlp, n, [&]() {
+        objectToInertialN(m, streamIn, sout);
+    }, [&](size_t i) { return objectToInertialError(i, sout.get(i)); });
+    report.check("objectToInertialN (matrix per vector)", "random", kErrorUlp, n, [&]() {
+        objectToInertialN(&matrices[0], &v[0], &rotated[0], n);
+    }, [&](size_t i) {
+        return vectorUlp(rotated[i], refTransform(toRef(v[i]), refTranspose(toRef(matrices[i])), false));
+    });
+
+    /*
+        重新正交化：旋转矩阵的每个元素加上drift以内的随机偏差
+        参考结果在double中按同样的方法计算一次，见orthonormalizeN的说明
+     */
+    for (int set = 0; set < 2; ++set) {
+        double drift = set == 0 ? 1e-4 : 1e-2;
+        std::vector<RotationMatrix> drifted(n);
+        std::vector<RefMatrix> ref(n);
+        for (size_t i = 0; i < n; ++i) {
+            RefMatrix a = refFromQuaternion(makeRefQuaternion(kQuaternionRandom));
+            for (int r = 0; r < 3; ++r) {
+                for (int c = 0; c < 3; ++c) {
+                    a.m[r][c] += randomRange(-drift, drift);
+                }
+            }
+            drifted[i] = toRotationMatrix(a);
+            ref[i] = refOrthonormalize(toRef(drifted[i]));
+        }
+        report.check("orthonormalizeN", set == 0 ? "drift 1e-4" : "drift 1e-2", kErrorUlp, n, [&]() {
+            out = drifted;
+            orthonormalizeN(&out[0], n);
+        }, [&](size_t i) { return matrixUlp(toRef(out[i]), ref[i]); });
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// DualQuaternion和蒙皮
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static RefVector randomTranslation(double range) {
+    RefVector t = {randomRange(-range, range), randomRange(-range, range), randomRange(-range, range)};
+    return t;
+}
+
+// 对偶四元数的两部分分别按各自大小的ULP，取较大者
+static double dualQuaternionUlp(const DualQuaternion& r, const RefDualQuaternion& ref) {
+    return std::max(quaternionUlp(r.real, ref.real), quaternionUlp(r.dual, ref.dual));
+}
+
+// q和-q表示同一个变换，与参考结果的real点乘为负时比较-ref
+static RefDualQuaternion alignSign(const RefDualQuaternion& ref, const DualQuaternion& r) {
+    double dot = ref.real.w * r.real.w + ref.real.x * r.real.x + ref.real.y * r.real.y + ref.real.z * r.real.z;
+    if (dot >= 0.0) {
+        return ref;
+    }
+    RefDualQuaternion flipped = {refScale(ref.real, -1.0), refScale(ref.dual, -1.0)};
+    return flipped;
+}
+
+/*
+    各运算的输入都是在double中由随机旋转和平移构造、再舍入为float的刚体变换
+    接近180°的旋转用来检查fromMatrix选择最大分量开方的分支
+ */
+static void checkDualQuaternion(AccuracyReport& report, size_t n) {
+    std::vector<DualQuaternion> out(n);
+    std::vector<Vector3> points(n), result(n);
+    for (size_t i = 0; i < n; ++i) {
+        points[i] = randomPoint(10.0);
+    }
+
+    for (int kind = 0; kind < kQuaternionGimbalLock; ++kind) {
+        const char* inputs = quaternionInputName(kind);
+        std::vector<Quaternion> q = makeQuaternions(kind, n);
+        std::vector<Vector3> t(n);
+        std::vector<DualQuaternion> a(n), b(n);
+        std::vector<Matrix4x3> m(n), mout(n);
+        std::vector<RefDualQuaternion> refA(n), refB(n);
+        for (size_t i = 0; i < n; ++i) {
+            RefVector translation = randomTranslation(10.0);
+            t[i] = Vector3((float)translation.x, (float)translation.y, (float)translation.z);
+            refA[i] = refDualQuaternion(toRef(q[i]), toRef(t[i]));
+            refB[i] = refDualQuaternion(makeRefQuaternion(kQuaternionRandom), randomTranslation(10.0));
+            a[i] = toFloat(refA[i]);
+            b[i] = toFloat(refB[i]);
+            refA[i] = toRef(a[i]);
+            refB[i] = toRef(b[i]);
+            RefMatrix refM = refFromQuaternion(toRef(q[i]));
+            refM.t[0] = t[i].x;
+            refM.t[1] = t[i].y;
+            refM.t[2] = t[i].z;
+            m[i] = toFloat(refM, kTransformRigid);
+        }
+
+        report.check("DualQuaternion::setup", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].setup(q[i], t[i]);
+            }
+        }, [&](size_t i) { return dualQuaternionUlp(out[i], refDualQuaternion(toRef(q[i]), toRef(t[i]))); });
+
+        // 矩阵的参考结果由舍入后的矩阵在double中提取，符号与结果一致
+        auto fromMatrixError = [&](size_t i) {
+            RefMatrix refM = toRef(m[i]);
+            RefVector translation = {refM.t[0], refM.t[1], refM.t[2]};
+            RefDualQuaternion ref = refDualQuaternion(refQuaternionFromMatrix(refM), translation);
+            return dualQuaternionUlp(out[i], alignSign(ref, out[i]));
+        };
+        report.check("DualQuaternion::fromMatrix", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].fromMatrix(m[i]);
+            }
+        }, fromMatrixError);
+        report.check("fromMatrixN (DualQuaternion)", inputs, kErrorUlp, n, [&]() {
+            fromMatrixN(&m[0], &out[0], n);
+        }, fromMatrixError);
+
+        report.check("DualQuaternion::toMatrix", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                a[i].toMatrix(mout[i]);
+            }
+        }, [&](size_t i) { return matrixUlp(toRef(mout[i]), refFromDualQuaternion(refA[i])); });
+
+        report.check("DualQuaternion::operator* (concatenate)", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = a[i] * b[i];
+            }
+        }, [&](size_t i) { return dualQuaternionUlp(out[i], refMultiply(refA[i], refB[i])); });
+
+        report.check("operator* (Vector3, DualQuaternion)", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                result[i] = points[i] * a[i];
+            }
+        }, [&](size_t i) { return vectorUlp(result[i], refTransform(toRef(points[i]), refFromDualQuaternion(refA[i]), true)); });
+
+        report.check("rotateVector (DualQuaternion)", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                result[i] = rotateVector(points[i], a[i]);
+            }
+        }, [&](size_t i) { return vectorUlp(result[i], refTransform(toRef(points[i]), refFromDualQuaternion(refA[i]), false)); });
+    }
+
+    // 正则化的输入：模长在0.5到2之间，dual与real不正交
+    std::vector<DualQuaternion> drifted(n);
+    for (size_t i = 0; i < n; ++i) {
+        RefDualQuaternion dq = refDualQuaternion(makeRefQuaternion(kQuaternionRandom), randomTranslation(10.0));
+        double k = randomRange(0.5, 2.0), e = randomRange(-0.1, 0.1);
+        RefDualQuaternion d = {refScale(dq.real, k), refScale(dq.dual, k)};
+        d.dual.w += e * dq.real.w;
+        d.dual.x += e * dq.real.x;
+        d.dual.y += e * dq.real.y;
+        d.dual.z += e * dq.real.z;
+        drifted[i] = toFloat(d);
+    }
+    report.check("DualQuaternion::normalize", "|real| in [0.5, 2]", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = drifted[i];
+            out[i].normalize();
+        }
+    }, [&](size_t i) {
+        RefDualQuaternion d = toRef(drifted[i]);
+        double magSq = d.real.w * d.real.w + d.real.x * d.real.x + d.real.y * d.real.y + d.real.z * d.real.z;
+        double k = 1.0 / sqrt(magSq);
+        double dot = (d.real.w * d.dual.w + d.real.x * d.dual.x + d.real.y * d.dual.y + d.real.z * d.dual.z) / magSq;
+        RefDualQuaternion ref = {refScale(d.real, k), refScale(d.dual, k)};
+        ref.dual.w -= ref.real.w * dot;
+        ref.dual.x -= ref.real.x * dot;
+        ref.dual.y -= ref.real.y * dot;
+        ref.dual.z -= ref.real.z * dot;
+        return dualQuaternionUlp(out[i], ref);
+    });
+}
+
+/*
+    蒙皮：64个骨骼，每个顶点1到6个影响，超过4个时setVertex只保留权重最大的4个
+    参考结果用网格中保存的权重和骨骼下标，在double中按相同的公式混合后变换：
+    线性混合蒙皮为sum(w * palette)，对偶四元数蒙皮与第一个影响的real点乘为负时取反再混合，除以real的模
+    twisted：每个顶点受两个绕同一轴相差接近180°的骨骼影响，权重接近相等，
+    线性混合的矩阵接近奇异（candy-wrapper），法线的正则化是病态的；对偶四元数混合后real的模约为0.7
+ */
+static const int kSkinningBones = 64;
+
+static void makeSkinnedMesh(SkinnedMesh& mesh, size_t n, bool twisted) {
+    mesh.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        int bones[6];
+        float weights[6];
+        int count = twisted ? 2 : 1 + (int)(random01() * 6.0) % 6;
+        int first = (int)(random01() * kSkinningBones) % kSkinningBones;
+        for (int k = 0; k < count; ++k) {
+            bones[k] = twisted ? (first & ~1) + k : (int)(random01() * kSkinningBones) % kSkinningBones;
+            weights[k] = twisted ? (float)randomRange(0.45, 0.55) : (float)randomRange(0.05, 1.0);
+        }
+        Vector3 normal = toFloatVector(randomDirection());
+        mesh.setVertex(i, randomPoint(2.0), normal, bones, weights, count);
+    }
+}
+
+// 偶数骨骼为随机的刚体变换，四元数的符号随机；twisted时奇数骨骼为前一个骨骼再绕随机轴旋转接近180°，平移相同
+static void makeSkinningPalette(bool twisted, std::vector<RefQuaternion>& rotation,
+                                std::vector<RefVector>& translation) {
+    rotation.resize(kSkinningBones);
+    translation.resize(kSkinningBones);
+    for (int b = 0; b < kSkinningBones; ++b) {
+        rotation[b] = refScale(makeRefQuaternion(kQuaternionRandom), randomSign());
+        translation[b] = randomTranslation(10.0);
+        if (twisted && (b & 1) != 0) {
+            rotation[b] = refMultiply(rotation[b - 1], axisAngle(randomDirection(), kPi - randomLog(-4.0, -1.0)));
+            translation[b] = translation[b - 1];
+        }
+    }
+}
+
+static void checkSkinning(AccuracyReport& report, size_t n) {
+    static const char* linearInputs[] = {"rigid", "general", "twisted"};
+    static const char* dualInputs[] = {"random signs", "twisted"};
+    Vector3Stream positions, normals;
+
+    for (int set = 0; set < 3; ++set) {
+        bool twisted = set == 2;
+        SkinnedMesh mesh;
+        makeSkinnedMesh(mesh, n, twisted);
+        std::vector<RefQuaternion> rotation;
+        std::vector<RefVector> translation;
+        makeSkinningPalette(twisted, rotation, translation);
+        std::vector<Matrix4x3> palette(kSkinningBones);
+        for (int b = 0; b < kSkinningBones; ++b) {
+            if (set == 1) {
+                palette[b] = makeMatrix(kMatrixGeneral);
+                continue;
+            }
+            RefMatrix a = refFromQuaternion(rotation[b]);
+            a.t[0] = translation[b].x;
+            a.t[1] = translation[b].y;
+            a.t[2] = translation[b].z;
+            palette[b] = toFloat(a, kTransformRigid);
+        }
+
+        std::vector<RefVector> refPositions(n), refNormals(n);
+        for (size_t i = 0; i < n; ++i) {
+            RefMatrix blended = {};
+            for (int k = 0; k < mesh.influenceCount(); ++k) {
+                double w = mesh.weights(k)[i];
+                RefMatrix a = toRef(palette[mesh.bones(k)[i]]);
+                for (int r = 0; r < 3; ++r) {
+                    for (int c = 0; c < 3; ++c) {
+                        blended.m[r][c] += w * a.m[r][c];
+                    }
+                    blended.t[r] += w * a.t[r];
+                }
+            }
+            refPositions[i] = refTransform(toRef(mesh.positions().get(i)), blended, true);
+            refNormals[i] = refNormalize(refTransform(toRef(mesh.normals().get(i)), blended, false));
+        }
+
+        report.check("skinVertices (linear)", linearInputs[set], kErrorUlp, n, [&]() {
+            skinVertices(mesh, &palette[0], kSkinningBones, positions, NULL);
+        }, [&](size_t i) { return vectorUlp(positions.get(i), refPositions[i]); });
+        report.check("skinVertices (linear) normals", linearInputs[set], kErrorUlp, n, [&]() {
+            skinVertices(mesh, &palette[0], kSkinningBones, positions, &normals);
+        }, [&](size_t i) { return vectorUlp(normals.get(i), refNormals[i]); });
+    }
+
+    for (int set = 0; set < 2; ++set) {
+        bool twisted = set == 1;
+        SkinnedMesh mesh;
+        makeSkinnedMesh(mesh, n, twisted);
+        std::vector<RefQuaternion> rotation;
+        std::vector<RefVector> translation;
+        makeSkinningPalette(twisted, rotation, translation);
+        std::vector<DualQuaternion> palette(kSkinningBones);
+        for (int b = 0; b < kSkinningBones; ++b) {
+            palette[b] = toFloat(refDualQuaternion(rotation[b], translation[b]));
+        }
+
+        std::vector<RefVector> refPositions(n), refNormals(n);
+        for (size_t i = 0; i < n; ++i) {
+            RefDualQuaternion blended = {};
+            RefQuaternion pivot = toRef(palette[mesh.bones(0)[i]].real);
+            for (int k = 0; k < mesh.influenceCount(); ++k) {
+                RefDualQuaternion dq = toRef(palette[mesh.bones(k)[i]]);
+                double dot = dq.real.w * pivot.w + dq.real.x * pivot.x + dq.real.y * pivot.y + dq.real.z * pivot.z;
+                double w = dot < 0.0 ? -mesh.weights(k)[i] : mesh.weights(k)[i];
+                blended.real.w += w * dq.real.w;
+                blended.real.x += w * dq.real.x;
+                blended.real.y += w * dq.real.y;
+                blended.real.z += w * dq.real.z;
+                blended.dual.w += w * dq.dual.w;
+                blended.dual.x += w * dq.dual.x;
+                blended.dual.y += w * dq.dual.y;
+                blended.dual.z += w * dq.dual.z;
+            }
+            RefMatrix m = refFromDualQuaternion(blended);
+            refPositions[i] = refTransform(toRef(mesh.positions().get(i)), m, true);
+            refNormals[i] = refTransform(toRef(mesh.normals().get(i)), m, false);
+        }
+
+        report.check("skinVertices (dual quaternion)", dualInputs[set], kErrorUlp, n, [&]() {
+            skinVertices(mesh, &palette[0], kSkinningBones, positions, NULL);
+        }, [&](size_t i) { return vectorUlp(positions.get(i), refPositions[i]); });
+        report.check("skinVertices (dual quaternion) normals", dualInputs[set], kErrorUlp, n, [&]() {
+            skinVertices(mesh, &palette[0], kSkinningBones, positions, &normals);
+        }, [&](size_t i) { return vectorUlp(normals.get(i), refNormals[i]); });
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// AABB3、Frustum和BVH
+//
+/////////////////////////////////////////////////////////////////////////////
+
+struct RefBox {
+    RefVector min;
+    RefVector max;
+};
+
+// 与setToTransformedBox相同的方法：中心变换，半尺寸乘以3x3部分各元素的绝对值，参看12.4.4
+static RefBox refTransformBox(const AABB3& box, const RefMatrix& a) {
+    RefVector lo = toRef(box.min), hi = toRef(box.max);
+    RefVector c = {(lo.x + hi.x) * 0.5, (lo.y + hi.y) * 0.5, (lo.z + hi.z) * 0.5};
+    double e[3] = {hi.x - c.x, hi.y - c.y, hi.z - c.z};
+    RefVector center = refTransform(c, a, true);
+    double extent[3];
+    for (int j = 0; j < 3; ++j) {
+        extent[j] = e[0] * fabs(a.m[0][j]) + e[1] * fabs(a.m[1][j]) + e[2] * fabs(a.m[2][j]);
+    }
+    RefBox r = {
+        {center.x - extent[0], center.y - extent[1], center.z - extent[2]},
+        {center.x + extent[0], center.y + extent[1], center.z + extent[2]}
+    };
+    return r;
+}
+
+// 各坐标的最大差，除以min和max中较大的向量长度的ULP；空的边界框变换后必须仍为空
+static double boxUlp(const AABB3& r, const AABB3& input, const RefBox& ref) {
+    if (input.isEmpty()) {
+        return r.isEmpty() ? 0.0 : INFINITY;
+    }
+    double e = std::max(std::max(fabs(r.min.x - ref.min.x), fabs(r.min.y - ref.min.y)), fabs(r.min.z - ref.min.z));
+    e = std::max(e, std::max(std::max(fabs(r.max.x - ref.max.x), fabs(r.max.y - ref.max.y)), fabs(r.max.z - ref.max.z)));
+    return e / floatUlp(std::max(refLength(ref.min), refLength(ref.max)));
+}
+
+/*
+    中心在±50以内，半尺寸在1e-3到10之间；十六分之一是某个轴上尺寸为0的扁平边界框，十六分之一是空的边界框
+    矩阵分别为刚体、一般和接近奇异的变换
+ */
+static AABB3 makeBox(size_t i) {
+    AABB3 box;
+    if (i % 16 == 15) {
+        box.empty();
+        return box;
+    }
+    Vector3 c = randomPoint(50.0);
+    Vector3 e((float)randomLog(-3.0, 1.0), (float)randomLog(-3.0, 1.0), (float)randomLog(-3.0, 1.0));
+    if (i % 16 == 7) {
+        (&e.x)[i / 16 % 3] = 0.0f;
+    }
+    box.min = c - e;
+    box.max = c + e;
+    return box;
+}
+
+static void checkTransformBoxes(AccuracyReport& report, size_t n) {
+    static const int kKinds[] = {kMatrixRigid, kMatrixGeneral, kMatrixNearSingular};
+    std::vector<AABB3> boxes(n), out(n);
+    for (size_t i = 0; i < n; ++i) {
+        boxes[i] = makeBox(i);
+    }
+
+    for (int set = 0; set < 3; ++set) {
+        const char* inputs = matrixInputName(kKinds[set]);
+        Matrix4x3 m = makeMatrix(kKinds[set]);
+        RefMatrix refM = toRef(m);
+        std::vector<Matrix4x3> matrices = makeMatrices(kKinds[set], n);
+        auto error = [&](size_t i) { return boxUlp(out[i], boxes[i], refTransformBox(boxes[i], refM)); };
+
+        report.check("AABB3::setToTransformedBox", inputs, kErrorUlp, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i].setToTransformedBox(boxes[i], m);
+            }
+        }, error, kReportOnly);
+        report.check("transformBoxes (shared matrix)", inputs, kErrorUlp, n, [&]() {
+            transformBoxes(m, &boxes[0], &out[0], n);
+        }, error, kReportOnly);
+        report.check("transformBoxes (matrix per box)", inputs, kErrorUlp, n, [&]() {
+            transformBoxes(&matrices[0], &boxes[0], &out[0], n);
+        }, [&](size_t i) { return boxUlp(out[i], boxes[i], refTransformBox(boxes[i], toRef(matrices[i]))); }, kReportOnly);
+    }
+}
+
+/*
+    视锥裁剪：物体在相机空间中分布在视锥周围，一半是球，一半是边界框
+    参考结果在double中用视锥的平面（float输入）和物体原始的中心、半尺寸计算每个平面的余量s + min(r, 投影半径)，
+    有一个为负时不可见。判断与参考结果不同时，误差为离判定边界最近的余量的绝对值，即物体被误判的距离，相同时为0
+    touching planes：物体移到与某个平面相切的位置，再沿法向量偏移1e-6到1e-2，舍入误差可能改变判断
+ */
+struct CullingInput {
+    RefVector center;
+    RefVector extent;
+    bool sphere;
+};
+
+static double refCullingMargin(const Frustum& frustum, const CullingInput& object) {
+    double margin = INFINITY;
+    for (int k = 0; k < Frustum::kPlaneCount; ++k) {
+        RefVector n = toRef(frustum.normal[k]);
+        double s = refDot(object.center, n) - frustum.distance[k];
+        double projected = fabs(n.x) * object.extent.x + fabs(n.y) * object.extent.y + fabs(n.z) * object.extent.z;
+        margin = std::min(margin, s + (object.sphere ? object.extent.x : projected));
+    }
+    return margin;
+}
+
+static void checkCulling(AccuracyReport& report, size_t n) {
+    Matrix4x3 worldToCamera = makeMatrix(kMatrixRigid);
+    RefMatrix cameraToWorld = refInverse(toRef(worldToCamera));
+    Frustum frustum;
+    frustum.setupPerspective(worldToCamera, 1.0f, 1.6f, 0.5f, 200.0f);
+
+    std::vector<unsigned int> visible(n);
+    std::vector<unsigned char> lastPlane(n), flags(n);
+    std::vector<double> margin(n);
+    for (int set = 0; set < 2; ++set) {
+        const char* inputs = set == 0 ? "random" : "touching planes";
+        CullingSet objects(n);
+        std::vector<CullingInput> input(n);
+        std::vector<AABB3> boxes(n);
+        for (size_t i = 0; i < n; ++i) {
+            RefVector camera = {randomRange(-150.0, 150.0), randomRange(-150.0, 150.0), randomRange(-20.0, 220.0)};
+            RefVector c = refTransform(camera, cameraToWorld, true);
+            CullingInput& object = input[i];
+            object.sphere = i % 2 == 0;
+            double r = randomLog(-2.0, 1.0);
+            RefVector e = {r, r, r};
+            if (!object.sphere) {
+                e.x = randomLog(-2.0, 1.0);
+                e.y = randomLog(-2.0, 1.0);
+                e.z = randomLog(-2.0, 1.0);
+            }
+            object.extent = toRef(toFloatVector(e));
+            if (set == 1) {
+                int k = (int)(random01() * Frustum::kPlaneCount) % Frustum::kPlaneCount;
+                RefVector normal = toRef(frustum.normal[k]);
+                double projected = object.sphere ? object.extent.x : fabs(normal.x) * object.extent.x +
+                                   fabs(normal.y) * object.extent.y + fabs(normal.z) * object.extent.z;
+                double shift = refDot(c, normal) - frustum.distance[k] + projected - randomSign() * randomLog(-6.0, -2.0);
+                c.x -= normal.x * shift;
+                c.y -= normal.y * shift;
+                c.z -= normal.z * shift;
+            }
+            object.center = toRef(toFloatVector(c));
+            if (object.sphere) {
+                objects.setSphere(i, toFloatVector(object.center), (float)object.extent.x);
+            } else {
+                // 边界框的min和max舍入为float后，中心和半尺寸按舍入后的值计算
+                boxes[i].min = toFloatVector(object.center) - toFloatVector(object.extent);
+                boxes[i].max = toFloatVector(object.center) + toFloatVector(object.extent);
+                RefVector lo = toRef(boxes[i].min), hi = toRef(boxes[i].max);
+                RefVector center = {(lo.x + hi.x) * 0.5, (lo.y + hi.y) * 0.5, (lo.z + hi.z) * 0.5};
+                RefVector extent = {hi.x - center.x, hi.y - center.y, hi.z - center.z};
+                object.center = center;
+                object.extent = extent;
+                objects.setBox(i, boxes[i]);
+            }
+            margin[i] = refCullingMargin(frustum, object);
+        }
+        auto error = [&](size_t i) { return (flags[i] != 0) == (margin[i] >= 0.0) ? 0.0 : fabs(margin[i]); };
+        auto toFlags = [&](size_t count) {
+            std::fill(flags.begin(), flags.end(), 0);
+            for (size_t k = 0; k < count; ++k) {
+                flags[visible[k]] = 1;
+            }
+        };
+
+        report.check("Frustum::isVisible", inputs, kErrorAbsolute, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                const CullingInput& object = input[i];
+                flags[i] = object.sphere ? frustum.isVisible(toFloatVector(object.center), (float)object.extent.x)
+                                         : frustum.isVisible(boxes[i]);
+            }
+        }, error);
+
+        // error(i)按i从0开始依次调用，第一次调用时把可见物体的下标展开为标记，不计入时间
+        size_t count = 0;
+        report.check("cull", inputs, kErrorAbsolute, n, [&]() {
+            count = cull(frustum, objects, &visible[0]);
+        }, [&](size_t i) {
+            if (i == 0) {
+                toFlags(count);
+            }
+            return error(i);
+        });
+
+        // 时间相关性：计时的每一遍都使用上一遍记录的平面
+        std::fill(lastPlane.begin(), lastPlane.end(), 0);
+        report.check("cull (lastPlane)", inputs, kErrorAbsolute, n, [&]() {
+            count = cull(frustum, objects, &visible[0], &lastPlane[0]);
+        }, [&](size_t i) {
+            if (i == 0) {
+                toFlags(count);
+            }
+            return error(i);
+        });
+    }
+}
+
+/*
+    BVH的查询与double中逐个测试所有图元的结果比较
+    射线检测：命中同一个球时误差为交点到球面的距离（起点在球内时为交点到起点的距离）；
+    一个命中一个没有，或者命中不同的球时，误差为相关的球离判定边界的距离，即射线所在直线到球心的距离与半径之差、
+    起点或终点到球面的距离中最小的一个，命中不同的球时还可以是两个交点之间的距离
+    grazing：射线经过某个球时与球面的距离在1e-6到1e-2之间，舍入误差可能改变是否命中
+    最近图元：误差为距离之差，距离相同的图元不论选择哪个都是对的
+ */
+static const int kBVHPrimitives = 1024;
+
+// 与BVH中射线与球相交相同的方法，参看13.12
+static bool refRaySphere(const RefVector& o, const RefVector& d, const RefVector& c, double r, double* t) {
+    RefVector m = {o.x - c.x, o.y - c.y, o.z - c.z};
+    double a = refDot(d, d), b = refDot(m, d), mm = refDot(m, m) - r * r;
+    if (mm <= 0.0) {
+        *t = 0.0;
+        return true;
+    }
+    double disc = b * b - a * mm;
+    if (b > 0.0 || disc < 0.0) {
+        return false;
+    }
+    *t = (-b - sqrt(disc)) / a;
+    return *t <= 1.0;
+}
+
+static double rayBoundaryDistance(const RefVector& o, const RefVector& d, const RefVector& c, double r) {
+    RefVector m = {c.x - o.x, c.y - o.y, c.z - o.z};
+    RefVector m1 = {m.x - d.x, m.y - d.y, m.z - d.z};
+    double line = refLength(refCross(m, d)) / refLength(d);
+    return std::min(fabs(line - r), std::min(fabs(refLength(m) - r), fabs(refLength(m1) - r)));
+}
+
+static void checkBVH(AccuracyReport& report, size_t n) {
+    std::vector<Vector3> centers(kBVHPrimitives);
+    std::vector<float> radii(kBVHPrimitives);
+    for (int k = 0; k < kBVHPrimitives; ++k) {
+        centers[k] = randomPoint(100.0);
+        radii[k] = (float)randomRange(0.1, 3.0);
+    }
+    BVH bvh;
+    bvh.build(&centers[0], &radii[0], kBVHPrimitives);
+
+    std::vector<Vector3> origin(n), delta(n);
+    std::vector<BVHRayHit> hits(n);
+    std::vector<int> refPrimitive(n);
+    std::vector<double> refT(n);
+    for (int set = 0; set < 2; ++set) {
+        for (size_t i = 0; i < n; ++i) {
+            RefVector d = randomDirection();
+            double length = randomRange(10.0, 200.0);
+            RefVector o = toRef(randomPoint(100.0));
+            if (set == 1) {
+                // 射线所在直线与某个球面相距gap，起点在球外
+                int k = (int)(random01() * kBVHPrimitives) % kBVHPrimitives;
+                RefVector side = refNormalize(refCross(d, randomDirection()));
+                double gap = radii[k] + randomSign() * randomLog(-6.0, -2.0);
+                double back = randomRange(5.0, 0.5 * length);
+                o.x = centers[k].x + side.x * gap - d.x * back;
+                o.y = centers[k].y + side.y * gap - d.y * back;
+                o.z = centers[k].z + side.z * gap - d.z * back;
+            }
+            origin[i] = toFloatVector(o);
+            delta[i] = Vector3((float)(d.x * length), (float)(d.y * length), (float)(d.z * length));
+
+            refPrimitive[i] = -1;
+            refT[i] = INFINITY;
+            for (int k = 0; k < kBVHPrimitives; ++k) {
+                double t;
+                if (refRaySphere(toRef(origin[i]), toRef(delta[i]), toRef(centers[k]), radii[k], &t) && t < refT[i]) {
+                    refT[i] = t;
+                    refPrimitive[i] = k;
+                }
+            }
+        }
+
+        auto error = [&](size_t i) {
+            const BVHRayHit& hit = hits[i];
+            int k = refPrimitive[i];
+            RefVector o = toRef(origin[i]), d = toRef(delta[i]);
+            if (hit.primitive < 0 && k < 0) {
+                return 0.0;
+            }
+            if (hit.primitive == k) {
+                if (refT[i] == 0.0) {
+                    return hit.t * refLength(d);
+                }
+                // 接近相切时交点参数是病态的，只计交点到球面的距离，不计沿球面的偏差
+                RefVector c = toRef(centers[hit.primitive]);
+                RefVector m = {o.x + d.x * hit.t - c.x, o.y + d.y * hit.t - c.y, o.z + d.z * hit.t - c.z};
+                return fabs(refLength(m) - radii[hit.primitive]);
+            }
+            double e = hit.primitive >= 0 && k >= 0 ? fabs(hit.t - refT[i]) * refLength(d) : INFINITY;
+            if (hit.primitive >= 0) {
+                e = std::min(e, rayBoundaryDistance(o, d, toRef(centers[hit.primitive]), radii[hit.primitive]));
+            }
+            if (k >= 0) {
+                e = std::min(e, rayBoundaryDistance(o, d, toRef(centers[k]), radii[k]));
+            }
+            return e;
+        };
+        const char* inputs = set == 0 ? "random" : "grazing";
+        report.check("BVH::rayCast", inputs, kErrorAbsolute, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                if (!bvh.rayCast(origin[i], delta[i], &hits[i])) {
+                    hits[i].primitive = -1;
+                }
+            }
+        }, error);
+        report.check("rayCastN", inputs, kErrorAbsolute, n, [&]() {
+            rayCastN(bvh, &origin[0], &delta[0], &hits[0], n);
+        }, error);
+    }
+
+    std::vector<Vector3> p(n);
+    std::vector<int> result(n);
+    std::vector<float> distance(n);
+    std::vector<double> refDistance(n);
+    for (int set = 0; set < 2; ++set) {
+        for (size_t i = 0; i < n; ++i) {
+            if (set == 0) {
+                p[i] = randomPoint(120.0);
+            } else {
+                // 某个球面附近，可能在球内
+                int k = (int)(random01() * kBVHPrimitives) % kBVHPrimitives;
+                RefVector d = randomDirection();
+                double r = radii[k] + randomSign() * randomLog(-6.0, -1.0);
+                p[i] = Vector3((float)(centers[k].x + d.x * r), (float)(centers[k].y + d.y * r), (float)(centers[k].z + d.z * r));
+            }
+            refDistance[i] = INFINITY;
+            for (int k = 0; k < kBVHPrimitives; ++k) {
+                RefVector m = {(double)p[i].x - centers[k].x, (double)p[i].y - centers[k].y, (double)p[i].z - centers[k].z};
+                refDistance[i] = std::min(refDistance[i], std::max(refLength(m) - radii[k], 0.0));
+            }
+        }
+
+        auto error = [&](size_t i) { return result[i] < 0 ? INFINITY : fabs(distance[i] - refDistance[i]); };
+        const char* inputs = set == 0 ? "random" : "near surface";
+        report.check("BVH::nearest", inputs, kErrorAbsolute, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                result[i] = bvh.nearest(p[i], FLT_MAX, &distance[i]);
+            }
+        }, error, kReportOnly);
+        report.check("nearestN", inputs, kErrorAbsolute, n, [&]() {
+            nearestN(bvh, &p[0], &result[0], &distance[0], n);
+        }, error, kReportOnly);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// AnimationClip
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/*
+    64个骨骼的片段，每条轨道2到24个关键帧，时间在0到4秒之间随机；每8个骨骼中有一个没有缩放轨道，取默认值
+    每个实例在片段前后各0.2秒以内的随机时间采样，八分之一的实例正好在某个关键帧的时间采样
+    参考结果在double中由原始的关键帧计算：找到时间所在的两个关键帧，旋转与前一个关键帧点乘为负时取反，
+    线性插值后正则化（nlerp），再按先缩放、再旋转、最后平移构造矩阵
+    flipped keys：每个关键帧是前一个关键帧再旋转0.3弧度以内后取反，相邻关键帧的符号总是相反
+ */
+static const int kAnimationBones = 64;
+
+// 正确读取关键帧时误差在几十ulp以内，游标用了重新build()之前的关键帧流时在1e6 ulp以上
+static const double kAnimationBound = 1024.0;
+
+// 一条轨道的关键帧，与AnimationClip::Key相同，旋转的value为w、x、y、z，平移和缩放只用前三个
+struct RefTrack {
+    std::vector<double> time;
+    std::vector<RefQuaternion> value;
+};
+
+static RefQuaternion refSampleTrack(const RefTrack& track, double time, const RefQuaternion& defaultValue,
+                                    bool rotation) {
+    if (track.time.empty()) {
+        return defaultValue;
+    }
+    size_t j = std::upper_bound(track.time.begin(), track.time.end(), time) - track.time.begin();
+    if (j == 0 || j == track.time.size()) {
+        RefQuaternion r = track.value[j == 0 ? 0 : j - 1];
+        return rotation ? refNormalize(r) : r;
+    }
+    RefQuaternion a = track.value[j - 1], b = track.value[j];
+    if (rotation) {
+        a = refNormalize(a);
+        b = refNormalize(b);
+        if (a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z < 0.0) {
+            b = refScale(b, -1.0);
+        }
+    }
+    double alpha = (time - track.time[j - 1]) / (track.time[j] - track.time[j - 1]);
+    RefQuaternion r = {a.w + (b.w - a.w) * alpha, a.x + (b.x - a.x) * alpha,
+                       a.y + (b.y - a.y) * alpha, a.z + (b.z - a.z) * alpha};
+    return rotation ? refNormalize(r) : r;
+}
+
+static void checkAnimation(AccuracyReport& report, size_t n) {
+    size_t jobCount = std::max(n / kAnimationBones, (size_t)1);
+    size_t count = jobCount * kAnimationBones;
+    std::vector<Matrix4x3> locals(count);
+    std::vector<RefMatrix> ref(count);
+
+    for (int set = 0; set < 2; ++set) {
+        bool flipped = set == 1;
+        AnimationClip clip(kAnimationBones);
+        std::vector<RefTrack> tracks(kAnimationBones * AnimationClip::kChannelCount);
+        std::vector<AnimationCursor> cursors(jobCount);
+        for (int bone = 0; bone < kAnimationBones; ++bone) {
+            // 先只用前一半骨骼的关键帧build()并让游标读取一次，再次build()后游标应从头读取
+            if (bone == kAnimationBones / 2) {
+                clip.build();
+                for (size_t j = 0; j < jobCount; ++j) {
+                    cursors[j].seek(clip, 0.0f);
+                }
+            }
+            for (int c = 0; c < AnimationClip::kChannelCount; ++c) {
+                if (c == AnimationClip::kScale && bone % 8 == 7) {
+                    continue;
+                }
+                RefTrack& track = tracks[bone * AnimationClip::kChannelCount + c];
+                int keys = 2 + (int)(random01() * 23.0) % 23;
+                for (int k = 0; k < keys; ++k) {
+                    track.time.push_back(randomRange(0.0, 4.0));
+                }
+                std::sort(track.time.begin(), track.time.end());
+                RefQuaternion q = makeRefQuaternion(kQuaternionRandom);
+                for (int k = 0; k < keys; ++k) {
+                    float time = (float)track.time[k];
+                    track.time[k] = time;
+                    if (c == AnimationClip::kRotation) {
+                        if (k > 0) {
+                            q = flipped ? refScale(refMultiply(q, axisAngle(randomDirection(), randomRange(0.0, 0.3))), -1.0)
+                                        : makeRefQuaternion(kQuaternionRandom);
+                        }
+                        Quaternion key = toFloat(q);
+                        clip.addRotationKey(bone, time, key);
+                        track.value.push_back(toRef(key));
+                        continue;
+                    }
+                    Vector3 v = c == AnimationClip::kTranslation ? randomPoint(10.0)
+                              : Vector3((float)randomRange(0.5, 2.0), (float)randomRange(0.5, 2.0), (float)randomRange(0.5, 2.0));
+                    RefQuaternion value = {v.x, v.y, v.z, 0.0};
+                    if (c == AnimationClip::kTranslation) {
+                        clip.addTranslationKey(bone, time, v);
+                    } else {
+                        clip.addScaleKey(bone, time, v);
+                    }
+                    track.value.push_back(value);
+                }
+            }
+        }
+        clip.build();
+
+        std::vector<AnimationJob> jobs(jobCount);
+        for (size_t j = 0; j < jobCount; ++j) {
+            float time = (float)randomRange(-0.2, clip.duration() + 0.2);
+            if (j % 8 == 0) {
+                const RefTrack& track = tracks[(j / 8) % tracks.size()];
+                time = track.time.empty() ? 0.0f : (float)track.time[(j / 8) % track.time.size()];
+            }
+            AnimationJob job = {&clip, &cursors[j], time, &locals[j * kAnimationBones]};
+            jobs[j] = job;
+
+            static const RefQuaternion kDefaultTranslation = {0.0, 0.0, 0.0, 0.0};
+            static const RefQuaternion kDefaultScale = {1.0, 1.0, 1.0, 0.0};
+            for (int bone = 0; bone < kAnimationBones; ++bone) {
+                const RefTrack* boneTracks = &tracks[bone * AnimationClip::kChannelCount];
+                RefQuaternion q = refSampleTrack(boneTracks[AnimationClip::kRotation], time, kRefIdentity, true);
+                RefQuaternion t = refSampleTrack(boneTracks[AnimationClip::kTranslation], time, kDefaultTranslation, false);
+                RefQuaternion scale = refSampleTrack(boneTracks[AnimationClip::kScale], time, kDefaultScale, false);
+                RefMatrix s = {{{scale.w, 0.0, 0.0}, {0.0, scale.x, 0.0}, {0.0, 0.0, scale.y}}, {0.0, 0.0, 0.0}};
+                RefMatrix m = refConcatenate(s, refFromQuaternion(q));
+                m.t[0] = t.w;
+                m.t[1] = t.x;
+                m.t[2] = t.y;
+                ref[j * kAnimationBones + bone] = m;
+            }
+        }
+
+        report.check("sampleClips", flipped ? "flipped keys" : "random keys", kErrorUlp, count, [&]() {
+            sampleClips(&jobs[0], jobCount);
+        }, [&](size_t i) { return matrixUlp(toRef(locals[i]), ref[i]); }, kAnimationBound);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// MathUtil
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/*
+    MathUtil.h中各精度等级的绝对误差上限，标准库函数按1e-6检查
+    只对参数在主值区间内的输入检查，大参数的sinCos和接近±1的acos只报告
+ */
+#if MATH_ACCURACY == MATH_ACCURACY_FAST
+static const double kTrigBound = 2e-4;
+#else
+static const double kTrigBound = 2e-6;
+#endif
+
+/*
+    平方根倒数和开方的ulp上限，标量版本和批量版本相同
+    FAST等级的mathRsqrt是整数近似初值加两次牛顿迭代，其余情况是直接计算或硬件估计值加一次迭代
+ */
+#if MATH_ACCURACY == MATH_ACCURACY_FAST
+static const double kRsqrtBound = 96.0;
+#else
+static const double kRsqrtBound = 4.0;
+#endif
+
+static void checkMathUtil(AccuracyReport& report, size_t n) {
+    std::vector<float> x(n), y(n), out(n), out2(n);
+
+    for (int set = 0; set < 2; ++set) {
+        const char* inputs = set == 0 ? "[-pi, pi]" : "|x| < 1e4";
+        double range = set == 0 ? kPi : 1e4;
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = (float)randomRange(-range, range);
+        }
+        double bound = set == 0 ? kTrigBound : 0.0;
+        auto error = [&](size_t i) { return std::max(fabs(out[i] - sin((double)x[i])), fabs(out2[i] - cos((double)x[i]))); };
+
+        report.check("sinCos", inputs, kErrorAbsolute, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                sinCos(&out[i], &out2[i], x[i]);
+            }
+        }, error, bound);
+        report.check("sinCosN", inputs, kErrorAbsolute, n, [&]() {
+            sinCosN(&x[0], &out[0], &out2[0], n);
+        }, error, bound);
+    }
+
+    // wrapPi的参考结果按精确的2pi取余，误差随参数增大
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = (float)randomRange(-100.0, 100.0);
+    }
+    auto wrapError = [&](size_t i) {
+        double ref = remainder((double)x[i], 2.0 * M_PI);
+        double e = fabs(out[i] - ref);
+        // 正好在±pi附近时两个结果都对
+        return std::min(e, fabs(e - 2.0 * M_PI));
+    };
+    report.check("wrapPi", "|x| < 100", kErrorAbsolute, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = wrapPi(x[i]);
+        }
+    }, wrapError);
+    report.check("wrapPiN", "|x| < 100", kErrorAbsolute, n, [&]() {
+        wrapPiN(&x[0], &out[0], n);
+    }, wrapError);
+
+    for (int set = 0; set < 2; ++set) {
+        const char* inputs = set == 0 ? "[-1, 1]" : "near +-1";
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = set == 0 ? (float)randomRange(-1.0, 1.0) : (float)(randomSign() * (1.0 - randomLog(-7.0, -1.0)));
+        }
+        double bound = set == 0 ? kTrigBound : 0.0;
+        auto acosError = [&](size_t i) { return fabs(out[i] - acos((double)x[i])); };
+
+        report.check("safeAcos", inputs, kErrorAbsolute, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = safeAcos(x[i]);
+            }
+        }, acosError, bound);
+        report.check("safeAcosN", inputs, kErrorAbsolute, n, [&]() {
+            safeAcosN(&x[0], &out[0], n);
+        }, acosError, bound);
+        report.check("mathAsin", inputs, kErrorAbsolute, n, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = mathAsin(x[i]);
+            }
+        }, [&](size_t i) { return fabs(out[i] - asin((double)x[i])); }, bound);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = (float)randomRange(-10.0, 10.0);
+        y[i] = (float)randomRange(-10.0, 10.0);
+    }
+    auto atanError = [&](size_t i) { return fabs(out[i] - atan2((double)y[i], (double)x[i])); };
+    report.check("mathAtan2", "random", kErrorAbsolute, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = mathAtan2(y[i], x[i]);
+        }
+    }, atanError, kTrigBound);
+    report.check("atan2N", "random", kErrorAbsolute, n, [&]() {
+        atan2N(&y[0], &x[0], &out[0], n);
+    }, atanError, kTrigBound);
+
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = (float)randomLog(-6.0, 6.0);
+    }
+    auto rsqrtError = [&](size_t i) { return scalarUlp(out[i], 1.0 / sqrt((double)x[i])); };
+    report.check("mathRsqrt", "[1e-6, 1e6]", kErrorUlp, n, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = mathRsqrt(x[i]);
+        }
+    }, rsqrtError, kRsqrtBound);
+    report.check("rsqrtN", "[1e-6, 1e6]", kErrorUlp, n, [&]() {
+        rsqrtN(&x[0], &out[0], n);
+    }, rsqrtError, kRsqrtBound);
+    report.check("sqrtN", "[1e-6, 1e6]", kErrorUlp, n, [&]() {
+        sqrtN(&x[0], &out[0], n);
+    }, [&](size_t i) { return scalarUlp(out[i], sqrt((double)x[i])); }, kRsqrtBound);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 命令行
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int runAccuracyCheck(int argc, const char* argv[]) {
+    size_t samples = 65536;
+    const char* filter = NULL;
+    const char* outputPath = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--accuracy") == 0) {
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "missing value for %s\n", arg);
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (strcmp(arg, "--samples") == 0) {
+            samples = std::max((size_t)strtoull(value, NULL, 10), (size_t)1);
+        } else if (strcmp(arg, "--seed") == 0) {
+            randomState = strtoull(value, NULL, 10) | 1u;
+        } else if (strcmp(arg, "--filter") == 0) {
+            filter = value;
+        } else if (strcmp(arg, "--output") == 0) {
+            outputPath = value;
+        } else {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return 2;
+        }
+    }
+
+    printf("MATH_ACCURACY=%d\n", MATH_ACCURACY);
+    printf("%-50s %-16s %10s %10s %-3s %12s\n", "kernel", "inputs", "max", "mean", "", "time");
+
+    AccuracyReport report(filter);
+    checkVector3(report, samples);
+    checkMatrix4x3(report, samples);
+    checkQuaternion(report, samples);
+    checkPackedQuaternion(report, samples);
+    checkBlend(report, samples);
+    checkQuaternionStream(report, samples);
+    checkEulerAngles(report, samples);
+    checkRotationMatrix(report, samples);
+    checkDualQuaternion(report, samples);
+    checkSkinning(report, samples);
+    checkTransformBoxes(report, samples);
+    checkCulling(report, samples);
+    checkBVH(report, samples);
+    checkAnimation(report, samples);
+    checkMathUtil(report, samples);
+
+    if (outputPath != NULL) {
+        FILE* file = fopen(outputPath, "w");
+        if (file == NULL) {
+            fprintf(stderr, "cannot write %s\n", outputPath);
+            return 2;
+        }
+        report.writeCsv(file);
+        fclose(file);
+    }
+
+    int failures = report.failures();
+    printf("%d checks over their documented bound\n", failures);
+    return failures > 0 ? 1 : 0;
+}
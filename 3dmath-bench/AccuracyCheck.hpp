@@ -0,0 +1,38 @@
+//
+//  AccuracyCheck.hpp
+//  3dmath-bench
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef AccuracyCheck_hpp
+#define AccuracyCheck_hpp
+
+/*
+    精度检查
+    对每个操作的各种实现（标量、批量、快速近似），在随机输入和容易出错的输入（万向锁附近、接近单位四元数、
+    接近180°的旋转、接近奇异的矩阵等）上运行，与用double计算的参考结果对比，
+    报告最大和平均误差以及每个元素的纳秒数，用来权衡精度和速度
+
+    误差的单位：
+    ulp：与参考结果的差除以参考值在float中的ULP，向量和矩阵取最大分量的差，除以整个向量（矩阵）大小的ULP
+    rad：旋转之间的夹角（弧度），欧拉角先转换为旋转再比较，因此万向锁附近heading和bank的分配不影响结果
+    abs：绝对误差，用于结果接近0时ULP没有意义的三角函数；视锥裁剪和BVH查询中为误判的物体离判定边界的距离
+
+    头文件中给出了误差上限的实现（如slerpN的快速模式、MATH_ACCURACY的各级近似）按上限检查，超出时报告FAIL
+    其他以弧度计的旋转误差按2e-3检查，这比任何有记录的近似误差都大，超出说明算法本身有错
+    对抗性的输入（如在整个旋转空间中分布的混合姿态）超出近似的适用范围时只报告，结果为NaN或明显错误时仍报告FAIL
+ */
+
+/*
+    命令行入口，性能测试程序带--accuracy参数时调用，参数：
+    --samples n        每组输入的个数，默认65536
+    --seed n           随机数种子
+    --filter name      只检查名字中包含name的项
+    --output file      同时把结果写成CSV，列为kernel,inputs,samples,max_error,mean_error,unit,ns_per_element,bound
+    有超出上限的项时返回1
+ */
+extern int runAccuracyCheck(int argc, const char* argv[]);
+
+#endif /* AccuracyCheck_hpp */
@@ -0,0 +1,354 @@
+//
+//  BenchSuite.cpp
+//  3dmath-bench
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "BenchSuite.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+#include "SimdUtil.h"
+#include "SimdDispatch.hpp"
+#include "ThreadPool.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define BENCH_HAS_TSC 1
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 计时
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static inline unsigned long long readCycles() {
+#if defined(BENCH_HAS_TSC)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static const char* simdName() {
+#if defined(SIMD_AVX) && defined(__FMA__)
+    return "AVX+FMA";
+#elif defined(SIMD_AVX)
+    return "AVX";
+#elif defined(SIMD_SSE)
+    return "SSE";
+#elif defined(SIMD_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+const char* benchSizeName(BenchSize size) {
+    static const char* names[kBenchSizeCount] = {"L1", "L2", "DRAM"};
+    return names[size];
+}
+
+BenchOptions::BenchOptions() {
+    // L1取常见数据缓存的一半，L2取常见二级缓存的一半，留出栈和其他数据的空间
+    workingSet[kBenchL1] = 16 * 1024;
+    workingSet[kBenchL2] = 512 * 1024;
+    workingSet[kBenchDRAM] = 64 * 1024 * 1024;
+    minSeconds = 0.02;
+    trials = 3;
+    filter = NULL;
+    onlySize = kBenchSizeCount;
+}
+
+void BenchSuite::add(const char* name, size_t bytesPerElement, const Kernel& kernel) {
+    Case c;
+    c.name = name;
+    c.bytesPerElement = bytesPerElement;
+    c.kernel = kernel;
+    cases.push_back(c);
+}
+
+/*
+    先把遍数加倍直到一次计时不短于minSeconds，这一次也算作第一次计时，
+    再按同样的遍数计时到trials次，取最快的一次：噪声只会让结果变慢
+ */
+void BenchSuite::run(const BenchOptions& options, std::vector<BenchResult>& results, FILE* log) const {
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const Case& c = cases[i];
+        if (options.filter != NULL && c.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+
+        for (int s = 0; s < kBenchSizeCount; ++s) {
+            if (options.onlySize != kBenchSizeCount && options.onlySize != s) {
+                continue;
+            }
+
+            size_t n = std::max(options.workingSet[s] / c.bytesPerElement, (size_t)1);
+
+            // 预热，同时让测试项准备好输入数据
+            c.kernel(n);
+
+            double bestNs = 0.0;
+            double bestCycles = 0.0;
+            long passes = 1;
+            int trial = 0;
+            while (trial < options.trials) {
+                unsigned long long startCycles = readCycles();
+                auto start = std::chrono::steady_clock::now();
+                for (long p = 0; p < passes; ++p) {
+                    c.kernel(n);
+                }
+                auto end = std::chrono::steady_clock::now();
+                unsigned long long endCycles = readCycles();
+
+                double seconds = std::chrono::duration<double>(end - start).count();
+                if (trial == 0 && seconds < options.minSeconds && passes < (1L << 30)) {
+                    passes *= 2;
+                    continue;
+                }
+
+                double elements = (double)n * passes;
+                double ns = seconds * 1e9 / elements;
+                double cycles = (double)(endCycles - startCycles) / elements;
+                if (trial == 0 || ns < bestNs) {
+                    bestNs = ns;
+                    bestCycles = cycles;
+                }
+                ++trial;
+            }
+
+            BenchResult r;
+            r.name = c.name;
+            r.size = benchSizeName((BenchSize)s);
+            // 编译时的指令集/批量核函数运行时选择的一级
+            r.simd = std::string(simdName()) + "/" + simdTierName(activeSimdTier());
+            r.elements = n;
+            r.nsPerElement = bestNs;
+            r.elementsPerSecond = bestNs > 0.0 ? 1e9 / bestNs : 0.0;
+            r.cyclesPerElement = bestCycles;
+            results.push_back(r);
+
+            if (log != NULL) {
+                fprintf(log, "%-48s %-4s %10zu %10.3f ns %10.3f cycles\n",
+                        r.name.c_str(), r.size.c_str(), r.elements, r.nsPerElement, r.cyclesPerElement);
+            }
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 结果文件
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void writeBenchResults(FILE* file, const std::vector<BenchResult>& results) {
+    fprintf(file, "name,size,simd,elements,ns_per_element,elements_per_sec,cycles_per_element\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        fprintf(file, "%s,%s,%s,%zu,%.4f,%.0f,%.4f\n", r.name.c_str(), r.size.c_str(), r.simd.c_str(),
+                r.elements, r.nsPerElement, r.elementsPerSecond, r.cyclesPerElement);
+    }
+}
+
+// 按逗号拆分一行，名字中没有逗号，不需要处理引号
+static std::vector<std::string> splitFields(const char* line) {
+    std::vector<std::string> fields;
+    std::string field;
+    for (const char* p = line; *p != '\0' && *p != '\n' && *p != '\r'; ++p) {
+        if (*p == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else {
+            field += *p;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+bool readBenchResults(const char* path, std::vector<BenchResult>& results) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    char line[1024];
+    bool header = true;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (header) {
+            header = false;
+            continue;
+        }
+        std::vector<std::string> fields = splitFields(line);
+        if (fields.size() < 7) {
+            continue;
+        }
+
+        BenchResult r;
+        r.name = fields[0];
+        r.size = fields[1];
+        r.simd = fields[2];
+        r.elements = (size_t)strtoull(fields[3].c_str(), NULL, 10);
+        r.nsPerElement = atof(fields[4].c_str());
+        r.elementsPerSecond = atof(fields[5].c_str());
+        r.cyclesPerElement = atof(fields[6].c_str());
+        results.push_back(r);
+    }
+
+    fclose(file);
+    return true;
+}
+
+int compareBenchResults(const std::vector<BenchResult>& previous, const std::vector<BenchResult>& current,
+                        double threshold, FILE* out) {
+    std::map<std::string, const BenchResult*> old;
+    for (size_t i = 0; i < previous.size(); ++i) {
+        old[previous[i].name + "/" + previous[i].size] = &previous[i];
+    }
+
+    int regressions = 0;
+    int improvements = 0;
+    int missing = 0;
+    for (size_t i = 0; i < current.size(); ++i) {
+        const BenchResult& r = current[i];
+        std::map<std::string, const BenchResult*>::const_iterator it = old.find(r.name + "/" + r.size);
+        if (it == old.end()) {
+            ++missing;
+            continue;
+        }
+
+        const BenchResult& p = *it->second;
+        if (p.nsPerElement <= 0.0 || r.nsPerElement <= 0.0) {
+            continue;
+        }
+        double ratio = r.nsPerElement / p.nsPerElement;
+        const char* verdict = NULL;
+        if (ratio > 1.0 + threshold) {
+            verdict = "REGRESSION";
+            ++regressions;
+        } else if (ratio < 1.0 / (1.0 + threshold)) {
+            verdict = "faster";
+            ++improvements;
+        }
+        if (verdict != NULL) {
+            fprintf(out, "%-10s %-48s %-4s %10.3f -> %10.3f ns  %+7.1f%%%s\n", verdict, r.name.c_str(), r.size.c_str(),
+                    p.nsPerElement, r.nsPerElement, (ratio - 1.0) * 100.0,
+                    p.simd == r.simd ? "" : "  (different SIMD)");
+        }
+    }
+
+    fprintf(out, "%d regressions, %d faster, %d not in previous results (threshold %.0f%%)\n",
+            regressions, improvements, missing, threshold * 100.0);
+    return regressions;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 命令行
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// 带一个值的参数
+static bool takesValue(const char* arg) {
+    static const char* options[] = {"--output", "--compare", "--threshold", "--filter", "--size", "--dram-mb", "--threads"};
+    for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); ++i) {
+        if (strcmp(arg, options[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int runBenchSuite(int argc, const char* argv[]) {
+    BenchOptions options;
+    const char* outputPath = NULL;
+    const char* comparePath = NULL;
+    double threshold = 0.1;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool consumed = true;
+        if (strcmp(arg, "--suite") == 0) {
+            consumed = false;
+        } else if (strcmp(arg, "--quick") == 0) {
+            options.trials = 1;
+            options.minSeconds = 0.002;
+            consumed = false;
+        } else if (!takesValue(arg)) {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return 2;
+        } else if (value == NULL) {
+            fprintf(stderr, "missing value for %s\n", arg);
+            return 2;
+        } else if (strcmp(arg, "--output") == 0) {
+            outputPath = value;
+        } else if (strcmp(arg, "--compare") == 0) {
+            comparePath = value;
+        } else if (strcmp(arg, "--threshold") == 0) {
+            threshold = atof(value);
+        } else if (strcmp(arg, "--filter") == 0) {
+            options.filter = value;
+        } else if (strcmp(arg, "--dram-mb") == 0) {
+            options.workingSet[kBenchDRAM] = (size_t)atoi(value) * 1024 * 1024;
+        } else if (strcmp(arg, "--threads") == 0) {
+            ThreadPool::instance().setThreadCount(atoi(value));
+        } else if (strcmp(arg, "--size") == 0) {
+            for (int s = 0; s < kBenchSizeCount; ++s) {
+                if (strcmp(value, benchSizeName((BenchSize)s)) == 0) {
+                    options.onlySize = (BenchSize)s;
+                }
+            }
+            if (options.onlySize == kBenchSizeCount) {
+                fprintf(stderr, "unknown size %s\n", value);
+                return 2;
+            }
+        }
+        if (consumed) {
+            ++i;
+        }
+    }
+
+    // 先读以前的结果，路径错误时不必等测试跑完才发现
+    std::vector<BenchResult> previous;
+    if (comparePath != NULL && !readBenchResults(comparePath, previous)) {
+        fprintf(stderr, "cannot read %s\n", comparePath);
+        return 2;
+    }
+
+    BenchSuite suite;
+    addOperationBenchmarks(suite);
+
+    std::vector<BenchResult> results;
+    suite.run(options, results, stderr);
+
+    if (outputPath != NULL) {
+        FILE* file = fopen(outputPath, "w");
+        if (file == NULL) {
+            fprintf(stderr, "cannot write %s\n", outputPath);
+            return 2;
+        }
+        writeBenchResults(file, results);
+        fclose(file);
+    } else {
+        writeBenchResults(stdout, results);
+    }
+
+    if (comparePath != NULL) {
+        return compareBenchResults(previous, results, threshold, stderr) > 0 ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+//
+//  BenchSuite.hpp
+//  3dmath-bench
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef BenchSuite_hpp
+#define BenchSuite_hpp
+
+#include <stddef.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+    逐项操作的性能测试
+    每个测试项是一个处理前n个元素的函数，按工作集大小分别在L1、L2和内存中测量：
+    n = 工作集字节数 / 每个元素涉及的字节数（输入和输出之和）
+    结果为每个元素的纳秒数、每秒元素数和每个元素的周期数，可以写成CSV，与以前的结果对比找出变慢的项
+ */
+
+// 工作集的档位
+enum BenchSize {
+    kBenchL1,
+    kBenchL2,
+    kBenchDRAM,
+    kBenchSizeCount
+};
+
+extern const char* benchSizeName(BenchSize size);
+
+struct BenchOptions {
+    // 各档位的工作集字节数
+    size_t workingSet[kBenchSizeCount];
+    // 每次计时至少持续的秒数，以及计时的次数（取最快的一次）
+    double minSeconds;
+    int trials;
+    // 只运行名字中包含filter的项，为NULL时全部运行
+    const char* filter;
+    // 只运行某一档，为kBenchSizeCount时全部运行
+    BenchSize onlySize;
+
+    BenchOptions();
+};
+
+/*
+    一项测试在一个档位上的结果
+    cyclesPerElement在x86上用时间戳计数器（TSC）测量，是参考周期而不是核心周期，
+    睿频时与实际周期数有差别；其他平台上为0
+ */
+struct BenchResult {
+    std::string name;
+    std::string size;
+    std::string simd;
+    size_t elements;
+    double nsPerElement;
+    double elementsPerSecond;
+    double cyclesPerElement;
+};
+
+class BenchSuite {
+
+public:
+    typedef std::function<void(size_t n)> Kernel;
+
+    // bytesPerElement为处理一个元素读写的字节数，用于由工作集大小决定元素个数
+    void add(const char* name, size_t bytesPerElement, const Kernel& kernel);
+
+    size_t size() const { return cases.size(); }
+
+    // 依次运行所有测试项，进度写到log（可以为NULL）
+    void run(const BenchOptions& options, std::vector<BenchResult>& results, FILE* log) const;
+
+private:
+    struct Case {
+        std::string name;
+        size_t bytesPerElement;
+        Kernel kernel;
+    };
+
+    std::vector<Case> cases;
+};
+
+// 注册所有Vector3、Matrix4x3、Quaternion、EulerAngles（以及RotationMatrix）的操作，包括批量形式，
+// 以及建立在它们之上的流、压缩格式、混合、对偶四元数、包围盒、裁剪、BVH、求交、蒙皮、动画片段和层级更新
+extern void addOperationBenchmarks(BenchSuite& suite);
+
+// 结果的CSV读写，列为name,size,simd,elements,ns_per_element,elements_per_sec,cycles_per_element
+extern void writeBenchResults(FILE* file, const std::vector<BenchResult>& results);
+extern bool readBenchResults(const char* path, std::vector<BenchResult>& results);
+
+/*
+    按name和size对比两次结果，新结果比旧结果慢超过threshold（0.1表示10%）的记为变慢
+    报告写到out，返回变慢的项数
+ */
+extern int compareBenchResults(const std::vector<BenchResult>& previous, const std::vector<BenchResult>& current,
+                               double threshold, FILE* out);
+
+/*
+    命令行入口，性能测试程序带参数时调用，参数：
+    --suite            只运行逐项测试，没有其他参数时使用
+    --output file      结果写到文件，否则CSV写到标准输出
+    --compare file     与以前的结果对比，有变慢的项时返回1
+    --threshold x      判断变慢的比例，默认0.1
+    --filter name      只运行名字中包含name的项
+    --size L1|L2|DRAM  只运行一档
+    --dram-mb n        内存档的工作集大小，默认64MB，应大于末级缓存
+    --threads n        批量操作使用的线程数
+    --quick            每项只计时一次，时间更短，结果噪声更大
+    进度和对比报告写到标准错误
+ */
+extern int runBenchSuite(int argc, const char* argv[]);
+
+#endif /* BenchSuite_hpp */
@@ -0,0 +1,1233 @@
+//
+//  OperationBench.cpp
+//  3dmath-bench
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "BenchSuite.hpp"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "MathUtil.h"
+#include "Vector3.hpp"
+#include "EulerAngles.hpp"
+#include "Matrix4x3.hpp"
+#include "Quaternion.hpp"
+#include "RotationMatrix.hpp"
+#include "Vector3Stream.hpp"
+#include "QuaternionStream.hpp"
+#include "PackedQuaternion.hpp"
+#include "QuaternionBlend.hpp"
+#include "DualQuaternion.hpp"
+#include "AABB3.hpp"
+#include "Frustum.hpp"
+#include "BVH.hpp"
+#include "Intersection.hpp"
+#include "Skinning.hpp"
+#include "AnimationClip.hpp"
+#include "TransformHierarchy.hpp"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 输入数据
+//
+// 每种类型有几个输入数组，按需要的个数增长，内容是固定种子生成的随机但合法的值，
+// 两次运行的输入相同。输出数组与输入分开，就地修改的操作使用单独的输入数组
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static const int kInputPools = 5;
+
+// 就地修改用的输入数组
+static const int kInPlacePool = 2;
+
+static unsigned int benchSeed = 12345u;
+
+static float randomRange(float lo, float hi) {
+    benchSeed = benchSeed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(benchSeed >> 8) * (1.0f / 16777216.0f);
+}
+
+static EulerAngles randomOrientation() {
+    return EulerAngles(randomRange(-kPi, kPi), randomRange(-kPi * 0.5f, kPi * 0.5f), randomRange(-kPi, kPi));
+}
+
+/*
+    各类型的生成函数，which为输入数组的编号
+    Vector3：1号为单位向量，其余在[-10, 10]的立方体中
+    float：0号和2号为[-2π, 2π]的角度，1号为[0, 1]的插值参数
+    Quaternion、Matrix4x3、RotationMatrix由随机方位构造，Matrix4x3还带有平移
+    AABB3的中心在[-10, 10]的立方体中，半尺寸在[0.1, 2]之间；DualQuaternion由随机方位和平移构造
+ */
+template <typename T>
+T generate(int which);
+
+template <>
+float generate<float>(int which) {
+    return which == 1 ? randomRange(0.0f, 1.0f) : randomRange(-k2Pi, k2Pi);
+}
+
+template <>
+Vector3 generate<Vector3>(int which) {
+    Vector3 v(randomRange(-10.0f, 10.0f), randomRange(-10.0f, 10.0f), randomRange(-10.0f, 10.0f));
+    if (which == 1) {
+        v.normalize();
+    }
+    return v;
+}
+
+template <>
+EulerAngles generate<EulerAngles>(int /* which */) {
+    return randomOrientation();
+}
+
+template <>
+Quaternion generate<Quaternion>(int /* which */) {
+    Quaternion q;
+    q.setToRotateObjectToInertial(randomOrientation());
+    return q;
+}
+
+template <>
+Matrix4x3 generate<Matrix4x3>(int /* which */) {
+    Matrix4x3 m;
+    m.setupLocalToParent(generate<Vector3>(0), randomOrientation());
+    return m;
+}
+
+template <>
+RotationMatrix generate<RotationMatrix>(int /* which */) {
+    RotationMatrix m;
+    m.setup(randomOrientation());
+    return m;
+}
+
+template <>
+AABB3 generate<AABB3>(int /* which */) {
+    Vector3 c = generate<Vector3>(0);
+    Vector3 e(randomRange(0.1f, 2.0f), randomRange(0.1f, 2.0f), randomRange(0.1f, 2.0f));
+    AABB3 box;
+    box.min = c - e;
+    box.max = c + e;
+    return box;
+}
+
+template <>
+DualQuaternion generate<DualQuaternion>(int /* which */) {
+    DualQuaternion dq;
+    dq.setup(generate<Quaternion>(0), generate<Vector3>(0));
+    return dq;
+}
+
+template <typename T>
+static T* input(int which, size_t n) {
+    static std::vector<T> pools[kInputPools];
+    std::vector<T>& pool = pools[which];
+    if (pool.size() < n) {
+        pool.reserve(n);
+        while (pool.size() < n) {
+            pool.push_back(generate<T>(which));
+        }
+    }
+    return &pool[0];
+}
+
+template <typename T>
+static T* output(size_t n, int which = 0) {
+    static std::vector<T> pools[2];
+    std::vector<T>& pool = pools[which];
+    if (pool.size() < n) {
+        pool.resize(n);
+    }
+    return &pool[0];
+}
+
+static Vector3Stream& streamInput(int which, size_t n) {
+    static Vector3Stream streams[kInputPools];
+    Vector3Stream& s = streams[which];
+    if (s.size() != n) {
+        size_t old = s.size();
+        s.resize(n);
+        for (size_t i = old; i < n; ++i) {
+            s.set(i, generate<Vector3>(which));
+        }
+    }
+    return s;
+}
+
+// std::vector<bool>不是bool数组，批量测试的结果单独分配
+static bool* boolOutput(size_t n) {
+    static bool* data = NULL;
+    static size_t size = 0;
+    if (size < n) {
+        delete[] data;
+        data = new bool[n];
+        size = n;
+    }
+    return data;
+}
+
+static Vector3Stream& streamOutput(size_t n) {
+    static Vector3Stream stream;
+    if (stream.size() != n) {
+        stream.resize(n);
+    }
+    return stream;
+}
+
+// 批量操作中所有元素共用的矩阵和四元数
+static const Matrix4x3& sharedMatrix() {
+    static Matrix4x3 m = generate<Matrix4x3>(0);
+    return m;
+}
+
+static const RotationMatrix& sharedRotation() {
+    static RotationMatrix m = generate<RotationMatrix>(0);
+    return m;
+}
+
+static const Quaternion& sharedQuaternion() {
+    static Quaternion q = generate<Quaternion>(0);
+    return q;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 逐个元素的操作
+//
+// 标量操作在循环中对每个元素调用一次，结果写入输出数组，
+// 输入输出都是数组，编译器可以像实际使用时一样内联和向量化
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// out[i] = f(a[i])
+template <typename A, typename R, typename F>
+static void addUnary(BenchSuite& suite, const char* name, F f, int which = 0) {
+    suite.add(name, sizeof(A) + sizeof(R), [f, which](size_t n) {
+        const A* a = input<A>(which, n);
+        R* out = output<R>(n);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = f(a[i]);
+        }
+    });
+}
+
+// out[i] = f(a[i], b[i])
+template <typename A, typename B, typename R, typename F>
+static void addBinary(BenchSuite& suite, const char* name, F f, int whichA = 0, int whichB = 1) {
+    suite.add(name, sizeof(A) + sizeof(B) + sizeof(R), [f, whichA, whichB](size_t n) {
+        const A* a = input<A>(whichA, n);
+        const B* b = input<B>(whichB, n);
+        R* out = output<R>(n);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = f(a[i], b[i]);
+        }
+    });
+}
+
+static void addVector3Benchmarks(BenchSuite& suite) {
+    addBinary<Vector3, Vector3, Vector3>(suite, "Vector3::operator+",
+        [](const Vector3& a, const Vector3& b) { return a + b; });
+    addBinary<Vector3, Vector3, Vector3>(suite, "Vector3::operator-",
+        [](const Vector3& a, const Vector3& b) { return a - b; });
+    addUnary<Vector3, Vector3>(suite, "Vector3::operator- (negate)",
+        [](const Vector3& a) { return -a; });
+    addBinary<Vector3, float, Vector3>(suite, "Vector3::operator* (scalar)",
+        [](const Vector3& a, float k) { return a * k; });
+    addBinary<Vector3, float, Vector3>(suite, "operator* (scalar * Vector3)",
+        [](const Vector3& a, float k) { return k * a; });
+    addBinary<Vector3, float, Vector3>(suite, "Vector3::operator/",
+        [](const Vector3& a, float k) { return a / (k + 1.0f); });
+    addBinary<Vector3, Vector3, Vector3>(suite, "Vector3::operator+=",
+        [](const Vector3& a, const Vector3& b) { Vector3 r = a; r += b; return r; });
+    addBinary<Vector3, Vector3, Vector3>(suite, "Vector3::operator-=",
+        [](const Vector3& a, const Vector3& b) { Vector3 r = a; r -= b; return r; });
+    addBinary<Vector3, float, Vector3>(suite, "Vector3::operator*=",
+        [](const Vector3& a, float k) { Vector3 r = a; r *= k; return r; });
+    addBinary<Vector3, float, Vector3>(suite, "Vector3::operator/=",
+        [](const Vector3& a, float k) { Vector3 r = a; r /= k + 1.0f; return r; });
+    addBinary<Vector3, Vector3, float>(suite, "Vector3::operator==",
+        [](const Vector3& a, const Vector3& b) { return a == b ? 1.0f : 0.0f; });
+    addBinary<Vector3, Vector3, float>(suite, "Vector3::operator!=",
+        [](const Vector3& a, const Vector3& b) { return a != b ? 1.0f : 0.0f; });
+    addBinary<Vector3, Vector3, float>(suite, "Vector3::operator* (dot)",
+        [](const Vector3& a, const Vector3& b) { return a * b; });
+    addUnary<Vector3, Vector3>(suite, "Vector3::zero",
+        [](const Vector3& a) { Vector3 r = a; r.zero(); return r; });
+    addUnary<Vector3, Vector3>(suite, "Vector3::normalize",
+        [](const Vector3& a) { Vector3 r = a; r.normalize(); return r; });
+    addUnary<Vector3, float>(suite, "vectorMag",
+        [](const Vector3& a) { return vectorMag(a); });
+    addBinary<Vector3, Vector3, Vector3>(suite, "crossProduct",
+        [](const Vector3& a, const Vector3& b) { return crossProduct(a, b); });
+    addBinary<Vector3, Vector3, float>(suite, "distance",
+        [](const Vector3& a, const Vector3& b) { return distance(a, b); });
+}
+
+static void addVector3StreamBenchmarks(BenchSuite& suite) {
+    const size_t v = 3 * sizeof(float);
+
+    suite.add("Vector3Stream add", 3 * v, [](size_t n) {
+        add(streamInput(0, n), streamInput(1, n), streamOutput(n));
+    });
+    suite.add("Vector3Stream sub", 3 * v, [](size_t n) {
+        sub(streamInput(0, n), streamInput(1, n), streamOutput(n));
+    });
+    suite.add("Vector3Stream scale", 2 * v, [](size_t n) {
+        scale(streamInput(0, n), 0.5f, streamOutput(n));
+    });
+    suite.add("Vector3Stream crossProduct", 3 * v, [](size_t n) {
+        crossProduct(streamInput(0, n), streamInput(1, n), streamOutput(n));
+    });
+    suite.add("Vector3Stream dotProduct", 2 * v + sizeof(float), [](size_t n) {
+        dotProduct(streamInput(0, n), streamInput(1, n), output<float>(n));
+    });
+    suite.add("Vector3Stream vectorMag", v + sizeof(float), [](size_t n) {
+        vectorMag(streamInput(0, n), output<float>(n));
+    });
+    suite.add("Vector3Stream distance", 2 * v + sizeof(float), [](size_t n) {
+        distance(streamInput(0, n), streamInput(1, n), output<float>(n));
+    });
+    suite.add("Vector3Stream normalize", v, [](size_t n) {
+        normalize(streamInput(kInPlacePool, n));
+    });
+    suite.add("Vector3Stream::fromVector3Array", 2 * v, [](size_t n) {
+        streamOutput(n).fromVector3Array(input<Vector3>(0, n), n);
+    });
+    suite.add("Vector3Stream::toVector3Array", 2 * v, [](size_t n) {
+        streamInput(0, n).toVector3Array(output<Vector3>(n));
+    });
+}
+
+static void addMatrix4x3Benchmarks(BenchSuite& suite) {
+    const size_t v = sizeof(Vector3);
+    const size_t m = sizeof(Matrix4x3);
+
+    addUnary<float, Matrix4x3>(suite, "Matrix4x3::identity",
+        [](float) { Matrix4x3 r; r.identity(); return r; });
+    addUnary<Matrix4x3, Matrix4x3>(suite, "Matrix4x3::zeroTranslation",
+        [](const Matrix4x3& a) { Matrix4x3 r = a; r.zeroTranslation(); return r; });
+    addBinary<Matrix4x3, Vector3, Matrix4x3>(suite, "Matrix4x3::setTranslation",
+        [](const Matrix4x3& a, const Vector3& d) { Matrix4x3 r = a; r.setTranslation(d); return r; });
+    addUnary<Vector3, Matrix4x3>(suite, "Matrix4x3::setupTranslation",
+        [](const Vector3& d) { Matrix4x3 r; r.setupTranslation(d); return r; });
+    addBinary<Vector3, EulerAngles, Matrix4x3>(suite, "Matrix4x3::setupLocalToParent (EulerAngles)",
+        [](const Vector3& p, const EulerAngles& e) { Matrix4x3 r; r.setupLocalToParent(p, e); return r; });
+    addBinary<Vector3, RotationMatrix, Matrix4x3>(suite, "Matrix4x3::setupLocalToParent (RotationMatrix)",
+        [](const Vector3& p, const RotationMatrix& o) { Matrix4x3 r; r.setupLocalToParent(p, o); return r; });
+    addBinary<Vector3, EulerAngles, Matrix4x3>(suite, "Matrix4x3::setupParentToLocal (EulerAngles)",
+        [](const Vector3& p, const EulerAngles& e) { Matrix4x3 r; r.setupParentToLocal(p, e); return r; });
+    addBinary<Vector3, RotationMatrix, Matrix4x3>(suite, "Matrix4x3::setupParentToLocal (RotationMatrix)",
+        [](const Vector3& p, const RotationMatrix& o) { Matrix4x3 r; r.setupParentToLocal(p, o); return r; });
+    addUnary<float, Matrix4x3>(suite, "Matrix4x3::setupRotate (cardinal axis)",
+        [](float theta) { Matrix4x3 r; r.setupRotate(2, theta); return r; });
+    addBinary<Vector3, float, Matrix4x3>(suite, "Matrix4x3::setupRotate (arbitrary axis)",
+        [](const Vector3& axis, float theta) { Matrix4x3 r; r.setupRotate(axis, theta); return r; }, 1, 0);
+    addUnary<Quaternion, Matrix4x3>(suite, "Matrix4x3::fromQuaternion",
+        [](const Quaternion& q) { Matrix4x3 r; r.fromQuaternion(q); return r; });
+    addUnary<Vector3, Matrix4x3>(suite, "Matrix4x3::setupScale",
+        [](const Vector3& s) { Matrix4x3 r; r.setupScale(s); return r; });
+    addBinary<Vector3, float, Matrix4x3>(suite, "Matrix4x3::setupScaleAlongAxis",
+        [](const Vector3& axis, float k) { Matrix4x3 r; r.setupScaleAlongAxis(axis, k); return r; }, 1, 1);
+    addBinary<float, float, Matrix4x3>(suite, "Matrix4x3::setupShear",
+        [](float s, float t) { Matrix4x3 r; r.setupShear(1, s, t); return r; }, 0, 1);
+    addUnary<Vector3, Matrix4x3>(suite, "Matrix4x3::setupProject",
+        [](const Vector3& n) { Matrix4x3 r; r.setupProject(n); return r; }, 1);
+    addUnary<float, Matrix4x3>(suite, "Matrix4x3::setupReflect (cardinal axis)",
+        [](float k) { Matrix4x3 r; r.setupReflect(3, k); return r; });
+    addUnary<Vector3, Matrix4x3>(suite, "Matrix4x3::setupReflect (arbitrary plane)",
+        [](const Vector3& n) { Matrix4x3 r; r.setupReflect(n); return r; }, 1);
+
+    addBinary<Vector3, Matrix4x3, Vector3>(suite, "operator* (Vector3 * Matrix4x3)",
+        [](const Vector3& p, const Matrix4x3& a) { return p * a; }, 0, 0);
+    addBinary<Vector3, Matrix4x3, Vector3>(suite, "operator*= (Vector3 *= Matrix4x3)",
+        [](const Vector3& p, const Matrix4x3& a) { Vector3 r = p; r *= a; return r; }, 0, 0);
+    addBinary<Matrix4x3, Matrix4x3, Matrix4x3>(suite, "operator* (Matrix4x3 * Matrix4x3)",
+        [](const Matrix4x3& a, const Matrix4x3& b) { return a * b; });
+    addBinary<Matrix4x3, Matrix4x3, Matrix4x3>(suite, "operator*= (Matrix4x3 *= Matrix4x3)",
+        [](const Matrix4x3& a, const Matrix4x3& b) { Matrix4x3 r = a; r *= b; return r; });
+    addBinary<Matrix4x3, Matrix4x3, Matrix4x3>(suite, "concatenate",
+        [](const Matrix4x3& a, const Matrix4x3& b) { Matrix4x3 r; concatenate(a, b, r); return r; });
+    addUnary<Matrix4x3, float>(suite, "determinant",
+        [](const Matrix4x3& a) { return determinant(a); });
+    addUnary<Matrix4x3, Matrix4x3>(suite, "inverse (Matrix4x3)",
+        [](const Matrix4x3& a) { return inverse(a); });
+    addUnary<Matrix4x3, Vector3>(suite, "getTranslation",
+        [](const Matrix4x3& a) { return getTranslation(a); });
+    addUnary<Matrix4x3, Vector3>(suite, "getPositionFromParentToLocal",
+        [](const Matrix4x3& a) { return getPositionFromParentToLocal(a); });
+    addUnary<Matrix4x3, Vector3>(suite, "getPositionFromLocalToParent",
+        [](const Matrix4x3& a) { return getPositionFromLocalToParent(a); });
+
+    // 批量形式，所有元素共用一个矩阵
+    suite.add("transformPoints (array)", 2 * v, [](size_t n) {
+        transformPoints(sharedMatrix(), input<Vector3>(0, n), output<Vector3>(n), n);
+    });
+    suite.add("transformPoints (in place)", v, [](size_t n) {
+        transformPoints(sharedMatrix(), input<Vector3>(kInPlacePool, n), n);
+    });
+    suite.add("transformPoints (Vector3Stream)", 2 * v, [](size_t n) {
+        transformPoints(sharedMatrix(), streamInput(0, n), streamOutput(n));
+    });
+    suite.add("transformDirections (array)", 2 * v, [](size_t n) {
+        transformDirections(sharedMatrix(), input<Vector3>(0, n), output<Vector3>(n), n);
+    });
+    suite.add("transformDirections (in place)", v, [](size_t n) {
+        transformDirections(sharedMatrix(), input<Vector3>(kInPlacePool, n), n);
+    });
+    suite.add("transformDirections (Vector3Stream)", 2 * v, [](size_t n) {
+        transformDirections(sharedMatrix(), streamInput(0, n), streamOutput(n));
+    });
+    suite.add("fromQuaternionN", sizeof(Quaternion) + m, [](size_t n) {
+        fromQuaternionN(input<Quaternion>(0, n), output<Matrix4x3>(n), n);
+    });
+}
+
+static void addQuaternionBenchmarks(BenchSuite& suite) {
+    const size_t q = sizeof(Quaternion);
+    const size_t v = sizeof(Vector3);
+
+    addUnary<float, Quaternion>(suite, "Quaternion::identity",
+        [](float) { Quaternion r; r.identity(); return r; });
+    addUnary<float, Quaternion>(suite, "Quaternion::setToRotateAboutX",
+        [](float theta) { Quaternion r; r.setToRotateAboutX(theta); return r; });
+    addUnary<float, Quaternion>(suite, "Quaternion::setToRotateAboutY",
+        [](float theta) { Quaternion r; r.setToRotateAboutY(theta); return r; });
+    addUnary<float, Quaternion>(suite, "Quaternion::setToRotateAboutZ",
+        [](float theta) { Quaternion r; r.setToRotateAboutZ(theta); return r; });
+    addBinary<Vector3, float, Quaternion>(suite, "Quaternion::setToRotateAboutAxis",
+        [](const Vector3& axis, float theta) { Quaternion r; r.setToRotateAboutAxis(axis, theta); return r; }, 1, 0);
+    addUnary<EulerAngles, Quaternion>(suite, "Quaternion::setToRotateObjectToInertial",
+        [](const EulerAngles& e) { Quaternion r; r.setToRotateObjectToInertial(e); return r; });
+    addUnary<EulerAngles, Quaternion>(suite, "Quaternion::setToRotateInertialToObject",
+        [](const EulerAngles& e) { Quaternion r; r.setToRotateInertialToObject(e); return r; });
+    addUnary<Matrix4x3, Quaternion>(suite, "Quaternion::fromMatrix",
+        [](const Matrix4x3& a) { Quaternion r; r.fromMatrix(a); return r; });
+    addBinary<Quaternion, Quaternion, Quaternion>(suite, "Quaternion::operator*",
+        [](const Quaternion& a, const Quaternion& b) { return a * b; });
+    addBinary<Quaternion, Quaternion, Quaternion>(suite, "Quaternion::operator*=",
+        [](const Quaternion& a, const Quaternion& b) { Quaternion r = a; r *= b; return r; });
+    addUnary<Quaternion, Quaternion>(suite, "Quaternion::normalize",
+        [](const Quaternion& a) { Quaternion r = a; r.normalize(); return r; });
+    addUnary<Quaternion, float>(suite, "Quaternion::getRotationAngles",
+        [](const Quaternion& a) { return a.getRotationAngles(); });
+    addUnary<Quaternion, Vector3>(suite, "Quaternion::getRotationAxis",
+        [](const Quaternion& a) { return a.getRotationAxis(); });
+    addBinary<Quaternion, Quaternion, float>(suite, "dotProduct (Quaternion)",
+        [](const Quaternion& a, const Quaternion& b) { return dotProduct(a, b); });
+    addUnary<Quaternion, Quaternion>(suite, "conjugate",
+        [](const Quaternion& a) { return conjugate(a); });
+    addUnary<Quaternion, Quaternion>(suite, "inverse (Quaternion)",
+        [](const Quaternion& a) { return inverse(a); });
+    addBinary<Quaternion, Quaternion, Quaternion>(suite, "diff",
+        [](const Quaternion& a, const Quaternion& b) { return diff(a, b); });
+    addBinary<Quaternion, float, Quaternion>(suite, "pow",
+        [](const Quaternion& a, float e) { return pow(a, e); });
+    addBinary<Quaternion, Vector3, Vector3>(suite, "rotate",
+        [](const Quaternion& a, const Vector3& p) { return rotate(a, p); }, 0, 0);
+
+    suite.add("slerp", 3 * q + sizeof(float), [](size_t n) {
+        const Quaternion* a = input<Quaternion>(0, n);
+        const Quaternion* b = input<Quaternion>(1, n);
+        const float* t = input<float>(1, n);
+        Quaternion* out = output<Quaternion>(n);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = slerp(a[i], b[i], t[i]);
+        }
+    });
+
+    // 批量形式
+    suite.add("slerpN (exact)", 3 * q + sizeof(float), [](size_t n) {
+        slerpN(input<Quaternion>(0, n), input<Quaternion>(1, n), input<float>(1, n), output<Quaternion>(n), n, kSlerpExact);
+    });
+    suite.add("slerpN (fast)", 3 * q + sizeof(float), [](size_t n) {
+        slerpN(input<Quaternion>(0, n), input<Quaternion>(1, n), input<float>(1, n), output<Quaternion>(n), n, kSlerpFast);
+    });
+    suite.add("setToRotateObjectToInertialN", sizeof(EulerAngles) + q, [](size_t n) {
+        setToRotateObjectToInertialN(input<EulerAngles>(0, n), output<Quaternion>(n), n);
+    });
+    suite.add("setToRotateInertialToObjectN", sizeof(EulerAngles) + q, [](size_t n) {
+        setToRotateInertialToObjectN(input<EulerAngles>(0, n), output<Quaternion>(n), n);
+    });
+    suite.add("rotateN (shared quaternion array)", 2 * v, [](size_t n) {
+        rotateN(sharedQuaternion(), input<Vector3>(0, n), output<Vector3>(n), n);
+    });
+    suite.add("rotateN (shared quaternion Vector3Stream)", 2 * v, [](size_t n) {
+        rotateN(sharedQuaternion(), streamInput(0, n), streamOutput(n));
+    });
+    suite.add("rotateN (per-element quaternion)", q + 2 * v, [](size_t n) {
+        rotateN(input<Quaternion>(0, n), input<Vector3>(0, n), output<Vector3>(n), n);
+    });
+}
+
+static void addEulerAnglesBenchmarks(BenchSuite& suite) {
+    const size_t e = sizeof(EulerAngles);
+
+    addUnary<float, EulerAngles>(suite, "EulerAngles::identity",
+        [](float) { EulerAngles r; r.identity(); return r; });
+    addBinary<float, float, EulerAngles>(suite, "EulerAngles::canonize",
+        [](float h, float p) { EulerAngles r(h, p, h - p); r.canonize(); return r; }, 0, 2);
+    addUnary<Quaternion, EulerAngles>(suite, "EulerAngles::fromObjectToInertialQuaternion",
+        [](const Quaternion& q) { EulerAngles r; r.fromObjectToInertialQuaternion(q); return r; });
+    addUnary<Quaternion, EulerAngles>(suite, "EulerAngles::fromInertialToObjectQuaternion",
+        [](const Quaternion& q) { EulerAngles r; r.fromInertialToObjectQuaternion(q); return r; });
+    addUnary<Matrix4x3, EulerAngles>(suite, "EulerAngles::fromObjectToWorldMatrix",
+        [](const Matrix4x3& m) { EulerAngles r; r.fromObjectToWorldMatrix(m); return r; });
+    addUnary<Matrix4x3, EulerAngles>(suite, "EulerAngles::fromWorldToObjectMatrix",
+        [](const Matrix4x3& m) { EulerAngles r; r.fromWorldToObjectMatrix(m); return r; });
+    addUnary<RotationMatrix, EulerAngles>(suite, "EulerAngles::fromRotationMatrix",
+        [](const RotationMatrix& m) { EulerAngles r; r.fromRotationMatrix(m); return r; });
+
+    // 批量形式
+    suite.add("fromObjectToInertialQuaternionN (EulerAngles)", sizeof(Quaternion) + e, [](size_t n) {
+        fromObjectToInertialQuaternionN(input<Quaternion>(0, n), output<EulerAngles>(n), n);
+    });
+    suite.add("fromInertialToObjectQuaternionN (EulerAngles)", sizeof(Quaternion) + e, [](size_t n) {
+        fromInertialToObjectQuaternionN(input<Quaternion>(0, n), output<EulerAngles>(n), n);
+    });
+    suite.add("fromObjectToWorldMatrixN", sizeof(Matrix4x3) + e, [](size_t n) {
+        fromObjectToWorldMatrixN(input<Matrix4x3>(0, n), output<EulerAngles>(n), n);
+    });
+    suite.add("fromWorldToObjectMatrixN", sizeof(Matrix4x3) + e, [](size_t n) {
+        fromWorldToObjectMatrixN(input<Matrix4x3>(0, n), output<EulerAngles>(n), n);
+    });
+    suite.add("fromRotationMatrixN", sizeof(RotationMatrix) + e, [](size_t n) {
+        fromRotationMatrixN(input<RotationMatrix>(0, n), output<EulerAngles>(n), n);
+    });
+}
+
+static void addRotationMatrixBenchmarks(BenchSuite& suite) {
+    const size_t r = sizeof(RotationMatrix);
+    const size_t v = sizeof(Vector3);
+
+    addUnary<EulerAngles, RotationMatrix>(suite, "RotationMatrix::setup",
+        [](const EulerAngles& e) { RotationMatrix m; m.setup(e); return m; });
+    addUnary<Quaternion, RotationMatrix>(suite, "RotationMatrix::fromInertialToObjectQuaternion",
+        [](const Quaternion& q) { RotationMatrix m; m.fromInertialToObjectQuaternion(q); return m; });
+    addUnary<Quaternion, RotationMatrix>(suite, "RotationMatrix::fromObjectToInertialQuaternion",
+        [](const Quaternion& q) { RotationMatrix m; m.fromObjectToInertialQuaternion(q); return m; });
+    addBinary<RotationMatrix, Vector3, Vector3>(suite, "RotationMatrix::inertialToObject",
+        [](const RotationMatrix& m, const Vector3& p) { return m.inertialToObject(p); }, 0, 0);
+    addBinary<RotationMatrix, Vector3, Vector3>(suite, "RotationMatrix::objectToInertial",
+        [](const RotationMatrix& m, const Vector3& p) { return m.objectToInertial(p); }, 0, 0);
+
+    suite.add("setupN", sizeof(EulerAngles) + r, [](size_t n) {
+        setupN(input<EulerAngles>(0, n), output<RotationMatrix>(n), n);
+    });
+    suite.add("fromInertialToObjectQuaternionN (RotationMatrix)", sizeof(Quaternion) + r, [](size_t n) {
+        fromInertialToObjectQuaternionN(input<Quaternion>(0, n), output<RotationMatrix>(n), n);
+    });
+    suite.add("fromObjectToInertialQuaternionN (RotationMatrix)", sizeof(Quaternion) + r, [](size_t n) {
+        fromObjectToInertialQuaternionN(input<Quaternion>(0, n), output<RotationMatrix>(n), n);
+    });
+    suite.add("orthonormalizeN", r, [](size_t n) {
+        orthonormalizeN(input<RotationMatrix>(kInPlacePool, n), n);
+    });
+    suite.add("inertialToObjectN (shared matrix array)", 2 * v, [](size_t n) {
+        inertialToObjectN(sharedRotation(), input<Vector3>(0, n), output<Vector3>(n), n);
+    });
+    suite.add("objectToInertialN (shared matrix array)", 2 * v, [](size_t n) {
+        objectToInertialN(sharedRotation(), input<Vector3>(0, n), output<Vector3>(n), n);
+    });
+    suite.add("inertialToObjectN (shared matrix Vector3Stream)", 2 * v, [](size_t n) {
+        inertialToObjectN(sharedRotation(), streamInput(0, n), streamOutput(n));
+    });
+    suite.add("objectToInertialN (shared matrix Vector3Stream)", 2 * v, [](size_t n) {
+        objectToInertialN(sharedRotation(), streamInput(0, n), streamOutput(n));
+    });
+    suite.add("inertialToObjectN (per-element matrix)", r + 2 * v, [](size_t n) {
+        inertialToObjectN(input<RotationMatrix>(0, n), input<Vector3>(0, n), output<Vector3>(n), n);
+    });
+    suite.add("objectToInertialN (per-element matrix)", r + 2 * v, [](size_t n) {
+        objectToInertialN(input<RotationMatrix>(0, n), input<Vector3>(0, n), output<Vector3>(n), n);
+    });
+}
+
+// 上面各类用到的MathUtil函数
+static void addMathUtilBenchmarks(BenchSuite& suite) {
+    const size_t f = sizeof(float);
+
+    addUnary<float, float>(suite, "wrapPi", [](float x) { return wrapPi(x); });
+    addUnary<float, float>(suite, "safeAcos", [](float x) { return safeAcos(x); }, 1);
+    addUnary<float, float>(suite, "mathAcos", [](float x) { return mathAcos(x); }, 1);
+    addUnary<float, float>(suite, "mathAsin", [](float x) { return mathAsin(x); }, 1);
+    addBinary<float, float, float>(suite, "mathAtan2", [](float y, float x) { return mathAtan2(y, x); }, 0, 2);
+    addUnary<float, float>(suite, "mathRsqrt", [](float x) { return mathRsqrt(x); }, 1);
+    addUnary<float, float>(suite, "sinCos", [](float x) {
+        float s, c;
+        sinCos(&s, &c, x);
+        return s + c;
+    });
+
+    suite.add("sinCosN", 3 * f, [](size_t n) {
+        sinCosN(input<float>(0, n), output<float>(n, 0), output<float>(n, 1), n);
+    });
+    suite.add("wrapPiN", 2 * f, [](size_t n) {
+        wrapPiN(input<float>(0, n), output<float>(n), n);
+    });
+    suite.add("safeAcosN", 2 * f, [](size_t n) {
+        safeAcosN(input<float>(1, n), output<float>(n), n);
+    });
+    suite.add("atan2N", 3 * f, [](size_t n) {
+        atan2N(input<float>(0, n), input<float>(2, n), output<float>(n), n);
+    });
+    suite.add("sqrtN", 2 * f, [](size_t n) {
+        sqrtN(input<float>(1, n), output<float>(n), n);
+    });
+    suite.add("rsqrtN", 2 * f, [](size_t n) {
+        rsqrtN(input<float>(1, n), output<float>(n), n);
+    });
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 建立在上面各类之上的模块
+//
+// 需要预先构造的数据（网格、层次、BVH、动画片段等）按元素个数缓存，个数变化时重新构造，
+// 构造在预热调用中完成，不计入时间
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void addQuaternionStreamBenchmarks(BenchSuite& suite) {
+    const size_t q = 4 * sizeof(float);
+    const size_t v = 3 * sizeof(float);
+
+    // 积分和漂移修正就地修改，结果保持为单位四元数附近，可以反复使用
+    static QuaternionStream orientations;
+    auto orientationInput = [](size_t n) -> QuaternionStream& {
+        if (orientations.size() != n) {
+            orientations.fromQuaternionArray(input<Quaternion>(0, n), n);
+        }
+        return orientations;
+    };
+
+    suite.add("integrateOrientations (first order)", q + v, [orientationInput](size_t n) {
+        integrateOrientations(orientationInput(n), streamInput(1, n), 1.0f / 60.0f, kIntegrateFirstOrder);
+    });
+    suite.add("integrateOrientations (exponential)", q + v, [orientationInput](size_t n) {
+        integrateOrientations(orientationInput(n), streamInput(1, n), 1.0f / 60.0f, kIntegrateExponential);
+    });
+    suite.add("renormalize (QuaternionStream)", q, [orientationInput](size_t n) {
+        renormalize(orientationInput(n));
+    });
+    suite.add("normalize (QuaternionStream)", q, [orientationInput](size_t n) {
+        normalize(orientationInput(n));
+    });
+    suite.add("QuaternionStream::fromQuaternionArray", 2 * q, [](size_t n) {
+        static QuaternionStream stream;
+        stream.fromQuaternionArray(input<Quaternion>(0, n), n);
+    });
+    suite.add("QuaternionStream::toQuaternionArray", 2 * q, [orientationInput](size_t n) {
+        orientationInput(n).toQuaternionArray(output<Quaternion>(n));
+    });
+}
+
+// 解码的输入，由0号四元数数组编码得到
+template <typename P>
+static const P* packedInput(size_t n) {
+    static std::vector<P> packed;
+    if (packed.size() < n) {
+        packed.resize(n);
+        packN(input<Quaternion>(0, n), &packed[0], n);
+    }
+    return &packed[0];
+}
+
+template <typename P>
+static void addPackedFormatBenchmarks(BenchSuite& suite, const char* type) {
+    const size_t q = sizeof(Quaternion);
+
+    addUnary<Quaternion, P>(suite, (std::string(type) + "::pack").c_str(),
+        [](const Quaternion& a) { P r; r.pack(a); return r; });
+    suite.add((std::string(type) + "::unpack").c_str(), sizeof(P) + q, [](size_t n) {
+        const P* a = packedInput<P>(n);
+        Quaternion* out = output<Quaternion>(n);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = a[i].unpack();
+        }
+    });
+    suite.add((std::string("packN (") + type + ")").c_str(), q + sizeof(P), [](size_t n) {
+        packN(input<Quaternion>(0, n), output<P>(n), n);
+    });
+    suite.add((std::string("unpackN (") + type + ")").c_str(), sizeof(P) + q, [](size_t n) {
+        unpackN(packedInput<P>(n), output<Quaternion>(n), n);
+    });
+}
+
+static void addPackedQuaternionBenchmarks(BenchSuite& suite) {
+    addPackedFormatBenchmarks<PackedQuaternion32>(suite, "PackedQuaternion32");
+    addPackedFormatBenchmarks<PackedQuaternion48>(suite, "PackedQuaternion48");
+    addPackedFormatBenchmarks<PackedQuaternion64>(suite, "PackedQuaternion64");
+}
+
+/*
+    混合4个姿态，使用0、1、3、4号四元数数组（2号留给就地修改），每个骨骼读4个姿态、写一个结果
+ */
+static void addQuaternionBlendBenchmarks(BenchSuite& suite) {
+    const size_t q = sizeof(Quaternion);
+    static const float weights[4] = {0.4f, 0.3f, 0.2f, 0.1f};
+
+    auto blend = [](size_t n, BlendAccuracy accuracy) {
+        const Quaternion* poses[4] = {
+            input<Quaternion>(0, n), input<Quaternion>(1, n), input<Quaternion>(3, n), input<Quaternion>(4, n)
+        };
+        blendN(poses, weights, 4, output<Quaternion>(n), n, accuracy);
+    };
+    suite.add("blendN (4 poses, fast)", 5 * q, [blend](size_t n) {
+        blend(n, kBlendFast);
+    });
+    suite.add("blendN (4 poses, accurate)", 5 * q, [blend](size_t n) {
+        blend(n, kBlendAccurate);
+    });
+    suite.add("additiveDeltaN", 3 * q, [](size_t n) {
+        additiveDeltaN(input<Quaternion>(0, n), input<Quaternion>(1, n), output<Quaternion>(n), n);
+    });
+    suite.add("blendAdditiveN", 3 * q, [](size_t n) {
+        blendAdditiveN(input<Quaternion>(0, n), input<Quaternion>(1, n), 0.5f, output<Quaternion>(n), n);
+    });
+}
+
+static void addDualQuaternionBenchmarks(BenchSuite& suite) {
+    addUnary<float, DualQuaternion>(suite, "DualQuaternion::identity",
+        [](float) { DualQuaternion r; r.identity(); return r; });
+    addBinary<Quaternion, Vector3, DualQuaternion>(suite, "DualQuaternion::setup",
+        [](const Quaternion& q, const Vector3& p) { DualQuaternion r; r.setup(q, p); return r; }, 0, 0);
+    addUnary<Matrix4x3, DualQuaternion>(suite, "DualQuaternion::fromMatrix",
+        [](const Matrix4x3& m) { DualQuaternion r; r.fromMatrix(m); return r; });
+    addUnary<DualQuaternion, Matrix4x3>(suite, "DualQuaternion::toMatrix",
+        [](const DualQuaternion& a) { Matrix4x3 r; a.toMatrix(r); return r; });
+    addUnary<DualQuaternion, DualQuaternion>(suite, "DualQuaternion::normalize",
+        [](const DualQuaternion& a) { DualQuaternion r = a; r.normalize(); return r; });
+    addBinary<DualQuaternion, DualQuaternion, DualQuaternion>(suite, "operator* (DualQuaternion)",
+        [](const DualQuaternion& a, const DualQuaternion& b) { return a * b; });
+    addBinary<DualQuaternion, DualQuaternion, DualQuaternion>(suite, "operator*= (DualQuaternion)",
+        [](const DualQuaternion& a, const DualQuaternion& b) { DualQuaternion r = a; r *= b; return r; });
+    addBinary<Vector3, DualQuaternion, Vector3>(suite, "operator* (Vector3 * DualQuaternion)",
+        [](const Vector3& p, const DualQuaternion& a) { return p * a; }, 0, 0);
+    addBinary<Vector3, DualQuaternion, Vector3>(suite, "rotateVector",
+        [](const Vector3& v, const DualQuaternion& a) { return rotateVector(v, a); }, 1, 0);
+    addUnary<DualQuaternion, Vector3>(suite, "getTranslation (DualQuaternion)",
+        [](const DualQuaternion& a) { return getTranslation(a); });
+    addUnary<DualQuaternion, DualQuaternion>(suite, "inverse (DualQuaternion)",
+        [](const DualQuaternion& a) { return inverse(a); });
+
+    suite.add("fromMatrixN (DualQuaternion)", sizeof(Matrix4x3) + sizeof(DualQuaternion), [](size_t n) {
+        fromMatrixN(input<Matrix4x3>(0, n), output<DualQuaternion>(n), n);
+    });
+}
+
+static void addAABB3Benchmarks(BenchSuite& suite) {
+    const size_t b = sizeof(AABB3);
+    const size_t v = sizeof(Vector3);
+
+    addBinary<AABB3, Vector3, AABB3>(suite, "AABB3::add (point)",
+        [](const AABB3& a, const Vector3& p) { AABB3 r = a; r.add(p); return r; }, 0, 0);
+    addBinary<AABB3, AABB3, AABB3>(suite, "AABB3::add (box)",
+        [](const AABB3& a, const AABB3& c) { AABB3 r = a; r.add(c); return r; });
+    addBinary<AABB3, Matrix4x3, AABB3>(suite, "AABB3::setToTransformedBox",
+        [](const AABB3& a, const Matrix4x3& m) { AABB3 r; r.setToTransformedBox(a, m); return r; }, 0, 0);
+    addBinary<AABB3, Vector3, float>(suite, "AABB3::contains",
+        [](const AABB3& a, const Vector3& p) { return a.contains(p) ? 1.0f : 0.0f; }, 0, 0);
+    addBinary<AABB3, Vector3, Vector3>(suite, "AABB3::closestPointTo",
+        [](const AABB3& a, const Vector3& p) { return a.closestPointTo(p); }, 0, 0);
+    addBinary<AABB3, AABB3, AABB3>(suite, "intersectAABBs",
+        [](const AABB3& a, const AABB3& c) { AABB3 r; intersectAABBs(a, c, &r); return r; });
+
+    // 批量形式
+    suite.add("computeBounds (array)", v, [](size_t n) {
+        AABB3 box = computeBounds(input<Vector3>(0, n), n);
+        output<AABB3>(1)[0] = box;
+    });
+    suite.add("computeBounds (Vector3Stream)", v, [](size_t n) {
+        AABB3 box = computeBounds(streamInput(0, n));
+        output<AABB3>(1)[0] = box;
+    });
+    suite.add("transformBoxes (shared matrix)", 2 * b, [](size_t n) {
+        transformBoxes(sharedMatrix(), input<AABB3>(0, n), output<AABB3>(n), n);
+    });
+    suite.add("transformBoxes (per-element matrix)", sizeof(Matrix4x3) + 2 * b, [](size_t n) {
+        transformBoxes(input<Matrix4x3>(0, n), input<AABB3>(0, n), output<AABB3>(n), n);
+    });
+    suite.add("unionBoxes", 3 * b, [](size_t n) {
+        unionBoxes(input<AABB3>(0, n), input<AABB3>(1, n), output<AABB3>(n), n);
+    });
+    suite.add("intersectAABBsN (shared box)", b + sizeof(bool), [](size_t n) {
+        intersectAABBsN(input<AABB3>(1, 1)[0], input<AABB3>(0, n), boolOutput(n), n);
+    });
+    suite.add("intersectAABBsN (pairs)", 2 * b + sizeof(bool), [](size_t n) {
+        intersectAABBsN(input<AABB3>(0, n), input<AABB3>(1, n), boolOutput(n), n);
+    });
+}
+
+/*
+    相机在原点附近看向+z，[-10, 10]立方体中的物体大约一半可见
+    CullingSet中球和边界框交替存放
+ */
+static const Frustum& sharedFrustum() {
+    static Frustum frustum;
+    static bool initialized = false;
+    if (!initialized) {
+        Matrix4x3 worldToCamera;
+        worldToCamera.setupParentToLocal(Vector3(0.0f, 0.0f, -2.0f), EulerAngles(0.2f, 0.1f, 0.0f));
+        frustum.setupPerspective(worldToCamera, fovToZoom(1.2f), fovToZoom(0.8f), 0.1f, 15.0f);
+        initialized = true;
+    }
+    return frustum;
+}
+
+static const CullingSet& cullingInput(size_t n) {
+    static CullingSet objects;
+    if (objects.size() != n) {
+        objects.resize(n);
+        const Vector3* centers = input<Vector3>(0, n);
+        const float* radii = input<float>(1, n);
+        const AABB3* boxes = input<AABB3>(0, n);
+        for (size_t i = 0; i < n; ++i) {
+            if (i % 2 == 0) {
+                objects.setSphere(i, centers[i], radii[i] + 0.1f);
+            } else {
+                objects.setBox(i, boxes[i]);
+            }
+        }
+    }
+    return objects;
+}
+
+// 一遍中裁剪的阴影级联个数
+static const int kCascadeCount = 4;
+
+static void addFrustumBenchmarks(BenchSuite& suite) {
+    // 每个物体7个float，可见下标4字节，时间相关性每个物体1字节
+    const size_t object = 7 * sizeof(float);
+
+    addBinary<Vector3, float, float>(suite, "Frustum::isVisible (sphere)",
+        [](const Vector3& c, float r) { return sharedFrustum().isVisible(c, r + 0.1f) ? 1.0f : 0.0f; });
+    addUnary<AABB3, float>(suite, "Frustum::isVisible (box)",
+        [](const AABB3& box) { return sharedFrustum().isVisible(box) ? 1.0f : 0.0f; });
+
+    suite.add("cull", object + sizeof(unsigned int), [](size_t n) {
+        cull(sharedFrustum(), cullingInput(n), output<unsigned int>(n));
+    });
+    suite.add("cull (temporal coherence)", object + sizeof(unsigned int) + 1, [](size_t n) {
+        static std::vector<unsigned char> lastPlane;
+        if (lastPlane.size() < n) {
+            lastPlane.assign(n, 0);
+        }
+        cull(sharedFrustum(), cullingInput(n), output<unsigned int>(n), &lastPlane[0]);
+    });
+
+    // 4个阴影级联的正交视体在同一遍中裁剪
+    suite.add("cull (4 views in one pass)", object + kCascadeCount * sizeof(unsigned int), [](size_t n) {
+        static Frustum cascades[kCascadeCount];
+        static std::vector<unsigned int> visible[kCascadeCount];
+        CullingView views[kCascadeCount];
+        for (int k = 0; k < kCascadeCount; ++k) {
+            if (visible[k].size() < n) {
+                visible[k].resize(n);
+                Matrix4x3 lightView;
+                lightView.setupParentToLocal(Vector3(0.0f, 20.0f, 5.0f * k - 10.0f), EulerAngles(0.0f, 1.2f, 0.0f));
+                cascades[k].setupOrthographic(lightView, 2.5f * (k + 1), 2.5f * (k + 1), 0.0f, 40.0f);
+            }
+            views[k].frustum = &cascades[k];
+            views[k].visible = &visible[k][0];
+            views[k].lastPlane = NULL;
+        }
+        cull(views, kCascadeCount, cullingInput(n));
+    });
+}
+
+/*
+    射线的起点在[-10, 10]的立方体中，方向为长度20的随机向量
+    三角形的3个顶点各自在立方体中随机选取，比较大，大约三分之一的射线与之相交
+ */
+static const Vector3* rayDeltas(size_t n) {
+    static std::vector<Vector3> deltas;
+    if (deltas.size() < n) {
+        const Vector3* unit = input<Vector3>(1, n);
+        deltas.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            deltas[i] = unit[i] * 20.0f;
+        }
+    }
+    return &deltas[0];
+}
+
+static const Vector3* triangleVertices(size_t n) {
+    static std::vector<Vector3> vertices;
+    while (vertices.size() < 3 * n) {
+        vertices.push_back(generate<Vector3>(0));
+    }
+    return &vertices[0];
+}
+
+// 射线包中的8条射线
+static const RayPacket& sharedPacket() {
+    static RayPacket packet;
+    static bool initialized = false;
+    if (!initialized) {
+        packet.set(input<Vector3>(0, kRayPacketSize), rayDeltas(kRayPacketSize), kRayPacketSize);
+        initialized = true;
+    }
+    return packet;
+}
+
+static void addIntersectionBenchmarks(BenchSuite& suite) {
+    const size_t v = sizeof(Vector3);
+    const size_t ray = 2 * v + sizeof(float);
+
+    // 每个元素是一条射线与一个图元
+    suite.add("rayTriangleIntersect", ray + 3 * v, [](size_t n) {
+        const Vector3* org = input<Vector3>(0, n);
+        const Vector3* delta = rayDeltas(n);
+        const Vector3* p = triangleVertices(n);
+        float* t = output<float>(n);
+        for (size_t i = 0; i < n; ++i) {
+            t[i] = 1.0f;
+            rayTriangleIntersect(org[i], delta[i], p[3 * i], p[3 * i + 1], p[3 * i + 2], kCullNone, &t[i]);
+        }
+    });
+    suite.add("rayAABBIntersect", ray + sizeof(AABB3), [](size_t n) {
+        const Vector3* org = input<Vector3>(0, n);
+        const Vector3* delta = rayDeltas(n);
+        const AABB3* boxes = input<AABB3>(0, n);
+        float* t = output<float>(n);
+        for (size_t i = 0; i < n; ++i) {
+            t[i] = 1.0f;
+            rayAABBIntersect(org[i], delta[i], boxes[i], &t[i]);
+        }
+    });
+    suite.add("raySphereIntersect", ray + v + sizeof(float), [](size_t n) {
+        const Vector3* org = input<Vector3>(0, n);
+        const Vector3* delta = rayDeltas(n);
+        const Vector3* centers = triangleVertices(n);
+        const float* radii = input<float>(1, n);
+        float* t = output<float>(n);
+        for (size_t i = 0; i < n; ++i) {
+            t[i] = 1.0f;
+            raySphereIntersect(org[i], delta[i], centers[3 * i], radii[i] + 0.1f, &t[i]);
+        }
+    });
+    suite.add("rayPlaneIntersect", ray + v + sizeof(float), [](size_t n) {
+        const Vector3* org = input<Vector3>(0, n);
+        const Vector3* delta = rayDeltas(n);
+        const Vector3* normals = input<Vector3>(1, n);
+        const float* d = input<float>(0, n);
+        float* t = output<float>(n);
+        for (size_t i = 0; i < n; ++i) {
+            t[i] = 1.0f;
+            rayPlaneIntersect(org[i], delta[i], normals[i], d[i], kCullNone, &t[i]);
+        }
+    });
+
+    // 射线包：每个元素是一个图元，与同一个包中的8条射线测试
+    suite.add("rayTriangleIntersect (packet)", 3 * v + sizeof(int), [](size_t n) {
+        const RayPacket& rays = sharedPacket();
+        const Vector3* p = triangleVertices(n);
+        int* mask = output<int>(n);
+        float t[kRayPacketSize];
+        for (size_t i = 0; i < n; ++i) {
+            mask[i] = rayTriangleIntersect(rays, p[3 * i], p[3 * i + 1], p[3 * i + 2], kCullNone, t);
+        }
+    });
+    suite.add("rayAABBIntersect (packet)", sizeof(AABB3) + sizeof(int), [](size_t n) {
+        const RayPacket& rays = sharedPacket();
+        const AABB3* boxes = input<AABB3>(0, n);
+        int* mask = output<int>(n);
+        float t[kRayPacketSize];
+        for (size_t i = 0; i < n; ++i) {
+            mask[i] = rayAABBIntersect(rays, boxes[i], t);
+        }
+    });
+    suite.add("raySphereIntersect (packet)", v + sizeof(float) + sizeof(int), [](size_t n) {
+        const RayPacket& rays = sharedPacket();
+        const Vector3* centers = triangleVertices(n);
+        const float* radii = input<float>(1, n);
+        int* mask = output<int>(n);
+        float t[kRayPacketSize];
+        for (size_t i = 0; i < n; ++i) {
+            mask[i] = raySphereIntersect(rays, centers[3 * i], radii[i] + 0.1f, t);
+        }
+    });
+    suite.add("rayPlaneIntersect (packet)", v + sizeof(float) + sizeof(int), [](size_t n) {
+        const RayPacket& rays = sharedPacket();
+        const Vector3* normals = input<Vector3>(1, n);
+        const float* d = input<float>(0, n);
+        int* mask = output<int>(n);
+        float t[kRayPacketSize];
+        for (size_t i = 0; i < n; ++i) {
+            mask[i] = rayPlaneIntersect(rays, normals[i], d[i], kCullNone, t);
+        }
+    });
+    suite.add("rayTrianglesIntersect (packet vs triangle batch)", 3 * v, [](size_t n) {
+        RayPacketHit hit;
+        hit.reset();
+        rayTrianglesIntersect(sharedPacket(), triangleVertices(n), NULL, n, kCullNone, hit);
+        output<float>(1)[0] = hit.t[0];
+    });
+}
+
+/*
+    BVH的图元是球，中心在边长随个数的立方根增长的立方体中，平均密度不随个数变化
+    每个图元约占64字节：中心和半径16字节，其余是节点中的AABB和子节点下标
+    查询的元素是一次查询，查询的个数与图元个数相同，工作集就是整个BVH
+ */
+static const size_t kBVHBytesPerPrimitive = 64;
+
+// nearestK查询的个数
+static const int kNearestCount = 8;
+
+struct BVHInput {
+    std::vector<Vector3> centers;
+    std::vector<float> radii;
+    std::vector<Vector3> queries;
+    std::vector<Vector3> deltas;
+    BVH bvh;
+};
+
+static BVHInput& bvhInput(size_t n) {
+    static BVHInput data;
+    if (data.centers.size() != n) {
+        float scale = 0.25f * cbrtf((float)n);
+        const Vector3* a = input<Vector3>(0, n);
+        const Vector3* b = input<Vector3>(1, n);
+        const float* r = input<float>(1, n);
+        data.centers.resize(n);
+        data.radii.resize(n);
+        data.queries.resize(n);
+        data.deltas.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            data.centers[i] = a[i] * scale;
+            data.radii[i] = r[i] + 0.1f;
+            data.queries[i] = a[n - 1 - i] * scale;
+            data.deltas[i] = b[i] * 20.0f;
+        }
+        data.bvh.build(&data.centers[0], &data.radii[0], n);
+    }
+    return data;
+}
+
+static void addBVHBenchmarks(BenchSuite& suite) {
+    const size_t primitive = kBVHBytesPerPrimitive;
+
+    suite.add("BVH::build", primitive, [](size_t n) {
+        BVHInput& data = bvhInput(n);
+        data.bvh.build(&data.centers[0], &data.radii[0], n);
+    });
+    suite.add("BVH::refit", primitive, [](size_t n) {
+        BVHInput& data = bvhInput(n);
+        data.bvh.refit(&data.centers[0], &data.radii[0]);
+    });
+    suite.add("BVH::rayCast", primitive, [](size_t n) {
+        const BVHInput& data = bvhInput(n);
+        BVHRayHit* hits = output<BVHRayHit>(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (!data.bvh.rayCast(data.queries[i], data.deltas[i], &hits[i])) {
+                hits[i].primitive = -1;
+            }
+        }
+    });
+    suite.add("rayCastN (BVH)", primitive, [](size_t n) {
+        const BVHInput& data = bvhInput(n);
+        rayCastN(data.bvh, &data.queries[0], &data.deltas[0], output<BVHRayHit>(n), n);
+    });
+    suite.add("BVH::nearest", primitive, [](size_t n) {
+        const BVHInput& data = bvhInput(n);
+        int* result = output<int>(n);
+        for (size_t i = 0; i < n; ++i) {
+            result[i] = data.bvh.nearest(data.queries[i]);
+        }
+    });
+    suite.add("nearestN (BVH)", primitive, [](size_t n) {
+        const BVHInput& data = bvhInput(n);
+        nearestN(data.bvh, &data.queries[0], output<int>(n), output<float>(n), n);
+    });
+    suite.add("BVH::nearestK (k = 8)", primitive, [](size_t n) {
+        const BVHInput& data = bvhInput(n);
+        int* result = output<int>(n);
+        int indices[kNearestCount];
+        float distances[kNearestCount];
+        for (size_t i = 0; i < n; ++i) {
+            data.bvh.nearestK(data.queries[i], kNearestCount, indices, distances);
+            result[i] = indices[0];
+        }
+    });
+    suite.add("BVH::overlapSphere (radius 5)", primitive, [](size_t n) {
+        const BVHInput& data = bvhInput(n);
+        static std::vector<int> overlaps;
+        int* result = output<int>(n);
+        for (size_t i = 0; i < n; ++i) {
+            overlaps.clear();
+            result[i] = (int)data.bvh.overlapSphere(data.queries[i], 5.0f, overlaps);
+        }
+    });
+}
+
+/*
+    蒙皮：每个顶点4个影响，骨骼矩阵64个
+    每个顶点读绑定姿态的位置和法线、4个权重和骨骼下标，写蒙皮后的位置和法线
+ */
+static const int kSkinningBones = 64;
+
+static const SkinnedMesh& skinningInput(size_t n) {
+    static SkinnedMesh mesh(4);
+    if (mesh.size() != n) {
+        mesh.resize(n);
+        const Vector3* positions = input<Vector3>(0, n);
+        const Vector3* normals = input<Vector3>(1, n);
+        const float* r = input<float>(1, 4 * n);
+        for (size_t i = 0; i < n; ++i) {
+            int bones[4];
+            float weights[4];
+            for (int k = 0; k < 4; ++k) {
+                bones[k] = (int)((i * 7 + k * 13) % kSkinningBones);
+                weights[k] = r[4 * i + k] + 0.01f;
+            }
+            mesh.setVertex(i, positions[i], normals[i], bones, weights, 4);
+        }
+    }
+    return mesh;
+}
+
+static const DualQuaternion* sharedDualPalette() {
+    static std::vector<DualQuaternion> palette;
+    if (palette.empty()) {
+        palette.resize(kSkinningBones);
+        fromMatrixN(input<Matrix4x3>(0, kSkinningBones), &palette[0], kSkinningBones);
+    }
+    return &palette[0];
+}
+
+static void addSkinningBenchmarks(BenchSuite& suite) {
+    const size_t v = 3 * sizeof(float);
+    const size_t influences = 4 * (sizeof(float) + sizeof(unsigned short));
+
+    suite.add("skinVertices (positions and normals)", 4 * v + influences, [](size_t n) {
+        static Vector3Stream normals;
+        skinVertices(skinningInput(n), input<Matrix4x3>(0, kSkinningBones), kSkinningBones, streamOutput(n), &normals);
+    });
+    suite.add("skinVertices (positions only)", 2 * v + influences, [](size_t n) {
+        skinVertices(skinningInput(n), input<Matrix4x3>(0, kSkinningBones), kSkinningBones, streamOutput(n), NULL);
+    });
+    suite.add("skinVertices (dual quaternion)", 4 * v + influences, [](size_t n) {
+        static Vector3Stream normals;
+        skinVertices(skinningInput(n), sharedDualPalette(), kSkinningBones, streamOutput(n), &normals);
+    });
+}
+
+/*
+    动画片段：32个骨骼，旋转和平移轨道各60个关键帧，关键帧时间各不相同
+    元素是一个骨骼的采样，n个骨骼分成若干个角色，元素个数不是32的整数倍时最后一个角色也完整采样
+    每个骨骼写一个矩阵，读游标中三条轨道各两个关键帧的值和时间
+ */
+static const int kAnimationBones = 32;
+
+static const AnimationClip& sharedClip() {
+    static AnimationClip clip(kAnimationBones);
+    static bool built = false;
+    if (!built) {
+        for (int b = 0; b < kAnimationBones; ++b) {
+            float t = randomRange(0.0f, 1.0f / 30.0f);
+            for (int k = 0; k < 60; ++k) {
+                clip.addRotationKey(b, t, generate<Quaternion>(0));
+                clip.addTranslationKey(b, t * 0.5f, generate<Vector3>(0));
+                t += randomRange(0.5f, 1.5f) / 30.0f;
+            }
+        }
+        clip.build();
+        built = true;
+    }
+    return clip;
+}
+
+static void addAnimationBenchmarks(BenchSuite& suite) {
+    const size_t bone = sizeof(Matrix4x3) + 3 * 2 * 5 * sizeof(float);
+
+    suite.add("sampleClips", bone, [](size_t n) {
+        static std::vector<AnimationCursor> cursors;
+        static std::vector<AnimationJob> jobs;
+        static int frame = 0;
+        const AnimationClip& clip = sharedClip();
+        size_t characters = (n + kAnimationBones - 1) / kAnimationBones;
+        if (cursors.size() < characters) {
+            cursors.resize(characters);
+        }
+        jobs.resize(characters);
+        Matrix4x3* locals = output<Matrix4x3>(characters * kAnimationBones);
+        ++frame;
+        for (size_t c = 0; c < characters; ++c) {
+            AnimationJob job = { &clip, &cursors[c], fmodf(frame / 60.0f + c * 0.01f, clip.duration()),
+                                 locals + c * kAnimationBones };
+            jobs[c] = job;
+        }
+        sampleClips(&jobs[0], characters);
+    });
+}
+
+/*
+    变换层次：随机树，每个节点的父节点在它前面随机选取
+    每次调用移动5%的节点再update()，元素是一个节点；updateAll()重新计算全部节点
+ */
+struct HierarchyInput {
+    TransformHierarchy hierarchy;
+    std::vector<int> moved;
+};
+
+static HierarchyInput& hierarchyInput(size_t n) {
+    static HierarchyInput data;
+    if (data.hierarchy.size() != n) {
+        data.hierarchy = TransformHierarchy();
+        data.hierarchy.reserve(n);
+        const Matrix4x3* locals = input<Matrix4x3>(0, n);
+        for (size_t i = 0; i < n; ++i) {
+            int parent = i == 0 ? TransformHierarchy::kNoParent : std::min((int)randomRange(0.0f, (float)i), (int)i - 1);
+            data.hierarchy.addNode(parent, locals[i]);
+        }
+        data.hierarchy.updateAll();
+        data.moved.resize(n / 20);
+        for (size_t i = 0; i < data.moved.size(); ++i) {
+            data.moved[i] = (int)randomRange(0.0f, (float)n) % (int)n;
+        }
+    }
+    return data;
+}
+
+static void addTransformHierarchyBenchmarks(BenchSuite& suite) {
+    // 每个节点的局部和世界矩阵，以及父节点、子节点区间等下标
+    const size_t node = 2 * sizeof(Matrix4x3) + 4 * sizeof(int);
+
+    suite.add("TransformHierarchy::update (5% moved)", node, [](size_t n) {
+        HierarchyInput& data = hierarchyInput(n);
+        for (size_t i = 0; i < data.moved.size(); ++i) {
+            data.hierarchy.setLocal(data.moved[i], data.hierarchy.getLocal(data.moved[i]));
+        }
+        data.hierarchy.update();
+    });
+    suite.add("TransformHierarchy::updateAll", node, [](size_t n) {
+        hierarchyInput(n).hierarchy.updateAll();
+    });
+}
+
+void addOperationBenchmarks(BenchSuite& suite) {
+    addVector3Benchmarks(suite);
+    addVector3StreamBenchmarks(suite);
+    addMatrix4x3Benchmarks(suite);
+    addQuaternionBenchmarks(suite);
+    addEulerAnglesBenchmarks(suite);
+    addRotationMatrixBenchmarks(suite);
+    addMathUtilBenchmarks(suite);
+    addQuaternionStreamBenchmarks(suite);
+    addPackedQuaternionBenchmarks(suite);
+    addQuaternionBlendBenchmarks(suite);
+    addDualQuaternionBenchmarks(suite);
+    addAABB3Benchmarks(suite);
+    addFrustumBenchmarks(suite);
+    addIntersectionBenchmarks(suite);
+    addBVHBenchmarks(suite);
+    addSkinningBenchmarks(suite);
+    addAnimationBenchmarks(suite);
+    addTransformHierarchyBenchmarks(suite);
+}
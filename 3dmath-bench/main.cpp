@@ -0,0 +1,1363 @@
+//
+//  main.cpp
+//  3dmath-bench
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "MathUtil.h"
+#include "Vector3.hpp"
+#include "EulerAngles.hpp"
+#include "Matrix4x3.hpp"
+#include "Quaternion.hpp"
+#include "RotationMatrix.hpp"
+#include "Vector3Stream.hpp"
+#include "Skinning.hpp"
+#include "DualQuaternion.hpp"
+#include "PackedQuaternion.hpp"
+#include "AnimationClip.hpp"
+#include "QuaternionBlend.hpp"
+#include "QuaternionStream.hpp"
+#include "AABB3.hpp"
+#include "Frustum.hpp"
+#include "BVH.hpp"
+#include "Intersection.hpp"
+#include "TransformHierarchy.hpp"
+#include "BenchSuite.hpp"
+#include "AccuracyCheck.hpp"
+#include "SimdDispatch.hpp"
+#include "Instrument.hpp"
+
+/*
+    性能测试程序
+    每项测试对一组输入重复执行若干遍，报告每次操作的平均纳秒数
+    结果累加到sink中，防止编译器把计算优化掉
+    带--suite参数时改为运行逐项操作的测试，参看BenchSuite.hpp；带--accuracy参数时运行精度检查，参看AccuracyCheck.hpp
+    定义MATH_INSTRUMENT=1编译时，最后输出各个库函数的调用次数和耗时统计，参看Instrument.hpp
+ */
+
+static volatile float sink;
+
+template <typename F>
+static double nsPerOp(size_t opsPerPass, int passes, F f) {
+    // 先跑一遍预热缓存
+    f();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < passes; ++i) {
+        f();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / ((double)opsPerPass * passes);
+}
+
+static float randomFloat(float lo, float hi) {
+    return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+static void report(const char* name, double ns, double baselineNs) {
+    printf("%-40s %8.2f ns/op  %6.2fx\n", name, ns, baselineNs / ns);
+}
+
+/*
+    求逆、行列式和提取位置：按变换分类走快速路径，与把同样的矩阵标记为一般变换后的代价对比
+ */
+static void benchTransformClass() {
+    const size_t n = 256;
+    const int passes = 20000;
+    
+    std::vector<Matrix4x3> rigid(n), scaled(n), general(n);
+    for (size_t i = 0; i < n; ++i) {
+        Vector3 pos(randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f));
+        EulerAngles orient(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi));
+        rigid[i].setupLocalToParent(pos, orient);
+        
+        Matrix4x3 s;
+        s.setupScale(Vector3(2.0f, 2.0f, 2.0f));
+        scaled[i] = s * rigid[i];
+        
+        general[i] = rigid[i];
+        general[i].transformClass = kTransformGeneral;
+    }
+    
+    std::vector<Matrix4x3> out(n);
+    auto inverseOf = [&](const std::vector<Matrix4x3>& in) {
+        return [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = inverse(in[i]);
+            }
+            sink = out[n - 1].tx;
+        };
+    };
+    auto determinantOf = [&](const std::vector<Matrix4x3>& in) {
+        return [&]() {
+            float sum = 0.0f;
+            for (size_t i = 0; i < n; ++i) {
+                sum += determinant(in[i]);
+            }
+            sink = sum;
+        };
+    };
+    auto positionOf = [&](const std::vector<Matrix4x3>& in) {
+        return [&]() {
+            float sum = 0.0f;
+            for (size_t i = 0; i < n; ++i) {
+                sum += getPositionFromParentToLocal(in[i]).x;
+            }
+            sink = sum;
+        };
+    };
+    
+    double generalInverse = nsPerOp(n, passes, inverseOf(general));
+    report("inverse (general)", generalInverse, generalInverse);
+    report("inverse (rigid)", nsPerOp(n, passes, inverseOf(rigid)), generalInverse);
+    report("inverse (uniform scale)", nsPerOp(n, passes, inverseOf(scaled)), generalInverse);
+    
+    double generalDet = nsPerOp(n, passes, determinantOf(general));
+    report("determinant (general)", generalDet, generalDet);
+    report("determinant (rigid)", nsPerOp(n, passes, determinantOf(rigid)), generalDet);
+    
+    double generalPos = nsPerOp(n, passes, positionOf(general));
+    report("getPositionFromParentToLocal (general)", generalPos, generalPos);
+    report("getPositionFromParentToLocal (rigid)", nsPerOp(n, passes, positionOf(rigid)), generalPos);
+}
+
+/*
+    批量slerp：逐个调用slerp()与多项式快速模式对比
+ */
+static void benchSlerp() {
+    const size_t n = 4096;
+    const int passes = 500;
+    
+    std::vector<Quaternion> a(n), b(n), out(n);
+    std::vector<float> t(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i].setToRotateObjectToInertial(EulerAngles(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi)));
+        b[i].setToRotateObjectToInertial(EulerAngles(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi)));
+        t[i] = randomFloat(0.0f, 1.0f);
+    }
+    
+    auto slerpWith = [&](SlerpAccuracy accuracy) {
+        return [&, accuracy]() {
+            slerpN(&a[0], &b[0], &t[0], &out[0], n, accuracy);
+            sink = out[n - 1].w;
+        };
+    };
+    
+    double exact = nsPerOp(n, passes, slerpWith(kSlerpExact));
+    report("slerpN (exact)", exact, exact);
+    report("slerpN (fast)", nsPerOp(n, passes, slerpWith(kSlerpFast)), exact);
+}
+
+/*
+    三角函数：标准库逐个计算与当前精度等级下的sinCos、批量版本对比
+    精度等级在编译时通过MATH_ACCURACY选择
+ */
+static void benchTrig() {
+    const size_t n = 4096;
+    const int passes = 500;
+    
+    std::vector<float> angles(n), values(n), s(n), c(n);
+    for (size_t i = 0; i < n; ++i) {
+        angles[i] = randomFloat(-10.0f, 10.0f);
+        values[i] = randomFloat(-1.0f, 1.0f);
+    }
+    
+    double libm = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            s[i] = sin(angles[i]);
+            c[i] = cos(angles[i]);
+        }
+        sink = s[n - 1] + c[n - 1];
+    });
+    report("sin + cos (libm)", libm, libm);
+    report("sinCos", nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            sinCos(&s[i], &c[i], angles[i]);
+        }
+        sink = s[n - 1] + c[n - 1];
+    }), libm);
+    report("sinCosN", nsPerOp(n, passes, [&]() {
+        sinCosN(&angles[0], &s[0], &c[0], n);
+        sink = s[n - 1] + c[n - 1];
+    }), libm);
+    
+    double libmAcos = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            s[i] = acos(values[i]);
+        }
+        sink = s[n - 1];
+    });
+    report("acos (libm)", libmAcos, libmAcos);
+    report("safeAcosN", nsPerOp(n, passes, [&]() {
+        safeAcosN(&values[0], &s[0], n);
+        sink = s[n - 1];
+    }), libmAcos);
+    
+    double libmAtan2 = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            s[i] = atan2(values[i], angles[i]);
+        }
+        sink = s[n - 1];
+    });
+    report("atan2 (libm)", libmAtan2, libmAtan2);
+    report("atan2N", nsPerOp(n, passes, [&]() {
+        atan2N(&values[0], &angles[0], &s[0], n);
+        sink = s[n - 1];
+    }), libmAtan2);
+}
+
+/*
+    方位表示之间的批量转换与逐个调用成员函数对比
+ */
+static void benchConversions() {
+    const size_t n = 4096;
+    const int passes = 200;
+    
+    std::vector<EulerAngles> angles(n), anglesOut(n);
+    std::vector<Quaternion> quaternions(n);
+    std::vector<RotationMatrix> rotations(n);
+    std::vector<Matrix4x3> matrices(n);
+    for (size_t i = 0; i < n; ++i) {
+        angles[i] = EulerAngles(randomFloat(-kPi, kPi), randomFloat(-KPiOver2, KPiOver2), randomFloat(-kPi, kPi));
+        quaternions[i].setToRotateObjectToInertial(angles[i]);
+        rotations[i].setup(angles[i]);
+    }
+    
+    double scalar = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            quaternions[i].setToRotateObjectToInertial(angles[i]);
+        }
+        sink = quaternions[n - 1].w;
+    });
+    report("setToRotateObjectToInertial", scalar, scalar);
+    report("setToRotateObjectToInertialN", nsPerOp(n, passes, [&]() {
+        setToRotateObjectToInertialN(&angles[0], &quaternions[0], n);
+        sink = quaternions[n - 1].w;
+    }), scalar);
+    
+    scalar = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            anglesOut[i].fromObjectToInertialQuaternion(quaternions[i]);
+        }
+        sink = anglesOut[n - 1].heading;
+    });
+    report("fromObjectToInertialQuaternion", scalar, scalar);
+    report("fromObjectToInertialQuaternionN", nsPerOp(n, passes, [&]() {
+        fromObjectToInertialQuaternionN(&quaternions[0], &anglesOut[0], n);
+        sink = anglesOut[n - 1].heading;
+    }), scalar);
+    
+    scalar = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            rotations[i].setup(angles[i]);
+        }
+        sink = rotations[n - 1].m11;
+    });
+    report("RotationMatrix::setup", scalar, scalar);
+    report("setupN", nsPerOp(n, passes, [&]() {
+        setupN(&angles[0], &rotations[0], n);
+        sink = rotations[n - 1].m11;
+    }), scalar);
+    
+    scalar = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            anglesOut[i].fromRotationMatrix(rotations[i]);
+        }
+        sink = anglesOut[n - 1].heading;
+    });
+    report("fromRotationMatrix", scalar, scalar);
+    report("fromRotationMatrixN", nsPerOp(n, passes, [&]() {
+        fromRotationMatrixN(&rotations[0], &anglesOut[0], n);
+        sink = anglesOut[n - 1].heading;
+    }), scalar);
+    
+    scalar = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            matrices[i].fromQuaternion(quaternions[i]);
+        }
+        sink = matrices[n - 1].m11;
+    });
+    report("Matrix4x3::fromQuaternion", scalar, scalar);
+    report("fromQuaternionN", nsPerOp(n, passes, [&]() {
+        fromQuaternionN(&quaternions[0], &matrices[0], n);
+        sink = matrices[n - 1].m11;
+    }), scalar);
+}
+
+/*
+    蒙皮：逐顶点对每个影响执行p * m再加权求和，与SoA的SIMD蒙皮对比
+    模拟一群角色，每个角色有自己的骨骼矩阵，顶点数据共用一份
+ */
+static void benchSkinning() {
+    const size_t vertexCount = 5000;
+    const size_t boneCount = 64;
+    const size_t characterCount = 32;
+    const int influenceCount = 4;
+    const int passes = 10;
+    
+    SkinnedMesh mesh(influenceCount);
+    mesh.resize(vertexCount);
+    std::vector<Vector3> positions(vertexCount), normals(vertexCount);
+    std::vector<int> bones(vertexCount * influenceCount);
+    std::vector<float> weights(vertexCount * influenceCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        positions[i] = Vector3(randomFloat(-1.0f, 1.0f), randomFloat(0.0f, 2.0f), randomFloat(-1.0f, 1.0f));
+        normals[i] = Vector3(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f));
+        normals[i].normalize();
+        // 大部分顶点受2到4个骨骼影响
+        int used = 2 + rand() % 3;
+        float* w = &weights[i * influenceCount];
+        int* b = &bones[i * influenceCount];
+        float sum = 0.0f;
+        for (int k = 0; k < influenceCount; ++k) {
+            b[k] = rand() % boneCount;
+            w[k] = k < used ? randomFloat(0.1f, 1.0f) : 0.0f;
+            sum += w[k];
+        }
+        for (int k = 0; k < influenceCount; ++k) {
+            w[k] /= sum;
+        }
+        mesh.setVertex(i, positions[i], normals[i], b, w, influenceCount);
+    }
+    
+    std::vector<std::vector<Matrix4x3> > palettes(characterCount, std::vector<Matrix4x3>(boneCount));
+    for (size_t c = 0; c < characterCount; ++c) {
+        for (size_t j = 0; j < boneCount; ++j) {
+            Vector3 pos(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f));
+            EulerAngles orient(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi));
+            palettes[c][j].setupLocalToParent(pos, orient);
+        }
+    }
+    
+    const size_t ops = vertexCount * characterCount;
+    std::vector<Vector3> outPositions(vertexCount), outNormals(vertexCount);
+    double scalar = nsPerOp(ops, passes, [&]() {
+        for (size_t c = 0; c < characterCount; ++c) {
+            const Matrix4x3* palette = &palettes[c][0];
+            for (size_t i = 0; i < vertexCount; ++i) {
+                Vector3 p(0.0f, 0.0f, 0.0f), n(0.0f, 0.0f, 0.0f);
+                for (int k = 0; k < influenceCount; ++k) {
+                    float w = weights[i * influenceCount + k];
+                    if (w > 0.0f) {
+                        const Matrix4x3& m = palette[bones[i * influenceCount + k]];
+                        p += (positions[i] * m) * w;
+                        n += Vector3(normals[i].x * m.m11 + normals[i].y * m.m21 + normals[i].z * m.m31,
+                                     normals[i].x * m.m12 + normals[i].y * m.m22 + normals[i].z * m.m32,
+                                     normals[i].x * m.m13 + normals[i].y * m.m23 + normals[i].z * m.m33) * w;
+                    }
+                }
+                n.normalize();
+                outPositions[i] = p;
+                outNormals[i] = n;
+            }
+        }
+        sink = outPositions[vertexCount - 1].x + outNormals[vertexCount - 1].x;
+    });
+    report("skinning (scalar operator*)", scalar, scalar);
+    
+    std::vector<Vector3Stream> skinnedPositions(characterCount), skinnedNormals(characterCount);
+    std::vector<SkinningJob> jobs(characterCount);
+    for (size_t c = 0; c < characterCount; ++c) {
+        SkinningJob job = { &mesh, &palettes[c][0], NULL, boneCount, &skinnedPositions[c], &skinnedNormals[c] };
+        jobs[c] = job;
+    }
+    report("skinVertices (per character)", nsPerOp(ops, passes, [&]() {
+        for (size_t c = 0; c < characterCount; ++c) {
+            skinVertices(mesh, &palettes[c][0], boneCount, skinnedPositions[c], &skinnedNormals[c]);
+        }
+        sink = skinnedPositions[characterCount - 1].x()[0];
+    }), scalar);
+    report("skinVertices (all characters)", nsPerOp(ops, passes, [&]() {
+        skinVertices(&jobs[0], characterCount);
+        sink = skinnedPositions[characterCount - 1].x()[0];
+    }), scalar);
+    
+    // 同样的骨骼变换转换为对偶四元数
+    std::vector<std::vector<DualQuaternion> > dualPalettes(characterCount, std::vector<DualQuaternion>(boneCount));
+    for (size_t c = 0; c < characterCount; ++c) {
+        fromMatrixN(&palettes[c][0], &dualPalettes[c][0], boneCount);
+        jobs[c].palette = NULL;
+        jobs[c].dualPalette = &dualPalettes[c][0];
+    }
+    report("skinVertices (dual quaternion)", nsPerOp(ops, passes, [&]() {
+        skinVertices(&jobs[0], characterCount);
+        sink = skinnedPositions[characterCount - 1].x()[0];
+    }), scalar);
+}
+
+/*
+    压缩四元数：逐个pack/unpack与批量版本对比，每种格式以自己的逐个调用为基准
+ */
+template <typename Packed>
+static void benchPackedFormat(const char* packName, const char* packNName, const char* unpackName, const char* unpackNName,
+                              const std::vector<Quaternion>& q) {
+    const size_t n = q.size();
+    const int passes = 200;
+    std::vector<Packed> packed(n);
+    std::vector<Quaternion> out(n);
+    
+    double scalarPack = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            packed[i].pack(q[i]);
+        }
+        sink = (float)packed[n - 1].unpack().w;
+    });
+    report(packName, scalarPack, scalarPack);
+    report(packNName, nsPerOp(n, passes, [&]() {
+        packN(&q[0], &packed[0], n);
+        sink = (float)packed[n - 1].unpack().w;
+    }), scalarPack);
+    
+    double scalarUnpack = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = packed[i].unpack();
+        }
+        sink = out[n - 1].w;
+    });
+    report(unpackName, scalarUnpack, scalarUnpack);
+    report(unpackNName, nsPerOp(n, passes, [&]() {
+        unpackN(&packed[0], &out[0], n);
+        sink = out[n - 1].w;
+    }), scalarUnpack);
+}
+
+static void benchPackedQuaternion() {
+    const size_t n = 4096;
+    
+    std::vector<Quaternion> q(n);
+    for (size_t i = 0; i < n; ++i) {
+        q[i].setToRotateObjectToInertial(EulerAngles(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi)));
+    }
+    
+    benchPackedFormat<PackedQuaternion32>("PackedQuaternion32::pack", "packN (32)",
+                                          "PackedQuaternion32::unpack", "unpackN (32)", q);
+    benchPackedFormat<PackedQuaternion48>("PackedQuaternion48::pack", "packN (48)",
+                                          "PackedQuaternion48::unpack", "unpackN (48)", q);
+    benchPackedFormat<PackedQuaternion64>("PackedQuaternion64::pack", "packN (64)",
+                                          "PackedQuaternion64::unpack", "unpackN (64)", q);
+}
+
+/*
+    动画采样：1000个角色各100个骨骼，每遍时间前进1/60秒
+    对比每个骨骼每条轨道二分查找关键帧后调用slerp()，与按时间排列的关键帧流加批量采样
+ */
+static void benchAnimation() {
+    const int boneCount = 100;
+    const size_t characterCount = 1000;
+    const int keyCount = 60;
+    const float keyInterval = 1.0f / 30.0f;
+    const int passes = 20;
+    
+    // 每条轨道的关键帧时间各不相同
+    std::vector<std::vector<float> > rotationTimes(boneCount), translationTimes(boneCount);
+    std::vector<std::vector<Quaternion> > rotations(boneCount);
+    std::vector<std::vector<Vector3> > translations(boneCount);
+    AnimationClip clip(boneCount);
+    for (int b = 0; b < boneCount; ++b) {
+        float t = randomFloat(0.0f, keyInterval);
+        for (int k = 0; k < keyCount; ++k) {
+            Quaternion q;
+            q.setToRotateObjectToInertial(EulerAngles(randomFloat(-0.5f, 0.5f), randomFloat(-0.5f, 0.5f), randomFloat(-0.5f, 0.5f)));
+            rotationTimes[b].push_back(t);
+            rotations[b].push_back(q);
+            clip.addRotationKey(b, t, q);
+            Vector3 v(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f));
+            translationTimes[b].push_back(t * 0.5f);
+            translations[b].push_back(v);
+            clip.addTranslationKey(b, t * 0.5f, v);
+            t += keyInterval * randomFloat(0.5f, 1.5f);
+        }
+    }
+    clip.build();
+    
+    const size_t ops = boneCount * characterCount;
+    std::vector<Matrix4x3> locals(ops);
+    int frame = 0;
+    auto clipTime = [&](size_t c) {
+        return fmodf(frame / 60.0f + c * 0.01f, clip.duration());
+    };
+    
+    auto findKey = [](const std::vector<float>& times, float t) {
+        size_t k = std::upper_bound(times.begin(), times.end(), t) - times.begin();
+        return k == 0 ? 0 : (k == times.size() ? k - 2 : k - 1);
+    };
+    double scalar = nsPerOp(ops, passes, [&]() {
+        ++frame;
+        for (size_t c = 0; c < characterCount; ++c) {
+            float t = clipTime(c);
+            for (int b = 0; b < boneCount; ++b) {
+                const std::vector<float>& rt = rotationTimes[b];
+                size_t k = findKey(rt, t);
+                float alpha = std::min(std::max((t - rt[k]) / (rt[k + 1] - rt[k]), 0.0f), 1.0f);
+                Matrix4x3& m = locals[c * boneCount + b];
+                m.fromQuaternion(slerp(rotations[b][k], rotations[b][k + 1], alpha));
+                
+                const std::vector<float>& tt = translationTimes[b];
+                k = findKey(tt, t);
+                alpha = std::min(std::max((t - tt[k]) / (tt[k + 1] - tt[k]), 0.0f), 1.0f);
+                m.setTranslation(translations[b][k] + (translations[b][k + 1] - translations[b][k]) * alpha);
+            }
+        }
+        sink = locals[ops - 1].tx;
+    });
+    report("binary search + slerp", scalar, scalar);
+    
+    std::vector<AnimationCursor> cursors(characterCount);
+    std::vector<AnimationJob> jobs(characterCount);
+    double sampled = nsPerOp(ops, passes, [&]() {
+        ++frame;
+        for (size_t c = 0; c < characterCount; ++c) {
+            AnimationJob job = { &clip, &cursors[c], clipTime(c), &locals[c * boneCount] };
+            jobs[c] = job;
+        }
+        sampleClips(&jobs[0], characterCount);
+        sink = locals[ops - 1].tx;
+    });
+    report("sampleClips", sampled, scalar);
+    printf("%-40s %8.3f ms\n", "sampleClips (1000 x 100 bones)", sampled * ops * 1e-6);
+}
+
+/*
+    四元数直接旋转向量与先构造矩阵再相乘的对比
+    每个方位旋转k个向量，k越大构造矩阵的开销分摊得越少，报告每个向量的平均时间，基准为k个向量都用rotate()
+ */
+static void benchRotate() {
+    const size_t n = 4096;
+    const int passes = 200;
+    
+    std::vector<Quaternion> q(n);
+    std::vector<Vector3> v(n), out(n);
+    for (size_t i = 0; i < n; ++i) {
+        q[i].setToRotateObjectToInertial(EulerAngles(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi)));
+        v[i] = Vector3(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f));
+    }
+    
+    const size_t counts[] = { 1, 2, 4, 8, 16 };
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        size_t k = counts[c];
+        size_t orientations = n / k;
+        char name[64];
+        double direct = nsPerOp(n, passes, [&]() {
+            for (size_t i = 0; i < orientations; ++i) {
+                for (size_t j = 0; j < k; ++j) {
+                    out[i * k + j] = rotate(q[i], v[i * k + j]);
+                }
+            }
+            sink = out[n - 1].x;
+        });
+        snprintf(name, sizeof(name), "rotate (%d vectors each)", (int)k);
+        report(name, direct, direct);
+        snprintf(name, sizeof(name), "fromQuaternion + v * m (%d vectors each)", (int)k);
+        report(name, nsPerOp(n, passes, [&]() {
+            for (size_t i = 0; i < orientations; ++i) {
+                Matrix4x3 m;
+                m.fromQuaternion(q[i]);
+                for (size_t j = 0; j < k; ++j) {
+                    out[i * k + j] = v[i * k + j] * m;
+                }
+            }
+            sink = out[n - 1].x;
+        }), direct);
+    }
+    
+    // 批量版本：每个方位一个向量，以及一个方位旋转整个数组
+    std::vector<Matrix4x3> matrices(n);
+    double many = nsPerOp(n, passes, [&]() {
+        fromQuaternionN(&q[0], &matrices[0], n);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = v[i] * matrices[i];
+        }
+        sink = out[n - 1].x;
+    });
+    report("fromQuaternionN + v * m", many, many);
+    report("rotateN (one vector each)", nsPerOp(n, passes, [&]() {
+        rotateN(&q[0], &v[0], &out[0], n);
+        sink = out[n - 1].x;
+    }), many);
+    
+    double single = nsPerOp(n, passes, [&]() {
+        Matrix4x3 m;
+        m.fromQuaternion(q[0]);
+        transformDirections(m, &v[0], &out[0], n);
+        sink = out[n - 1].x;
+    });
+    report("fromQuaternion + transformDirections", single, single);
+    report("rotateN (one orientation)", nsPerOp(n, passes, [&]() {
+        rotateN(q[0], &v[0], &out[0], n);
+        sink = out[n - 1].x;
+    }), single);
+}
+
+/*
+    混合5个姿态：混合树中两两调用slerp()累加，与blendN的两种精度模式对比
+    叠加层：逐个调用diff()和pow()，与additiveDeltaN、blendAdditiveN对比
+ */
+static void benchBlend() {
+    const size_t n = 4096;
+    const int poseCount = 5;
+    const int passes = 100;
+    
+    std::vector<std::vector<Quaternion> > poses(poseCount, std::vector<Quaternion>(n));
+    for (size_t i = 0; i < n; ++i) {
+        for (int k = 0; k < poseCount; ++k) {
+            poses[k][i].setToRotateObjectToInertial(EulerAngles(randomFloat(-0.5f, 0.5f), randomFloat(-0.5f, 0.5f), randomFloat(-0.5f, 0.5f)));
+        }
+    }
+    const float weights[poseCount] = { 0.1f, 0.3f, 0.2f, 0.25f, 0.15f };
+    const Quaternion* posePointers[poseCount];
+    for (int k = 0; k < poseCount; ++k) {
+        posePointers[k] = &poses[k][0];
+    }
+    std::vector<Quaternion> out(n), delta(n);
+    
+    double chained = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            Quaternion q = poses[0][i];
+            float total = weights[0];
+            for (int k = 1; k < poseCount; ++k) {
+                total += weights[k];
+                q = slerp(q, poses[k][i], weights[k] / total);
+            }
+            out[i] = q;
+        }
+        sink = out[n - 1].w;
+    });
+    report("chained slerp (5 poses)", chained, chained);
+    report("blendN (fast)", nsPerOp(n, passes, [&]() {
+        blendN(posePointers, weights, poseCount, &out[0], n, kBlendFast);
+        sink = out[n - 1].w;
+    }), chained);
+    report("blendN (accurate)", nsPerOp(n, passes, [&]() {
+        blendN(posePointers, weights, poseCount, &out[0], n, kBlendAccurate);
+        sink = out[n - 1].w;
+    }), chained);
+    
+    double additive = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = poses[0][i] * pow(diff(poses[1][i], poses[2][i]), 0.5f);
+        }
+        sink = out[n - 1].w;
+    });
+    report("diff + pow (additive)", additive, additive);
+    report("additiveDeltaN + blendAdditiveN", nsPerOp(n, passes, [&]() {
+        additiveDeltaN(&poses[1][0], &poses[2][0], &delta[0], n);
+        blendAdditiveN(&poses[0][0], &delta[0], 0.5f, &out[0], n);
+        sink = out[n - 1].w;
+    }), additive);
+}
+
+/*
+    刚体方位积分：20万个刚体积分一帧，基准为AoS数组上逐个计算四元数乘积再正则化
+    另外对比批量重新正交化旋转矩阵与逐个做Gram-Schmidt
+ */
+static void benchIntegrate() {
+    const size_t n = 200000;
+    const int passes = 20;
+    const float dt = 1.0f / 60.0f;
+    
+    std::vector<Quaternion> q(n);
+    std::vector<Vector3> omega(n);
+    for (size_t i = 0; i < n; ++i) {
+        q[i].setToRotateObjectToInertial(EulerAngles(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi)));
+        omega[i] = Vector3(randomFloat(-5.0f, 5.0f), randomFloat(-5.0f, 5.0f), randomFloat(-5.0f, 5.0f));
+    }
+    QuaternionStream orientations;
+    orientations.fromQuaternionArray(&q[0], n);
+    Vector3Stream angularVelocity;
+    angularVelocity.fromVector3Array(&omega[0], n);
+    
+    double scalar = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            // 本库的q * w即Hamilton乘积w * q
+            Quaternion w;
+            w.w = 0.0f;
+            w.x = omega[i].x;
+            w.y = omega[i].y;
+            w.z = omega[i].z;
+            Quaternion d = q[i] * w;
+            q[i].w += 0.5f * dt * d.w;
+            q[i].x += 0.5f * dt * d.x;
+            q[i].y += 0.5f * dt * d.y;
+            q[i].z += 0.5f * dt * d.z;
+            q[i].normalize();
+        }
+        sink = q[n - 1].w;
+    });
+    report("Quaternion integrate + normalize", scalar, scalar);
+    double firstOrder = nsPerOp(n, passes, [&]() {
+        integrateOrientations(orientations, angularVelocity, dt, kIntegrateFirstOrder);
+        sink = orientations.w()[n - 1];
+    });
+    report("integrateOrientations (first order)", firstOrder, scalar);
+    report("integrateOrientations (exponential)", nsPerOp(n, passes, [&]() {
+        integrateOrientations(orientations, angularVelocity, dt, kIntegrateExponential);
+        sink = orientations.w()[n - 1];
+    }), scalar);
+    printf("%-40s %8.3f ms\n", "first order tick (200k bodies)", firstOrder * n * 1e-6);
+    
+    // 已经正则化的数据，漂移修正只读不写
+    double normalized = nsPerOp(n, passes, [&]() {
+        normalize(orientations);
+        sink = orientations.w()[n - 1];
+    });
+    report("normalize (QuaternionStream)", normalized, normalized);
+    report("renormalize (no drift)", nsPerOp(n, passes, [&]() {
+        sink = (float)renormalize(orientations);
+    }), normalized);
+    
+    std::vector<RotationMatrix> m(n);
+    fromObjectToInertialQuaternionN(&q[0], &m[0], n);
+    double gramSchmidt = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            Vector3 r1(m[i].m11, m[i].m12, m[i].m13);
+            Vector3 r2(m[i].m21, m[i].m22, m[i].m23);
+            r1.normalize();
+            r2 = r2 - (r1 * r2) * r1;
+            r2.normalize();
+            Vector3 r3 = crossProduct(r1, r2);
+            m[i].m11 = r1.x; m[i].m12 = r1.y; m[i].m13 = r1.z;
+            m[i].m21 = r2.x; m[i].m22 = r2.y; m[i].m23 = r2.z;
+            m[i].m31 = r3.x; m[i].m32 = r3.y; m[i].m33 = r3.z;
+        }
+        sink = m[n - 1].m11;
+    });
+    report("Gram-Schmidt (RotationMatrix)", gramSchmidt, gramSchmidt);
+    report("orthonormalizeN", nsPerOp(n, passes, [&]() {
+        orthonormalizeN(&m[0], n);
+        sink = m[n - 1].m11;
+    }), gramSchmidt);
+}
+
+/*
+    变换层次：10万个节点，每帧随机移动5%的节点
+    分别用骨骼（1000副各100根骨头）和随机树两种形状，对比update()与全部重新计算的updateAll()
+ */
+static void benchHierarchyShape(const char* shape, bool skeletons) {
+    const size_t n = 100000;
+    const size_t moved = n / 20;
+    const int passes = 50;
+    
+    TransformHierarchy hierarchy;
+    hierarchy.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        Matrix4x3 local;
+        local.setupLocalToParent(Vector3(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f)),
+                                 EulerAngles(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi)));
+        int parent = TransformHierarchy::kNoParent;
+        if (skeletons) {
+            // 每副骨骼的第一根骨头是根，其余骨头挂在同一骨骼中更早的骨头上
+            size_t bone = i % 100;
+            if (bone > 0) {
+                parent = (int)(i - 1 - rand() % std::min(bone, (size_t)4));
+            }
+        } else if (i > 0) {
+            parent = rand() % (int)i;
+        }
+        hierarchy.addNode(parent, local);
+    }
+    hierarchy.updateAll();
+    
+    std::vector<int> movedNodes(moved);
+    std::vector<Matrix4x3> movedLocals(moved);
+    for (size_t i = 0; i < moved; ++i) {
+        movedNodes[i] = rand() % (int)n;
+        movedLocals[i] = hierarchy.getLocal(movedNodes[i]);
+    }
+    auto move = [&]() {
+        for (size_t i = 0; i < moved; ++i) {
+            hierarchy.setLocal(movedNodes[i], movedLocals[i]);
+        }
+    };
+    
+    char name[64];
+    double all = nsPerOp(n, passes, [&]() {
+        move();
+        hierarchy.updateAll();
+        sink = hierarchy.getWorld((int)n - 1).tx;
+    });
+    snprintf(name, sizeof(name), "updateAll (%s)", shape);
+    report(name, all, all);
+    size_t count = 0;
+    double incremental = nsPerOp(n, passes, [&]() {
+        move();
+        count = hierarchy.update();
+        sink = hierarchy.getWorld((int)n - 1).tx;
+    });
+    snprintf(name, sizeof(name), "update, 5%% moved (%s)", shape);
+    report(name, incremental, all);
+    printf("%-40s %8.3f ms  %zu nodes recomputed\n", "update tick (100k nodes)", incremental * n * 1e-6, count);
+    
+    // 只移动少数节点时只遍历它们的子树
+    double few = nsPerOp(1, passes, [&]() {
+        hierarchy.setLocal(movedNodes[0], movedLocals[0]);
+        count = hierarchy.update();
+        sink = hierarchy.getWorld((int)n - 1).tx;
+    });
+    printf("%-40s %8.3f ms  %zu nodes recomputed\n", "update tick, 1 moved", few * 1e-6, count);
+}
+
+static void benchHierarchy() {
+    benchHierarchyShape("skeletons", true);
+    benchHierarchyShape("random tree", false);
+}
+
+/*
+    旋转矩阵批量变换向量：同一个矩阵旋转一组向量（AoS与SoA），以及每个矩阵旋转一个向量
+    基准为逐个调用inertialToObject/objectToInertial
+ */
+static void benchRotationMatrixTransform() {
+    const size_t n = 1 << 18;
+    const int passes = 20;
+    
+    std::vector<Vector3> v(n), out(n);
+    std::vector<RotationMatrix> m(n);
+    for (size_t i = 0; i < n; ++i) {
+        v[i] = Vector3(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f));
+        m[i].setup(EulerAngles(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi)));
+    }
+    Vector3Stream in, streamOut;
+    in.fromVector3Array(&v[0], n);
+    const RotationMatrix& r = m[0];
+    
+    double single = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = r.inertialToObject(v[i]);
+        }
+        sink = out[n - 1].x;
+    });
+    report("inertialToObject", single, single);
+    report("inertialToObjectN (AoS)", nsPerOp(n, passes, [&]() {
+        inertialToObjectN(r, &v[0], &out[0], n);
+        sink = out[n - 1].x;
+    }), single);
+    report("inertialToObjectN (SoA)", nsPerOp(n, passes, [&]() {
+        inertialToObjectN(r, in, streamOut);
+        sink = streamOut.x()[n - 1];
+    }), single);
+    
+    double transposed = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = r.objectToInertial(v[i]);
+        }
+        sink = out[n - 1].x;
+    });
+    report("objectToInertial", transposed, transposed);
+    report("objectToInertialN (AoS)", nsPerOp(n, passes, [&]() {
+        objectToInertialN(r, &v[0], &out[0], n);
+        sink = out[n - 1].x;
+    }), transposed);
+    report("objectToInertialN (SoA)", nsPerOp(n, passes, [&]() {
+        objectToInertialN(r, in, streamOut);
+        sink = streamOut.x()[n - 1];
+    }), transposed);
+    
+    double each = nsPerOp(n, passes, [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = m[i].inertialToObject(v[i]);
+        }
+        sink = out[n - 1].x;
+    });
+    report("m[i].inertialToObject(v[i])", each, each);
+    report("inertialToObjectN (per matrix)", nsPerOp(n, passes, [&]() {
+        inertialToObjectN(&m[0], &v[0], &out[0], n);
+        sink = out[n - 1].x;
+    }), each);
+}
+
+/*
+    边界框：点集的边界框与逐点标量min/max对比，变换边界框与变换8个顶点后重新求边界框对比
+ */
+static void benchAABB() {
+    const size_t n = 1 << 18;
+    const int passes = 20;
+    
+    std::vector<Vector3> points(n);
+    for (size_t i = 0; i < n; ++i) {
+        points[i] = Vector3(randomFloat(-100.0f, 100.0f), randomFloat(-100.0f, 100.0f), randomFloat(-100.0f, 100.0f));
+    }
+    Vector3Stream stream;
+    stream.fromVector3Array(&points[0], n);
+    
+    double scalarBounds = nsPerOp(n, passes, [&]() {
+        AABB3 box;
+        box.empty();
+        for (size_t i = 0; i < n; ++i) {
+            box.add(points[i]);
+        }
+        sink = box.max.x;
+    });
+    report("AABB3::add (per point)", scalarBounds, scalarBounds);
+    report("computeBounds (AoS)", nsPerOp(n, passes, [&]() {
+        sink = computeBounds(&points[0], n).max.x;
+    }), scalarBounds);
+    report("computeBounds (SoA)", nsPerOp(n, passes, [&]() {
+        sink = computeBounds(stream).max.x;
+    }), scalarBounds);
+    
+    const size_t boxCount = 1 << 16;
+    std::vector<AABB3> boxes(boxCount), out(boxCount);
+    std::vector<Matrix4x3> m(boxCount);
+    for (size_t i = 0; i < boxCount; ++i) {
+        Vector3 c(randomFloat(-100.0f, 100.0f), randomFloat(-100.0f, 100.0f), randomFloat(-100.0f, 100.0f));
+        Vector3 e(randomFloat(0.5f, 5.0f), randomFloat(0.5f, 5.0f), randomFloat(0.5f, 5.0f));
+        boxes[i].min = c - e;
+        boxes[i].max = c + e;
+        m[i].setupLocalToParent(c, EulerAngles(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi)));
+    }
+    
+    double corners = nsPerOp(boxCount, passes, [&]() {
+        for (size_t i = 0; i < boxCount; ++i) {
+            out[i].empty();
+            for (int k = 0; k < 8; ++k) {
+                out[i].add(boxes[i].corner(k) * m[i]);
+            }
+        }
+        sink = out[boxCount - 1].max.x;
+    });
+    report("8 corners * Matrix4x3", corners, corners);
+    report("setToTransformedBox", nsPerOp(boxCount, passes, [&]() {
+        for (size_t i = 0; i < boxCount; ++i) {
+            out[i].setToTransformedBox(boxes[i], m[i]);
+        }
+        sink = out[boxCount - 1].max.x;
+    }), corners);
+    report("transformBoxes (per matrix)", nsPerOp(boxCount, passes, [&]() {
+        transformBoxes(&m[0], &boxes[0], &out[0], boxCount);
+        sink = out[boxCount - 1].max.x;
+    }), corners);
+    
+    bool* hits = new bool[boxCount];
+    double scalarOverlap = nsPerOp(boxCount, passes, [&]() {
+        size_t count = 0;
+        for (size_t i = 0; i < boxCount; ++i) {
+            hits[i] = intersectAABBs(boxes[i], out[i]);
+            count += hits[i];
+        }
+        sink = (float)count;
+    });
+    report("intersectAABBs", scalarOverlap, scalarOverlap);
+    report("intersectAABBsN", nsPerOp(boxCount, passes, [&]() {
+        sink = (float)intersectAABBsN(&boxes[0], &out[0], hits, boxCount);
+    }), scalarOverlap);
+    delete [] hits;
+    
+    double scalarUnion = nsPerOp(boxCount, passes, [&]() {
+        for (size_t i = 0; i < boxCount; ++i) {
+            AABB3 box = boxes[i];
+            box.add(out[i]);
+            out[i] = box;
+        }
+        sink = out[boxCount - 1].max.x;
+    });
+    report("AABB3::add (box)", scalarUnion, scalarUnion);
+    report("unionBoxes", nsPerOp(boxCount, passes, [&]() {
+        unionBoxes(&boxes[0], &out[0], &out[0], boxCount);
+        sink = out[boxCount - 1].max.x;
+    }), scalarUnion);
+}
+
+/*
+    视锥裁剪：50万个物体（球和边界框各一半），按区域存放，基准为逐个调用Frustum::isVisible
+    另外测试时间相关性（相机不动的第二帧）和4个阴影级联一遍完成
+ */
+static void benchCulling() {
+    const size_t n = 500000;
+    const int passes = 10;
+    const int cascadeCount = 4;
+    
+    CullingSet objects(n);
+    std::vector<Vector3> centers(n);
+    std::vector<float> radii(n);
+    std::vector<AABB3> boxes(n);
+    Vector3 cluster;
+    for (size_t i = 0; i < n; ++i) {
+        // 场景按区域存放，每64个物体在同一个区域内
+        if (i % 64 == 0) {
+            cluster = Vector3(randomFloat(-1000.0f, 1000.0f), 0.0f, randomFloat(-1000.0f, 1000.0f));
+        }
+        centers[i] = cluster + Vector3(randomFloat(-20.0f, 20.0f), randomFloat(-50.0f, 50.0f), randomFloat(-20.0f, 20.0f));
+        radii[i] = randomFloat(0.5f, 5.0f);
+        Vector3 e(radii[i], radii[i] * 0.5f, radii[i]);
+        boxes[i].min = centers[i] - e;
+        boxes[i].max = centers[i] + e;
+        if (i % 2 == 0) {
+            objects.setSphere(i, centers[i], radii[i]);
+        } else {
+            objects.setBox(i, boxes[i]);
+        }
+    }
+    
+    Matrix4x3 worldToCamera;
+    worldToCamera.setupParentToLocal(Vector3(0.0f, 10.0f, 0.0f), EulerAngles(0.3f, 0.1f, 0.0f));
+    Frustum frustum;
+    frustum.setupPerspective(worldToCamera, fovToZoom(1.2f), fovToZoom(0.8f), 0.5f, 500.0f);
+    std::vector<unsigned int> visible(n);
+    std::vector<unsigned char> lastPlane(n, 0);
+    
+    double scalar = nsPerOp(n, passes, [&]() {
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i) {
+            bool v = i % 2 == 0 ? frustum.isVisible(centers[i], radii[i]) : frustum.isVisible(boxes[i]);
+            if (v) {
+                visible[count++] = (unsigned int)i;
+            }
+        }
+        sink = (float)count;
+    });
+    report("Frustum::isVisible (500k objects)", scalar, scalar);
+    report("cull", nsPerOp(n, passes, [&]() {
+        sink = (float)cull(frustum, objects, &visible[0]);
+    }), scalar);
+    report("cull (temporal coherence)", nsPerOp(n, passes, [&]() {
+        sink = (float)cull(frustum, objects, &visible[0], &lastPlane[0]);
+    }), scalar);
+    
+    // 阴影级联：沿视线方向排列的4个正交视体
+    Frustum cascades[cascadeCount];
+    std::vector<std::vector<unsigned int> > cascadeVisible(cascadeCount, std::vector<unsigned int>(n));
+    CullingView views[cascadeCount];
+    for (int k = 0; k < cascadeCount; ++k) {
+        Matrix4x3 lightView;
+        lightView.setupParentToLocal(Vector3(0.0f, 200.0f, 100.0f * k), EulerAngles(0.0f, 1.2f, 0.0f));
+        cascades[k].setupOrthographic(lightView, 50.0f * (k + 1), 50.0f * (k + 1), 0.0f, 400.0f);
+        views[k].frustum = &cascades[k];
+        views[k].visible = &cascadeVisible[k][0];
+        views[k].lastPlane = NULL;
+    }
+    double separate = nsPerOp(n, passes, [&]() {
+        for (int k = 0; k < cascadeCount; ++k) {
+            sink = (float)cull(cascades[k], objects, &cascadeVisible[k][0]);
+        }
+    });
+    report("cull x 4 cascades", separate, separate);
+    report("cull (4 views in one pass)", nsPerOp(n, passes, [&]() {
+        cull(views, cascadeCount, objects);
+        sink = (float)views[0].visibleCount;
+    }), separate);
+}
+
+/*
+    BVH：100万个球的构造、refit和各种查询，查询与逐个测试所有图元对比
+    逐个测试太慢，只用少量查询计时
+ */
+static void benchBVH() {
+    const size_t n = 1000000;
+    const size_t queryCount = 100000;
+    const size_t bruteCount = 20;
+    
+    std::vector<Vector3> centers(n);
+    std::vector<float> radii(n);
+    for (size_t i = 0; i < n; ++i) {
+        centers[i] = Vector3(randomFloat(-1000.0f, 1000.0f), randomFloat(-100.0f, 100.0f), randomFloat(-1000.0f, 1000.0f));
+        radii[i] = randomFloat(0.1f, 2.0f);
+    }
+    std::vector<Vector3> rayOrg(queryCount), rayDelta(queryCount);
+    for (size_t i = 0; i < queryCount; ++i) {
+        rayOrg[i] = Vector3(randomFloat(-1000.0f, 1000.0f), randomFloat(-100.0f, 100.0f), randomFloat(-1000.0f, 1000.0f));
+        rayDelta[i] = Vector3(randomFloat(-200.0f, 200.0f), randomFloat(-20.0f, 20.0f), randomFloat(-200.0f, 200.0f));
+    }
+    
+    BVH bvh;
+    double build = nsPerOp(n, 1, [&]() {
+        bvh.build(&centers[0], &radii[0], n);
+    });
+    report("BVH::build (1M spheres, per primitive)", build, build);
+    report("BVH::refit", nsPerOp(n, 3, [&]() {
+        bvh.refit(&centers[0], &radii[0]);
+    }), build);
+    
+    double bruteRay = nsPerOp(bruteCount, 1, [&]() {
+        for (size_t q = 0; q < bruteCount; ++q) {
+            const Vector3& o = rayOrg[q];
+            const Vector3& d = rayDelta[q];
+            float a = d * d, best = 1.0f;
+            for (size_t i = 0; i < n; ++i) {
+                Vector3 m = o - centers[i];
+                float b = m * d, c = m * m - radii[i] * radii[i];
+                float disc = b * b - a * c;
+                if (c <= 0.0f) {
+                    best = 0.0f;
+                } else if (b <= 0.0f && disc >= 0.0f) {
+                    best = std::min(best, (-b - sqrtf(disc)) / a);
+                }
+            }
+            sink = best;
+        }
+    });
+    report("ray vs all spheres", bruteRay, bruteRay);
+    report("BVH::rayCast", nsPerOp(queryCount, 1, [&]() {
+        BVHRayHit hit;
+        for (size_t q = 0; q < queryCount; ++q) {
+            if (bvh.rayCast(rayOrg[q], rayDelta[q], &hit)) {
+                sink = hit.t;
+            }
+        }
+    }), bruteRay);
+    std::vector<BVHRayHit> hits(queryCount);
+    report("rayCastN", nsPerOp(queryCount, 1, [&]() {
+        rayCastN(bvh, &rayOrg[0], &rayDelta[0], &hits[0], queryCount);
+        sink = hits[0].t;
+    }), bruteRay);
+    
+    double bruteNearest = nsPerOp(bruteCount, 1, [&]() {
+        for (size_t q = 0; q < bruteCount; ++q) {
+            float best = FLT_MAX;
+            for (size_t i = 0; i < n; ++i) {
+                best = std::min(best, vectorMag(rayOrg[q] - centers[i]) - radii[i]);
+            }
+            sink = best;
+        }
+    });
+    report("nearest by testing all spheres", bruteNearest, bruteNearest);
+    report("BVH::nearest", nsPerOp(queryCount, 1, [&]() {
+        float distance;
+        for (size_t q = 0; q < queryCount; ++q) {
+            sink = (float)bvh.nearest(rayOrg[q], FLT_MAX, &distance);
+        }
+    }), bruteNearest);
+    std::vector<int> nearest(queryCount);
+    report("nearestN", nsPerOp(queryCount, 1, [&]() {
+        nearestN(bvh, &rayOrg[0], &nearest[0], NULL, queryCount);
+        sink = (float)nearest[0];
+    }), bruteNearest);
+    report("BVH::nearestK (k = 16)", nsPerOp(queryCount, 1, [&]() {
+        int indices[16];
+        for (size_t q = 0; q < queryCount; ++q) {
+            sink = (float)bvh.nearestK(rayOrg[q], 16, indices, NULL);
+        }
+    }), bruteNearest);
+    
+    double bruteOverlap = nsPerOp(bruteCount, 1, [&]() {
+        for (size_t q = 0; q < bruteCount; ++q) {
+            size_t count = 0;
+            for (size_t i = 0; i < n; ++i) {
+                Vector3 m = rayOrg[q] - centers[i];
+                float reach = 10.0f + radii[i];
+                count += m * m <= reach * reach;
+            }
+            sink = (float)count;
+        }
+    });
+    report("sphere overlap by testing all", bruteOverlap, bruteOverlap);
+    report("BVH::overlapSphere (r = 10)", nsPerOp(queryCount, 1, [&]() {
+        std::vector<int> result;
+        for (size_t q = 0; q < queryCount; ++q) {
+            result.clear();
+            sink = (float)bvh.overlapSphere(rayOrg[q], 10.0f, result);
+        }
+    }), bruteOverlap);
+}
+
+/*
+    射线相交：单条射线逐个测试与8条射线的射线包对比，另外报告每个核每秒的百万次射线测试数
+    三角形一批64个，相当于BVH叶子或者一个网格块
+ */
+static void reportRate(const char* name, double ns) {
+    printf("%-40s %8.2f Mrays/s\n", name, 1000.0 / ns);
+}
+
+static void benchIntersection() {
+    const size_t rayCount = 65536;
+    const size_t triangleCount = 64;
+    const int passes = 3;
+    
+    std::vector<Vector3> rayOrg(rayCount), rayDelta(rayCount);
+    for (size_t i = 0; i < rayCount; ++i) {
+        rayOrg[i] = Vector3(randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), -20.0f);
+        rayDelta[i] = Vector3(randomFloat(-5.0f, 5.0f), randomFloat(-5.0f, 5.0f), 40.0f);
+    }
+    std::vector<RayPacket> packets(rayCount / kRayPacketSize);
+    for (size_t p = 0; p < packets.size(); ++p) {
+        packets[p].set(&rayOrg[p * kRayPacketSize], &rayDelta[p * kRayPacketSize], kRayPacketSize);
+    }
+    std::vector<Vector3> vertices(3 * triangleCount);
+    for (size_t i = 0; i < triangleCount; ++i) {
+        Vector3 c(randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f));
+        for (int k = 0; k < 3; ++k) {
+            vertices[3 * i + k] = c + Vector3(randomFloat(-2.0f, 2.0f), randomFloat(-2.0f, 2.0f), randomFloat(-2.0f, 2.0f));
+        }
+    }
+    AABB3 box;
+    box.min = Vector3(-3.0f, -3.0f, -3.0f);
+    box.max = Vector3(3.0f, 3.0f, 3.0f);
+    Vector3 planeNormal = Vector3(0.2f, 0.1f, -1.0f);
+    planeNormal.normalize();
+    
+    size_t tests = rayCount * triangleCount;
+    double scalar = nsPerOp(tests, passes, [&]() {
+        float t;
+        for (size_t i = 0; i < rayCount; ++i) {
+            float best = FLT_MAX;
+            for (size_t k = 0; k < triangleCount; ++k) {
+                if (rayTriangleIntersect(rayOrg[i], rayDelta[i], vertices[3 * k], vertices[3 * k + 1], vertices[3 * k + 2],
+                                         kCullBackFace, &t) && t < best) {
+                    best = t;
+                }
+            }
+            sink = best;
+        }
+    });
+    report("rayTriangleIntersect (x 64 triangles)", scalar, scalar);
+    double packet = nsPerOp(tests, passes, [&]() {
+        RayPacketHit hit;
+        for (size_t p = 0; p < packets.size(); ++p) {
+            hit.reset();
+            sink = (float)rayTrianglesIntersect(packets[p], &vertices[0], NULL, triangleCount, kCullBackFace, hit);
+        }
+    });
+    report("rayTrianglesIntersect (packet)", packet, scalar);
+    reportRate("  ray-triangle, single ray", scalar);
+    reportRate("  ray-triangle, packet", packet);
+    
+    float t[kRayPacketSize];
+    double scalarBox = nsPerOp(rayCount, passes * 16, [&]() {
+        float hitT;
+        for (size_t i = 0; i < rayCount; ++i) {
+            sink = rayAABBIntersect(rayOrg[i], rayDelta[i], box, &hitT) ? hitT : 0.0f;
+        }
+    });
+    report("rayAABBIntersect", scalarBox, scalarBox);
+    double packetBox = nsPerOp(rayCount, passes * 16, [&]() {
+        for (size_t p = 0; p < packets.size(); ++p) {
+            sink = (float)rayAABBIntersect(packets[p], box, t);
+        }
+    });
+    report("rayAABBIntersect (packet)", packetBox, scalarBox);
+    reportRate("  ray-AABB, packet", packetBox);
+    
+    double scalarSphere = nsPerOp(rayCount, passes * 16, [&]() {
+        float hitT;
+        for (size_t i = 0; i < rayCount; ++i) {
+            sink = raySphereIntersect(rayOrg[i], rayDelta[i], kZeroVector, 4.0f, &hitT) ? hitT : 0.0f;
+        }
+    });
+    report("raySphereIntersect", scalarSphere, scalarSphere);
+    double packetSphere = nsPerOp(rayCount, passes * 16, [&]() {
+        for (size_t p = 0; p < packets.size(); ++p) {
+            sink = (float)raySphereIntersect(packets[p], kZeroVector, 4.0f, t);
+        }
+    });
+    report("raySphereIntersect (packet)", packetSphere, scalarSphere);
+    reportRate("  ray-sphere, packet", packetSphere);
+    
+    double scalarPlane = nsPerOp(rayCount, passes * 16, [&]() {
+        float hitT;
+        for (size_t i = 0; i < rayCount; ++i) {
+            sink = rayPlaneIntersect(rayOrg[i], rayDelta[i], planeNormal, 1.0f, kCullNone, &hitT) ? hitT : 0.0f;
+        }
+    });
+    report("rayPlaneIntersect", scalarPlane, scalarPlane);
+    double packetPlane = nsPerOp(rayCount, passes * 16, [&]() {
+        for (size_t p = 0; p < packets.size(); ++p) {
+            sink = (float)rayPlaneIntersect(packets[p], planeNormal, 1.0f, kCullNone, t);
+        }
+    });
+    report("rayPlaneIntersect (packet)", packetPlane, scalarPlane);
+    reportRate("  ray-plane, packet", packetPlane);
+}
+
+/*
+    运行时分派：同样的批量核函数在当前CPU支持的每一级指令集上各跑一遍，与标量版本对比
+    测完后恢复原来的一级
+ */
+static void benchDispatch() {
+    const size_t n = 4096;
+    const int passes = 500;
+    
+    Matrix4x3 m;
+    m.setupLocalToParent(Vector3(1.0f, 2.0f, 3.0f), EulerAngles(0.3f, 0.2f, 0.1f));
+    std::vector<Vector3> points(n), transformed(n);
+    std::vector<Quaternion> a(n), b(n), slerped(n);
+    std::vector<Matrix4x3> matrices(n);
+    std::vector<float> t(n);
+    Vector3Stream stream(n);
+    for (size_t i = 0; i < n; ++i) {
+        points[i] = Vector3(randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f));
+        stream.set(i, points[i]);
+        a[i].setToRotateObjectToInertial(EulerAngles(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi)));
+        b[i].setToRotateObjectToInertial(EulerAngles(randomFloat(-kPi, kPi), randomFloat(-1.5f, 1.5f), randomFloat(-kPi, kPi)));
+        t[i] = randomFloat(0.0f, 1.0f);
+    }
+    
+    SimdTier original = activeSimdTier();
+    double scalar[4] = {0.0, 0.0, 0.0, 0.0};
+    for (int tier = kSimdTierScalar; tier < kSimdTierCount; ++tier) {
+        if (!simdTierSupported((SimdTier)tier)) {
+            continue;
+        }
+        setSimdTier((SimdTier)tier);
+        
+        double ns[4];
+        ns[0] = nsPerOp(n, passes, [&]() {
+            transformPoints(m, &points[0], &transformed[0], n);
+            sink = transformed[n - 1].x;
+        });
+        ns[1] = nsPerOp(n, passes, [&]() {
+            fromQuaternionN(&a[0], &matrices[0], n);
+            sink = matrices[n - 1].tx;
+        });
+        ns[2] = nsPerOp(n, passes, [&]() {
+            slerpN(&a[0], &b[0], &t[0], &slerped[0], n, kSlerpFast);
+            sink = slerped[n - 1].w;
+        });
+        ns[3] = nsPerOp(n, passes, [&]() {
+            normalize(stream);
+            sink = stream.x()[n - 1];
+        });
+        if (tier == kSimdTierScalar) {
+            for (int i = 0; i < 4; ++i) {
+                scalar[i] = ns[i];
+            }
+        }
+        
+        static const char* const names[4] = {"transformPoints", "fromQuaternionN", "slerpN (fast)", "normalize (Vector3Stream)"};
+        char name[64];
+        for (int i = 0; i < 4; ++i) {
+            snprintf(name, sizeof(name), "%s [%s]", names[i], simdTierName((SimdTier)tier));
+            report(name, ns[i], scalar[i]);
+        }
+    }
+    setSimdTier(original);
+}
+
+int main(int argc, const char * argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--accuracy") == 0) {
+        return runAccuracyCheck(argc, argv);
+    }
+    if (argc > 1) {
+        return runBenchSuite(argc, argv);
+    }
+    
+    benchTransformClass();
+    benchSlerp();
+    benchTrig();
+    benchConversions();
+    benchSkinning();
+    benchPackedQuaternion();
+    benchAnimation();
+    benchRotate();
+    benchBlend();
+    benchIntegrate();
+    benchHierarchy();
+    benchRotationMatrixTransform();
+    benchAABB();
+    benchCulling();
+    benchBVH();
+    benchIntersection();
+    benchDispatch();
+#if MATH_INSTRUMENT
+    printf("\n");
+    instrumentReport(stdout);
+#endif
+    return 0;
+}
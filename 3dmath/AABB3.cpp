@@ -0,0 +1,343 @@
+//
+//  AABB3.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "AABB3.hpp"
+
+#include <assert.h>
+#include <float.h>
+#include <vector>
+
+#include "Matrix4x3.hpp"
+#include "Vector3Stream.hpp"
+#include "SimdUtil.h"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
+
+Vector3 AABB3::corner(int i) const {
+    assert(i >= 0 && i <= 7);
+    return Vector3((i & 1) ? max.x : min.x,
+                   (i & 2) ? max.y : min.y,
+                   (i & 4) ? max.z : min.z);
+}
+
+void AABB3::empty() {
+    min.x = min.y = min.z = FLT_MAX;
+    max.x = max.y = max.z = -FLT_MAX;
+}
+
+void AABB3::add(const Vector3& p) {
+    if (p.x < min.x) min.x = p.x;
+    if (p.x > max.x) max.x = p.x;
+    if (p.y < min.y) min.y = p.y;
+    if (p.y > max.y) max.y = p.y;
+    if (p.z < min.z) min.z = p.z;
+    if (p.z > max.z) max.z = p.z;
+}
+
+void AABB3::add(const AABB3& box) {
+    if (box.min.x < min.x) min.x = box.min.x;
+    if (box.max.x > max.x) max.x = box.max.x;
+    if (box.min.y < min.y) min.y = box.min.y;
+    if (box.max.y > max.y) max.y = box.max.y;
+    if (box.min.z < min.z) min.z = box.min.z;
+    if (box.max.z > max.z) max.z = box.max.z;
+}
+
+/*
+    变换边界框，参看12.4.4
+    中心c和半尺寸e，变换后c' = c * M + t
+    e'的每个分量是e在该轴上投影的最大值，即e'x = |m11| * ex + |m21| * ey + |m31| * ez，其余两轴类推
+    只有平移时直接平移min和max
+ */
+void AABB3::setToTransformedBox(const AABB3& box, const Matrix4x3& m) {
+    if (box.isEmpty()) {
+        empty();
+        return;
+    }
+    if (m.transformClass <= kTransformTranslation) {
+        Vector3 t = getTranslation(m);
+        min = box.min + t;
+        max = box.max + t;
+        return;
+    }
+
+    Vector3 c = box.center();
+    Vector3 e = box.max - c;
+    Vector3 newCenter(c.x * m.m11 + c.y * m.m21 + c.z * m.m31 + m.tx,
+                      c.x * m.m12 + c.y * m.m22 + c.z * m.m32 + m.ty,
+                      c.x * m.m13 + c.y * m.m23 + c.z * m.m33 + m.tz);
+    Vector3 newExtent(e.x * fabsf(m.m11) + e.y * fabsf(m.m21) + e.z * fabsf(m.m31),
+                      e.x * fabsf(m.m12) + e.y * fabsf(m.m22) + e.z * fabsf(m.m32),
+                      e.x * fabsf(m.m13) + e.y * fabsf(m.m23) + e.z * fabsf(m.m33));
+    min = newCenter - newExtent;
+    max = newCenter + newExtent;
+}
+
+bool AABB3::isEmpty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+bool AABB3::contains(const Vector3& p) const {
+    return p.x >= min.x && p.x <= max.x &&
+           p.y >= min.y && p.y <= max.y &&
+           p.z >= min.z && p.z <= max.z;
+}
+
+Vector3 AABB3::closestPointTo(const Vector3& p) const {
+    Vector3 r;
+    r.x = p.x < min.x ? min.x : (p.x > max.x ? max.x : p.x);
+    r.y = p.y < min.y ? min.y : (p.y > max.y ? max.y : p.y);
+    r.z = p.z < min.z ? min.z : (p.z > max.z ? max.z : p.z);
+    return r;
+}
+
+// 两个边界框是否相交，参看13.18：任何一个轴上的区间不重叠就不相交
+bool intersectAABBs(const AABB3& box1, const AABB3& box2, AABB3* boxIntersect) {
+    if (box1.min.x > box2.max.x) return false;
+    if (box1.max.x < box2.min.x) return false;
+    if (box1.min.y > box2.max.y) return false;
+    if (box1.max.y < box2.min.y) return false;
+    if (box1.min.z > box2.max.z) return false;
+    if (box1.max.z < box2.min.z) return false;
+
+    if (boxIntersect != NULL) {
+        boxIntersect->min.x = box1.min.x > box2.min.x ? box1.min.x : box2.min.x;
+        boxIntersect->max.x = box1.max.x < box2.max.x ? box1.max.x : box2.max.x;
+        boxIntersect->min.y = box1.min.y > box2.min.y ? box1.min.y : box2.min.y;
+        boxIntersect->max.y = box1.max.y < box2.max.y ? box1.max.y : box2.max.y;
+        boxIntersect->min.z = box1.min.z > box2.min.z ? box1.min.z : box2.min.z;
+        boxIntersect->max.z = box1.max.z < box2.max.z ? box1.max.z : box2.max.z;
+    }
+    return true;
+}
+
+/*
+    边界框按6个float的步长转置到寄存器中，依次为min.x、min.y、min.z、max.x、max.y、max.z
+ */
+static const size_t kBoxStride = sizeof(AABB3) / sizeof(float);
+
+static inline void loadBoxes(const AABB3* box, size_t count, SimdFloat* f) {
+    simdLoadFields(reinterpret_cast<const float*>(box), kBoxStride, 6, count, f);
+}
+
+static inline void storeBoxes(AABB3* box, size_t count, const SimdFloat* f) {
+    simdStoreFields(reinterpret_cast<float*>(box), kBoxStride, 6, count, f);
+}
+
+// 把寄存器中的kSimdWidth个最小值和最大值归约到box中
+static inline void reduceBounds(AABB3& box, SimdFloat minX, SimdFloat minY, SimdFloat minZ,
+                                SimdFloat maxX, SimdFloat maxY, SimdFloat maxZ) {
+    float lanes[6][kSimdWidth];
+    simdStoreU(lanes[0], minX);
+    simdStoreU(lanes[1], minY);
+    simdStoreU(lanes[2], minZ);
+    simdStoreU(lanes[3], maxX);
+    simdStoreU(lanes[4], maxY);
+    simdStoreU(lanes[5], maxZ);
+    for (int i = 0; i < kSimdWidth; ++i) {
+        AABB3 lane;
+        lane.min = Vector3(lanes[0][i], lanes[1][i], lanes[2][i]);
+        lane.max = Vector3(lanes[3][i], lanes[4][i], lanes[5][i]);
+        box.add(lane);
+    }
+}
+
+/*
+    点集的边界框
+    每块在寄存器中分别累计kSimdWidth组最小值和最大值，块末尾归约为一个边界框，写入该块自己的位置
+    各块的结果最后在当前线程合并，不需要加锁
+ */
+template <typename Kernel>
+static AABB3 reduceBoundsByChunk(size_t n, size_t grain, const Kernel& kernel) {
+    AABB3 box;
+    box.empty();
+    if (n == 0) {
+        return box;
+    }
+    std::vector<AABB3> partial((n + grain - 1) / grain, box);
+    parallelFor(n, grain, [&](size_t begin, size_t end) {
+        kernel(begin, end, partial[begin / grain]);
+    });
+    for (size_t k = 0; k < partial.size(); ++k) {
+        box.add(partial[k]);
+    }
+    return box;
+}
+
+AABB3 computeBounds(const Vector3* points, size_t n) {
+    MATH_INSTRUMENT_BATCH(ComputeBounds, n);
+    const float* p = reinterpret_cast<const float*>(points);
+    return reduceBoundsByChunk(n, cacheChunk(3 * sizeof(float)), [&](size_t begin, size_t end, AABB3& box) {
+        size_t i = begin;
+        if (i + kSimdWidth <= end) {
+            SimdFloat x, y, z;
+            simdLoadVector3(p + 3 * i, x, y, z);
+            SimdFloat minX = x, minY = y, minZ = z, maxX = x, maxY = y, maxZ = z;
+            for (i += kSimdWidth; i + kSimdWidth <= end; i += kSimdWidth) {
+                simdLoadVector3(p + 3 * i, x, y, z);
+                minX = simdMin(minX, x); maxX = simdMax(maxX, x);
+                minY = simdMin(minY, y); maxY = simdMax(maxY, y);
+                minZ = simdMin(minZ, z); maxZ = simdMax(maxZ, z);
+            }
+            reduceBounds(box, minX, minY, minZ, maxX, maxY, maxZ);
+        }
+        for (; i < end; ++i) {
+            box.add(points[i]);
+        }
+    });
+}
+
+// SoA形式，补齐部分为0不能参与归约，最后不足一组的点逐个添加
+AABB3 computeBounds(const Vector3Stream& points) {
+    MATH_INSTRUMENT_BATCH(ComputeBoundsStream, points.size());
+    const float* xs = points.x();
+    const float* ys = points.y();
+    const float* zs = points.z();
+    return reduceBoundsByChunk(points.size(), cacheChunk(3 * sizeof(float)), [&](size_t begin, size_t end, AABB3& box) {
+        size_t i = begin;
+        if (i + kSimdWidth <= end) {
+            SimdFloat minX = simdLoad(xs + i), minY = simdLoad(ys + i), minZ = simdLoad(zs + i);
+            SimdFloat maxX = minX, maxY = minY, maxZ = minZ;
+            for (i += kSimdWidth; i + kSimdWidth <= end; i += kSimdWidth) {
+                SimdFloat x = simdLoad(xs + i), y = simdLoad(ys + i), z = simdLoad(zs + i);
+                minX = simdMin(minX, x); maxX = simdMax(maxX, x);
+                minY = simdMin(minY, y); maxY = simdMax(maxY, y);
+                minZ = simdMin(minZ, z); maxZ = simdMax(maxZ, z);
+            }
+            reduceBounds(box, minX, minY, minZ, maxX, maxY, maxZ);
+        }
+        for (; i < end; ++i) {
+            box.add(Vector3(xs[i], ys[i], zs[i]));
+        }
+    });
+}
+
+/*
+    批量变换边界框，与setToTransformedBox相同的绝对值方法
+    r为矩阵的12个元素，空的边界框变换后仍为空
+ */
+static inline void simdTransformBox(const SimdFloat* r, SimdFloat* f) {
+    SimdFloat half = simdSet(0.5f);
+    SimdMask isEmpty = simdMaskOr(simdCmpGt(f[0], f[3]), simdMaskOr(simdCmpGt(f[1], f[4]), simdCmpGt(f[2], f[5])));
+    SimdFloat cx = simdMul(half, simdAdd(f[0], f[3]));
+    SimdFloat cy = simdMul(half, simdAdd(f[1], f[4]));
+    SimdFloat cz = simdMul(half, simdAdd(f[2], f[5]));
+    SimdFloat ex = simdSub(f[3], cx);
+    SimdFloat ey = simdSub(f[4], cy);
+    SimdFloat ez = simdSub(f[5], cz);
+    SimdFloat emptyMin = simdSet(FLT_MAX), emptyMax = simdSet(-FLT_MAX);
+    for (int k = 0; k < 3; ++k) {
+        SimdFloat c = simdMadd(cz, r[6 + k], simdMadd(cy, r[3 + k], simdMadd(cx, r[k], r[9 + k])));
+        SimdFloat e = simdMadd(ez, simdAbs(r[6 + k]), simdMadd(ey, simdAbs(r[3 + k]), simdMul(ex, simdAbs(r[k]))));
+        f[k] = simdSelect(isEmpty, emptyMin, simdSub(c, e));
+        f[3 + k] = simdSelect(isEmpty, emptyMax, simdAdd(c, e));
+    }
+}
+
+void transformBoxes(const Matrix4x3& m, const AABB3* in, AABB3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(TransformBoxes, n);
+    const float* e = &m.m11;
+    SimdFloat r[12];
+    for (int k = 0; k < 12; ++k) {
+        r[k] = simdSet(e[k]);
+    }
+    parallelForGroups(n, kSimdWidth, cacheChunk(12 * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat f[6];
+        loadBoxes(in + i, count, f);
+        simdTransformBox(r, f);
+        storeBoxes(out + i, count, f);
+    });
+}
+
+// 矩阵按13个float的步长（包括transformClass）读入前12个元素
+void transformBoxes(const Matrix4x3* m, const AABB3* in, AABB3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(TransformBoxesPerBox, n);
+    const float* matrices = reinterpret_cast<const float*>(m);
+    const size_t stride = sizeof(Matrix4x3) / sizeof(float);
+    parallelForGroups(n, kSimdWidth, cacheChunk(24 * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat r[12], f[6];
+        simdLoadFields(matrices + stride * i, stride, 12, count, r);
+        loadBoxes(in + i, count, f);
+        simdTransformBox(r, f);
+        storeBoxes(out + i, count, f);
+    });
+}
+
+void unionBoxes(const AABB3* a, const AABB3* b, AABB3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(UnionBoxes, n);
+    parallelForGroups(n, kSimdWidth, cacheChunk(18 * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat fa[6], fb[6];
+        loadBoxes(a + i, count, fa);
+        loadBoxes(b + i, count, fb);
+        for (int k = 0; k < 3; ++k) {
+            fa[k] = simdMin(fa[k], fb[k]);
+            fa[3 + k] = simdMax(fa[3 + k], fb[3 + k]);
+        }
+        storeBoxes(out + i, count, fa);
+    });
+}
+
+/*
+    6个比较都成立才相交，与intersectAABBs相同
+    每组的结果由掩码的各位写出，各块的计数最后相加
+ */
+static inline int simdOverlap(const SimdFloat* a, const SimdFloat* b) {
+    SimdMask overlap = simdMaskAnd(simdCmpLe(a[0], b[3]), simdCmpGe(a[3], b[0]));
+    overlap = simdMaskAnd(overlap, simdMaskAnd(simdCmpLe(a[1], b[4]), simdCmpGe(a[4], b[1])));
+    overlap = simdMaskAnd(overlap, simdMaskAnd(simdCmpLe(a[2], b[5]), simdCmpGe(a[5], b[2])));
+    return simdMoveMask(overlap);
+}
+
+static inline size_t writeOverlap(int mask, bool* result, size_t count) {
+    size_t hits = 0;
+    for (size_t k = 0; k < count; ++k) {
+        result[k] = (mask >> k) & 1;
+        hits += result[k];
+    }
+    return hits;
+}
+
+template <typename Kernel>
+static size_t countByChunk(size_t n, size_t grain, const Kernel& kernel) {
+    if (n == 0) {
+        return 0;
+    }
+    std::vector<size_t> partial((n + grain - 1) / grain, 0);
+    parallelForGroups(n, kSimdWidth, grain, [&](size_t i, size_t count) {
+        partial[i / grain] += kernel(i, count);
+    });
+    size_t total = 0;
+    for (size_t k = 0; k < partial.size(); ++k) {
+        total += partial[k];
+    }
+    return total;
+}
+
+size_t intersectAABBsN(const AABB3& box, const AABB3* boxes, bool* result, size_t n) {
+    MATH_INSTRUMENT_BATCH(IntersectAABBsN, n);
+    SimdFloat a[6];
+    const float* e = &box.min.x;
+    for (int k = 0; k < 6; ++k) {
+        a[k] = simdSet(e[k]);
+    }
+    return countByChunk(n, cacheChunk(7 * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat b[6];
+        loadBoxes(boxes + i, count, b);
+        return writeOverlap(simdOverlap(a, b), result + i, count);
+    });
+}
+
+size_t intersectAABBsN(const AABB3* a, const AABB3* b, bool* result, size_t n) {
+    MATH_INSTRUMENT_BATCH(IntersectAABBsNPairwise, n);
+    return countByChunk(n, cacheChunk(13 * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat fa[6], fb[6];
+        loadBoxes(a + i, count, fa);
+        loadBoxes(b + i, count, fb);
+        return writeOverlap(simdOverlap(fa, fb), result + i, count);
+    });
+}
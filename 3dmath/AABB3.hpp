@@ -0,0 +1,89 @@
+//
+//  AABB3.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef AABB3_hpp
+#define AABB3_hpp
+
+#include <stddef.h>
+
+#include "Vector3.hpp"
+
+class Matrix4x3;
+class Vector3Stream;
+
+/*
+    AABB3类
+    3D轴对齐矩形边界框，参看12.4
+    空的边界框min为最大的float，max为最小的float，这样add任何点之后都是正确的
+ */
+class AABB3 {
+
+public:
+    Vector3 min;
+    Vector3 max;
+
+    // 尺寸、中心点和8个顶点之一
+    Vector3 size() const { return max - min; }
+    float xSize() const { return max.x - min.x; }
+    float ySize() const { return max.y - min.y; }
+    float zSize() const { return max.z - min.z; }
+    Vector3 center() const { return (min + max) * 0.5f; }
+
+    /*
+        取8个顶点中的一个，i的三个二进制位依次选择x、y、z取min还是max
+        比如0为min，7为max
+     */
+    Vector3 corner(int i) const;
+
+    // 清空边界框
+    void empty();
+
+    // 向边界框中添加点或另一个边界框
+    void add(const Vector3& p);
+    void add(const AABB3& box);
+
+    /*
+        变换边界框并计算新的AABB，参看12.4.4
+        新的中心是原中心的变换，新的半尺寸是原半尺寸乘以3x3部分各元素的绝对值，不需要变换8个顶点
+        得到的AABB包含变换后的原AABB，可能比原物体变换后的AABB大
+     */
+    void setToTransformedBox(const AABB3& box, const Matrix4x3& m);
+
+    // 是否为空，任何一个轴上min > max就是空的
+    bool isEmpty() const;
+
+    // 是否包含点p
+    bool contains(const Vector3& p) const;
+
+    // 返回边界框上离p最近的点
+    Vector3 closestPointTo(const Vector3& p) const;
+};
+
+// 两个边界框是否相交，相交时可以返回相交部分，参看13.18
+extern bool intersectAABBs(const AABB3& box1, const AABB3& box2, AABB3* boxIntersect = 0);
+
+/*
+    批量运算，多个点或边界框在SIMD寄存器中同时计算，数量较多时分给多个线程
+ */
+
+// n个点的边界框，n为0时返回空的边界框
+extern AABB3 computeBounds(const Vector3* points, size_t n);
+extern AABB3 computeBounds(const Vector3Stream& points);
+
+// out[i]为in[i]变换后的边界框，同一个矩阵或每个边界框各自的矩阵，in和out可以是同一个数组
+extern void transformBoxes(const Matrix4x3& m, const AABB3* in, AABB3* out, size_t n);
+extern void transformBoxes(const Matrix4x3* m, const AABB3* in, AABB3* out, size_t n);
+
+// out[i]为a[i]和b[i]的并集
+extern void unionBoxes(const AABB3* a, const AABB3* b, AABB3* out, size_t n);
+
+// result[i]为box与boxes[i]（或a[i]与b[i]）是否相交，返回相交的个数。空的边界框与任何边界框都不相交
+extern size_t intersectAABBsN(const AABB3& box, const AABB3* boxes, bool* result, size_t n);
+extern size_t intersectAABBsN(const AABB3* a, const AABB3* b, bool* result, size_t n);
+
+#endif /* AABB3_hpp */
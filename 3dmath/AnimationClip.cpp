@@ -0,0 +1,367 @@
+//
+//  AnimationClip.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "AnimationClip.hpp"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include "Vector3.hpp"
+#include "Quaternion.hpp"
+#include "Matrix4x3.hpp"
+#include "SimdUtil.h"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
+
+/*
+    AnimationCursor的数据块由若干个float数组组成，每种轨道依次占用一段：
+    时间段起点、1 / (终点 - 起点)，然后是时间段两端的关键帧，旋转每个关键帧4个数组，平移和缩放各3个
+    数组按每kLaneBlock个骨骼交错存放（AoSoA）：先是前8个骨骼的全部数组，再是后8个骨骼的
+    采样时每次读取的仍是连续对齐的kSimdWidth个值，读取关键帧流时一个骨骼的一条轨道只落在少数几个缓存行中
+ */
+static const int kChannelWidth[AnimationClip::kChannelCount] = { 4, 3, 3 };
+static const int kChannelSlot[AnimationClip::kChannelCount] = { 0, 10, 18 };
+static const int kSlotCount = 26;
+static const size_t kLaneBlock = 8;
+static_assert(kLaneBlock % kSimdWidth == 0, "kLaneBlock must be a multiple of kSimdWidth");
+
+// 第s个数组中骨骼b的值
+static inline float& lane(float* data, int s, size_t b) {
+    return data[(b / kLaneBlock * kSlotCount + s) * kLaneBlock + b % kLaneBlock];
+}
+
+static inline int startSlot(int channel) { return kChannelSlot[channel]; }
+static inline int inverseSlot(int channel) { return kChannelSlot[channel] + 1; }
+
+// 第key个端点（0为起点，1为终点）的第k个分量
+static inline int valueSlot(int channel, int key, int k) {
+    return kChannelSlot[channel] + 2 + key * kChannelWidth[channel] + k;
+}
+
+// 最近一次build()的编号，所有片段共用，同一地址上先后构造的片段也不会得到相同的编号
+static std::atomic<unsigned> lastBuildGeneration(0);
+
+AnimationClip::AnimationClip(int boneCount) : bones(boneCount), length(0.0f), buildGeneration(0) {
+    assert(boneCount >= 0 && boneCount <= 0xffff);
+}
+
+void AnimationClip::addKey(int bone, int channel, float time, float w, float x, float y, float z) {
+    assert(bone >= 0 && bone < bones);
+    Key key;
+    key.needTime = time;
+    key.time = time;
+    key.inverseDuration = 0.0f;
+    key.bone = (unsigned short)bone;
+    key.channel = (unsigned short)channel;
+    key.value[0] = w;
+    key.value[1] = x;
+    key.value[2] = y;
+    key.value[3] = z;
+    sourceKeys.push_back(key);
+}
+
+void AnimationClip::addRotationKey(int bone, float time, const Quaternion& q) {
+    addKey(bone, kRotation, time, q.w, q.x, q.y, q.z);
+}
+
+void AnimationClip::addTranslationKey(int bone, float time, const Vector3& v) {
+    addKey(bone, kTranslation, time, v.x, v.y, v.z, 0.0f);
+}
+
+void AnimationClip::addScaleKey(int bone, float time, const Vector3& s) {
+    addKey(bone, kScale, time, s.x, s.y, s.z, 0.0f);
+}
+
+/*
+    先按轨道分组（同一轨道保持加入的顺序），整理每条轨道：
+    去掉时间重复的关键帧，旋转正则化并使相邻关键帧的点乘非负，这样采样时不需要判断符号
+    第一个关键帧放入firstKeys，其余的needTime取前一个关键帧的时间，最后按needTime排序
+    needTime相同时按骨骼排序，读取流时对各数组的写入也大致是顺序的
+    整理在副本上进行，sourceKeys只按轨道排序，之后再加入的关键帧在下次build()时一起整理
+ */
+void AnimationClip::build() {
+    std::stable_sort(sourceKeys.begin(), sourceKeys.end(), [](const Key& a, const Key& b) {
+        return a.bone != b.bone ? a.bone < b.bone : a.channel < b.channel;
+    });
+
+    firstKeys.clear();
+    stream.clear();
+    length = 0.0f;
+
+    // 没有关键帧的轨道使用默认值
+    for (int b = 0; b < bones; ++b) {
+        for (int c = 0; c < kChannelCount; ++c) {
+            Key key;
+            key.needTime = key.time = key.inverseDuration = 0.0f;
+            key.bone = (unsigned short)b;
+            key.channel = (unsigned short)c;
+            key.value[0] = c == kTranslation ? 0.0f : 1.0f;
+            key.value[1] = c == kScale ? 1.0f : 0.0f;
+            key.value[2] = c == kScale ? 1.0f : 0.0f;
+            key.value[3] = 0.0f;
+            firstKeys.push_back(key);
+        }
+    }
+
+    std::vector<Key> track;
+    size_t i = 0;
+    while (i < sourceKeys.size()) {
+        track.clear();
+        size_t j = i;
+        for (; j < sourceKeys.size() && sourceKeys[j].bone == sourceKeys[i].bone &&
+               sourceKeys[j].channel == sourceKeys[i].channel; ++j) {
+            Key key = sourceKeys[j];
+            if (key.channel == kRotation) {
+                float magSq = key.value[0] * key.value[0] + key.value[1] * key.value[1] +
+                              key.value[2] * key.value[2] + key.value[3] * key.value[3];
+                assert(magSq > 0.0f);
+                float oneOverMag = 1.0f / sqrtf(magSq);
+                for (int k = 0; k < 4; ++k) {
+                    key.value[k] *= oneOverMag;
+                }
+            }
+            if (!track.empty() && key.time <= track.back().time) {
+                assert(key.time == track.back().time);
+                track.back() = key;
+            } else {
+                track.push_back(key);
+            }
+        }
+        i = j;
+
+        for (size_t k = 1; k < track.size(); ++k) {
+            if (track[k].channel == kRotation) {
+                const float* a = track[k - 1].value;
+                float* b = track[k].value;
+                if (a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0.0f) {
+                    b[0] = -b[0];
+                    b[1] = -b[1];
+                    b[2] = -b[2];
+                    b[3] = -b[3];
+                }
+            }
+            track[k].needTime = track[k - 1].time;
+            track[k].inverseDuration = 1.0f / (track[k].time - track[k].needTime);
+            stream.push_back(track[k]);
+        }
+        firstKeys[track[0].bone * kChannelCount + track[0].channel] = track[0];
+        length = std::max(length, track.back().time);
+    }
+
+    std::sort(stream.begin(), stream.end(), [](const Key& a, const Key& b) {
+        if (a.needTime != b.needTime) {
+            return a.needTime < b.needTime;
+        }
+        return a.bone != b.bone ? a.bone < b.bone : a.channel < b.channel;
+    });
+
+    buildGeneration = ++lastBuildGeneration;
+}
+
+AnimationCursor::AnimationCursor()
+    : boundGeneration(0), position(0), currentTime(-FLT_MAX), padded(0), data(NULL) {
+}
+
+AnimationCursor::AnimationCursor(const AnimationCursor& a)
+    : boundGeneration(a.boundGeneration), position(a.position), currentTime(a.currentTime), padded(0), data(NULL) {
+    allocate(a.padded);
+    if (padded > 0) {
+        memcpy(data, a.data, kSlotCount * padded * sizeof(float));
+    }
+}
+
+AnimationCursor::~AnimationCursor() {
+    release();
+}
+
+AnimationCursor& AnimationCursor::operator =(const AnimationCursor& a) {
+    if (this != &a) {
+        release();
+        allocate(a.padded);
+        if (padded > 0) {
+            memcpy(data, a.data, kSlotCount * padded * sizeof(float));
+        }
+        boundGeneration = a.boundGeneration;
+        position = a.position;
+        currentTime = a.currentTime;
+    }
+    return *this;
+}
+
+void AnimationCursor::allocate(size_t n) {
+    padded = (n + 15) & ~(size_t)15;
+    if (padded == 0) {
+        return;
+    }
+    data = (float*)alignedAlloc(kSlotCount * padded * sizeof(float));
+    if (data == NULL) {
+        padded = 0;
+        throw std::bad_alloc();
+    }
+}
+
+void AnimationCursor::release() {
+    alignedFree(data);
+    data = NULL;
+    padded = 0;
+}
+
+/*
+    每条轨道的两端都置为第一个关键帧，1 / (终点 - 起点)为0，插值结果就是这个关键帧
+    补齐部分的旋转置为单位四元数，采样时正则化不会出现除以0
+ */
+void AnimationCursor::reset(const AnimationClip& clip) {
+    if (padded < (size_t)clip.boneCount() || data == NULL) {
+        release();
+        allocate(clip.boneCount());
+    }
+    if (padded > 0) {
+        memset(data, 0, kSlotCount * padded * sizeof(float));
+        for (size_t i = 0; i < padded; ++i) {
+            lane(data, valueSlot(AnimationClip::kRotation, 0, 0), i) = 1.0f;
+            lane(data, valueSlot(AnimationClip::kRotation, 1, 0), i) = 1.0f;
+        }
+    }
+
+    const std::vector<AnimationClip::Key>& keys = clip.initialKeys();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const AnimationClip::Key& key = keys[i];
+        int c = key.channel;
+        lane(data, startSlot(c), key.bone) = key.time;
+        lane(data, inverseSlot(c), key.bone) = 0.0f;
+        for (int k = 0; k < kChannelWidth[c]; ++k) {
+            lane(data, valueSlot(c, 0, k), key.bone) = key.value[k];
+            lane(data, valueSlot(c, 1, k), key.bone) = key.value[k];
+        }
+    }
+
+    boundGeneration = clip.generation();
+    position = 0;
+    currentTime = -FLT_MAX;
+}
+
+// 原来的终点变为起点，新关键帧成为终点
+void AnimationCursor::applyKey(const AnimationClip::Key& key) {
+    int c = key.channel;
+    size_t b = key.bone;
+    lane(data, startSlot(c), b) = key.needTime;
+    lane(data, inverseSlot(c), b) = key.inverseDuration;
+    for (int k = 0; k < kChannelWidth[c]; ++k) {
+        lane(data, valueSlot(c, 0, k), b) = lane(data, valueSlot(c, 1, k), b);
+        lane(data, valueSlot(c, 1, k), b) = key.value[k];
+    }
+}
+
+void AnimationCursor::seek(const AnimationClip& clip, float time) {
+    const std::vector<AnimationClip::Key>& keys = clip.keyStream();
+    if (boundGeneration == 0 || clip.generation() != boundGeneration || time < currentTime || position > keys.size()) {
+        reset(clip);
+    }
+    while (position < keys.size() && keys[position].needTime <= time) {
+        applyKey(keys[position]);
+        ++position;
+    }
+    currentTime = time;
+}
+
+/*
+    每次处理kSimdWidth个骨骼：三种轨道分别求插值参数并插值，旋转正则化后按fromQuaternion的公式构造矩阵，
+    3x3部分的各行再乘以对应的缩放因子（先缩放再旋转），最后一行是平移
+    缩放为1时是刚体变换，三个缩放因子相等且为正时是均匀缩放
+ */
+void AnimationCursor::sample(const AnimationClip& clip, float time, Matrix4x3* locals) {
+    seek(clip, time);
+
+    float* out = reinterpret_cast<float*>(locals);
+    const size_t stride = sizeof(Matrix4x3) / sizeof(float);
+    const size_t n = clip.boneCount();
+    SimdFloat t = simdSet(time);
+    SimdFloat zero = simdZero();
+    SimdFloat one = simdSet(1.0f);
+    SimdFloat two = simdSet(2.0f);
+    for (size_t i = 0; i < n; i += kSimdWidth) {
+        size_t count = std::min((size_t)kSimdWidth, n - i);
+
+        SimdFloat v[AnimationClip::kChannelCount][4];
+        for (int c = 0; c < AnimationClip::kChannelCount; ++c) {
+            SimdFloat alpha = simdMul(simdSub(t, simdLoad(&lane(data, startSlot(c), i))), simdLoad(&lane(data, inverseSlot(c), i)));
+            alpha = simdMin(simdMax(alpha, zero), one);
+            for (int k = 0; k < kChannelWidth[c]; ++k) {
+                SimdFloat a = simdLoad(&lane(data, valueSlot(c, 0, k), i));
+                SimdFloat b = simdLoad(&lane(data, valueSlot(c, 1, k), i));
+                v[c][k] = simdMadd(simdSub(b, a), alpha, a);
+            }
+        }
+
+        SimdFloat* q = v[AnimationClip::kRotation];
+        SimdFloat magSq = simdMadd(q[3], q[3], simdMadd(q[2], q[2], simdMadd(q[1], q[1], simdMul(q[0], q[0]))));
+        SimdFloat oneOverMag = simdRsqrt(magSq);
+        SimdFloat w = simdMul(q[0], oneOverMag), x = simdMul(q[1], oneOverMag);
+        SimdFloat y = simdMul(q[2], oneOverMag), z = simdMul(q[3], oneOverMag);
+        SimdFloat ww = simdMul(two, w), xx = simdMul(two, x), yy = simdMul(two, y), zz = simdMul(two, z);
+
+        const SimdFloat* s = v[AnimationClip::kScale];
+        const SimdFloat* p = v[AnimationClip::kTranslation];
+        SimdFloat m[12];
+        m[0] = simdMul(simdNmadd(zz, z, simdNmadd(yy, y, one)), s[0]);
+        m[1] = simdMul(simdMadd(ww, z, simdMul(xx, y)), s[0]);
+        m[2] = simdMul(simdNmadd(ww, y, simdMul(xx, z)), s[0]);
+        m[3] = simdMul(simdNmadd(ww, z, simdMul(xx, y)), s[1]);
+        m[4] = simdMul(simdNmadd(zz, z, simdNmadd(xx, x, one)), s[1]);
+        m[5] = simdMul(simdMadd(ww, x, simdMul(yy, z)), s[1]);
+        m[6] = simdMul(simdMadd(ww, y, simdMul(xx, z)), s[2]);
+        m[7] = simdMul(simdNmadd(ww, x, simdMul(yy, z)), s[2]);
+        m[8] = simdMul(simdNmadd(yy, y, simdNmadd(xx, x, one)), s[2]);
+        m[9] = p[0];
+        m[10] = p[1];
+        m[11] = p[2];
+        simdStoreFields(out + stride * i, stride, 12, count, m);
+
+        SimdMask uniform = simdMaskAnd(simdMaskAnd(simdCmpEq(s[0], s[1]), simdCmpEq(s[1], s[2])), simdCmpGt(s[0], zero));
+        int uniformBits = simdMoveMask(uniform);
+        int rigidBits = simdMoveMask(simdMaskAnd(uniform, simdCmpEq(s[0], one)));
+        for (size_t k = 0; k < count; ++k) {
+            if (rigidBits & (1 << k)) {
+                locals[i + k].transformClass = kTransformRigid;
+            } else if (uniformBits & (1 << k)) {
+                locals[i + k].transformClass = kTransformUniformScale;
+            } else {
+                locals[i + k].transformClass = kTransformGeneral;
+            }
+        }
+    }
+}
+
+/*
+    每个实例的骨骼数组是连续的，实例之间互不依赖，按实例分块并行
+    总骨骼数小于kParallelThreshold时线程调度的开销超过收益，直接串行
+ */
+void sampleClips(const AnimationJob* jobs, size_t jobCount) {
+    size_t boneTotal = 0;
+    for (size_t j = 0; j < jobCount; ++j) {
+        boneTotal += jobs[j].clip->boneCount();
+    }
+    // 按骨骼计数
+    MATH_INSTRUMENT_BATCH(SampleClips, boneTotal);
+
+    auto body = [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j) {
+            jobs[j].cursor->sample(*jobs[j].clip, jobs[j].time, jobs[j].locals);
+        }
+    };
+    if (boneTotal < kParallelThreshold) {
+        body(0, jobCount);
+    } else {
+        ThreadPool::instance().parallelFor(jobCount, 0, body);
+    }
+}
@@ -0,0 +1,149 @@
+//
+//  AnimationClip.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef AnimationClip_hpp
+#define AnimationClip_hpp
+
+#include <stddef.h>
+#include <vector>
+
+class Vector3;
+class Quaternion;
+class Matrix4x3;
+
+/*
+    AnimationClip类
+    关键帧动画片段，每个骨骼有旋转（Quaternion）、平移和缩放（Vector3）三条轨道，各轨道的关键帧时间可以不同
+    关键帧不按轨道存放，而是按“需要它的时刻”排成一个流：关键帧j在播放到关键帧j-1的时间时才参与插值，
+    所以同一时间段内所有骨骼要用到的关键帧在内存中是连续的
+    播放时AnimationCursor沿着流顺序读取，不需要对每条轨道二分查找
+ */
+class AnimationClip {
+
+public:
+    // 轨道类型
+    enum Channel {
+        kRotation = 0,
+        kTranslation,
+        kScale,
+        kChannelCount
+    };
+
+    /*
+        流中的一个关键帧，needTime是同一轨道上一个关键帧的时间，即以它为终点的时间段的起点
+        inverseDuration = 1 / (time - needTime)，读取时不需要再做除法，第一个关键帧为0
+        旋转的value为w、x、y、z，平移和缩放只用前三个，每个关键帧32字节
+     */
+    struct Key {
+        float needTime;
+        float time;
+        float inverseDuration;
+        unsigned short bone;
+        unsigned short channel;
+        float value[4];
+    };
+
+    explicit AnimationClip(int boneCount = 0);
+
+    int boneCount() const { return bones; }
+
+    // 最后一个关键帧的时间，build()之后有效
+    float duration() const { return length; }
+
+    /*
+        添加关键帧，同一轨道的关键帧时间必须递增，时间相同时后加入的代替前一个
+        没有关键帧的轨道取单位旋转、零平移和单位缩放
+        build()之后还可以继续添加，再次调用build()后生效
+     */
+    void addRotationKey(int bone, float time, const Quaternion& q);
+    void addTranslationKey(int bone, float time, const Vector3& v);
+    void addScaleKey(int bone, float time, const Vector3& s);
+
+    /*
+        添加完关键帧后调用，排列出采样用的关键帧流
+        原始关键帧保留在片段中，每次都用到目前为止加入的全部关键帧重新排列，重复调用结果相同
+     */
+    void build();
+
+    // 每次build()得到一个新的编号（所有片段之间也不重复），没有build()过时为0；游标据此判断是否要从头读取
+    unsigned generation() const { return buildGeneration; }
+
+    // 每条轨道的第一个关键帧，按骨骼和轨道类型排列
+    const std::vector<Key>& initialKeys() const { return firstKeys; }
+
+    // 其余关键帧，按needTime排序
+    const std::vector<Key>& keyStream() const { return stream; }
+
+private:
+    int bones;
+    float length;
+    unsigned buildGeneration;
+    // 加入的原始关键帧，按轨道排序，同一轨道保持加入的顺序
+    std::vector<Key> sourceKeys;
+    std::vector<Key> firstKeys;
+    std::vector<Key> stream;
+
+    void addKey(int bone, int channel, float time, float w, float x, float y, float z);
+};
+
+/*
+    AnimationCursor类
+    一个动画实例的播放状态：关键帧流的读取位置，以及每条轨道当前时间段两端的关键帧（按骨骼分块的SoA）
+    时间单调递增时每次只读取新经过的关键帧，时间倒退（如循环播放回到开头）、换了片段或片段重新build()过时从头重新读取
+    采样时所有骨骼一起插值，旋转用正则化线性插值（nlerp），build()已使相邻关键帧的点乘非负
+ */
+class AnimationCursor {
+
+public:
+    AnimationCursor();
+    AnimationCursor(const AnimationCursor& a);
+    ~AnimationCursor();
+
+    AnimationCursor& operator =(const AnimationCursor& a);
+
+    // 回到片段开头
+    void reset(const AnimationClip& clip);
+
+    // 移动到time，读取经过的关键帧
+    void seek(const AnimationClip& clip, float time);
+
+    // 当前时间
+    float time() const { return currentTime; }
+
+    /*
+        在time采样，每个骨骼的局部->父变换写入locals[0]到locals[boneCount - 1]
+        变换顺序为先缩放，再旋转，最后平移
+     */
+    void sample(const AnimationClip& clip, float time, Matrix4x3* locals);
+
+private:
+    unsigned boundGeneration;
+    size_t position;
+    float currentTime;
+    size_t padded;
+    float* data;
+
+    void allocate(size_t n);
+    void release();
+    void applyKey(const AnimationClip::Key& key);
+};
+
+/*
+    一次采样多个动画实例，比如同屏的一群角色
+    各实例分给不同的线程，总骨骼数较少时在当前线程执行
+ */
+struct AnimationJob {
+    const AnimationClip* clip;
+    AnimationCursor* cursor;
+    float time;
+    Matrix4x3* locals;
+};
+
+extern void sampleClips(const AnimationJob* jobs, size_t jobCount);
+
+#endif /* AnimationClip_hpp */
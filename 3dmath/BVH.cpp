@@ -0,0 +1,963 @@
+//
+//  BVH.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "BVH.hpp"
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+#include "Vector3.hpp"
+#include "AABB3.hpp"
+#include "SimdUtil.h"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
+
+// 宽节点的子节点数，至少为4，SIMD宽度更大时与之相同，一个节点的子节点用整数个寄存器测试
+static const int kBVHWidth = kSimdWidth >= 4 ? kSimdWidth : 4;
+
+// 叶子中最多的图元个数
+static const int kMaxLeafSize = 4;
+
+// 每个轴上的分箱个数
+static const int kBinCount = 16;
+
+// 超过这个深度后按中位数分割，限制树的深度和遍历栈的大小
+static const int kMaxBuildDepth = 64;
+
+// 遍历栈的大小，深度受kMaxBuildDepth限制，每层最多压入kBVHWidth - 1个节点
+static const int kStackSize = 1024;
+
+/*
+    宽节点
+    child[k] >= 0为子节点的下标，child[k] < 0为叶子，图元从~child[k]开始，共count[k]个
+    空的位置count为0，AABB是远处的一个点，任何查询都不会进入
+ */
+struct BVHNode {
+    float minX[kBVHWidth], minY[kBVHWidth], minZ[kBVHWidth];
+    float maxX[kBVHWidth], maxY[kBVHWidth], maxZ[kBVHWidth];
+    int child[kBVHWidth];
+    int count[kBVHWidth];
+};
+
+/*
+    构造和refit中使用的AABB，min和-max各占4个float（最后一个不用，为0）
+    合并两个AABB就是对8个float逐个取最小值，每次用kSimdWidth个通道
+ */
+struct Box {
+    float min[4], negMax[4];
+};
+
+static inline void setBox(Box& box, float minX, float minY, float minZ, float maxX, float maxY, float maxZ) {
+    box.min[0] = minX; box.min[1] = minY; box.min[2] = minZ; box.min[3] = 0.0f;
+    box.negMax[0] = -maxX; box.negMax[1] = -maxY; box.negMax[2] = -maxZ; box.negMax[3] = 0.0f;
+}
+
+static inline void setEmpty(Box& box) {
+    setBox(box, FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+static inline void grow(Box& box, const Box& b) {
+    for (int j = 0; j < 8; j += kSimdWidth) {
+        simdStoreU(box.min + j, simdMin(simdLoadU(box.min + j), simdLoadU(b.min + j)));
+    }
+}
+
+static inline void growPoint(Box& box, const float* p) {
+    for (int a = 0; a < 3; ++a) {
+        box.min[a] = std::min(box.min[a], p[a]);
+        box.negMax[a] = std::min(box.negMax[a], -p[a]);
+    }
+}
+
+// AABB的表面积，SAH中只需要相对大小，空的AABB为0
+static inline float surfaceArea(const Box& box) {
+    float x = -box.negMax[0] - box.min[0], y = -box.negMax[1] - box.min[1], z = -box.negMax[2] - box.min[2];
+    if (x < 0.0f) {
+        return 0.0f;
+    }
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+static inline void setSlot(BVHNode& node, int k, const Box& box) {
+    node.minX[k] = box.min[0]; node.minY[k] = box.min[1]; node.minZ[k] = box.min[2];
+    node.maxX[k] = -box.negMax[0]; node.maxY[k] = -box.negMax[1]; node.maxZ[k] = -box.negMax[2];
+}
+
+static inline Box getSlot(const BVHNode& node, int k) {
+    Box box;
+    setBox(box, node.minX[k], node.minY[k], node.minZ[k], node.maxX[k], node.maxY[k], node.maxZ[k]);
+    return box;
+}
+
+static void clearNode(BVHNode& node) {
+    Box far;
+    setBox(far, FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX);
+    for (int k = 0; k < kBVHWidth; ++k) {
+        setSlot(node, k, far);
+        node.child[k] = -1;
+        node.count[k] = 0;
+    }
+}
+
+/*
+    构造
+    先对图元的下标数组自顶向下分割出一棵二叉树，每个节点对应下标数组中的一段
+ */
+struct BuildNode {
+    Box box;
+    int left, right;
+    int start, count;
+};
+
+/*
+    图元的AABB和中心预先算好，连同原来的下标一起存放
+    分割时直接重排这个数组，每一层都顺序读取，不通过下标随机访问
+ */
+struct BuildPrimitive {
+    Box box;
+    float center[3];
+    int index;
+};
+
+struct BuildInput {
+    BuildPrimitive* primitives;
+};
+
+struct Bin {
+    Box box;
+    int count;
+};
+
+/*
+    对[begin, end)执行kernel(begin, end, partial)，partial是每块自己的累计结果，最后按块的顺序合并到result中
+    result调用前为初始值。数量少于kParallelThreshold时直接累计到result中，不复制初始值
+ */
+template <typename T, typename Kernel, typename Merge>
+static void reduceRange(int begin, int end, T& result, const Kernel& kernel, const Merge& merge) {
+    size_t n = end - begin;
+    if (n < kParallelThreshold) {
+        kernel(begin, end, result);
+        return;
+    }
+    size_t grain = cacheChunk(4 * sizeof(float));
+    std::vector<T> partial((n + grain - 1) / grain, result);
+    parallelFor(n, grain, [&](size_t b, size_t e) {
+        kernel(begin + (int)b, begin + (int)e, partial[b / grain]);
+    });
+    for (size_t k = 0; k < partial.size(); ++k) {
+        merge(result, partial[k]);
+    }
+}
+
+// 一段图元的AABB和中心的范围
+struct RangeBounds {
+    Box box;
+    Box centroids;
+};
+
+static inline void growBounds(RangeBounds& r, const BuildPrimitive& p) {
+    grow(r.box, p.box);
+    growPoint(r.centroids, p.center);
+}
+
+static RangeBounds rangeBounds(const BuildInput& in, int begin, int end) {
+    RangeBounds bounds;
+    setEmpty(bounds.box);
+    setEmpty(bounds.centroids);
+    reduceRange(begin, end, bounds, [&](int b, int e, RangeBounds& r) {
+        for (int i = b; i < e; ++i) {
+            growBounds(r, in.primitives[i]);
+        }
+    }, [](RangeBounds& r, const RangeBounds& part) {
+        grow(r.box, part.box);
+        grow(r.centroids, part.centroids);
+    });
+    return bounds;
+}
+
+struct BuildTask {
+    int node;
+    int begin, end;
+    int depth;
+    RangeBounds bounds;
+};
+
+struct BinSet {
+    Bin bins[3][kBinCount];
+};
+
+/*
+    分割一段图元，返回分割位置，返回begin表示作为叶子
+    在3个轴上各把中心的范围等分为kBinCount个箱，统计每个箱的图元个数和AABB，
+    扫描两个方向的前缀，取面积L * 个数L + 面积R * 个数R最小的分割
+    不超过kMaxLeafSize个图元时直接作为叶子，叶子中的图元用标量测试，比再分一层节点便宜
+    两个子节点的范围写入children，在交换图元的同时累计，不必再读一遍
+ */
+static int splitRange(const BuildInput& in, int begin, int end, int depth, const RangeBounds& bounds, RangeBounds* children) {
+    int n = end - begin;
+    if (n <= kMaxLeafSize) {
+        return begin;
+    }
+
+    const float* cmin = bounds.centroids.min;
+    float extent[3];
+    for (int a = 0; a < 3; ++a) {
+        extent[a] = -bounds.centroids.negMax[a] - cmin[a];
+    }
+    int bestAxis = -1, bestBin = 0;
+    float bestCost = FLT_MAX;
+    if (depth < kMaxBuildDepth) {
+        // 图元较少时箱也少，下层的小节点不必初始化和扫描全部kBinCount个箱
+        int binCount = std::min(n, kBinCount);
+        float scale[3];
+        for (int a = 0; a < 3; ++a) {
+            scale[a] = extent[a] > 0.0f ? binCount * 0.9999f / extent[a] : 0.0f;
+        }
+        BinSet binned;
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < binCount; ++b) {
+                setEmpty(binned.bins[a][b].box);
+                binned.bins[a][b].count = 0;
+            }
+        }
+        reduceRange(begin, end, binned, [&](int b, int e, BinSet& set) {
+            for (int i = b; i < e; ++i) {
+                const BuildPrimitive& p = in.primitives[i];
+                for (int a = 0; a < 3; ++a) {
+                    int k = (int)((p.center[a] - cmin[a]) * scale[a]);
+                    k = k < 0 ? 0 : (k >= binCount ? binCount - 1 : k);
+                    grow(set.bins[a][k].box, p.box);
+                    set.bins[a][k].count++;
+                }
+            }
+        }, [&](BinSet& r, const BinSet& set) {
+            for (int a = 0; a < 3; ++a) {
+                for (int b = 0; b < binCount; ++b) {
+                    grow(r.bins[a][b].box, set.bins[a][b].box);
+                    r.bins[a][b].count += set.bins[a][b].count;
+                }
+            }
+        });
+
+        for (int a = 0; a < 3; ++a) {
+            if (scale[a] == 0.0f) {
+                continue;
+            }
+            const Bin* bins = binned.bins[a];
+            float rightArea[kBinCount];
+            int rightCount[kBinCount];
+            Box box;
+            setEmpty(box);
+            int count = 0;
+            for (int b = binCount - 1; b > 0; --b) {
+                grow(box, bins[b].box);
+                count += bins[b].count;
+                rightArea[b] = surfaceArea(box);
+                rightCount[b] = count;
+            }
+            setEmpty(box);
+            count = 0;
+            for (int b = 1; b < binCount; ++b) {
+                grow(box, bins[b - 1].box);
+                count += bins[b - 1].count;
+                if (count == 0 || rightCount[b] == 0) {
+                    continue;
+                }
+                float cost = surfaceArea(box) * count + rightArea[b] * rightCount[b];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = a;
+                    bestBin = b;
+                }
+            }
+        }
+        if (bestAxis >= 0) {
+            float origin = cmin[bestAxis], s = scale[bestAxis];
+            auto isLeft = [&](const BuildPrimitive& p) {
+                return (int)((p.center[bestAxis] - origin) * s) < bestBin;
+            };
+            RangeBounds& left = children[0];
+            RangeBounds& right = children[1];
+            setEmpty(left.box); setEmpty(left.centroids);
+            setEmpty(right.box); setEmpty(right.centroids);
+            BuildPrimitive* p = in.primitives;
+            int i = begin, j = end - 1;
+            for (;;) {
+                while (i <= j && isLeft(p[i])) {
+                    growBounds(left, p[i++]);
+                }
+                while (i <= j && !isLeft(p[j])) {
+                    growBounds(right, p[j--]);
+                }
+                if (i > j) {
+                    break;
+                }
+                std::swap(p[i], p[j]);
+                growBounds(left, p[i++]);
+                growBounds(right, p[j--]);
+            }
+            return i;
+        }
+    }
+
+    // 无法按箱分割（中心重合）或者太深时，在最长的轴上按中位数分成两半
+    int axis = extent[0] >= extent[1] && extent[0] >= extent[2] ? 0 : (extent[1] >= extent[2] ? 1 : 2);
+    int mid = begin + n / 2;
+    std::nth_element(in.primitives + begin, in.primitives + mid, in.primitives + end,
+                     [&](const BuildPrimitive& p, const BuildPrimitive& q) {
+        return p.center[axis] < q.center[axis];
+    });
+    children[0] = rangeBounds(in, begin, mid);
+    children[1] = rangeBounds(in, mid, end);
+    return mid;
+}
+
+/*
+    递归构造[begin, end)的子树，返回节点下标，bounds为这段图元的范围
+    tasks不为NULL时，图元个数不超过taskSize的子树不在这里构造，而是记录为任务，以后分给各线程
+ */
+static int buildRange(const BuildInput& in, std::vector<BuildNode>& nodes, int begin, int end, int depth,
+                      const RangeBounds& bounds, std::vector<BuildTask>* tasks, int taskSize) {
+    int index = (int)nodes.size();
+    BuildNode node;
+    node.box = bounds.box;
+    node.left = node.right = -1;
+    node.start = begin;
+    node.count = 0;
+    nodes.push_back(node);
+
+    if (tasks != NULL && end - begin <= taskSize && end - begin > kMaxLeafSize) {
+        BuildTask task = { index, begin, end, depth, bounds };
+        tasks->push_back(task);
+        return index;
+    }
+
+    RangeBounds children[2];
+    int mid = splitRange(in, begin, end, depth, bounds, children);
+    if (mid == begin) {
+        nodes[index].count = end - begin;
+        return index;
+    }
+    int left = buildRange(in, nodes, begin, mid, depth + 1, children[0], tasks, taskSize);
+    int right = buildRange(in, nodes, mid, end, depth + 1, children[1], tasks, taskSize);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+/*
+    把二叉树合并为宽节点：从二叉节点的两个子节点开始，反复把其中表面积最大的内部节点换成它的两个子节点，
+    直到有kBVHWidth个或者都是叶子
+ */
+static int collapse(const std::vector<BuildNode>& binary, int root, std::vector<BVHNode>& wide) {
+    int list[kBVHWidth];
+    int listSize = 0;
+    if (binary[root].count > 0) {
+        list[listSize++] = root;
+    } else {
+        list[listSize++] = binary[root].left;
+        list[listSize++] = binary[root].right;
+    }
+    while (listSize < kBVHWidth) {
+        int best = -1;
+        float bestArea = -1.0f;
+        for (int k = 0; k < listSize; ++k) {
+            const BuildNode& b = binary[list[k]];
+            float area = surfaceArea(b.box);
+            if (b.count == 0 && area > bestArea) {
+                best = k;
+                bestArea = area;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        int expanded = list[best];
+        list[best] = binary[expanded].left;
+        list[listSize++] = binary[expanded].right;
+    }
+
+    int index = (int)wide.size();
+    wide.push_back(BVHNode());
+    clearNode(wide[index]);
+    for (int k = 0; k < listSize; ++k) {
+        const BuildNode& b = binary[list[k]];
+        int child, count;
+        if (b.count > 0) {
+            child = ~b.start;
+            count = b.count;
+        } else {
+            child = collapse(binary, list[k], wide);
+            count = 0;
+        }
+        setSlot(wide[index], k, b.box);
+        wide[index].child[k] = child;
+        wide[index].count[k] = count;
+    }
+    return index;
+}
+
+BVH::BVH() : tree(NULL), nodes(0), primitives(0) {}
+
+BVH::BVH(const BVH& a) : tree(NULL), nodes(0), primitives(0) {
+    *this = a;
+}
+
+BVH::~BVH() {
+    release();
+}
+
+BVH& BVH::operator =(const BVH& a) {
+    if (this != &a) {
+        release();
+        if (a.nodes > 0) {
+            tree = (BVHNode*)alignedAlloc(a.nodes * sizeof(BVHNode));
+            if (tree == NULL) {
+                throw std::bad_alloc();
+            }
+            memcpy(tree, a.tree, a.nodes * sizeof(BVHNode));
+        }
+        nodes = a.nodes;
+        primitives = a.primitives;
+        primitiveIndex = a.primitiveIndex;
+        centerX = a.centerX;
+        centerY = a.centerY;
+        centerZ = a.centerZ;
+        radius = a.radius;
+    }
+    return *this;
+}
+
+void BVH::release() {
+    alignedFree(tree);
+    tree = NULL;
+    nodes = primitives = 0;
+}
+
+/*
+    上层在当前线程中分割，每个节点的统计通过parallelFor分给各线程
+    子树的图元个数降到n / (线程数 * 8)（至少4096）以下后记录为任务，各任务在不同线程中构造到自己的数组里，最后接到主数组后面
+    分割只取决于图元本身，所以树的结构与线程数无关
+ */
+void BVH::build(const Vector3* centers, const float* radii, size_t n) {
+    MATH_INSTRUMENT_BATCH(BVHBuild, n);
+    release();
+    primitives = n;
+    primitiveIndex.resize(n);
+    if (n == 0) {
+        centerX.clear(); centerY.clear(); centerZ.clear(); radius.clear();
+        return;
+    }
+
+    std::vector<BuildPrimitive> prims(n);
+    parallelFor(n, cacheChunk(sizeof(BuildPrimitive)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            float r = radii != NULL ? radii[i] : 0.0f;
+            const Vector3& c = centers[i];
+            setBox(prims[i].box, c.x - r, c.y - r, c.z - r, c.x + r, c.y + r, c.z + r);
+            prims[i].center[0] = c.x;
+            prims[i].center[1] = c.y;
+            prims[i].center[2] = c.z;
+            prims[i].index = (int)i;
+        }
+    });
+    BuildInput in = { &prims[0] };
+    std::vector<BuildNode> binary;
+    binary.reserve(2 * n / kMaxLeafSize + 1);
+    std::vector<BuildTask> tasks;
+    int threads = ThreadPool::instance().threadCount();
+    if (threads > 1 && n >= kParallelThreshold) {
+        int taskSize = std::max((int)(n / (threads * 8)), 4096);
+        buildRange(in, binary, 0, (int)n, 0, rangeBounds(in, 0, (int)n), &tasks, taskSize);
+
+        std::vector<std::vector<BuildNode> > subtrees(tasks.size());
+        ThreadPool::instance().parallelFor(tasks.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; ++t) {
+                buildRange(in, subtrees[t], tasks[t].begin, tasks[t].end, tasks[t].depth, tasks[t].bounds, NULL, 0);
+            }
+        });
+
+        // 子树的根代替任务占位的节点，其余节点接到后面，下标加上偏移
+        for (size_t t = 0; t < tasks.size(); ++t) {
+            const std::vector<BuildNode>& sub = subtrees[t];
+            int offset = (int)binary.size() - 1;
+            BuildNode& placeholder = binary[tasks[t].node];
+            placeholder.count = sub[0].count;
+            placeholder.left = sub[0].left >= 0 ? sub[0].left + offset : -1;
+            placeholder.right = sub[0].right >= 0 ? sub[0].right + offset : -1;
+            for (size_t k = 1; k < sub.size(); ++k) {
+                BuildNode node = sub[k];
+                if (node.count == 0) {
+                    node.left += offset;
+                    node.right += offset;
+                }
+                binary.push_back(node);
+            }
+        }
+    } else {
+        buildRange(in, binary, 0, (int)n, 0, rangeBounds(in, 0, (int)n), NULL, 0);
+    }
+
+    std::vector<BVHNode> wide;
+    wide.reserve(binary.size() / 2 + 1);
+    collapse(binary, 0, wide);
+    nodes = wide.size();
+    tree = (BVHNode*)alignedAlloc(nodes * sizeof(BVHNode));
+    if (tree == NULL) {
+        throw std::bad_alloc();
+    }
+    memcpy(tree, &wide[0], nodes * sizeof(BVHNode));
+    for (size_t i = 0; i < n; ++i) {
+        primitiveIndex[i] = prims[i].index;
+    }
+
+    centerX.resize(n); centerY.resize(n); centerZ.resize(n); radius.resize(n);
+    refit(centers, radii);
+}
+
+/*
+    按叶子的顺序重新排列图元，再从后向前重新计算各节点的AABB
+    子节点的下标总是大于父节点，所以计算一个节点时它的子节点都已经计算过
+ */
+void BVH::refit(const Vector3* centers, const float* radii) {
+    MATH_INSTRUMENT_BATCH(BVHRefit, primitives);
+    parallelFor(primitives, cacheChunk(5 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            int p = primitiveIndex[i];
+            centerX[i] = centers[p].x;
+            centerY[i] = centers[p].y;
+            centerZ[i] = centers[p].z;
+            radius[i] = radii != NULL ? radii[p] : 0.0f;
+        }
+    });
+    refitNodes();
+}
+
+void BVH::refitNodes() {
+    // 叶子的AABB只取决于图元，可以分给各线程
+    parallelFor(nodes, 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            BVHNode& node = tree[i];
+            for (int k = 0; k < kBVHWidth; ++k) {
+                if (node.count[k] == 0) {
+                    continue;
+                }
+                Box box;
+                setEmpty(box);
+                for (int p = ~node.child[k], e = p + node.count[k]; p < e; ++p) {
+                    float r = radius[p];
+                    Box prim;
+                    setBox(prim, centerX[p] - r, centerY[p] - r, centerZ[p] - r, centerX[p] + r, centerY[p] + r, centerZ[p] + r);
+                    grow(box, prim);
+                }
+                setSlot(node, k, box);
+            }
+        }
+    });
+    for (size_t i = nodes; i-- > 0;) {
+        BVHNode& node = tree[i];
+        for (int k = 0; k < kBVHWidth; ++k) {
+            if (node.child[k] < 0) {
+                continue;
+            }
+            const BVHNode& child = tree[node.child[k]];
+            Box box;
+            setEmpty(box);
+            for (int c = 0; c < kBVHWidth; ++c) {
+                if (child.child[c] >= 0 || child.count[c] > 0) {
+                    grow(box, getSlot(child, c));
+                }
+            }
+            setSlot(node, k, box);
+        }
+    }
+}
+
+AABB3 BVH::bounds() const {
+    Box box;
+    setEmpty(box);
+    if (nodes > 0) {
+        for (int k = 0; k < kBVHWidth; ++k) {
+            if (tree[0].child[k] >= 0 || tree[0].count[k] > 0) {
+                grow(box, getSlot(tree[0], k));
+            }
+        }
+    }
+    AABB3 result;
+    result.min = Vector3(box.min[0], box.min[1], box.min[2]);
+    result.max = Vector3(-box.negMax[0], -box.negMax[1], -box.negMax[2]);
+    return result;
+}
+
+/*
+    遍历时一个节点的子节点按kSimdWidth个一组测试，命中的子节点按距离从近到远处理：
+    叶子直接测试其中的图元，内部节点按从远到近的顺序压栈，使近的先出栈
+ */
+struct StackEntry {
+    int node;
+    float key;
+};
+
+struct ChildHit {
+    float key;
+    int slot;
+};
+
+static inline void sortHits(ChildHit* hits, int count) {
+    for (int i = 1; i < count; ++i) {
+        ChildHit h = hits[i];
+        int j = i;
+        for (; j > 0 && hits[j - 1].key > h.key; --j) {
+            hits[j] = hits[j - 1];
+        }
+        hits[j] = h;
+    }
+}
+
+// 子节点AABB到点p的距离的平方，p在AABB内时为0
+static inline int childDistances(const BVHNode& node, SimdFloat px, SimdFloat py, SimdFloat pz, SimdFloat limitSq,
+                                 ChildHit* hits) {
+    int count = 0;
+    SimdFloat zero = simdZero();
+    for (int j = 0; j < kBVHWidth; j += kSimdWidth) {
+        SimdFloat dx = simdMax(simdMax(simdSub(simdLoad(node.minX + j), px), simdSub(px, simdLoad(node.maxX + j))), zero);
+        SimdFloat dy = simdMax(simdMax(simdSub(simdLoad(node.minY + j), py), simdSub(py, simdLoad(node.maxY + j))), zero);
+        SimdFloat dz = simdMax(simdMax(simdSub(simdLoad(node.minZ + j), pz), simdSub(pz, simdLoad(node.maxZ + j))), zero);
+        SimdFloat distSq = simdMadd(dz, dz, simdMadd(dy, dy, simdMul(dx, dx)));
+        int mask = simdMoveMask(simdCmpLe(distSq, limitSq));
+        if (mask == 0) {
+            continue;
+        }
+        float d[kSimdWidth];
+        simdStoreU(d, distSq);
+        for (int k = 0; k < kSimdWidth; ++k) {
+            if ((mask >> k) & 1) {
+                hits[count].key = d[k];
+                hits[count].slot = j + k;
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+/*
+    射线与球相交，参看13.12
+    射线为o + t * d，令m = o - c，解|m + t * d|^2 = r^2，取较小的根
+    起点在球内时交点参数为0
+ */
+static inline bool raySphere(const Vector3& o, const Vector3& d, float a, const Vector3& c, float r, float* t) {
+    Vector3 m = o - c;
+    float b = m * d;
+    float mm = m * m - r * r;
+    if (mm <= 0.0f) {
+        *t = 0.0f;
+        return true;
+    }
+    if (b > 0.0f) {
+        return false;
+    }
+    float disc = b * b - a * mm;
+    if (disc < 0.0f) {
+        return false;
+    }
+    *t = (-b - sqrtf(disc)) / a;
+    return true;
+}
+
+/*
+    射线与子节点AABB的平板测试（slab），参看13.17
+    为避免0 * inf，rayDelta为0的分量换成很小的数
+ */
+bool BVH::rayCast(const Vector3& rayOrg, const Vector3& rayDelta, BVHRayHit* hit) const {
+    if (nodes == 0) {
+        return false;
+    }
+    float a = rayDelta * rayDelta;
+    if (a <= 0.0f) {
+        return false;
+    }
+    float inv[3];
+    const float* d = &rayDelta.x;
+    for (int k = 0; k < 3; ++k) {
+        float dk = fabsf(d[k]) < 1e-30f ? copysignf(1e-30f, d[k]) : d[k];
+        inv[k] = 1.0f / dk;
+    }
+    SimdFloat ox = simdSet(rayOrg.x), oy = simdSet(rayOrg.y), oz = simdSet(rayOrg.z);
+    SimdFloat ix = simdSet(inv[0]), iy = simdSet(inv[1]), iz = simdSet(inv[2]);
+    SimdFloat zero = simdZero();
+
+    float best = 1.0f;
+    int bestPrimitive = -1;
+    StackEntry stack[kStackSize];
+    int top = 0;
+    stack[top].node = 0;
+    stack[top].key = 0.0f;
+    ++top;
+    while (top > 0) {
+        StackEntry entry = stack[--top];
+        if (entry.key > best) {
+            continue;
+        }
+        const BVHNode& node = tree[entry.node];
+        ChildHit hits[kBVHWidth];
+        int hitCount = 0;
+        SimdFloat limit = simdSet(best);
+        for (int j = 0; j < kBVHWidth; j += kSimdWidth) {
+            SimdFloat t1x = simdMul(simdSub(simdLoad(node.minX + j), ox), ix);
+            SimdFloat t2x = simdMul(simdSub(simdLoad(node.maxX + j), ox), ix);
+            SimdFloat t1y = simdMul(simdSub(simdLoad(node.minY + j), oy), iy);
+            SimdFloat t2y = simdMul(simdSub(simdLoad(node.maxY + j), oy), iy);
+            SimdFloat t1z = simdMul(simdSub(simdLoad(node.minZ + j), oz), iz);
+            SimdFloat t2z = simdMul(simdSub(simdLoad(node.maxZ + j), oz), iz);
+            SimdFloat tEnter = simdMax(simdMax(simdMin(t1x, t2x), simdMin(t1y, t2y)), simdMax(simdMin(t1z, t2z), zero));
+            SimdFloat tExit = simdMin(simdMin(simdMax(t1x, t2x), simdMax(t1y, t2y)), simdMin(simdMax(t1z, t2z), limit));
+            int mask = simdMoveMask(simdCmpLe(tEnter, tExit));
+            if (mask == 0) {
+                continue;
+            }
+            float enter[kSimdWidth];
+            simdStoreU(enter, tEnter);
+            for (int k = 0; k < kSimdWidth; ++k) {
+                if ((mask >> k) & 1) {
+                    hits[hitCount].key = enter[k];
+                    hits[hitCount].slot = j + k;
+                    ++hitCount;
+                }
+            }
+        }
+        sortHits(hits, hitCount);
+
+        for (int h = hitCount - 1; h >= 0; --h) {
+            int k = hits[h].slot;
+            if (node.child[k] >= 0) {
+                assert(top < kStackSize);
+                stack[top].node = node.child[k];
+                stack[top].key = hits[h].key;
+                ++top;
+            }
+        }
+        for (int h = 0; h < hitCount; ++h) {
+            int k = hits[h].slot;
+            if (node.child[k] >= 0 || hits[h].key > best) {
+                continue;
+            }
+            for (int p = ~node.child[k], e = p + node.count[k]; p < e; ++p) {
+                float t;
+                if (raySphere(rayOrg, rayDelta, a, Vector3(centerX[p], centerY[p], centerZ[p]), radius[p], &t) && t <= best) {
+                    best = t;
+                    bestPrimitive = p;
+                }
+            }
+        }
+    }
+
+    if (bestPrimitive < 0) {
+        return false;
+    }
+    if (hit != NULL) {
+        hit->primitive = primitiveIndex[bestPrimitive];
+        hit->t = best;
+    }
+    return true;
+}
+
+// 点到球面的距离，点在球内时为0
+static inline float sphereDistance(float px, float py, float pz, float cx, float cy, float cz, float r) {
+    float dx = px - cx, dy = py - cy, dz = pz - cz;
+    float d = sqrtf(dx * dx + dy * dy + dz * dz) - r;
+    return d > 0.0f ? d : 0.0f;
+}
+
+int BVH::nearest(const Vector3& p, float maxDistance, float* distance) const {
+    if (nodes == 0) {
+        return -1;
+    }
+    SimdFloat px = simdSet(p.x), py = simdSet(p.y), pz = simdSet(p.z);
+    float best = maxDistance;
+    int bestPrimitive = -1;
+    StackEntry stack[kStackSize];
+    int top = 0;
+    stack[top].node = 0;
+    stack[top].key = 0.0f;
+    ++top;
+    while (top > 0) {
+        StackEntry entry = stack[--top];
+        if (entry.key > best * best) {
+            continue;
+        }
+        const BVHNode& node = tree[entry.node];
+        ChildHit hits[kBVHWidth];
+        int hitCount = childDistances(node, px, py, pz, simdSet(best * best), hits);
+        sortHits(hits, hitCount);
+
+        for (int h = hitCount - 1; h >= 0; --h) {
+            int k = hits[h].slot;
+            if (node.child[k] >= 0) {
+                assert(top < kStackSize);
+                stack[top].node = node.child[k];
+                stack[top].key = hits[h].key;
+                ++top;
+            }
+        }
+        for (int h = 0; h < hitCount; ++h) {
+            int k = hits[h].slot;
+            if (node.child[k] >= 0 || hits[h].key > best * best) {
+                continue;
+            }
+            for (int q = ~node.child[k], e = q + node.count[k]; q < e; ++q) {
+                float d = sphereDistance(p.x, p.y, p.z, centerX[q], centerY[q], centerZ[q], radius[q]);
+                if (d < best || (d == best && bestPrimitive < 0)) {
+                    best = d;
+                    bestPrimitive = q;
+                }
+            }
+        }
+    }
+
+    if (bestPrimitive < 0) {
+        return -1;
+    }
+    if (distance != NULL) {
+        *distance = best;
+    }
+    return primitiveIndex[bestPrimitive];
+}
+
+/*
+    k近邻：用大小为k的最大堆保存目前找到的最近的k个图元，堆满后以堆顶的距离作为剪枝的范围
+ */
+struct Neighbor {
+    float distance;
+    int primitive;
+    bool operator <(const Neighbor& a) const { return distance < a.distance; }
+};
+
+size_t BVH::nearestK(const Vector3& p, size_t k, int* indices, float* distances) const {
+    if (nodes == 0 || k == 0) {
+        return 0;
+    }
+    SimdFloat px = simdSet(p.x), py = simdSet(p.y), pz = simdSet(p.z);
+    std::vector<Neighbor> heap;
+    heap.reserve(k);
+    float limit = FLT_MAX;
+    StackEntry stack[kStackSize];
+    int top = 0;
+    stack[top].node = 0;
+    stack[top].key = 0.0f;
+    ++top;
+    while (top > 0) {
+        StackEntry entry = stack[--top];
+        if (entry.key > limit * limit) {
+            continue;
+        }
+        const BVHNode& node = tree[entry.node];
+        ChildHit hits[kBVHWidth];
+        int hitCount = childDistances(node, px, py, pz, simdSet(limit * limit), hits);
+        sortHits(hits, hitCount);
+
+        for (int h = hitCount - 1; h >= 0; --h) {
+            int c = hits[h].slot;
+            if (node.child[c] >= 0) {
+                assert(top < kStackSize);
+                stack[top].node = node.child[c];
+                stack[top].key = hits[h].key;
+                ++top;
+            }
+        }
+        for (int h = 0; h < hitCount; ++h) {
+            int c = hits[h].slot;
+            if (node.child[c] >= 0 || hits[h].key > limit * limit) {
+                continue;
+            }
+            for (int q = ~node.child[c], e = q + node.count[c]; q < e; ++q) {
+                float d = sphereDistance(p.x, p.y, p.z, centerX[q], centerY[q], centerZ[q], radius[q]);
+                if (heap.size() < k) {
+                    Neighbor n = { d, q };
+                    heap.push_back(n);
+                    std::push_heap(heap.begin(), heap.end());
+                } else if (d < heap.front().distance) {
+                    std::pop_heap(heap.begin(), heap.end());
+                    heap.back().distance = d;
+                    heap.back().primitive = q;
+                    std::push_heap(heap.begin(), heap.end());
+                }
+                if (heap.size() == k) {
+                    limit = heap.front().distance;
+                }
+            }
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end());
+    for (size_t i = 0; i < heap.size(); ++i) {
+        if (indices != NULL) {
+            indices[i] = primitiveIndex[heap[i].primitive];
+        }
+        if (distances != NULL) {
+            distances[i] = heap[i].distance;
+        }
+    }
+    return heap.size();
+}
+
+size_t BVH::overlapSphere(const Vector3& center, float r, std::vector<int>& result) const {
+    if (nodes == 0) {
+        return 0;
+    }
+    size_t before = result.size();
+    SimdFloat px = simdSet(center.x), py = simdSet(center.y), pz = simdSet(center.z);
+    SimdFloat limitSq = simdSet(r * r);
+    int stack[kStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BVHNode& node = tree[stack[--top]];
+        ChildHit hits[kBVHWidth];
+        int hitCount = childDistances(node, px, py, pz, limitSq, hits);
+        for (int h = 0; h < hitCount; ++h) {
+            int k = hits[h].slot;
+            if (node.child[k] >= 0) {
+                assert(top < kStackSize);
+                stack[top++] = node.child[k];
+                continue;
+            }
+            for (int q = ~node.child[k], e = q + node.count[k]; q < e; ++q) {
+                float dx = center.x - centerX[q], dy = center.y - centerY[q], dz = center.z - centerZ[q];
+                float reach = r + radius[q];
+                if (dx * dx + dy * dy + dz * dz <= reach * reach) {
+                    result.push_back(primitiveIndex[q]);
+                }
+            }
+        }
+    }
+    return result.size() - before;
+}
+
+void rayCastN(const BVH& bvh, const Vector3* rayOrg, const Vector3* rayDelta, BVHRayHit* hits, size_t n) {
+    MATH_INSTRUMENT_BATCH(BVHRayCastN, n);
+    parallelFor(n, 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (!bvh.rayCast(rayOrg[i], rayDelta[i], &hits[i])) {
+                hits[i].primitive = -1;
+                hits[i].t = 1.0f;
+            }
+        }
+    });
+}
+
+void nearestN(const BVH& bvh, const Vector3* p, int* result, float* distance, size_t n) {
+    MATH_INSTRUMENT_BATCH(BVHNearestN, n);
+    parallelFor(n, 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            result[i] = bvh.nearest(p[i], FLT_MAX, distance != NULL ? &distance[i] : NULL);
+        }
+    });
+}
@@ -0,0 +1,99 @@
+//
+//  BVH.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef BVH_hpp
+#define BVH_hpp
+
+#include <stddef.h>
+#include <float.h>
+#include <vector>
+
+class Vector3;
+class AABB3;
+struct BVHNode;
+
+// 射线检测的结果，t为参数形式的射线rayOrg + t * rayDelta上的交点参数，在[0, 1]之间
+struct BVHRayHit {
+    int primitive;
+    float t;
+};
+
+/*
+    BVH类
+    层次包围盒，图元为球（中心和半径），半径为0时就是点
+    构造时用分箱的SAH（表面积启发式）自顶向下分割，上层的统计分给多个线程，下层的子树各自在一个线程中构造
+    先构造二叉树，再合并为宽节点：每个节点最多kSimdWidth（至少4）个子节点，各子节点的AABB以SoA存放，
+    遍历时一个节点的所有子节点在SIMD寄存器中同时测试
+    节点按先序存放在一个连续数组中，子节点的下标总是大于父节点；叶子中的图元按叶子的顺序重新排列存放
+ */
+class BVH {
+
+public:
+    BVH();
+    BVH(const BVH& a);
+    ~BVH();
+
+    BVH& operator =(const BVH& a);
+
+    /*
+        对n个图元构造层次，radii为NULL时所有半径为0
+        查询结果中的图元下标是这里的下标
+     */
+    void build(const Vector3* centers, const float* radii, size_t n);
+
+    /*
+        图元移动后只重新计算各节点的AABB，不改变树的结构，比重新构造快得多
+        个数必须与build()时相同。移动较多时树的质量会下降，查询变慢，这时应重新构造
+     */
+    void refit(const Vector3* centers, const float* radii);
+
+    size_t primitiveCount() const { return primitives; }
+    size_t nodeCount() const { return nodes; }
+
+    // 所有图元的AABB
+    AABB3 bounds() const;
+
+    /*
+        射线检测，射线为rayOrg + t * rayDelta，t在[0, 1]之间，与球相交参看13.12
+        返回是否与某个球相交，hit中为最近的交点；起点在球内时t为0
+     */
+    bool rayCast(const Vector3& rayOrg, const Vector3& rayDelta, BVHRayHit* hit) const;
+
+    /*
+        离p最近的图元，距离为到球面的距离，p在球内时为0
+        只查找距离不超过maxDistance的图元，没有时返回-1
+     */
+    int nearest(const Vector3& p, float maxDistance = FLT_MAX, float* distance = NULL) const;
+
+    /*
+        离p最近的k个图元，按距离从近到远写入indices和distances（可以为NULL），返回找到的个数
+     */
+    size_t nearestK(const Vector3& p, size_t k, int* indices, float* distances) const;
+
+    // 与球(center, radius)相交的所有图元，下标追加到result中，返回追加的个数
+    size_t overlapSphere(const Vector3& center, float radius, std::vector<int>& result) const;
+
+private:
+    BVHNode* tree;
+    size_t nodes;
+    size_t primitives;
+    std::vector<int> primitiveIndex;
+    std::vector<float> centerX, centerY, centerZ, radius;
+
+    void release();
+    void refitNodes();
+};
+
+/*
+    批量查询，各查询分给多个线程，每个查询的结果与单独调用相同
+    射线没有相交时hits[i].primitive为-1
+ */
+extern void rayCastN(const BVH& bvh, const Vector3* rayOrg, const Vector3* rayDelta, BVHRayHit* hits, size_t n);
+extern void nearestN(const BVH& bvh, const Vector3* p, int* result, float* distance, size_t n);
+
+#endif /* BVH_hpp */
@@ -0,0 +1,133 @@
+//
+//  DualQuaternion.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "DualQuaternion.hpp"
+
+#include <assert.h>
+#include <math.h>
+
+#include "Vector3.hpp"
+#include "Matrix4x3.hpp"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
+
+/*
+    本库的四元数乘法a * b表示先a后b（参看10.4.8），等于通常写法（Hamilton乘积）的b a
+    下面的公式都按本库的乘法写出
+ */
+
+// 全局单位对偶四元数
+const DualQuaternion kDualQuaternionIdentity = { {1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 0.0f} };
+
+void DualQuaternion::identity() {
+    real.identity();
+    dual.w = dual.x = dual.y = dual.z = 0.0f;
+}
+
+// dual = 0.5 * t * real（Hamilton乘积），即本库的0.5 * (real * t)
+void DualQuaternion::setup(const Quaternion& orientation, const Vector3& pos) {
+    real = orientation;
+    Quaternion t = { 0.0f, pos.x, pos.y, pos.z };
+    dual = real * t;
+    dual.w *= 0.5f;
+    dual.x *= 0.5f;
+    dual.y *= 0.5f;
+    dual.z *= 0.5f;
+}
+
+void DualQuaternion::fromMatrix(const Matrix4x3& m) {
+    assert(m.transformClass <= kTransformRigid);
+    Quaternion q;
+    q.fromMatrix(m);
+    setup(q, getTranslation(m));
+}
+
+void DualQuaternion::toMatrix(Matrix4x3& m) const {
+    m.fromQuaternion(real);
+    m.setTranslation(::getTranslation(*this));
+}
+
+/*
+    real除以自身的模，dual除以同一个数，再减去在real上的分量
+    这样real和dual的点乘为0，满足单位对偶四元数的条件
+ */
+void DualQuaternion::normalize() {
+    float magSq = dotProduct(real, real);
+    if (magSq <= 0.0f) {
+        assert(false);
+        // 在发布版中，返回单位变换
+        identity();
+        return;
+    }
+    float oneOverMag = 1.0f / sqrtf(magSq);
+    real.w *= oneOverMag;
+    real.x *= oneOverMag;
+    real.y *= oneOverMag;
+    real.z *= oneOverMag;
+
+    float d = dotProduct(real, dual) * oneOverMag;
+    dual.w = dual.w * oneOverMag - real.w * d;
+    dual.x = dual.x * oneOverMag - real.x * d;
+    dual.y = dual.y * oneOverMag - real.y * d;
+    dual.z = dual.z * oneOverMag - real.z * d;
+}
+
+/*
+    (ra + e da)先执行，(rb + e db)后执行
+    real = ra * rb，dual = da * rb + ra * db，共3次四元数乘法
+ */
+DualQuaternion operator*(const DualQuaternion& a, const DualQuaternion& b) {
+    DualQuaternion result;
+    result.real = a.real * b.real;
+    Quaternion d0 = a.dual * b.real;
+    Quaternion d1 = a.real * b.dual;
+    result.dual.w = d0.w + d1.w;
+    result.dual.x = d0.x + d1.x;
+    result.dual.y = d0.y + d1.y;
+    result.dual.z = d0.z + d1.z;
+    return result;
+}
+
+DualQuaternion& operator*=(DualQuaternion& a, const DualQuaternion& b) {
+    a = a * b;
+    return a;
+}
+
+// 旋转部分就是real，参看Quaternion.hpp中的rotate()
+Vector3 rotateVector(const Vector3& v, const DualQuaternion& dq) {
+    return rotate(dq.real, v);
+}
+
+// 平移 = 2 * dual * conjugate(real)（Hamilton乘积）的向量部分
+Vector3 getTranslation(const DualQuaternion& dq) {
+    Vector3 u(dq.real.x, dq.real.y, dq.real.z);
+    Vector3 d(dq.dual.x, dq.dual.y, dq.dual.z);
+    Vector3 t = d * dq.real.w - u * dq.dual.w + crossProduct(u, d);
+    return t * 2.0f;
+}
+
+Vector3 operator*(const Vector3& p, const DualQuaternion& dq) {
+    return rotateVector(p, dq) + getTranslation(dq);
+}
+
+// 单位对偶四元数的逆是两部分分别取共轭
+DualQuaternion inverse(const DualQuaternion& dq) {
+    DualQuaternion result;
+    result.real = conjugate(dq.real);
+    result.dual = conjugate(dq.dual);
+    return result;
+}
+
+void fromMatrixN(const Matrix4x3* m, DualQuaternion* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(DualQuaternionFromMatrixN, n);
+    parallelFor(n, cacheChunk(sizeof(Matrix4x3) + sizeof(DualQuaternion)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            out[i].fromMatrix(m[i]);
+        }
+    });
+}
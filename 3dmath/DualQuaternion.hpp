@@ -0,0 +1,68 @@
+//
+//  DualQuaternion.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef DualQuaternion_hpp
+#define DualQuaternion_hpp
+
+#include "Quaternion.hpp"
+
+class Vector3;
+class Matrix4x3;
+
+/*
+    DualQuaternion类
+    用对偶四元数real + e * dual表示刚体变换（旋转加平移），只需8个float，Matrix4x3需要12个
+    real是旋转四元数，dual = 0.5 * t * real，其中t是纯四元数(0, 平移)
+    变换的顺序与Matrix4x3相同：先旋转再平移，a * b表示先执行a再执行b
+    多个对偶四元数按权重混合后正则化，结果仍是刚体变换，不会像矩阵混合那样使模型收缩
+ */
+class DualQuaternion {
+
+public:
+    Quaternion real;
+    Quaternion dual;
+
+    // 置为单位变换
+    void identity();
+
+    // 先按orientation旋转，再平移pos，与Matrix4x3::fromQuaternion后setTranslation(pos)相同
+    void setup(const Quaternion& orientation, const Vector3& pos);
+
+    // 从刚体变换矩阵构造，矩阵的3x3部分必须是正交的（kTransformIdentity到kTransformRigid）
+    void fromMatrix(const Matrix4x3& m);
+
+    // 转换为矩阵
+    void toMatrix(Matrix4x3& m) const;
+
+    // 正则化：real为单位四元数，dual与real正交
+    void normalize();
+};
+
+// 全局单位对偶四元数
+extern const DualQuaternion kDualQuaternionIdentity;
+
+// 连接，先a后b
+extern DualQuaternion operator*(const DualQuaternion& a, const DualQuaternion& b);
+extern DualQuaternion& operator*=(DualQuaternion& a, const DualQuaternion& b);
+
+// 变换点，与p * m相同
+extern Vector3 operator*(const Vector3& p, const DualQuaternion& dq);
+
+// 只旋转，用于方向向量和法线
+extern Vector3 rotateVector(const Vector3& v, const DualQuaternion& dq);
+
+// 提取平移部分
+extern Vector3 getTranslation(const DualQuaternion& dq);
+
+// 单位对偶四元数的逆变换
+extern DualQuaternion inverse(const DualQuaternion& dq);
+
+// 批量从刚体变换矩阵构造，用于把骨骼矩阵转换为蒙皮用的对偶四元数
+extern void fromMatrixN(const Matrix4x3* m, DualQuaternion* out, size_t n);
+
+#endif /* DualQuaternion_hpp */
@@ -11,6 +11,9 @@
 #include "MathUtil.h"
 #include "Matrix4x3.hpp"
 #include "RotationMatrix.hpp"
+#include "SimdMath.h"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
 
 #include <math.h>
 
@@ -19,8 +22,14 @@
     欧拉角参看10.3节
  */
 
-// 全局单位欧拉角
-const EulerAngles kEulerAnglesIdentity(0.0f, 0.0f, 0.0f);
+/*
+    判断万向锁的sin(pitch)阈值，|sin(pitch)|超过它时bank置零，全部绕竖直轴的旋转给heading
+    阈值越宽，被当作万向锁的pitch离±90°越远，bank置零引入的误差越大：0.9999时最大约0.8°；
+    阈值太窄时，由四元数算出的sin(pitch)在正好±90°时也可能因舍入低于阈值，heading和bank的atan2参数只剩舍入误差。
+    取0.999999f，pitch离±90°约0.08°以内才按万向锁处理，与double参考结果的最大误差约1.4e-3弧度
+    （参看性能测试程序的--accuracy）
+ */
+static const float kGimbalLockSin = 0.999999f;
 
 /*
     将欧拉角转换到限制集中
@@ -29,6 +38,7 @@ const EulerAngles kEulerAnglesIdentity(0.0f, 0.0f, 0.0f);
     参看10.3
  */
 void EulerAngles::canonize() {
+    MATH_INSTRUMENT_SAMPLED(EulerAnglesCanonize);
     // 首先，将pitch变换到-pi到pi之间
     pitch = wrapPi(pitch);
     
@@ -46,7 +56,12 @@ void EulerAngles::canonize() {
     // 检查万向锁的情况，允许存在一定的误差
     if (fabs(pitch) > KPiOver2 - 1e-4) {
         // 在万向锁中，将所有绕垂直轴的旋转付给heading
-        heading += bank;
+        // pitch为+90°时旋转只取决于heading - bank，为-90°时只取决于heading + bank，参看10.6.5
+        if (pitch > 0.0f) {
+            heading -= bank;
+        } else {
+            heading += bank;
+        }
         bank = 0;
     } else {
         // 非万向锁，将bank转换到限制集中
@@ -62,21 +77,22 @@ void EulerAngles::canonize() {
     参看10.6.6
  */
 void EulerAngles::fromObjectToInertialQuaternion(const Quaternion &q) {
+    MATH_INSTRUMENT_SCOPE(EulerAnglesFromObjectToInertialQuaternion);
     // 计算sin(pitch)
     float sp = -2.0f * (q.y * q.z - q.w * q.x);
     
     // 检查万向锁，允许存在一定误差
-    if (fabs(sp) > 0.9999f) {
+    if (fabs(sp) > kGimbalLockSin) {
         // 向正上方或正下方看
         pitch = KPiOver2 * sp;
         // bank置零，计算heading
-        heading = atan2(-q.x * q.z + q.w * q.y, 0.5f - q.y * q.y - q.z * q.z);
+        heading = mathAtan2(-q.x * q.z + q.w * q.y, 0.5f - q.y * q.y - q.z * q.z);
         bank = 0.0f;
     } else {
         // 计算角度，这里不必使用安全的asin函数，因为之前在检查万向锁问题是已经检查过范围错误
-        pitch = asin(sp);
-        heading = atan2(q.x * q.z + q.w * q.y, 0.5f - q.x * q.x - q.y * q.y);
-        bank = atan2(q.x * q.y + q.w * q.z, 0.5f - q.x * q.x -q.z * q.z);
+        pitch = mathAsin(sp);
+        heading = mathAtan2(q.x * q.z + q.w * q.y, 0.5f - q.x * q.x - q.y * q.y);
+        bank = mathAtan2(q.x * q.y + q.w * q.z, 0.5f - q.x * q.x -q.z * q.z);
     }
 }
 
@@ -85,19 +101,20 @@ void EulerAngles::fromObjectToInertialQuaternion(const Quaternion &q) {
     参看10.6.6
  */
 void EulerAngles::fromInertialToObjectQuaternion(const Quaternion &q) {
+    MATH_INSTRUMENT_SCOPE(EulerAnglesFromInertialToObjectQuaternion);
     // 计算sin(pitch)
     float sp = -2.0f * (q.y * q.z + q.w * q.x);
     // 检查方向锁，允许一定误差
-    if (fabs(sp) > 0.9999f) {
+    if (fabs(sp) > kGimbalLockSin) {
         // 向正上方或正下方看
         pitch = KPiOver2 * sp;
         // bank置零，计算heading
-        heading = atan2(-q.x * q.z - q.w * q.y, 0.5f - q.y * q.y - q.z * q.z);
+        heading = mathAtan2(-q.x * q.z - q.w * q.y, 0.5f - q.y * q.y - q.z * q.z);
         bank = 0.0f;
     } else {
-        pitch = asin(sp);
-        heading = atan2(q.x * q.z - q.w * q.y, 0.5f -q.x * q.x - q.y * q.y);
-        bank = atan2(q.x * q.y - q.w * q.z, 0.5f - q.x * q.x - q.z * q.z);
+        pitch = mathAsin(sp);
+        heading = mathAtan2(q.x * q.z - q.w * q.y, 0.5f -q.x * q.x - q.y * q.y);
+        bank = mathAtan2(q.x * q.y - q.w * q.z, 0.5f - q.x * q.x - q.z * q.z);
     }
 }
 
@@ -107,21 +124,22 @@ void EulerAngles::fromInertialToObjectQuaternion(const Quaternion &q) {
     参看10.6.2
  */
 void EulerAngles::fromObjectToWorldMatrix(const Matrix4x3 &m) {
+    MATH_INSTRUMENT_SCOPE(EulerAnglesFromObjectToWorldMatrix);
     // 通过m32计算sin(pitch)
     float sp = -m.m32;
     
     // 检查万向锁
-    if (fabs(sp) > 0.9999f) {
+    if (fabs(sp) > kGimbalLockSin) {
         // 向正上方或正下方看
         pitch = KPiOver2 * sp;
         // bank置零，计算heading
-        heading = atan2(-m.m23, m.m11);
+        heading = mathAtan2(-m.m13, m.m11);
         bank = 0.0f;
     } else {
         // 计算角度
-        heading = atan2(m.m31, m.m33);
-        pitch = asin(sp);
-        bank = atan2(m.m12, m.m22);
+        heading = mathAtan2(m.m31, m.m33);
+        pitch = mathAsin(sp);
+        bank = mathAtan2(m.m12, m.m22);
     }
 }
 
@@ -131,20 +149,21 @@ void EulerAngles::fromObjectToWorldMatrix(const Matrix4x3 &m) {
     参看10.6.2
  */
 void EulerAngles::fromWorldToObjectMatrix(const Matrix4x3 &m) {
+    MATH_INSTRUMENT_SCOPE(EulerAnglesFromWorldToObjectMatrix);
     // 根据m32计算sin(picth)
     float sp = -m.m23;
     
     // 检查万向锁
-    if (fabs(sp) > 0.9999f) {
+    if (fabs(sp) > kGimbalLockSin) {
         // 向正上方或正下方看
         pitch = KPiOver2 * sp;
         // back置零，计算heading
-        heading = atan2(-m.m31, m.m11);
+        heading = mathAtan2(-m.m31, m.m11);
         bank = 0.0f;
     } else {
-        heading = atan2(m.m13, m.m33);
-        pitch = asin(sp);
-        bank = atan2(m.m21, m.m22);
+        heading = mathAtan2(m.m13, m.m33);
+        pitch = mathAsin(sp);
+        bank = mathAtan2(m.m21, m.m22);
     }
 }
 
@@ -153,21 +172,120 @@ void EulerAngles::fromWorldToObjectMatrix(const Matrix4x3 &m) {
     参看10.6.2
  */
 void EulerAngles::fromRotationMatrix(const RotationMatrix &m) {
+    MATH_INSTRUMENT_SCOPE(EulerAnglesFromRotationMatrix);
     // 根据m23计算sin(pitch)
     float sp = -m.m23;
     
     // 检查万向锁
-    if (fabs(sp) > 0.9999f) {
+    if (fabs(sp) > kGimbalLockSin) {
         // 向正上方或正下方看
         pitch = KPiOver2 * sp;
         // bank置零，计算heading
-        heading = atan2(-m.m31, m.m11);
+        heading = mathAtan2(-m.m31, m.m11);
         bank = 0.0f;
     } else {
         // 计算角度
-        heading = atan2(m.m13, m.m33);
-        pitch = asin(sp);
-        bank = atan2(m.m21, m.m22);
+        heading = mathAtan2(m.m13, m.m33);
+        pitch = mathAsin(sp);
+        bank = mathAtan2(m.m21, m.m22);
     }
 }
 
+/*
+    批量提取欧拉角
+    两种情况都计算出atan2的参数，再按是否万向锁选择，heading只需要一次atan2
+    参数依次为sin(pitch)、万向锁时heading的y和x、一般情况heading的y和x、bank的y和x
+ */
+static inline void extractEulerAngles(SimdFloat sp,
+                                      SimdFloat lockHeadingY, SimdFloat lockHeadingX,
+                                      SimdFloat headingY, SimdFloat headingX,
+                                      SimdFloat bankY, SimdFloat bankX,
+                                      SimdFloat* angles) {
+    SimdMask lock = simdCmpGt(simdAbs(sp), simdSet(kGimbalLockSin));
+    SimdFloat zero = simdZero();
+    
+    angles[0] = simdAtan2(simdSelect(lock, lockHeadingY, headingY), simdSelect(lock, lockHeadingX, headingX));
+    // 万向锁的通道不使用asin的结果，先把sp限制在定义域内
+    SimdFloat clamped = simdMin(simdMax(sp, simdSet(-1.0f)), simdSet(1.0f));
+    angles[1] = simdSelect(lock, simdMul(simdSet(KPiOver2), sp), simdAsin(clamped));
+    angles[2] = simdSelect(lock, zero, simdAtan2(bankY, bankX));
+}
+
+/*
+    四元数->欧拉角，参看10.6.6
+    惯性-物体四元数的公式就是把物体-惯性公式中的w取反，wSign为-1时对w取反
+ */
+static void quaternionToEulerN(const Quaternion* q, EulerAngles* out, size_t n, float wSign) {
+    const float* in = reinterpret_cast<const float*>(q);
+    float* result = reinterpret_cast<float*>(out);
+    parallelForGroups(n, kSimdWidth, cacheChunk(7 * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat f[4];
+        simdLoadFields(in + 4 * i, 4, 4, count, f);
+        SimdFloat w = simdMul(f[0], simdSet(wSign)), x = f[1], y = f[2], z = f[3];
+        
+        SimdFloat half = simdSet(0.5f);
+        SimdFloat xx = simdMul(x, x), yy = simdMul(y, y), zz = simdMul(z, z);
+        SimdFloat xz = simdMul(x, z), wy = simdMul(w, y);
+        SimdFloat sp = simdMul(simdSet(-2.0f), simdNmadd(w, x, simdMul(y, z)));
+        
+        SimdFloat angles[3];
+        extractEulerAngles(sp,
+                           simdSub(wy, xz), simdSub(simdSub(half, yy), zz),
+                           simdAdd(xz, wy), simdSub(simdSub(half, xx), yy),
+                           simdMadd(w, z, simdMul(x, y)), simdSub(simdSub(half, xx), zz),
+                           angles);
+        simdStoreFields(result + 3 * i, 3, 3, count, angles);
+    });
+}
+
+void fromObjectToInertialQuaternionN(const Quaternion* q, EulerAngles* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(EulerAnglesFromObjectToInertialQuaternionN, n);
+    quaternionToEulerN(q, out, n, 1.0f);
+}
+
+void fromInertialToObjectQuaternionN(const Quaternion* q, EulerAngles* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(EulerAnglesFromInertialToObjectQuaternionN, n);
+    quaternionToEulerN(q, out, n, -1.0f);
+}
+
+/*
+    矩阵->欧拉角，参看10.6.2
+    m指向一组惯性-物体（世界-物体）矩阵的3x3部分，相邻矩阵相隔stride个float
+    物体-世界矩阵是它的转置，transpose为true时交换行列读取
+ */
+static void matrixToEulerN(const float* m, size_t stride, bool transpose, EulerAngles* out, size_t n) {
+    float* result = reinterpret_cast<float*>(out);
+    parallelForGroups(n, kSimdWidth, cacheChunk((stride + 3) * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat e[9];
+        simdLoadFields(m + stride * i, stride, 9, count, e);
+        if (transpose) {
+            SimdFloat t;
+            t = e[1]; e[1] = e[3]; e[3] = t;
+            t = e[2]; e[2] = e[6]; e[6] = t;
+            t = e[5]; e[5] = e[7]; e[7] = t;
+        }
+        // e[0]到e[8]依次是m11、m12、m13、m21、m22、m23、m31、m32、m33
+        SimdFloat angles[3];
+        extractEulerAngles(simdNeg(e[5]),
+                           simdNeg(e[6]), e[0],
+                           e[2], e[8],
+                           e[3], e[4],
+                           angles);
+        simdStoreFields(result + 3 * i, 3, 3, count, angles);
+    });
+}
+
+void fromObjectToWorldMatrixN(const Matrix4x3* m, EulerAngles* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(EulerAnglesFromObjectToWorldMatrixN, n);
+    matrixToEulerN(reinterpret_cast<const float*>(m), sizeof(Matrix4x3) / sizeof(float), true, out, n);
+}
+
+void fromWorldToObjectMatrixN(const Matrix4x3* m, EulerAngles* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(EulerAnglesFromWorldToObjectMatrixN, n);
+    matrixToEulerN(reinterpret_cast<const float*>(m), sizeof(Matrix4x3) / sizeof(float), false, out, n);
+}
+
+void fromRotationMatrixN(const RotationMatrix* m, EulerAngles* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(EulerAnglesFromRotationMatrixN, n);
+    matrixToEulerN(reinterpret_cast<const float*>(m), sizeof(RotationMatrix) / sizeof(float), false, out, n);
+}
@@ -0,0 +1,368 @@
+//
+//  Frustum.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "Frustum.hpp"
+
+#include <assert.h>
+#include <float.h>
+#include <string.h>
+#include <new>
+#include <vector>
+
+#include "Matrix4x3.hpp"
+#include "AABB3.hpp"
+#include "SimdUtil.h"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
+
+/*
+    相机空间中的平面
+    透视投影：x * zoomX >= -z、x * zoomX <= z，y方向相同，另外z >= near、z <= far
+    正交投影：-halfWidth <= x <= halfWidth，y方向相同，近、远平面与透视投影相同
+ */
+void Frustum::setupPerspective(const Matrix4x3& worldToCamera, float zoomX, float zoomY, float nearClip, float farClip) {
+    assert(zoomX > 0.0f && zoomY > 0.0f);
+    assert(nearClip < farClip);
+    Vector3 n[kPlaneCount] = {
+        Vector3(zoomX, 0.0f, 1.0f),
+        Vector3(-zoomX, 0.0f, 1.0f),
+        Vector3(0.0f, zoomY, 1.0f),
+        Vector3(0.0f, -zoomY, 1.0f),
+        Vector3(0.0f, 0.0f, 1.0f),
+        Vector3(0.0f, 0.0f, -1.0f)
+    };
+    float d[kPlaneCount] = { 0.0f, 0.0f, 0.0f, 0.0f, nearClip, -farClip };
+    setupPlanes(worldToCamera, n, d);
+}
+
+void Frustum::setupOrthographic(const Matrix4x3& worldToCamera, float halfWidth, float halfHeight, float nearClip, float farClip) {
+    assert(halfWidth > 0.0f && halfHeight > 0.0f);
+    assert(nearClip < farClip);
+    Vector3 n[kPlaneCount] = {
+        Vector3(1.0f, 0.0f, 0.0f),
+        Vector3(-1.0f, 0.0f, 0.0f),
+        Vector3(0.0f, 1.0f, 0.0f),
+        Vector3(0.0f, -1.0f, 0.0f),
+        Vector3(0.0f, 0.0f, 1.0f),
+        Vector3(0.0f, 0.0f, -1.0f)
+    };
+    float d[kPlaneCount] = { -halfWidth, -halfWidth, -halfHeight, -halfHeight, nearClip, -farClip };
+    setupPlanes(worldToCamera, n, d);
+}
+
+/*
+    把相机空间的平面变换到世界空间
+    相机空间的点pc = pw * M + t，代入pc * nc >= dc得到pw * (M * nc) >= dc - t * nc
+    M * nc的每个分量是M的一行与nc的点乘，最后把法向量和距离一起除以法向量的模
+ */
+void Frustum::setupPlanes(const Matrix4x3& m, const Vector3* cameraNormal, const float* cameraDistance) {
+    for (int k = 0; k < kPlaneCount; ++k) {
+        const Vector3& n = cameraNormal[k];
+        Vector3 worldNormal(m.m11 * n.x + m.m12 * n.y + m.m13 * n.z,
+                            m.m21 * n.x + m.m22 * n.y + m.m23 * n.z,
+                            m.m31 * n.x + m.m32 * n.y + m.m33 * n.z);
+        float d = cameraDistance[k] - (m.tx * n.x + m.ty * n.y + m.tz * n.z);
+        float oneOverMag = 1.0f / vectorMag(worldNormal);
+        normal[k] = worldNormal * oneOverMag;
+        distance[k] = d * oneOverMag;
+    }
+}
+
+bool Frustum::isVisible(const Vector3& center, float radius) const {
+    for (int k = 0; k < kPlaneCount; ++k) {
+        if (center * normal[k] - distance[k] < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 边界框在法向量上投影的半径为|nx| * ex + |ny| * ey + |nz| * ez
+bool Frustum::isVisible(const AABB3& box) const {
+    if (box.isEmpty()) {
+        return false;
+    }
+    Vector3 c = box.center();
+    Vector3 e = box.max - c;
+    for (int k = 0; k < kPlaneCount; ++k) {
+        const Vector3& n = normal[k];
+        float r = fabsf(n.x) * e.x + fabsf(n.y) * e.y + fabsf(n.z) * e.z;
+        if (c * n - distance[k] < -r) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    七个分量数组放在同一块内存中，依次为中心、半尺寸和半径
+ */
+CullingSet::CullingSet() : data(NULL), count(0), padded(0) {}
+
+CullingSet::CullingSet(size_t n) : data(NULL), count(0), padded(0) {
+    allocate(n);
+}
+
+CullingSet::CullingSet(const CullingSet& a) : data(NULL), count(0), padded(0) {
+    allocate(a.count);
+    copyComponents(a);
+}
+
+CullingSet::~CullingSet() {
+    release();
+}
+
+CullingSet& CullingSet::operator =(const CullingSet& a) {
+    if (this != &a) {
+        if (padded != paddedSize(a.count)) {
+            release();
+            allocate(a.count);
+        }
+        count = a.count;
+        copyComponents(a);
+    }
+    return *this;
+}
+
+/*
+    a缩小过时容量比这里大，七个分量数组的间隔不同，要逐个复制
+    a在size()之后的部分都是不可见的补齐值，复制到补齐后的容量为止
+ */
+void CullingSet::copyComponents(const CullingSet& a) {
+    for (int k = 0; k < 7 && padded > 0; ++k) {
+        memcpy(data + k * padded, a.data + k * a.padded, padded * sizeof(float));
+    }
+}
+
+void CullingSet::allocate(size_t n) {
+    count = n;
+    padded = paddedSize(n);
+    if (padded == 0) {
+        return;
+    }
+    data = (float*)alignedAlloc(7 * padded * sizeof(float));
+    if (data == NULL) {
+        throw std::bad_alloc();
+    }
+    memset(data, 0, 6 * padded * sizeof(float));
+    float* r = data + 6 * padded;
+    for (size_t i = 0; i < padded; ++i) {
+        r[i] = -FLT_MAX;
+    }
+}
+
+void CullingSet::release() {
+    alignedFree(data);
+    data = NULL;
+    count = padded = 0;
+}
+
+void CullingSet::resize(size_t n) {
+    if (n <= padded) {
+        // 容量足够，被截掉的部分恢复为不可见
+        for (size_t i = n; i < count; ++i) {
+            set(i, kZeroVector, kZeroVector, -FLT_MAX);
+        }
+        count = n;
+        return;
+    }
+
+    CullingSet grown(n);
+    for (int k = 0; k < 7; ++k) {
+        memcpy(grown.data + k * grown.padded, data + k * padded, count * sizeof(float));
+    }
+
+    // 交换两者的存储，旧的内存由grown析构时释放
+    float* oldData = data;
+    data = grown.data;
+    padded = grown.padded;
+    count = n;
+    grown.data = oldData;
+}
+
+void CullingSet::set(size_t i, const Vector3& center, const Vector3& extent, float r) {
+    data[i] = center.x;
+    data[padded + i] = center.y;
+    data[2 * padded + i] = center.z;
+    data[3 * padded + i] = extent.x;
+    data[4 * padded + i] = extent.y;
+    data[5 * padded + i] = extent.z;
+    data[6 * padded + i] = r;
+}
+
+void CullingSet::setSphere(size_t i, const Vector3& center, float radius) {
+    assert(i < count);
+    assert(radius >= 0.0f);
+    set(i, center, Vector3(radius, radius, radius), radius);
+}
+
+void CullingSet::setBox(size_t i, const AABB3& box) {
+    assert(i < count);
+    if (box.isEmpty()) {
+        set(i, kZeroVector, kZeroVector, -FLT_MAX);
+        return;
+    }
+    Vector3 c = box.center();
+    Vector3 e = box.max - c;
+    set(i, c, e, vectorMag(e));
+}
+
+/*
+    批量裁剪
+    每个视图的平面系数预先展开为float表，核心循环中逐个广播
+ */
+struct PlaneTable {
+    float nx[Frustum::kPlaneCount], ny[Frustum::kPlaneCount], nz[Frustum::kPlaneCount], d[Frustum::kPlaneCount];
+    float ax[Frustum::kPlaneCount], ay[Frustum::kPlaneCount], az[Frustum::kPlaneCount];
+};
+
+static void setupPlaneTable(const Frustum& f, PlaneTable& t) {
+    for (int k = 0; k < Frustum::kPlaneCount; ++k) {
+        t.nx[k] = f.normal[k].x;
+        t.ny[k] = f.normal[k].y;
+        t.nz[k] = f.normal[k].z;
+        t.d[k] = f.distance[k];
+        t.ax[k] = fabsf(t.nx[k]);
+        t.ay[k] = fabsf(t.ny[k]);
+        t.az[k] = fabsf(t.nz[k]);
+    }
+}
+
+// 一组物体的中心、半尺寸和半径
+struct CullingGroup {
+    SimdFloat cx, cy, cz, ex, ey, ez, r;
+};
+
+/*
+    物体被平面排除的条件：中心到平面的距离s < -min(r, |nx| * ex + |ny| * ey + |nz| * ez)，即s + min(...) < 0
+    球的半尺寸为(r, r, r)，min取r；边界框的半径不小于投影半径，min取投影半径
+ */
+static inline SimdMask outside(const CullingGroup& g, SimdFloat nx, SimdFloat ny, SimdFloat nz, SimdFloat d,
+                               SimdFloat ax, SimdFloat ay, SimdFloat az) {
+    SimdFloat s = simdSub(simdMadd(g.cz, nz, simdMadd(g.cy, ny, simdMul(g.cx, nx))), d);
+    SimdFloat projected = simdMadd(g.ez, az, simdMadd(g.ey, ay, simdMul(g.ex, ax)));
+    return simdCmpLt(simdAdd(s, simdMin(g.r, projected)), simdZero());
+}
+
+/*
+    对一个视图测试一组物体，返回可见通道的掩码
+    时间相关性：lastPlane不为NULL时，如果一组物体记录的平面都相同，先只用这一个平面测试，全组都被排除就直接返回
+    按通道分别取出不同的平面再测试比测试所有平面还慢，所以只在全组相同时使用记录，
+    也只在某一个平面能排除全组时才更新记录，把它记给组内所有物体，使下一帧仍能整组跳过
+ */
+static inline int cullGroup(const CullingGroup& g, const PlaneTable& t, unsigned char* lastPlane, size_t lanes) {
+    if (lastPlane != NULL) {
+        int p = lastPlane[0];
+        bool uniform = true;
+        for (size_t k = 1; k < lanes; ++k) {
+            uniform &= lastPlane[k] == p;
+        }
+        if (uniform) {
+            SimdMask cached = outside(g, simdSet(t.nx[p]), simdSet(t.ny[p]), simdSet(t.nz[p]), simdSet(t.d[p]),
+                                      simdSet(t.ax[p]), simdSet(t.ay[p]), simdSet(t.az[p]));
+            if (simdMoveMask(cached) == kSimdAllLanes) {
+                return 0;
+            }
+        }
+    }
+
+    int planeMask[Frustum::kPlaneCount];
+    int rejected = 0;
+    for (int k = 0; k < Frustum::kPlaneCount; ++k) {
+        SimdMask out = outside(g, simdSet(t.nx[k]), simdSet(t.ny[k]), simdSet(t.nz[k]), simdSet(t.d[k]),
+                               simdSet(t.ax[k]), simdSet(t.ay[k]), simdSet(t.az[k]));
+        planeMask[k] = simdMoveMask(out);
+        rejected |= planeMask[k];
+    }
+
+    if (lastPlane != NULL && rejected == kSimdAllLanes) {
+        for (int k = 0; k < Frustum::kPlaneCount; ++k) {
+            if (planeMask[k] == kSimdAllLanes) {
+                memset(lastPlane, k, lanes);
+                break;
+            }
+        }
+    }
+    return ~rejected & kSimdAllLanes;
+}
+
+/*
+    块内的可见下标先写到visible中该块起点的位置，不需要分支：每个通道都写入，只有可见时才移动写入位置
+    块内写入的位置不会超过已处理的下标，所以不会覆盖其他块的数据，也不会越过物体个数
+    所有块完成后按块的顺序依次前移，得到升序的紧凑列表
+ */
+void cull(CullingView* views, int viewCount, const CullingSet& objects) {
+    MATH_INSTRUMENT_BATCH(CullMultiView, objects.size());
+    size_t n = objects.size();
+    for (int v = 0; v < viewCount; ++v) {
+        views[v].visibleCount = 0;
+    }
+    if (n == 0 || viewCount <= 0) {
+        return;
+    }
+
+    std::vector<PlaneTable> tables(viewCount);
+    for (int v = 0; v < viewCount; ++v) {
+        setupPlaneTable(*views[v].frustum, tables[v]);
+    }
+    size_t grain = cacheChunk(7 * sizeof(float) + viewCount * (sizeof(unsigned int) + 1));
+    size_t chunkCount = (n + grain - 1) / grain;
+    std::vector<size_t> chunkVisible(chunkCount * viewCount, 0);
+
+    parallelFor(n, grain, [&](size_t begin, size_t end) {
+        size_t chunk = begin / grain;
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            CullingGroup g;
+            g.cx = simdLoad(objects.centerX() + i);
+            g.cy = simdLoad(objects.centerY() + i);
+            g.cz = simdLoad(objects.centerZ() + i);
+            g.ex = simdLoad(objects.extentX() + i);
+            g.ey = simdLoad(objects.extentY() + i);
+            g.ez = simdLoad(objects.extentZ() + i);
+            g.r = simdLoad(objects.radius() + i);
+            size_t lanes = end - i < (size_t)kSimdWidth ? end - i : (size_t)kSimdWidth;
+
+            for (int v = 0; v < viewCount; ++v) {
+                unsigned char* lastPlane = views[v].lastPlane != NULL ? views[v].lastPlane + i : NULL;
+                int mask = cullGroup(g, tables[v], lastPlane, lanes);
+                if (mask == 0) {
+                    continue;
+                }
+                size_t& written = chunkVisible[chunk * viewCount + v];
+                unsigned int* out = views[v].visible + begin;
+                for (size_t k = 0; k < lanes; ++k) {
+                    out[written] = (unsigned int)(i + k);
+                    written += (mask >> k) & 1;
+                }
+            }
+        }
+    });
+
+    for (int v = 0; v < viewCount; ++v) {
+        size_t total = 0;
+        for (size_t c = 0; c < chunkCount; ++c) {
+            size_t written = chunkVisible[c * viewCount + v];
+            if (written > 0 && total != c * grain) {
+                memmove(views[v].visible + total, views[v].visible + c * grain, written * sizeof(unsigned int));
+            }
+            total += written;
+        }
+        views[v].visibleCount = total;
+    }
+}
+
+size_t cull(const Frustum& frustum, const CullingSet& objects, unsigned int* visible, unsigned char* lastPlane) {
+    MATH_INSTRUMENT_BATCH(Cull, objects.size());
+    CullingView view;
+    view.frustum = &frustum;
+    view.visible = visible;
+    view.lastPlane = lastPlane;
+    view.visibleCount = 0;
+    cull(&view, 1, objects);
+    return view.visibleCount;
+}
@@ -0,0 +1,138 @@
+//
+//  Frustum.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef Frustum_hpp
+#define Frustum_hpp
+
+#include <stddef.h>
+
+#include "Vector3.hpp"
+
+class Matrix4x3;
+class AABB3;
+
+/*
+    Frustum类
+    视锥的6个裁剪平面，参看15.2。平面用p * n = d的形式表示，法向量指向视锥内部，并且是单位向量
+    p * n >= d的点在平面内侧，点到平面的有符号距离为p * n - d
+    相机空间按本书的约定：+x向右，+y向上，+z向前
+ */
+class Frustum {
+
+public:
+    enum Plane {
+        kLeft = 0,
+        kRight,
+        kBottom,
+        kTop,
+        kNear,
+        kFar,
+        kPlaneCount
+    };
+
+    Vector3 normal[kPlaneCount];
+    float distance[kPlaneCount];
+
+    /*
+        透视投影，worldToCamera为世界->相机变换（如Matrix4x3::setupParentToLocal的结果）
+        zoomX、zoomY为两个方向的缩放倍数，可以由fovToZoom()得到，参看15.2.4
+     */
+    void setupPerspective(const Matrix4x3& worldToCamera, float zoomX, float zoomY, float nearClip, float farClip);
+
+    // 正交投影，比如阴影的级联，halfWidth和halfHeight为视体在相机x、y方向上的半尺寸
+    void setupOrthographic(const Matrix4x3& worldToCamera, float halfWidth, float halfHeight, float nearClip, float farClip);
+
+    /*
+        单个物体的测试，只要有一个平面把物体完全排除在外就不可见
+        结果是保守的：视锥角落附近的物体可能判断为可见
+     */
+    bool isVisible(const Vector3& center, float radius) const;
+    bool isVisible(const AABB3& box) const;
+
+private:
+    void setupPlanes(const Matrix4x3& worldToCamera, const Vector3* cameraNormal, const float* cameraDistance);
+};
+
+/*
+    CullingSet类
+    批量裁剪的物体，以SoA方式存储中心、半尺寸和半径，布局与Vector3Stream相同
+    球的半尺寸为(r, r, r)，边界框的半径为半尺寸的模，裁剪时对每个平面取两者投影中较小的一个，
+    所以同一个集合中球和边界框可以混合存放，结果与分别调用Frustum::isVisible相同
+    补齐部分和空的边界框的半径为-FLT_MAX，总是不可见
+ */
+class CullingSet {
+
+public:
+    // 容量补齐的粒度，与Vector3Stream相同
+    static const size_t kStreamPadding = 16;
+
+    CullingSet();
+    explicit CullingSet(size_t n);
+    CullingSet(const CullingSet& a);
+    ~CullingSet();
+
+    CullingSet& operator =(const CullingSet& a);
+
+    size_t size() const { return count; }
+    size_t capacity() const { return padded; }
+
+    // 物体个数补齐到kStreamPadding的整数倍，参看Vector3Stream::paddedSize
+    size_t paddedSize() const { return paddedSize(count); }
+    static size_t paddedSize(size_t n) { return (n + kStreamPadding - 1) / kStreamPadding * kStreamPadding; }
+
+    // 改变物体个数，原有数据保留，新增部分不可见
+    void resize(size_t n);
+
+    // 设置第i个物体
+    void setSphere(size_t i, const Vector3& center, float radius);
+    void setBox(size_t i, const AABB3& box);
+
+    // 分量数组
+    const float* centerX() const { return data; }
+    const float* centerY() const { return data + padded; }
+    const float* centerZ() const { return data + 2 * padded; }
+    const float* extentX() const { return data + 3 * padded; }
+    const float* extentY() const { return data + 4 * padded; }
+    const float* extentZ() const { return data + 5 * padded; }
+    const float* radius() const { return data + 6 * padded; }
+
+private:
+    float* data;
+    size_t count;
+    size_t padded;
+
+    void allocate(size_t n);
+    void release();
+    void copyComponents(const CullingSet& a);
+    void set(size_t i, const Vector3& center, const Vector3& extent, float r);
+};
+
+/*
+    一个视图的裁剪任务
+    visible：可见物体的下标按升序紧凑地写入这里，长度至少为物体个数
+    lastPlane：时间相关性，可以为NULL。记录每个物体上一次被哪个平面排除，一组物体记录的平面相同时，
+               下一帧先只用这个平面测试，全组仍被排除就不必测试其他平面
+               空间上相邻的物体下标也相邻时效果最好。长度至少为物体个数，第一次使用前置0
+    visibleCount：裁剪后写入可见物体的个数
+ */
+struct CullingView {
+    const Frustum* frustum;
+    unsigned int* visible;
+    unsigned char* lastPlane;
+    size_t visibleCount;
+};
+
+/*
+    批量裁剪，每次迭代kSimdWidth个物体同时对所有平面测试，结果与逐个调用isVisible相同
+    多个视图（比如阴影的各个级联）在同一遍中完成，每组物体只读入一次
+    返回可见物体的个数
+ */
+extern size_t cull(const Frustum& frustum, const CullingSet& objects, unsigned int* visible, unsigned char* lastPlane = NULL);
+extern void cull(CullingView* views, int viewCount, const CullingSet& objects);
+
+#endif /* Frustum_hpp */
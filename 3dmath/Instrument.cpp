@@ -0,0 +1,233 @@
+//
+//  Instrument.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "Instrument.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+#if MATH_INSTRUMENT
+
+#define MATH_INSTRUMENT_NAME(id, name) name,
+static const char* const kInstrumentNames[kInstrumentCount] = {
+    MATH_INSTRUMENT_COUNTERS(MATH_INSTRUMENT_NAME)
+};
+#undef MATH_INSTRUMENT_NAME
+
+#if defined(MATH_INSTRUMENT_TSC)
+static const char* const kInstrumentUnit = "cycles";
+#else
+static const char* const kInstrumentUnit = "ns";
+#endif
+
+MATH_INSTRUMENT_THREAD_LOCAL InstrumentThreadData* tlsInstrumentData = NULL;
+MATH_INSTRUMENT_THREAD_LOCAL unsigned tlsInstrumentTicks[kInstrumentCount];
+
+// 所有线程的计数器组成的链表，只在头部插入，从不删除，因此遍历时不需要加锁
+static std::atomic<InstrumentThreadData*> instrumentThreads(NULL);
+
+static void clearCounter(InstrumentCounter& c) {
+    c.calls.store(0, std::memory_order_relaxed);
+    c.sampledCalls.store(0, std::memory_order_relaxed);
+    c.elements.store(0, std::memory_order_relaxed);
+    c.samples.store(0, std::memory_order_relaxed);
+    c.sampledElements.store(0, std::memory_order_relaxed);
+    c.cycles.store(0, std::memory_order_relaxed);
+    for (int b = 0; b < kInstrumentBuckets; ++b) {
+        c.histogram[b].store(0, std::memory_order_relaxed);
+    }
+}
+
+InstrumentThreadData* instrumentRegisterThread() {
+    InstrumentThreadData* data = new InstrumentThreadData;
+    for (int i = 0; i < kInstrumentCount; ++i) {
+        clearCounter(data->counters[i]);
+    }
+    // 插入链表头部，release保证其他线程从链表中读到data时也能看到清零后的计数器
+    InstrumentThreadData* head = instrumentThreads.load(std::memory_order_relaxed);
+    do {
+        data->next = head;
+    } while (!instrumentThreads.compare_exchange_weak(head, data, std::memory_order_release, std::memory_order_relaxed));
+    tlsInstrumentData = data;
+    return data;
+}
+
+// 耗时所在的直方图分组，即cycles的最高位
+static int histogramBucket(unsigned long long cycles) {
+    int bucket = 0;
+    while ((cycles >>= 1) != 0) {
+        ++bucket;
+    }
+    return bucket < kInstrumentBuckets ? bucket : kInstrumentBuckets - 1;
+}
+
+void instrumentRecord(InstrumentCounter& counter, size_t elements, unsigned long long cycles) {
+    instrumentIncrement(counter.samples, 1);
+    instrumentIncrement(counter.sampledElements, elements);
+    instrumentIncrement(counter.cycles, cycles);
+    instrumentIncrement(counter.histogram[histogramBucket(cycles)], 1);
+}
+
+void instrumentRecordSampled(InstrumentId id, unsigned long long cycles) {
+    InstrumentThreadData* data = tlsInstrumentData;
+    if (data == NULL) {
+        data = instrumentRegisterThread();
+    }
+    // 第1次调用只计1次，之后每次抽样代表从上次抽样到这次的2^MATH_INSTRUMENT_SAMPLE_SHIFT次调用
+    unsigned long long calls = tlsInstrumentTicks[id] == 1 ? 1 : 1ull << MATH_INSTRUMENT_SAMPLE_SHIFT;
+    InstrumentCounter& counter = data->counters[id];
+    instrumentIncrement(counter.calls, calls);
+    instrumentIncrement(counter.sampledCalls, calls);
+    instrumentRecord(counter, 0, cycles);
+}
+
+// 统计过的线程数
+static int instrumentThreadCount() {
+    int count = 0;
+    for (InstrumentThreadData* d = instrumentThreads.load(std::memory_order_acquire); d != NULL; d = d->next) {
+        ++count;
+    }
+    return count;
+}
+
+/*
+    估计的总耗时：测量过的调用的平均耗时乘以调用次数
+    批量函数中元素多的调用总是测量，按每元素的耗时乘以元素总数估计
+ */
+static double estimatedCycles(const InstrumentStats& s) {
+    if (s.sampledElements != 0) {
+        return (double)s.cycles * (double)s.elements / (double)s.sampledElements;
+    }
+    return s.samples == 0 ? 0.0 : (double)s.cycles * (double)s.calls / (double)s.samples;
+}
+
+void instrumentSnapshot(std::vector<InstrumentStats>& stats) {
+    stats.clear();
+    InstrumentThreadData* head = instrumentThreads.load(std::memory_order_acquire);
+    for (int i = 0; i < kInstrumentCount; ++i) {
+        InstrumentStats s;
+        memset(&s, 0, sizeof(s));
+        s.name = kInstrumentNames[i];
+        for (InstrumentThreadData* d = head; d != NULL; d = d->next) {
+            const InstrumentCounter& c = d->counters[i];
+            s.calls += c.calls.load(std::memory_order_relaxed);
+            if (c.sampledCalls.load(std::memory_order_relaxed) != 0) {
+                s.callsSampled = true;
+            }
+            s.elements += c.elements.load(std::memory_order_relaxed);
+            s.samples += c.samples.load(std::memory_order_relaxed);
+            s.sampledElements += c.sampledElements.load(std::memory_order_relaxed);
+            s.cycles += c.cycles.load(std::memory_order_relaxed);
+            for (int b = 0; b < kInstrumentBuckets; ++b) {
+                s.histogram[b] += c.histogram[b].load(std::memory_order_relaxed);
+            }
+        }
+        if (s.calls != 0) {
+            stats.push_back(s);
+        }
+    }
+    std::stable_sort(stats.begin(), stats.end(), [](const InstrumentStats& a, const InstrumentStats& b) {
+        return estimatedCycles(a) > estimatedCycles(b);
+    });
+}
+
+void instrumentReset() {
+    for (InstrumentThreadData* d = instrumentThreads.load(std::memory_order_acquire); d != NULL; d = d->next) {
+        for (int i = 0; i < kInstrumentCount; ++i) {
+            clearCounter(d->counters[i]);
+        }
+    }
+}
+
+// 从直方图估计分位数，返回所在分组的上界
+static unsigned long long histogramPercentile(const InstrumentStats& s, double p) {
+    unsigned long long target = (unsigned long long)(p * (double)s.samples);
+    unsigned long long sum = 0;
+    for (int b = 0; b < kInstrumentBuckets; ++b) {
+        sum += s.histogram[b];
+        if (sum > target) {
+            return 2ull << b;
+        }
+    }
+    return 2ull << (kInstrumentBuckets - 1);
+}
+
+void instrumentReport(FILE* file) {
+    std::vector<InstrumentStats> stats;
+    instrumentSnapshot(stats);
+
+    double total = 0.0;
+    for (size_t i = 0; i < stats.size(); ++i) {
+        total += estimatedCycles(stats[i]);
+    }
+
+    fprintf(file, "%d thread(s), unit: %s, 1 in %d calls timed, batches of %d or more elements always timed, "
+            "calls marked ~ estimated from the timed calls\n",
+            instrumentThreadCount(), kInstrumentUnit, 1 << MATH_INSTRUMENT_SAMPLE_SHIFT, MATH_INSTRUMENT_TIMED_ELEMENTS);
+    fprintf(file, "%-48s %12s %12s %10s %10s %14s %6s %8s %8s\n",
+            "function", "calls", "elements", "per call", "per elem", "total (est)", "%", "p50 <=", "p99 <=");
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const InstrumentStats& s = stats[i];
+        double perCall = s.samples == 0 ? 0.0 : (double)s.cycles / (double)s.samples;
+        double estimated = estimatedCycles(s);
+        char calls[32];
+        snprintf(calls, sizeof(calls), "%s%llu", s.callsSampled ? "~" : "", s.calls);
+        fprintf(file, "%-48s %12s %12llu %10.1f ", s.name, calls, s.elements, perCall);
+        if (s.sampledElements != 0) {
+            fprintf(file, "%10.2f ", (double)s.cycles / (double)s.sampledElements);
+        } else {
+            fprintf(file, "%10s ", "-");
+        }
+        fprintf(file, "%14.0f %6.2f %8llu %8llu\n", estimated, total > 0.0 ? estimated * 100.0 / total : 0.0,
+                histogramPercentile(s, 0.5), histogramPercentile(s, 0.99));
+    }
+}
+
+void instrumentReportJson(FILE* file) {
+    std::vector<InstrumentStats> stats;
+    instrumentSnapshot(stats);
+
+    fprintf(file, "{\n  \"enabled\": true,\n  \"unit\": \"%s\",\n  \"sample_shift\": %d,\n  \"timed_elements\": %d,\n  \"threads\": %d,\n  \"functions\": [",
+            kInstrumentUnit, MATH_INSTRUMENT_SAMPLE_SHIFT, MATH_INSTRUMENT_TIMED_ELEMENTS, instrumentThreadCount());
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const InstrumentStats& s = stats[i];
+        fprintf(file, "%s\n    {\"name\": \"%s\", \"calls\": %llu, \"calls_sampled\": %s, \"elements\": %llu, \"samples\": %llu, "
+                "\"sampled_elements\": %llu, \"cycles\": %llu, \"estimated_cycles\": %.0f, \"histogram\": [",
+                i == 0 ? "" : ",", s.name, s.calls, s.callsSampled ? "true" : "false", s.elements, s.samples,
+                s.sampledElements, s.cycles, estimatedCycles(s));
+        // 去掉末尾的空组
+        int last = kInstrumentBuckets - 1;
+        while (last > 0 && s.histogram[last] == 0) {
+            --last;
+        }
+        for (int b = 0; b <= last; ++b) {
+            fprintf(file, "%s%llu", b == 0 ? "" : ", ", s.histogram[b]);
+        }
+        fprintf(file, "]}");
+    }
+    fprintf(file, "%s]\n}\n", stats.empty() ? "" : "\n  ");
+}
+
+#else
+
+void instrumentSnapshot(std::vector<InstrumentStats>& stats) {
+    stats.clear();
+}
+
+void instrumentReset() {
+}
+
+void instrumentReport(FILE* file) {
+    fprintf(file, "instrumentation disabled, build with MATH_INSTRUMENT=1\n");
+}
+
+void instrumentReportJson(FILE* file) {
+    fprintf(file, "{\n  \"enabled\": false,\n  \"functions\": []\n}\n");
+}
+
+#endif
@@ -0,0 +1,369 @@
+//
+//  Instrument.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef Instrument_hpp
+#define Instrument_hpp
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+/*
+    热点函数的调用计数和耗时统计，用来在实际程序中找出哪些库函数调用最多、花的时间最多
+    编译时定义MATH_INSTRUMENT为1打开，默认关闭，关闭时函数中的统计代码展开为空，不影响生成的代码
+
+    打开后每个线程有自己的一组计数器，只由这个线程写，不需要加锁；读取统计结果时把所有线程的计数器加起来
+    每次调用都计数，但只在每2^MATH_INSTRUMENT_SAMPLE_SHIFT次调用中测量一次耗时：读一次时间戳计数器要20多个周期，
+    虚拟机中更多，与normalize这样的小函数本身相当，只能分摊
+    这样对slerp这类十几纳秒以上的函数和批量函数，开销在几个百分点以内
+    Quaternion::normalize这样不到10纳秒的函数，连每次调用都计数（读TLS指针、读写计数器）也要增加约1纳秒，
+    相对开销达到几十个百分点，这些函数用MATH_INSTRUMENT_SAMPLED只做抽样计数：
+    每次调用只把静态TLS数组中的一个计数加1，第1次和之后每2^MATH_INSTRUMENT_SAMPLE_SHIFT次调用才进入测量的路径，
+    同时把调用次数加上距上次抽样的次数，因此这些函数的调用次数是估计值，
+    每个线程最多少计2^MATH_INSTRUMENT_SAMPLE_SHIFT - 1次，instrumentReset后也可能差这么多
+    抽样计数后setupRotate、canonize、rotate这类几纳秒的函数开销在几个百分点左右，
+    normalize、determinant这类一两纳秒的函数仍约增加0.2到0.3纳秒（加法、分支和保存时间戳的寄存器）
+    批量函数还累加处理的元素个数，元素不少于MATH_INSTRUMENT_TIMED_ELEMENTS的调用每次都测量耗时，
+    总耗时按测量过的调用的每元素耗时估计
+    耗时的单位是时间戳计数器的周期（x86上是参考周期，与睿频无关），其他平台上用纳秒代替
+    耗时按2的幂分组记入直方图，第b组为[2^b, 2^(b+1))个周期，第0组还包括0
+    嵌套调用时外层的耗时包含内层
+ */
+#ifndef MATH_INSTRUMENT
+#define MATH_INSTRUMENT 0
+#endif
+
+#ifndef MATH_INSTRUMENT_SAMPLE_SHIFT
+#define MATH_INSTRUMENT_SAMPLE_SHIFT 8
+#endif
+
+#ifndef MATH_INSTRUMENT_TIMED_ELEMENTS
+#define MATH_INSTRUMENT_TIMED_ELEMENTS 4096
+#endif
+
+/*
+    统计的函数，X(标识, 名字)
+    包括矩阵、四元数、欧拉角、旋转矩阵的构造和运算，以及所有批量函数
+    Vector3的运算和Vector3 * Matrix4x3这样的小函数本身只有几条指令，连抽样计数的开销也与函数本身相当，不统计；
+    头文件中的constexpr函数（矩阵和四元数的乘法、平移和缩放矩阵的构造等）要能在编译时求值，也不统计；
+    只是转发给另一个重载的函数（如使用欧拉角的setupLocalToParent）也不统计，调用记在被转发的函数上
+ */
+#define MATH_INSTRUMENT_COUNTERS(X) \
+    X(Matrix4x3SetupLocalToParent, "Matrix4x3::setupLocalToParent") \
+    X(Matrix4x3SetupParentToLocal, "Matrix4x3::setupParentToLocal") \
+    X(Matrix4x3SetupRotateAxis, "Matrix4x3::setupRotate(int)") \
+    X(Matrix4x3SetupRotate, "Matrix4x3::setupRotate(Vector3)") \
+    X(Matrix4x3FromQuaternion, "Matrix4x3::fromQuaternion") \
+    X(Matrix4x3SetupScaleAlongAxis, "Matrix4x3::setupScaleAlongAxis") \
+    X(Matrix4x3SetupShear, "Matrix4x3::setupShear") \
+    X(Matrix4x3SetupProject, "Matrix4x3::setupProject") \
+    X(Matrix4x3SetupReflectAxis, "Matrix4x3::setupReflect(int)") \
+    X(Matrix4x3SetupReflect, "Matrix4x3::setupReflect(Vector3)") \
+    X(Matrix4x3Determinant, "determinant(Matrix4x3)") \
+    X(Matrix4x3Inverse, "inverse(Matrix4x3)") \
+    X(Matrix4x3PositionFromParentToLocal, "getPositionFromParentToLocal") \
+    X(Matrix4x3PositionFromLocalToParent, "getPositionFromLocalToParent") \
+    X(SinCosN, "sinCosN") \
+    X(WrapPiN, "wrapPiN") \
+    X(SafeAcosN, "safeAcosN") \
+    X(Atan2N, "atan2N") \
+    X(SqrtN, "sqrtN") \
+    X(RsqrtN, "rsqrtN") \
+    X(TransformPoints, "transformPoints") \
+    X(TransformPointsStream, "transformPoints(Vector3Stream)") \
+    X(TransformDirections, "transformDirections") \
+    X(TransformDirectionsStream, "transformDirections(Vector3Stream)") \
+    X(FromQuaternionN, "fromQuaternionN") \
+    X(QuaternionSetToRotateAboutX, "Quaternion::setToRotateAboutX") \
+    X(QuaternionSetToRotateAboutY, "Quaternion::setToRotateAboutY") \
+    X(QuaternionSetToRotateAboutZ, "Quaternion::setToRotateAboutZ") \
+    X(QuaternionSetToRotateAboutAxis, "Quaternion::setToRotateAboutAxis") \
+    X(QuaternionSetToRotateObjectToInertial, "Quaternion::setToRotateObjectToInertial") \
+    X(QuaternionSetToRotateInertialToObject, "Quaternion::setToRotateInertialToObject") \
+    X(QuaternionFromMatrix, "Quaternion::fromMatrix") \
+    X(QuaternionNormalize, "Quaternion::normalize") \
+    X(QuaternionGetRotationAngles, "Quaternion::getRotationAngles") \
+    X(QuaternionGetRotationAxis, "Quaternion::getRotationAxis") \
+    X(QuaternionSlerp, "slerp") \
+    X(QuaternionInverse, "inverse(Quaternion)") \
+    X(QuaternionDiff, "diff(Quaternion)") \
+    X(QuaternionPow, "pow(Quaternion)") \
+    X(QuaternionRotate, "rotate(Quaternion, Vector3)") \
+    X(SlerpN, "slerpN") \
+    X(SetToRotateObjectToInertialN, "setToRotateObjectToInertialN") \
+    X(SetToRotateInertialToObjectN, "setToRotateInertialToObjectN") \
+    X(RotateN, "rotateN") \
+    X(RotateNStream, "rotateN(Vector3Stream)") \
+    X(RotateNPerVector, "rotateN(Quaternion*)") \
+    X(EulerAnglesCanonize, "EulerAngles::canonize") \
+    X(EulerAnglesFromObjectToInertialQuaternion, "EulerAngles::fromObjectToInertialQuaternion") \
+    X(EulerAnglesFromInertialToObjectQuaternion, "EulerAngles::fromInertialToObjectQuaternion") \
+    X(EulerAnglesFromObjectToWorldMatrix, "EulerAngles::fromObjectToWorldMatrix") \
+    X(EulerAnglesFromWorldToObjectMatrix, "EulerAngles::fromWorldToObjectMatrix") \
+    X(EulerAnglesFromRotationMatrix, "EulerAngles::fromRotationMatrix") \
+    X(EulerAnglesFromObjectToInertialQuaternionN, "fromObjectToInertialQuaternionN(EulerAngles)") \
+    X(EulerAnglesFromInertialToObjectQuaternionN, "fromInertialToObjectQuaternionN(EulerAngles)") \
+    X(EulerAnglesFromObjectToWorldMatrixN, "fromObjectToWorldMatrixN") \
+    X(EulerAnglesFromWorldToObjectMatrixN, "fromWorldToObjectMatrixN") \
+    X(EulerAnglesFromRotationMatrixN, "fromRotationMatrixN") \
+    X(RotationMatrixSetup, "RotationMatrix::setup") \
+    X(RotationMatrixFromInertialToObjectQuaternion, "RotationMatrix::fromInertialToObjectQuaternion") \
+    X(RotationMatrixFromObjectToInertialQuaternion, "RotationMatrix::fromObjectToInertialQuaternion") \
+    X(RotationMatrixSetupN, "setupN(RotationMatrix)") \
+    X(RotationMatrixFromInertialToObjectQuaternionN, "fromInertialToObjectQuaternionN(RotationMatrix)") \
+    X(RotationMatrixFromObjectToInertialQuaternionN, "fromObjectToInertialQuaternionN(RotationMatrix)") \
+    X(OrthonormalizeN, "orthonormalizeN") \
+    X(InertialToObjectN, "inertialToObjectN") \
+    X(ObjectToInertialN, "objectToInertialN") \
+    X(InertialToObjectNStream, "inertialToObjectN(Vector3Stream)") \
+    X(ObjectToInertialNStream, "objectToInertialN(Vector3Stream)") \
+    X(InertialToObjectNPerVector, "inertialToObjectN(RotationMatrix*)") \
+    X(ObjectToInertialNPerVector, "objectToInertialN(RotationMatrix*)") \
+    X(Vector3StreamAdd, "add(Vector3Stream)") \
+    X(Vector3StreamSub, "sub(Vector3Stream)") \
+    X(Vector3StreamScale, "scale(Vector3Stream)") \
+    X(Vector3StreamCrossProduct, "crossProduct(Vector3Stream)") \
+    X(Vector3StreamDotProduct, "dotProduct(Vector3Stream)") \
+    X(Vector3StreamVectorMag, "vectorMag(Vector3Stream)") \
+    X(Vector3StreamDistance, "distance(Vector3Stream)") \
+    X(Vector3StreamNormalize, "normalize(Vector3Stream)") \
+    X(QuaternionStreamRenormalize, "renormalize(QuaternionStream)") \
+    X(IntegrateOrientations, "integrateOrientations") \
+    X(BlendN, "blendN") \
+    X(AdditiveDeltaN, "additiveDeltaN") \
+    X(BlendAdditiveN, "blendAdditiveN") \
+    X(DualQuaternionFromMatrixN, "fromMatrixN(DualQuaternion)") \
+    X(PackN32, "packN(PackedQuaternion32)") \
+    X(PackN48, "packN(PackedQuaternion48)") \
+    X(PackN64, "packN(PackedQuaternion64)") \
+    X(UnpackN32, "unpackN(PackedQuaternion32)") \
+    X(UnpackN48, "unpackN(PackedQuaternion48)") \
+    X(UnpackN64, "unpackN(PackedQuaternion64)") \
+    X(SkinVertices, "skinVertices") \
+    X(SampleClips, "sampleClips") \
+    X(TransformHierarchyUpdate, "TransformHierarchy::update") \
+    X(TransformHierarchyUpdateAll, "TransformHierarchy::updateAll") \
+    X(ComputeBounds, "computeBounds") \
+    X(ComputeBoundsStream, "computeBounds(Vector3Stream)") \
+    X(TransformBoxes, "transformBoxes") \
+    X(TransformBoxesPerBox, "transformBoxes(Matrix4x3*)") \
+    X(UnionBoxes, "unionBoxes") \
+    X(IntersectAABBsN, "intersectAABBsN") \
+    X(IntersectAABBsNPairwise, "intersectAABBsN(AABB3*, AABB3*)") \
+    X(Cull, "cull") \
+    X(CullMultiView, "cull(CullingView*)") \
+    X(BVHBuild, "BVH::build") \
+    X(BVHRefit, "BVH::refit") \
+    X(BVHRayCastN, "rayCastN") \
+    X(BVHNearestN, "nearestN") \
+    X(RayPacketAABBIntersect, "rayAABBIntersect(RayPacket)") \
+    X(RayPacketSphereIntersect, "raySphereIntersect(RayPacket)") \
+    X(RayPacketPlaneIntersect, "rayPlaneIntersect(RayPacket)") \
+    X(RayPacketTriangleIntersect, "rayTriangleIntersect(RayPacket)") \
+    X(RayPacketTrianglesIntersect, "rayTrianglesIntersect")
+
+#define MATH_INSTRUMENT_ENUM(id, name) kInstrument##id,
+enum InstrumentId {
+    MATH_INSTRUMENT_COUNTERS(MATH_INSTRUMENT_ENUM)
+    kInstrumentCount
+};
+#undef MATH_INSTRUMENT_ENUM
+
+// 直方图的组数，最后一组还包括更长的耗时
+const int kInstrumentBuckets = 32;
+
+// 一个函数的统计结果
+struct InstrumentStats {
+    const char* name;
+    unsigned long long calls;
+    // 批量函数处理的元素总数（蒙皮按补齐后的顶点数，动画采样按骨骼数），单个元素的函数为0
+    unsigned long long elements;
+    // 测量了耗时的调用次数、这些调用处理的元素个数和总周期数
+    unsigned long long samples;
+    unsigned long long sampledElements;
+    unsigned long long cycles;
+    unsigned long long histogram[kInstrumentBuckets];
+    // 调用次数是否由抽样估计（MATH_INSTRUMENT_SAMPLED统计的函数）
+    bool callsSampled;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 读取统计结果，MATH_INSTRUMENT为0时也可以调用，结果为空
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// 所有线程的统计结果之和，只包括调用过的函数，按总耗时的估计值从大到小排列
+extern void instrumentSnapshot(std::vector<InstrumentStats>& stats);
+
+// 计数器清零，应在其他线程没有调用库函数时进行，否则可能有少量计数没有被清掉
+extern void instrumentReset();
+
+// 写出文本报告：每个函数一行，包括调用次数、平均周期数、估计的总周期数和从直方图估计的中位数、99%分位数
+extern void instrumentReport(FILE* file);
+
+// 写出JSON格式的统计结果，包括直方图
+extern void instrumentReportJson(FILE* file);
+
+#if MATH_INSTRUMENT
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define MATH_INSTRUMENT_TSC 1
+#else
+#include <chrono>
+#endif
+
+/*
+    一个线程中一个函数的计数器，只由所属的线程写，其他线程读取时可能看到稍旧的值
+    用relaxed的原子变量只是为了让并发读写有定义，在x86和ARM上读写都是普通的访存指令
+ */
+struct InstrumentCounter {
+    std::atomic<unsigned long long> calls;
+    // 其中由抽样估计的调用次数
+    std::atomic<unsigned long long> sampledCalls;
+    std::atomic<unsigned long long> elements;
+    std::atomic<unsigned long long> samples;
+    std::atomic<unsigned long long> sampledElements;
+    std::atomic<unsigned long long> cycles;
+    std::atomic<unsigned long long> histogram[kInstrumentBuckets];
+};
+
+// 一个线程的全部计数器，所有线程的计数器组成一个只增加的链表，线程结束后仍然保留，统计结果不会丢失
+struct InstrumentThreadData {
+    InstrumentCounter counters[kInstrumentCount];
+    InstrumentThreadData* next;
+};
+
+/*
+    当前线程的计数器，第一次使用前为NULL
+    GCC和Clang的__thread变量不能动态初始化，访问时不需要像thread_local那样先检查是否要调用初始化函数
+ */
+#if defined(__GNUC__)
+#define MATH_INSTRUMENT_THREAD_LOCAL __thread
+#else
+#define MATH_INSTRUMENT_THREAD_LOCAL thread_local
+#endif
+extern MATH_INSTRUMENT_THREAD_LOCAL InstrumentThreadData* tlsInstrumentData;
+
+/*
+    抽样计数的函数在当前线程的调用计数，只用来决定哪次调用进入测量的路径，溢出后回绕
+    静态初始化为0的TLS数组，访问时不需要读指针和检查是否已经分配，x86上是一条相对于fs的加法
+ */
+extern MATH_INSTRUMENT_THREAD_LOCAL unsigned tlsInstrumentTicks[kInstrumentCount];
+
+// 为当前线程分配计数器并加入链表
+extern InstrumentThreadData* instrumentRegisterThread();
+
+// 记录一次测量的耗时
+extern void instrumentRecord(InstrumentCounter& counter, size_t elements, unsigned long long cycles);
+
+// 抽样计数的函数记录一次测量的耗时，同时把调用次数加上距上次抽样的次数
+extern void instrumentRecordSampled(InstrumentId id, unsigned long long cycles);
+
+static inline unsigned long long instrumentCycles() {
+#if defined(MATH_INSTRUMENT_TSC)
+    return __rdtsc();
+#else
+    return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static inline void instrumentIncrement(std::atomic<unsigned long long>& a, unsigned long long k) {
+    a.store(a.load(std::memory_order_relaxed) + k, std::memory_order_relaxed);
+}
+
+/*
+    统计一次调用，构造时计数，需要测量耗时的调用在析构时记录
+    elements为批量函数处理的元素个数，单个元素的函数为0
+    不测量的调用只有一次读TLS和一次计数器加1；测量的部分不内联，减少对函数本身寄存器分配的影响
+ */
+class InstrumentScope {
+public:
+    InstrumentScope(InstrumentId id, size_t elements) : elements(elements), start(0) {
+        InstrumentThreadData* data = tlsInstrumentData;
+        if (data == NULL) {
+            data = instrumentRegisterThread();
+        }
+        counter = &data->counters[id];
+        unsigned long long calls = counter->calls.load(std::memory_order_relaxed);
+        counter->calls.store(calls + 1, std::memory_order_relaxed);
+        if (elements != 0) {
+            instrumentIncrement(counter->elements, elements);
+        }
+        if ((calls & ((1ull << MATH_INSTRUMENT_SAMPLE_SHIFT) - 1)) == 0 || elements >= MATH_INSTRUMENT_TIMED_ELEMENTS) {
+            start = instrumentCycles();
+        }
+    }
+
+    ~InstrumentScope() {
+        // 时间戳计数器不会为0，start为0表示这次调用不测量
+        if (start != 0) {
+            instrumentRecord(*counter, elements, instrumentCycles() - start);
+        }
+    }
+
+private:
+    InstrumentScope(const InstrumentScope&);
+    InstrumentScope& operator=(const InstrumentScope&);
+
+    InstrumentCounter* counter;
+    size_t elements;
+    unsigned long long start;
+};
+
+/*
+    抽样计数，用于不到10纳秒的函数
+    第1次和之后每2^MATH_INSTRUMENT_SAMPLE_SHIFT次调用测量耗时并计数，其他调用只有一次TLS中的加法和一次分支
+ */
+class InstrumentSampledScope {
+public:
+    explicit InstrumentSampledScope(InstrumentId id) : id(id), start(0) {
+        if ((tlsInstrumentTicks[id]++ & ((1u << MATH_INSTRUMENT_SAMPLE_SHIFT) - 1)) == 0) {
+            start = instrumentCycles();
+        }
+    }
+
+    ~InstrumentSampledScope() {
+        if (start != 0) {
+            instrumentRecordSampled(id, instrumentCycles() - start);
+        }
+    }
+
+private:
+    InstrumentSampledScope(const InstrumentSampledScope&);
+    InstrumentSampledScope& operator=(const InstrumentSampledScope&);
+
+    InstrumentId id;
+    unsigned long long start;
+};
+
+/*
+    放在函数体的开头，统计到函数返回为止；批量函数用MATH_INSTRUMENT_BATCH，n为处理的元素个数
+    不到10纳秒的函数用MATH_INSTRUMENT_SAMPLED，调用次数由抽样估计
+ */
+#define MATH_INSTRUMENT_SCOPE(id) InstrumentScope instrumentScope(kInstrument##id, 0)
+#define MATH_INSTRUMENT_BATCH(id, n) InstrumentScope instrumentScope(kInstrument##id, (size_t)(n))
+#define MATH_INSTRUMENT_SAMPLED(id) InstrumentSampledScope instrumentScope(kInstrument##id)
+
+#else
+
+#define MATH_INSTRUMENT_SCOPE(id) ((void)0)
+#define MATH_INSTRUMENT_BATCH(id, n) ((void)0)
+#define MATH_INSTRUMENT_SAMPLED(id) ((void)0)
+
+#endif
+
+#endif /* Instrument_hpp */
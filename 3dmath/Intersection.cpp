@@ -0,0 +1,392 @@
+//
+//  Intersection.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "Intersection.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#include "AABB3.hpp"
+#include "SimdUtil.h"
+#include "Instrument.hpp"
+
+/*
+    Möller-Trumbore
+    解o + t * d = p0 + u * e1 + v * e2，由克莱姆法则：
+    det = e1 * (d x e2)，u = (s * (d x e2)) / det，v = (d * (s x e1)) / det，t = (e2 * (s x e1)) / det，其中s = o - p0
+    det = -d * (e1 x e2)，所以击中正面时det > 0
+ */
+bool rayTriangleIntersect(const Vector3& rayOrg, const Vector3& rayDelta,
+                          const Vector3& p0, const Vector3& p1, const Vector3& p2,
+                          RayCulling culling, float* t, float* u, float* v) {
+    Vector3 e1 = p1 - p0;
+    Vector3 e2 = p2 - p0;
+    Vector3 p = crossProduct(rayDelta, e2);
+    float det = e1 * p;
+    if (culling == kCullBackFace ? !(det > 0.0f) : (culling == kCullFrontFace ? !(det < 0.0f) : det == 0.0f)) {
+        return false;
+    }
+    float oneOverDet = 1.0f / det;
+
+    Vector3 s = rayOrg - p0;
+    float hitU = (s * p) * oneOverDet;
+    if (hitU < 0.0f || hitU > 1.0f) {
+        return false;
+    }
+    Vector3 q = crossProduct(s, e1);
+    float hitV = (rayDelta * q) * oneOverDet;
+    if (hitV < 0.0f || hitU + hitV > 1.0f) {
+        return false;
+    }
+    float hitT = (e2 * q) * oneOverDet;
+    if (hitT < 0.0f || hitT > 1.0f) {
+        return false;
+    }
+
+    *t = hitT;
+    if (u != NULL) {
+        *u = hitU;
+    }
+    if (v != NULL) {
+        *v = hitV;
+    }
+    return true;
+}
+
+// 方向分量为0时换成很小的数，避免平板测试中出现0 * inf
+static inline float slabInverse(float d) {
+    return 1.0f / (fabsf(d) < 1e-30f ? copysignf(1e-30f, d) : d);
+}
+
+/*
+    平板法：射线进入三对平面之间的区间取最大的进入参数和最小的离开参数，进入不晚于离开就相交
+    与13.17中先选出可能相交的平面再检查交点的方法结果相同，但没有分支，适合SIMD
+ */
+bool rayAABBIntersect(const Vector3& rayOrg, const Vector3& rayDelta, const AABB3& box, float* t) {
+    if (box.isEmpty()) {
+        return false;
+    }
+    float tEnter = 0.0f, tExit = 1.0f;
+    const float* o = &rayOrg.x;
+    const float* d = &rayDelta.x;
+    const float* lo = &box.min.x;
+    const float* hi = &box.max.x;
+    for (int a = 0; a < 3; ++a) {
+        float inv = slabInverse(d[a]);
+        float t1 = (lo[a] - o[a]) * inv;
+        float t2 = (hi[a] - o[a]) * inv;
+        tEnter = std::max(tEnter, std::min(t1, t2));
+        tExit = std::min(tExit, std::max(t1, t2));
+    }
+    if (tEnter > tExit) {
+        return false;
+    }
+    *t = tEnter;
+    return true;
+}
+
+/*
+    令m = o - c，解|m + t * d|^2 = r^2，即a * t^2 + 2b * t + c = 0，
+    a = d * d，b = m * d，c = m * m - r^2，较小的根为(-b - sqrt(b^2 - a * c)) / a
+    c <= 0时起点在球内；否则b > 0时射线背离球心，不相交
+ */
+bool raySphereIntersect(const Vector3& rayOrg, const Vector3& rayDelta, const Vector3& center, float radius, float* t) {
+    Vector3 m = rayOrg - center;
+    float c = m * m - radius * radius;
+    if (c <= 0.0f) {
+        *t = 0.0f;
+        return true;
+    }
+    float a = rayDelta * rayDelta;
+    float b = m * rayDelta;
+    float disc = b * b - a * c;
+    if (b > 0.0f || disc < 0.0f || a == 0.0f) {
+        return false;
+    }
+    float hitT = (-b - sqrtf(disc)) / a;
+    if (hitT > 1.0f) {
+        return false;
+    }
+    *t = hitT;
+    return true;
+}
+
+// (o + t * delta) * n = d，t = (d - o * n) / (delta * n)
+bool rayPlaneIntersect(const Vector3& rayOrg, const Vector3& rayDelta, const Vector3& n, float d,
+                       RayCulling culling, float* t) {
+    float dn = rayDelta * n;
+    if (culling == kCullBackFace ? !(dn < 0.0f) : (culling == kCullFrontFace ? !(dn > 0.0f) : dn == 0.0f)) {
+        return false;
+    }
+    float hitT = (d - rayOrg * n) / dn;
+    if (hitT < 0.0f || hitT > 1.0f) {
+        return false;
+    }
+    *t = hitT;
+    return true;
+}
+
+void RayPacket::set(const Vector3* rayOrg, const Vector3* rayDelta, int n) {
+    count = n < kRayPacketSize ? n : kRayPacketSize;
+    for (int i = 0; i < kRayPacketSize; ++i) {
+        if (i < count) {
+            set(i, rayOrg[i], rayDelta[i]);
+        } else {
+            set(i, kZeroVector, kZeroVector);
+        }
+    }
+}
+
+void RayPacket::set(int i, const Vector3& rayOrg, const Vector3& rayDelta) {
+    orgX[i] = rayOrg.x;
+    orgY[i] = rayOrg.y;
+    orgZ[i] = rayOrg.z;
+    deltaX[i] = rayDelta.x;
+    deltaY[i] = rayDelta.y;
+    deltaZ[i] = rayDelta.z;
+}
+
+void RayPacketHit::reset() {
+    for (int i = 0; i < kRayPacketSize; ++i) {
+        t[i] = FLT_MAX;
+        u[i] = v[i] = 0.0f;
+        primitive[i] = -1;
+    }
+}
+
+/*
+    射线包的测试
+    每次处理kSimdWidth条射线，共kPacketGroups组，每组的计算与单条射线的版本相同，只是没有分支
+ */
+static const int kPacketGroups = kRayPacketSize / kSimdWidth;
+
+static const float kLaneIndex[kRayPacketSize] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+
+struct RayLanes {
+    SimdFloat ox, oy, oz;
+    SimdFloat dx, dy, dz;
+    SimdMask active;
+};
+
+static inline RayLanes loadLanes(const RayPacket& rays, int j) {
+    RayLanes r;
+    r.ox = simdLoadU(rays.orgX + j);
+    r.oy = simdLoadU(rays.orgY + j);
+    r.oz = simdLoadU(rays.orgZ + j);
+    r.dx = simdLoadU(rays.deltaX + j);
+    r.dy = simdLoadU(rays.deltaY + j);
+    r.dz = simdLoadU(rays.deltaZ + j);
+    r.active = simdCmpLt(simdLoadU(kLaneIndex + j), simdSet((float)rays.count));
+    return r;
+}
+
+static inline SimdFloat dot(SimdFloat ax, SimdFloat ay, SimdFloat az, SimdFloat bx, SimdFloat by, SimdFloat bz) {
+    return simdMadd(az, bz, simdMadd(ay, by, simdMul(ax, bx)));
+}
+
+// 按剔除方式选择det的有效范围，det为0时总是无效
+static inline SimdMask facing(SimdFloat det, RayCulling culling) {
+    SimdFloat zero = simdZero();
+    if (culling == kCullBackFace) {
+        return simdCmpGt(det, zero);
+    }
+    if (culling == kCullFrontFace) {
+        return simdCmpLt(det, zero);
+    }
+    return simdCmpGt(simdAbs(det), zero);
+}
+
+// 三角形的p0和两条边，广播到所有通道
+struct TriangleLanes {
+    SimdFloat p0x, p0y, p0z;
+    SimdFloat e1x, e1y, e1z;
+    SimdFloat e2x, e2y, e2z;
+};
+
+static inline TriangleLanes broadcastTriangle(const Vector3& p0, const Vector3& p1, const Vector3& p2) {
+    TriangleLanes tri;
+    tri.p0x = simdSet(p0.x); tri.p0y = simdSet(p0.y); tri.p0z = simdSet(p0.z);
+    tri.e1x = simdSet(p1.x - p0.x); tri.e1y = simdSet(p1.y - p0.y); tri.e1z = simdSet(p1.z - p0.z);
+    tri.e2x = simdSet(p2.x - p0.x); tri.e2y = simdSet(p2.y - p0.y); tri.e2z = simdSet(p2.z - p0.z);
+    return tri;
+}
+
+static inline SimdMask triangleLanes(const RayLanes& r, const TriangleLanes& tri, RayCulling culling,
+                                     SimdFloat& t, SimdFloat& u, SimdFloat& v) {
+    SimdFloat px = simdSub(simdMul(r.dy, tri.e2z), simdMul(r.dz, tri.e2y));
+    SimdFloat py = simdSub(simdMul(r.dz, tri.e2x), simdMul(r.dx, tri.e2z));
+    SimdFloat pz = simdSub(simdMul(r.dx, tri.e2y), simdMul(r.dy, tri.e2x));
+    SimdFloat det = dot(tri.e1x, tri.e1y, tri.e1z, px, py, pz);
+    SimdFloat oneOverDet = simdDiv(simdSet(1.0f), det);
+
+    SimdFloat sx = simdSub(r.ox, tri.p0x), sy = simdSub(r.oy, tri.p0y), sz = simdSub(r.oz, tri.p0z);
+    u = simdMul(dot(sx, sy, sz, px, py, pz), oneOverDet);
+    SimdFloat qx = simdSub(simdMul(sy, tri.e1z), simdMul(sz, tri.e1y));
+    SimdFloat qy = simdSub(simdMul(sz, tri.e1x), simdMul(sx, tri.e1z));
+    SimdFloat qz = simdSub(simdMul(sx, tri.e1y), simdMul(sy, tri.e1x));
+    v = simdMul(dot(r.dx, r.dy, r.dz, qx, qy, qz), oneOverDet);
+    t = simdMul(dot(tri.e2x, tri.e2y, tri.e2z, qx, qy, qz), oneOverDet);
+
+    SimdFloat zero = simdZero(), one = simdSet(1.0f);
+    SimdMask hit = simdMaskAnd(facing(det, culling), r.active);
+    hit = simdMaskAnd(hit, simdMaskAnd(simdCmpGe(u, zero), simdCmpGe(v, zero)));
+    hit = simdMaskAnd(hit, simdCmpLe(simdAdd(u, v), one));
+    return simdMaskAnd(hit, simdMaskAnd(simdCmpGe(t, zero), simdCmpLe(t, one)));
+}
+
+int rayTriangleIntersect(const RayPacket& rays, const Vector3& p0, const Vector3& p1, const Vector3& p2,
+                         RayCulling culling, float* t, float* u, float* v) {
+    MATH_INSTRUMENT_BATCH(RayPacketTriangleIntersect, rays.count);
+    TriangleLanes tri = broadcastTriangle(p0, p1, p2);
+    SimdFloat noHit = simdSet(FLT_MAX);
+    int result = 0;
+    for (int j = 0; j < kRayPacketSize; j += kSimdWidth) {
+        SimdFloat hitT, hitU, hitV;
+        SimdMask hit = triangleLanes(loadLanes(rays, j), tri, culling, hitT, hitU, hitV);
+        simdStoreU(t + j, simdSelect(hit, hitT, noHit));
+        if (u != NULL) {
+            simdStoreU(u + j, hitU);
+        }
+        if (v != NULL) {
+            simdStoreU(v + j, hitV);
+        }
+        result |= simdMoveMask(hit) << j;
+    }
+    return result;
+}
+
+static inline SimdFloat slabInverseLanes(SimdFloat d) {
+    SimdFloat tiny = simdSet(1e-30f);
+    return simdDiv(simdSet(1.0f), simdSelect(simdCmpLt(simdAbs(d), tiny), simdCopySign(tiny, d), d));
+}
+
+int rayAABBIntersect(const RayPacket& rays, const AABB3& box, float* t) {
+    MATH_INSTRUMENT_BATCH(RayPacketAABBIntersect, rays.count);
+    SimdFloat noHit = simdSet(FLT_MAX);
+    if (box.isEmpty()) {
+        for (int j = 0; j < kRayPacketSize; j += kSimdWidth) {
+            simdStoreU(t + j, noHit);
+        }
+        return 0;
+    }
+    SimdFloat minX = simdSet(box.min.x), minY = simdSet(box.min.y), minZ = simdSet(box.min.z);
+    SimdFloat maxX = simdSet(box.max.x), maxY = simdSet(box.max.y), maxZ = simdSet(box.max.z);
+    int result = 0;
+    for (int j = 0; j < kRayPacketSize; j += kSimdWidth) {
+        RayLanes r = loadLanes(rays, j);
+        SimdFloat ix = slabInverseLanes(r.dx), iy = slabInverseLanes(r.dy), iz = slabInverseLanes(r.dz);
+        SimdFloat t1x = simdMul(simdSub(minX, r.ox), ix), t2x = simdMul(simdSub(maxX, r.ox), ix);
+        SimdFloat t1y = simdMul(simdSub(minY, r.oy), iy), t2y = simdMul(simdSub(maxY, r.oy), iy);
+        SimdFloat t1z = simdMul(simdSub(minZ, r.oz), iz), t2z = simdMul(simdSub(maxZ, r.oz), iz);
+        SimdFloat tEnter = simdMax(simdMax(simdMin(t1x, t2x), simdMin(t1y, t2y)), simdMax(simdMin(t1z, t2z), simdZero()));
+        SimdFloat tExit = simdMin(simdMin(simdMax(t1x, t2x), simdMax(t1y, t2y)), simdMin(simdMax(t1z, t2z), simdSet(1.0f)));
+        SimdMask hit = simdMaskAnd(simdCmpLe(tEnter, tExit), r.active);
+        simdStoreU(t + j, simdSelect(hit, tEnter, noHit));
+        result |= simdMoveMask(hit) << j;
+    }
+    return result;
+}
+
+int raySphereIntersect(const RayPacket& rays, const Vector3& center, float radius, float* t) {
+    MATH_INSTRUMENT_BATCH(RayPacketSphereIntersect, rays.count);
+    SimdFloat cx = simdSet(center.x), cy = simdSet(center.y), cz = simdSet(center.z);
+    SimdFloat rr = simdSet(radius * radius);
+    SimdFloat zero = simdZero(), noHit = simdSet(FLT_MAX);
+    int result = 0;
+    for (int j = 0; j < kRayPacketSize; j += kSimdWidth) {
+        RayLanes r = loadLanes(rays, j);
+        SimdFloat mx = simdSub(r.ox, cx), my = simdSub(r.oy, cy), mz = simdSub(r.oz, cz);
+        SimdFloat c = simdSub(dot(mx, my, mz, mx, my, mz), rr);
+        SimdFloat a = dot(r.dx, r.dy, r.dz, r.dx, r.dy, r.dz);
+        SimdFloat b = dot(mx, my, mz, r.dx, r.dy, r.dz);
+        SimdFloat disc = simdNmadd(a, c, simdMul(b, b));
+        SimdFloat hitT = simdDiv(simdSub(simdNeg(b), simdSqrt(simdMax(disc, zero))), a);
+
+        // a为0时hitT是NaN，比较的结果为假
+        SimdMask inside = simdCmpLe(c, zero);
+        SimdMask outside = simdMaskAnd(simdMaskAnd(simdCmpLe(b, zero), simdCmpGe(disc, zero)), simdCmpLe(hitT, simdSet(1.0f)));
+        SimdMask hit = simdMaskAnd(simdMaskOr(inside, outside), r.active);
+        simdStoreU(t + j, simdSelect(hit, simdSelect(inside, zero, hitT), noHit));
+        result |= simdMoveMask(hit) << j;
+    }
+    return result;
+}
+
+int rayPlaneIntersect(const RayPacket& rays, const Vector3& n, float d, RayCulling culling, float* t) {
+    MATH_INSTRUMENT_BATCH(RayPacketPlaneIntersect, rays.count);
+    SimdFloat nx = simdSet(n.x), ny = simdSet(n.y), nz = simdSet(n.z), pd = simdSet(d);
+    SimdFloat zero = simdZero(), one = simdSet(1.0f), noHit = simdSet(FLT_MAX);
+    int result = 0;
+    for (int j = 0; j < kRayPacketSize; j += kSimdWidth) {
+        RayLanes r = loadLanes(rays, j);
+        SimdFloat dn = dot(r.dx, r.dy, r.dz, nx, ny, nz);
+        SimdFloat hitT = simdDiv(simdSub(pd, dot(r.ox, r.oy, r.oz, nx, ny, nz)), dn);
+
+        // 剔除方式与三角形相反：射线与法向量同向时det = -dn
+        SimdMask hit = simdMaskAnd(facing(simdNeg(dn), culling), r.active);
+        hit = simdMaskAnd(hit, simdMaskAnd(simdCmpGe(hitT, zero), simdCmpLe(hitT, one)));
+        simdStoreU(t + j, simdSelect(hit, hitT, noHit));
+        result |= simdMoveMask(hit) << j;
+    }
+    return result;
+}
+
+/*
+    一个射线包与一批三角形：射线和目前最近的交点一直留在寄存器中，每个三角形只广播一次
+    有射线更新了交点时才逐通道写入三角形的下标
+ */
+int rayTrianglesIntersect(const RayPacket& rays, const Vector3* vertices, const unsigned int* indices,
+                          size_t triangleCount, RayCulling culling, RayPacketHit& hit, int firstPrimitive) {
+    MATH_INSTRUMENT_BATCH(RayPacketTrianglesIntersect, triangleCount);
+    RayLanes lanes[kPacketGroups];
+    SimdFloat bestT[kPacketGroups], bestU[kPacketGroups], bestV[kPacketGroups];
+    for (int g = 0; g < kPacketGroups; ++g) {
+        lanes[g] = loadLanes(rays, g * kSimdWidth);
+        bestT[g] = simdLoadU(hit.t + g * kSimdWidth);
+        bestU[g] = simdLoadU(hit.u + g * kSimdWidth);
+        bestV[g] = simdLoadU(hit.v + g * kSimdWidth);
+    }
+
+    for (size_t i = 0; i < triangleCount; ++i) {
+        TriangleLanes tri;
+        if (indices != NULL) {
+            tri = broadcastTriangle(vertices[indices[3 * i]], vertices[indices[3 * i + 1]], vertices[indices[3 * i + 2]]);
+        } else {
+            tri = broadcastTriangle(vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]);
+        }
+        for (int g = 0; g < kPacketGroups; ++g) {
+            SimdFloat t, u, v;
+            SimdMask hitMask = triangleLanes(lanes[g], tri, culling, t, u, v);
+            SimdMask closer = simdMaskAnd(hitMask, simdCmpLt(t, bestT[g]));
+            int mask = simdMoveMask(closer);
+            if (mask == 0) {
+                continue;
+            }
+            bestT[g] = simdSelect(closer, t, bestT[g]);
+            bestU[g] = simdSelect(closer, u, bestU[g]);
+            bestV[g] = simdSelect(closer, v, bestV[g]);
+            for (int k = 0; k < kSimdWidth; ++k) {
+                if ((mask >> k) & 1) {
+                    hit.primitive[g * kSimdWidth + k] = firstPrimitive + (int)i;
+                }
+            }
+        }
+    }
+
+    for (int g = 0; g < kPacketGroups; ++g) {
+        simdStoreU(hit.t + g * kSimdWidth, bestT[g]);
+        simdStoreU(hit.u + g * kSimdWidth, bestU[g]);
+        simdStoreU(hit.v + g * kSimdWidth, bestV[g]);
+    }
+    int count = 0;
+    for (int i = 0; i < kRayPacketSize; ++i) {
+        count += hit.primitive[i] >= 0;
+    }
+    return count;
+}
@@ -0,0 +1,101 @@
+//
+//  Intersection.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef Intersection_hpp
+#define Intersection_hpp
+
+#include <stddef.h>
+
+#include "Vector3.hpp"
+
+class AABB3;
+
+/*
+    射线相交检测，参看第13章
+    射线用参数形式rayOrg + t * rayDelta表示，只报告t在[0, 1]之间的交点，返回的t为最近交点的参数
+ */
+
+/*
+    面的剔除方式
+    三角形按本书的约定，从正面看顶点为顺时针，法向量crossProduct(p1 - p0, p2 - p0)指向正面；
+    平面p * n = d的正面是n指向的一侧。射线方向与法向量的点乘小于0时击中的是正面
+ */
+enum RayCulling {
+    kCullNone,          // 两面都报告
+    kCullBackFace,      // 只报告正面
+    kCullFrontFace      // 只报告背面
+};
+
+/*
+    射线与三角形相交，参看13.16
+    用Möller-Trumbore方法，不需要预先计算三角形的平面，u、v（可以为NULL）为交点的重心坐标，
+    交点为p0 + u * (p1 - p0) + v * (p2 - p0)
+ */
+extern bool rayTriangleIntersect(const Vector3& rayOrg, const Vector3& rayDelta,
+                                 const Vector3& p0, const Vector3& p1, const Vector3& p2,
+                                 RayCulling culling, float* t, float* u = NULL, float* v = NULL);
+
+// 射线与AABB相交，参看13.17，用平板（slab）法；起点在AABB内时t为0
+extern bool rayAABBIntersect(const Vector3& rayOrg, const Vector3& rayDelta, const AABB3& box, float* t);
+
+// 射线与球相交，参看13.12；起点在球内时t为0
+extern bool raySphereIntersect(const Vector3& rayOrg, const Vector3& rayDelta, const Vector3& center, float radius, float* t);
+
+// 射线与平面p * n = d相交，参看13.9，射线与平面平行时不相交
+extern bool rayPlaneIntersect(const Vector3& rayOrg, const Vector3& rayDelta, const Vector3& n, float d,
+                              RayCulling culling, float* t);
+
+/*
+    射线包：kRayPacketSize条射线以SoA方式存放，一次测试所有射线
+    大小固定为8，与编译选项无关：AVX时是一个寄存器，SSE和NEON时是两个，标量时逐条计算
+    count之后的射线不参与测试，结果中对应的位总是0
+ */
+static const int kRayPacketSize = 8;
+
+struct RayPacket {
+    float orgX[kRayPacketSize], orgY[kRayPacketSize], orgZ[kRayPacketSize];
+    float deltaX[kRayPacketSize], deltaY[kRayPacketSize], deltaZ[kRayPacketSize];
+    int count;
+
+    // 从数组中取最多kRayPacketSize条射线，多余的通道是长度为0的射线
+    void set(const Vector3* rayOrg, const Vector3* rayDelta, int n);
+    void set(int i, const Vector3& rayOrg, const Vector3& rayDelta);
+};
+
+/*
+    射线包的测试，返回相交射线的掩码（第i位对应第i条射线），t中写入各射线的交点参数，没有相交的为FLT_MAX
+    与对每条射线分别调用单条射线的版本结果相同，只是使用FMA时交点参数可能有舍入误差
+ */
+extern int rayTriangleIntersect(const RayPacket& rays, const Vector3& p0, const Vector3& p1, const Vector3& p2,
+                                RayCulling culling, float* t, float* u = NULL, float* v = NULL);
+extern int rayAABBIntersect(const RayPacket& rays, const AABB3& box, float* t);
+extern int raySphereIntersect(const RayPacket& rays, const Vector3& center, float radius, float* t);
+extern int rayPlaneIntersect(const RayPacket& rays, const Vector3& n, float d, RayCulling culling, float* t);
+
+/*
+    射线包中各射线目前最近的交点，primitive为-1表示还没有交点
+    reset()后可以对多批三角形依次调用rayTrianglesIntersect，结果为所有批次中最近的交点
+ */
+struct RayPacketHit {
+    float t[kRayPacketSize];
+    float u[kRayPacketSize], v[kRayPacketSize];
+    int primitive[kRayPacketSize];
+
+    void reset();
+};
+
+/*
+    一个射线包与一批三角形相交，只在交点比hit中已有的更近时更新
+    indices为NULL时第i个三角形的顶点为vertices[3i]、vertices[3i + 1]、vertices[3i + 2]，
+    否则为vertices[indices[3i]]等。primitive为三角形在这一批中的下标加上firstPrimitive
+    返回调用后有交点的射线个数
+ */
+extern int rayTrianglesIntersect(const RayPacket& rays, const Vector3* vertices, const unsigned int* indices,
+                                 size_t triangleCount, RayCulling culling, RayPacketHit& hit, int firstPrimitive = 0);
+
+#endif /* Intersection_hpp */
@@ -7,10 +7,12 @@
 //
 
 #include <math.h>
+#include <string.h>
 #include "MathUtil.h"
 #include "Vector3.hpp"
-
-const Vector3 kZeroVector(0.0f, 0.0f, 0.0f);
+#include "SimdMath.h"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
 
 // 通过加上适当的2pi倍数，将角度限制在-pi到pi的区间
 float wrapPi(float theta) {
@@ -31,5 +33,154 @@ float safeAcos(float x) {
         return 0.0f;
     }
     
+    return mathAcos(x);
+}
+
+// 把视场角转换为缩放倍数，fov以弧度表示
+float fovToZoom(float fov) {
+    return 1.0f / tanf(fov * 0.5f);
+}
+
+// 把缩放倍数转换为视场角
+float zoomToFov(float zoom) {
+    return 2.0f * atanf(1.0f / zoom);
+}
+
+// x必须在[-1, 1]之间
+float mathAcos(float x) {
+#if MATH_ACCURACY == MATH_ACCURACY_FULL
     return acos(x);
+#else
+    float a = fabsf(x);
+    float r = sqrtf(1.0f - a) * polyEval(kAcosCoef, a);
+    return x < 0.0f ? kPi - r : r;
+#endif
+}
+
+float mathAsin(float x) {
+#if MATH_ACCURACY == MATH_ACCURACY_FULL
+    return asin(x);
+#else
+    return KPiOver2 - mathAcos(x);
+#endif
+}
+
+float mathAtan2(float y, float x) {
+#if MATH_ACCURACY == MATH_ACCURACY_FULL
+    return atan2(y, x);
+#else
+    // 先求第一象限中较小边与较大边之比的反正切
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float big = ax > ay ? ax : ay;
+    float small = ax > ay ? ay : ax;
+    if (big == 0.0f) {
+        return copysignf(x < 0.0f ? kPi : 0.0f, y);
+    }
+    float a = small / big;
+
+    float base = 0.0f;
+    if (kAtanReduce && a > 0.414213562f) {
+        a = (a - 1.0f) / (a + 1.0f);
+        base = kPi * 0.25f;
+    }
+    float angle = base + a * polyEval(kAtanCoef, a * a);
+
+    // 还原到原来的象限
+    if (ay > ax) {
+        angle = KPiOver2 - angle;
+    }
+    if (x < 0.0f) {
+        angle = kPi - angle;
+    }
+    return copysignf(angle, y);
+#endif
+}
+
+/*
+    FAST等级使用经典的整数近似初值，再做两次牛顿迭代，相对误差约5e-6
+    其余等级直接计算，现代处理器上开方和除法都很快
+ */
+float mathRsqrt(float x) {
+#if MATH_ACCURACY == MATH_ACCURACY_FAST
+    unsigned int i;
+    memcpy(&i, &x, sizeof(i));
+    i = 0x5f3759df - (i >> 1);
+    float y;
+    memcpy(&y, &i, sizeof(y));
+    float halfX = 0.5f * x;
+    y = y * (1.5f - halfX * y * y);
+    y = y * (1.5f - halfX * y * y);
+    return y;
+#else
+    return 1.0f / sqrtf(x);
+#endif
+}
+
+/*
+    批量版本：每个块按kSimdWidth一组处理，数组末尾不足一组的部分用simdLoadPartial补齐
+    补齐的通道填充不会出错的值，计算结果不写回
+ */
+template <typename Kernel>
+static void forEachGroup(size_t n, size_t bytesPerElement, const Kernel& kernel) {
+    parallelForGroups(n, kSimdWidth, cacheChunk(bytesPerElement), kernel);
+}
+
+static inline SimdFloat loadGroup(const float* p, size_t count, float fill) {
+    return count == (size_t)kSimdWidth ? simdLoadU(p) : simdLoadPartial(p, count, fill);
+}
+
+static inline void storeGroup(float* p, size_t count, SimdFloat a) {
+    if (count == (size_t)kSimdWidth) {
+        simdStoreU(p, a);
+    } else {
+        simdStorePartial(p, count, a);
+    }
+}
+
+void sinCosN(const float* theta, float* returnSin, float* returnCos, size_t n) {
+    MATH_INSTRUMENT_BATCH(SinCosN, n);
+    forEachGroup(n, 3 * sizeof(float), [&](size_t i, size_t count) {
+        SimdFloat s, c;
+        simdSinCos(loadGroup(theta + i, count, 0.0f), s, c);
+        storeGroup(returnSin + i, count, s);
+        storeGroup(returnCos + i, count, c);
+    });
+}
+
+void wrapPiN(const float* theta, float* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(WrapPiN, n);
+    forEachGroup(n, 2 * sizeof(float), [&](size_t i, size_t count) {
+        storeGroup(out + i, count, simdWrapPi(loadGroup(theta + i, count, 0.0f)));
+    });
+}
+
+void safeAcosN(const float* x, float* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(SafeAcosN, n);
+    forEachGroup(n, 2 * sizeof(float), [&](size_t i, size_t count) {
+        storeGroup(out + i, count, simdSafeAcos(loadGroup(x + i, count, 0.0f)));
+    });
+}
+
+void atan2N(const float* y, const float* x, float* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(Atan2N, n);
+    forEachGroup(n, 3 * sizeof(float), [&](size_t i, size_t count) {
+        SimdFloat vy = loadGroup(y + i, count, 0.0f);
+        SimdFloat vx = loadGroup(x + i, count, 1.0f);
+        storeGroup(out + i, count, simdAtan2(vy, vx));
+    });
+}
+
+void sqrtN(const float* x, float* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(SqrtN, n);
+    forEachGroup(n, 2 * sizeof(float), [&](size_t i, size_t count) {
+        storeGroup(out + i, count, simdMathSqrt(loadGroup(x + i, count, 1.0f)));
+    });
+}
+
+void rsqrtN(const float* x, float* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(RsqrtN, n);
+    forEachGroup(n, 2 * sizeof(float), [&](size_t i, size_t count) {
+        storeGroup(out + i, count, simdMathRsqrt(loadGroup(x + i, count, 1.0f)));
+    });
 }
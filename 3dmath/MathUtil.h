@@ -10,23 +10,206 @@
 #define MathUtil_h
 
 #include <math.h>
+#include <stddef.h>
+#include <string.h>
 
-// 定义和pi有关常量
-const float kPi = 3.14159265f;
-const float k2Pi = kPi * 2.0f;
-const float KPiOver2 = kPi / 2.0f;
-const float k1OverPi = 1.0f / kPi;
-const float k1Over2Pi = 1.0f / k2Pi;
+// 定义和pi有关常量，constexpr使它们也能用在编译期计算中
+constexpr float kPi = 3.14159265f;
+constexpr float k2Pi = kPi * 2.0f;
+constexpr float KPiOver2 = kPi / 2.0f;
+constexpr float k1OverPi = 1.0f / kPi;
+constexpr float k1Over2Pi = 1.0f / k2Pi;
+
+/*
+    三角函数和开方的精度等级，编译时定义MATH_ACCURACY选择，调用处不需要修改
+    MATH_ACCURACY_FULL：使用标准库函数，这是默认值；SIMD版本借助double计算，最多相差1到2 ulp（参看SimdMath.h）
+    MATH_ACCURACY_HIGH：多项式近似，绝对误差约1e-6
+    MATH_ACCURACY_FAST：低阶多项式近似，绝对误差约1e-4
+    sinCos、safeAcos以及库中所有根据角度构造方位的代码都按这个等级计算
+ */
+#define MATH_ACCURACY_FULL 0
+#define MATH_ACCURACY_HIGH 1
+#define MATH_ACCURACY_FAST 2
+
+#ifndef MATH_ACCURACY
+#define MATH_ACCURACY MATH_ACCURACY_FULL
+#endif
+
+/*
+    近似多项式的系数，按霍纳法则从最高次项开始排列
+    sin(r) = r + r * r^2 * S(r^2)，cos(r) = 1 + r^2 * C(r^2)，r在[-pi/4, pi/4]之间
+    atan(a) = a * T(a^2)，HIGH等级先把a > tan(pi/8)变换为(a - 1) / (a + 1)再加上pi/4
+    acos(x) = sqrt(1 - x) * A(x)，x在[0, 1]之间，参看Abramowitz & Stegun 4.4.45和4.4.46
+ */
+#if MATH_ACCURACY == MATH_ACCURACY_FAST
+const float kSinCoef[] = { 8.1515757e-3f, -1.6662755e-1f };
+const float kCosCoef[] = { 4.0481893e-2f, -4.9977254e-1f };
+const float kAtanCoef[] = { 2.08351e-2f, -8.51330e-2f, 1.801410e-1f, -3.302995e-1f, 9.998660e-1f };
+const float kAcosCoef[] = { -1.87293e-2f, 7.42610e-2f, -2.121144e-1f, 1.5707288f };
+const bool kAtanReduce = false;
+#else
+const float kSinCoef[] = { -1.9515296e-4f, 8.3321609e-3f, -1.6666655e-1f };
+const float kCosCoef[] = { 2.4433157e-5f, -1.3887316e-3f, 4.1666646e-2f, -0.5f };
+const float kAtanCoef[] = { 8.05374449538e-2f, -1.38776856032e-1f, 1.99777106478e-1f, -3.33329491539e-1f, 1.0f };
+const float kAcosCoef[] = {
+    -1.2624911e-3f, 6.6700901e-3f, -1.70881256e-2f, 3.08918810e-2f,
+    -5.01743046e-2f, 8.89789874e-2f, -2.145988016e-1f, 1.5707963050f
+};
+const bool kAtanReduce = true;
+#endif
+
+// 求值多项式，coef按从高到低的次序排列
+template <size_t N>
+inline float polyEval(const float (&coef)[N], float x) {
+    float r = coef[0];
+    for (size_t i = 1; i < N; ++i) {
+        r = r * x + coef[i];
+    }
+    return r;
+}
+
+/*
+    sin和cos的区间约简：theta = q * pi/2 + r
+    pi/2分成三部分依次减去（Cody-Waite），减少大角度时的舍入误差
+ */
+const float kPiOver2Part1 = 1.5703125f;
+const float kPiOver2Part2 = 4.837512969970703125e-4f;
+const float kPiOver2Part3 = 7.54978995489188216e-8f;
+const float k2OverPi = 2.0f / kPi;
+
+/*
+    MATH_ACCURACY_FULL下SIMD版本的sin和cos自己约简的角度上限，参看SimdMath.h中的simdSinCos
+    在这个范围内与正确舍入的结果最多相差2 ulp（SSE和AVX2在整个范围内测得的最大误差约1.6 ulp），更大的角度逐个调用标准库函数
+ */
+const float kSinCosFullLimit = 524288.0f;
+
+/*
+    加上再减去1.5 * 2^23，把小数部分舍入掉，得到最接近的整数
+    只用加减法，比nearbyintf和floorf的库函数调用快得多，|x| < 2^22时有效
+ */
+const float kRoundMagic = 12582912.0f;
 
 // 通过增加适当的2pi倍数将角度限制在-pi到pi的区间内
 extern float wrapPi(float theta);
 // 安全反三角函数
 extern float safeAcos(float x);
+
+// 视场角与缩放倍数之间的转换，参看15.2.4，zoom = 1 / tan(fov / 2)
+extern float fovToZoom(float fov);
+extern float zoomToFov(float zoom);
+
+// 按MATH_ACCURACY计算的反三角函数和开方
+extern float mathAcos(float x);
+extern float mathAsin(float x);
+extern float mathAtan2(float y, float x);
+inline float mathSqrt(float x) { return sqrtf(x); }
+extern float mathRsqrt(float x);
+
 // 计算角度的sin和cos值
 // 在某些平台上，如果需要这两个值，同时计算比分开计算快
+// 多项式近似的等级在|theta| < 1e5时满足精度等级的误差，角度更大时约简的误差逐渐增大，但不会出现未定义行为
 inline void sinCos(float* returnSin, float* returnCos, float theta) {
-    // 为了简单，只使用标准三角函数，在某些平台上可以做的得更好一些
+#if MATH_ACCURACY == MATH_ACCURACY_FULL
     *returnSin = sin(theta);
     *returnCos = cos(theta);
+#else
+    // 约简到[-pi/4, pi/4]，两个多项式共用同一个r
+    float q = (theta * k2OverPi + kRoundMagic) - kRoundMagic;
+    float r = theta - q * kPiOver2Part1;
+    r -= q * kPiOver2Part2;
+    r -= q * kPiOver2Part3;
+    float r2 = r * r;
+    float s = r + r * r2 * polyEval(kSinCoef, r2);
+    float c = 1.0f + r2 * polyEval(kCosCoef, r2);
+
+    /*
+        根据象限交换和取反
+        象限是随机的，条件分支很难预测，所以直接在整数位上选择和翻转符号位
+        q总是整数值，|q| >= 2^25时float的间距至少为4，q一定是4的倍数，象限为0，
+        先换成0再转换为int，避免超出int范围；& 3对负数也得到0到3的余数，与constexprQuadrant相同
+     */
+    float qMod = fabsf(q) < 33554432.0f ? q : 0.0f;
+    unsigned int quadrant = (unsigned int)(int)qMod & 3u;
+    unsigned int sinBits, cosBits;
+    memcpy(&sinBits, &s, sizeof(float));
+    memcpy(&cosBits, &c, sizeof(float));
+    unsigned int swap = 0u - (quadrant & 1u);
+    unsigned int sinResult = ((cosBits & swap) | (sinBits & ~swap)) ^ ((quadrant & 2u) << 30);
+    unsigned int cosResult = ((sinBits & swap) | (cosBits & ~swap)) ^ (((quadrant + 1u) & 2u) << 30);
+    memcpy(returnSin, &sinResult, sizeof(float));
+    memcpy(returnCos, &cosResult, sizeof(float));
+#endif
 }
+
+/*
+    编译期求值的sin和cos，用于在编译时构造旋转，参看Matrix4x3::setupRotate和Quaternion::setToRotateAboutX
+    用double计算：约简到[-pi/4, pi/4]后求泰勒级数，误差远小于float的ULP，结果与正确舍入的值最多差1ULP
+    与MATH_ACCURACY无关，运行时也能调用，但比sinCos慢得多，只应用于常量
+ */
+constexpr double kConstexprPiOver2Hi = 1.5707963267948966;
+constexpr double kConstexprPiOver2Lo = 6.123233995736766e-17;
+
+// |r| <= pi/4时，取到r^19项后剩余的项已经小于double的精度
+constexpr double constexprSinSeries(double r) {
+    double r2 = r * r;
+    double term = r;
+    double sum = r;
+    for (int i = 1; i <= 9; ++i) {
+        term *= -r2 / (double)((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double constexprCosSeries(double r) {
+    double r2 = r * r;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int i = 1; i <= 9; ++i) {
+        term *= -r2 / (double)((2 * i - 1) * (2 * i));
+        sum += term;
+    }
+    return sum;
+}
+
+// theta = q * pi/2 + r，返回q除以4的余数（0到3），r写入reduced
+constexpr int constexprQuadrant(float theta, double& reduced) {
+    double x = theta;
+    double qf = x / kConstexprPiOver2Hi;
+    long long q = (long long)(qf >= 0.0 ? qf + 0.5 : qf - 0.5);
+    reduced = (x - (double)q * kConstexprPiOver2Hi) - (double)q * kConstexprPiOver2Lo;
+    return (int)(((q % 4) + 4) % 4);
+}
+
+constexpr float constexprSin(float theta) {
+    double r = 0.0;
+    switch (constexprQuadrant(theta, r)) {
+        case 0: return (float)constexprSinSeries(r);
+        case 1: return (float)constexprCosSeries(r);
+        case 2: return (float)-constexprSinSeries(r);
+        default: return (float)-constexprCosSeries(r);
+    }
+}
+
+constexpr float constexprCos(float theta) {
+    double r = 0.0;
+    switch (constexprQuadrant(theta, r)) {
+        case 0: return (float)constexprCosSeries(r);
+        case 1: return (float)-constexprSinSeries(r);
+        case 2: return (float)-constexprCosSeries(r);
+        default: return (float)constexprSinSeries(r);
+    }
+}
+
+/*
+    批量版本，逐元素计算，使用SIMD并按数据量自动并行
+    输出数组可以与输入数组相同
+ */
+extern void sinCosN(const float* theta, float* returnSin, float* returnCos, size_t n);
+extern void wrapPiN(const float* theta, float* out, size_t n);
+extern void safeAcosN(const float* x, float* out, size_t n);
+extern void atan2N(const float* y, const float* x, float* out, size_t n);
+extern void sqrtN(const float* x, float* out, size_t n);
+extern void rsqrtN(const float* x, float* out, size_t n);
+
 #endif /* MathUtil_h */
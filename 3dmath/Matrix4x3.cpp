@@ -12,30 +12,15 @@
 #include "Quaternion.hpp"
 #include "RotationMatrix.hpp"
 #include "MathUtil.h"
+#include "Vector3Stream.hpp"
+#include "SimdMath.h"
+#include "ThreadPool.hpp"
+#include "SimdDispatch.hpp"
+#include "Instrument.hpp"
 
 #include <assert.h>
 #include <math.h>
 
-void Matrix4x3::identity() {
-    m11 = 1.0f; m12 = 0.0f; m13 = 0.0f;
-    m21 = 0.0f; m22 = 1.0f; m23 = 0.0f;
-    m31 = 0.0f; m32 = 0.0f; m33 = 1.0f;
-    tx = 0.0f; ty = 0.0f; tz = 0.0f;
-}
-
-// 将包含平移的部分置为0
-void Matrix4x3::zeroTranslation() {
-    tx = ty = tz = 0.0f;
-}
-
-// 平移部分赋值
-void Matrix4x3::setupTranslation(const Vector3 &d) {
-    m11 = 1.0f; m12 = 0.0f; m13 = 0.0f;
-    m21 = 0.0f; m22 = 1.0f; m23 = 0.0f;
-    m31 = 0.0f; m32 = 0.0f; m33 = 1.0f;
-    tx = d.x; ty = d.y; tz = d.z;
-}
-
 /*
     构造进行局部->父空间变换的矩阵，局部空间的位置和方位在父空间中描述
     该方法最常见的用途是构造物体->世界的变换矩阵，这个变换是非常直接的
@@ -51,6 +36,7 @@ void Matrix4x3::setupLocalToParent(const Vector3 &pos, const EulerAngles &oriant
 }
 
 void Matrix4x3::setupLocalToParent(const Vector3 &pos, const RotationMatrix &oriant) {
+    MATH_INSTRUMENT_SCOPE(Matrix4x3SetupLocalToParent);
     /*
         复制矩阵的旋转部分
         根据RotationMatrix中的注释，旋转矩阵“一般“是惯性->物体矩阵，是父->局部关系
@@ -58,10 +44,13 @@ void Matrix4x3::setupLocalToParent(const Vector3 &pos, const RotationMatrix &ori
      */
     m11 = oriant.m11; m12 = oriant.m21; m13 = oriant.m31;
     m21 = oriant.m12; m22 = oriant.m22; m23 = oriant.m32;
-    m31 = oriant.m13; m12 = oriant.m23; m13 = oriant.m33;
+    m31 = oriant.m13; m32 = oriant.m23; m33 = oriant.m33;
     
     // 现在设置平移部分，平移在3x3部分之后，只需要简单复制即可
     tx = pos.x; ty = pos.y; tz = pos.z;
+    
+    // 旋转矩阵是正交的，所以这是刚体变换
+    transformClass = kTransformRigid;
 }
 
 /*
@@ -80,6 +69,7 @@ void Matrix4x3::setupParentToLocal(const Vector3 &pos, const EulerAngles &oriant
 }
 
 void Matrix4x3::setupParentToLocal(const Vector3 &pos, const RotationMatrix &oriant) {
+    MATH_INSTRUMENT_SCOPE(Matrix4x3SetupParentToLocal);
     // 复制矩阵的旋转部分。可以直接复制元素（不用转置），根据RotationMatrix中注释的排列方式即可
     m11 = oriant.m11; m12 = oriant.m12; m13 = oriant.m13;
     m21 = oriant.m21; m22 = oriant.m22; m23 = oriant.m23;
@@ -94,6 +84,8 @@ void Matrix4x3::setupParentToLocal(const Vector3 &pos, const RotationMatrix &ori
     tx = -(pos.x * m11 + pos.y * m21 + pos.z *m31);
     ty = -(pos.x * m12 + pos.y * m22 + pos.z * m32);
     tz = -(pos.x * m13 + pos.y * m23 + pos.z * m33);
+    
+    transformClass = kTransformRigid;
 }
 
 /*
@@ -103,33 +95,12 @@ void Matrix4x3::setupParentToLocal(const Vector3 &pos, const RotationMatrix &ori
     参看8.2.2
  */
 void Matrix4x3::setupRotate(int axis, float theta) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3SetupRotateAxis);
     // 取得旋转角的sin和cos值
     float s, c;
     sinCos(&s, &c, theta);
     
-    switch (axis) {
-        case 1: // 绕x轴旋转
-            m11 = 1.0f; m12 = 0.0f; m13 = 0.0f;
-            m21 = 0.0f; m22 = c; m23 = s;
-            m31 = 0.0f; m32 = -s; m33 = c;
-            break;
-        case 2: // 绕y轴旋转
-            m11 = c; m12 = 0.0f; m13 = -s;
-            m21 = 0.0f; m22 = 1.0f; m23 = 0.0f;
-            m31 = s; m32 = 0.0f; m33 = c;
-            break;
-        case 3: // 绕z轴旋转
-        m11 = c; m12 = s; m13 = 0.0f;
-        m21 = -s; m22 = c; m23 = 0.0f;
-        m31 = 0.0f; m32 = 0.0f; m33 = 1.0f;
-        break;
-        default:
-            // 非法索引
-            assert(false);
-            break;
-    }
-    
-    tx = ty = tz = 0.0f;
+    setupRotate(axis, s, c);
 }
 
 /*
@@ -140,6 +111,7 @@ void Matrix4x3::setupRotate(int axis, float theta) {
     参看8.3.3
 */
 void Matrix4x3::setupRotate(const Vector3 &axis, float theta) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3SetupRotate);
     // 单位向量检查
     assert(fabs(axis * axis - 1.0f) < .01f);
     
@@ -168,6 +140,7 @@ void Matrix4x3::setupRotate(const Vector3 &axis, float theta) {
     
     // 平移部分置零
     tx = ty = tz = 0.0f;
+    transformClass = kTransformRigid;
 }
 
 /*
@@ -177,6 +150,7 @@ void Matrix4x3::setupRotate(const Vector3 &axis, float theta) {
 
  */
 void Matrix4x3::fromQuaternion(const Quaternion &q) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3FromQuaternion);
     float ww = 2.0f * q.w;
     float xx = 2.0f * q.x;
     float yy = 2.0f * q.y;
@@ -185,7 +159,7 @@ void Matrix4x3::fromQuaternion(const Quaternion &q) {
     // 矩阵元素分赋值
     m11 = 1.0f - yy * q.y - zz * q.z;
     m12 = xx * q.y + ww * q.z;
-    m13 = xx * q.z - ww * q.z;
+    m13 = xx * q.z - ww * q.y;
     
     m21 = xx * q.y - ww * q.z;
     m22 = 1.0f - xx * q.x - zz * q.z;
@@ -197,22 +171,9 @@ void Matrix4x3::fromQuaternion(const Quaternion &q) {
     
     // 平移部分置零
     tx = ty = tz = 0.0f;
-}
-
-/*
-    构造沿各坐标轴缩放的矩阵
-    对于缩放因子k，使用向量Vector3(k,k,k)表示
-    平移部分置零
-    参看8.3.1
- */
-void Matrix4x3::setupScale(const Vector3 &s) {
-    // 矩阵元素赋值
-    m11 = s.x; m12 = 0.0f; m13 = 0.0f;
-    m21 = 0.0f; m22 = s.y; m23 = 0.0f;
-    m31 = 0.0f; m32 = 0.0f; m33 = s.z;
     
-    // 平移部分置零
-    tx = ty = tz = 0.0f;
+    // 假设四元数是单位四元数
+    transformClass = kTransformRigid;
 }
 
 /*
@@ -222,6 +183,7 @@ void Matrix4x3::setupScale(const Vector3 &s) {
     参看8.3.2
  */
 void Matrix4x3::setupScaleAlongAxis(const Vector3 &axis, float k) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3SetupScaleAlongAxis);
     // 检查旋转轴是否为单位向量
     assert(fabs(axis * axis - 1.0f) < .01f);
     
@@ -242,6 +204,7 @@ void Matrix4x3::setupScaleAlongAxis(const Vector3 &axis, float k) {
     
     // 平移部分置零
     tx = ty = tz = 0.0f;
+    transformClass = kTransformGeneral;
 }
 
 /*
@@ -249,9 +212,10 @@ void Matrix4x3::setupScaleAlongAxis(const Vector3 &axis, float k) {
     切变类型由一个索引制定，变换效果如以下伪代码所示
     axis == 1 => y += s*x, z += t*x
     axis == 2 => x += s*y, z += t*y
-    axis == 3 => x += s*y, y += t*z
+    axis == 3 => x += s*z, y += t*z
  */
 void Matrix4x3::setupShear(int axis, float s, float t) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3SetupShear);
     // 判断切变类型
     switch (axis) {
         case 1:
@@ -265,11 +229,13 @@ void Matrix4x3::setupShear(int axis, float s, float t) {
             m11 = 1.0f; m12 = 0.0f; m13 = 0.0f;
             m21 = s; m22 = 1.0f; m23 = t;
             m31 = 0.0f; m32 = 0.0f; m33 = 1.0f;
+            break;
         case 3:
             // 用z切变x和y
             m11 = 1.0f; m12 = 0.0f; m13 = 0.0f;
             m21 = 0.0f; m22 = 1.0f; m23 = 0.0f;
             m31 = s; m32 = t; m33 = 1.0f;
+            break;
         default:
             // 非法索引
             assert(false);
@@ -278,6 +244,7 @@ void Matrix4x3::setupShear(int axis, float s, float t) {
     
     // 平移部分置零
     tx = ty = tz = 0.0f;
+    transformClass = kTransformGeneral;
 }
 
 /*
@@ -287,6 +254,7 @@ void Matrix4x3::setupShear(int axis, float s, float t) {
  
  */
 void Matrix4x3::setupProject(const Vector3 &n) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3SetupProject);
     // 检查旋转轴是否为单位向量
     assert(fabs(n * n - 1.0f) < .01f);
     
@@ -300,6 +268,7 @@ void Matrix4x3::setupProject(const Vector3 &n) {
     
     // 平移部分置零
     tx = ty = tz = 0.0f;
+    transformClass = kTransformGeneral;
 }
 
 /*
@@ -312,6 +281,7 @@ void Matrix4x3::setupProject(const Vector3 &n) {
     参看8.5
  */
 void Matrix4x3::setupReflect(int axis, float k /*= 0.0f*/) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3SetupReflectAxis);
     // 判断反射平面
     switch(axis) {
         case 1:
@@ -349,6 +319,9 @@ void Matrix4x3::setupReflect(int axis, float k /*= 0.0f*/) {
             assert(false);
             break;
     }
+    
+    // 反射的行列式为-1，不属于刚体变换
+    transformClass = kTransformGeneral;
 }
 
 /*
@@ -358,6 +331,7 @@ void Matrix4x3::setupReflect(int axis, float k /*= 0.0f*/) {
     参看8.5
  */
 void Matrix4x3::setupReflect(const Vector3 &n) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3SetupReflect);
     // 检查旋转轴是否为单位向量
     assert(fabs(n * n - 1.0f) < .01f);
     
@@ -374,64 +348,102 @@ void Matrix4x3::setupReflect(const Vector3 &n) {
     m12 = m21 = ax * n.y;
     m13 = m31 = ax * n.z;
     m23 = m32 = ay * n.z;
+    
+    // 平移部分置零
+    tx = ty = tz = 0.0f;
+    transformClass = kTransformGeneral;
 }
 
 /*
-    变换该点，
-    使得使用向量类就像在纸上作线性代数一样直观
-    参看7.1.7
+    批量变换点或方向向量
+    核函数按运行时检测到的指令集选择（参看SimdDispatch.hpp），这里只负责通过parallelFor分块交给线程池
+    translate为false时忽略平移部分，用于变换方向向量
  */
-Vector3 operator* (const Vector3& p, const Matrix4x3& m) {
-    return Vector3(
-        p.x * m.m11 + p.y * m.m21 + p.z * m.m31 + m.tx,
-        p.x * m.m12 + p.y * m.m22 + p.z * m.m32 + m.ty,
-        p.x * m.m13 + p.y * m.m23 + p.z * m.m33 + m.tz);
+static void transformArray(const Matrix4x3& m, const Vector3* in, Vector3* out, size_t n, bool translate) {
+    const SimdKernels& kernels = simdKernels();
+    const float* src = reinterpret_cast<const float*>(in);
+    float* dst = reinterpret_cast<float*>(out);
+    parallelFor(n, cacheChunk(6 * sizeof(float)), [&](size_t begin, size_t end) {
+        kernels.transformVector3(&m.m11, src + 3 * begin, dst + 3 * begin, end - begin, translate);
+    });
 }
 
-Vector3& operator*= (Vector3& p, const Matrix4x3& m) {
-    p = p * m;
-    return p;
+// SoA形式，块的边界是16的整数倍，保持分量数组的对齐
+static void transformStream(const Matrix4x3& m, const Vector3Stream& in, Vector3Stream& out, bool translate) {
+    out.resize(in.size());
+    
+    const SimdKernels& kernels = simdKernels();
+    size_t n = in.size();
+    parallelFor(n, cacheChunk(6 * sizeof(float)), [&](size_t begin, size_t end) {
+        kernels.transformStream(&m.m11, in.x() + begin, in.y() + begin, in.z() + begin,
+                                out.x() + begin, out.y() + begin, out.z() + begin, end - begin, translate);
+    });
+    
+    // 最后一组越过size()的通道被写入了平移量，重新清零，保证补齐部分仍然为0
+    for (size_t i = n; i < out.capacity(); ++i) {
+        out.x()[i] = out.y()[i] = out.z()[i] = 0.0f;
+    }
 }
 
-/*
-    矩阵连接，使得使用矩阵类就像在纸上做线性代数一样直观
-    提供*=运算符，以符合c语言的语法习惯
-    参看7.1.6
- */
-Matrix4x3 operator*(const Matrix4x3& a, const Matrix4x3& b) {
-    Matrix4x3 r;
-    
-    // 计算左上的线形变换部分
-    r.m11 = a.m11 * b.m11 + a.m12 * b.m21 + a.m13 * b.m31;
-    r.m12 = a.m11 * b.m12 + a.m12 * b.m22 + a.m13 * b.m32;
-    r.m13 = a.m11 * b.m13 + a.m12 * b.m23 + a.m13 * b.m33;
-    
-    r.m21 = a.m21 * b.m11 + a.m22 * b.m21 + a.m23 * b.m31;
-    r.m22 = a.m21 * b.m22 + a.m22 * b.m22 + a.m23 * b.m32;
-    r.m23 = a.m21 * b.m23 + a.m22 * b.m23 + a.m23 * b.m33;
-    
-    r.m31 = a.m31 * b.m11 + a.m32 * b.m21 + a.m33 * b.m31;
-    r.m32 = a.m31 * b.m12 + a.m32 * b.m22 + a.m33 * b.m32;
-    r.m33 = a.m31 * b.m13 + a.m32 * b.m23 + a.m33 * b.m33;
-    
-    r.tx = a.tx * b.m11 + a.ty * b.m21 + a.tz * b.m31 + b.tx;
-    r.ty = a.tx * b.m12 + a.ty * b.m22 + a.tz * b.m32 + b.ty;
-    r.tx = a.tx * b.m13 + a.ty * b.m23 + a.tz * b.m33 + b.tz;
-    
-    // 这种方法需要调用拷贝构造函数，如果速度非常重要，可能要用单独的函数在期望的地方给出返回值
-    return r;
+void transformPoints(const Matrix4x3& m, const Vector3* in, Vector3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(TransformPoints, n);
+    transformArray(m, in, out, n, true);
+}
+
+void transformPoints(const Matrix4x3& m, Vector3* p, size_t n) {
+    MATH_INSTRUMENT_BATCH(TransformPoints, n);
+    transformArray(m, p, p, n, true);
+}
+
+void transformPoints(const Matrix4x3& m, const Vector3Stream& in, Vector3Stream& out) {
+    MATH_INSTRUMENT_BATCH(TransformPointsStream, in.size());
+    transformStream(m, in, out, true);
+}
+
+void transformDirections(const Matrix4x3& m, const Vector3* in, Vector3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(TransformDirections, n);
+    transformArray(m, in, out, n, false);
+}
+
+void transformDirections(const Matrix4x3& m, Vector3* v, size_t n) {
+    MATH_INSTRUMENT_BATCH(TransformDirections, n);
+    transformArray(m, v, v, n, false);
+}
+
+void transformDirections(const Matrix4x3& m, const Vector3Stream& in, Vector3Stream& out) {
+    MATH_INSTRUMENT_BATCH(TransformDirectionsStream, in.size());
+    transformStream(m, in, out, false);
 }
 
-Matrix4x3& operator*=(Matrix4x3& a, const Matrix4x3& b) {
-    a = a * b;
-    return a;
+/*
+    批量从四元数构造矩阵，参看10.6.3
+    矩阵的前12个float（3x3部分和平移）由分派的核函数计算，变换分类逐个设置
+ */
+void fromQuaternionN(const Quaternion* q, Matrix4x3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(FromQuaternionN, n);
+    const SimdKernels& kernels = simdKernels();
+    const float* in = reinterpret_cast<const float*>(q);
+    float* result = reinterpret_cast<float*>(out);
+    const size_t stride = sizeof(Matrix4x3) / sizeof(float);
+    parallelFor(n, cacheChunk((stride + 4) * sizeof(float)), [&](size_t begin, size_t end) {
+        kernels.fromQuaternion(in + 4 * begin, result + stride * begin, stride, end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            out[i].transformClass = kTransformRigid;
+        }
+    });
 }
 
 /*
     计算矩阵左上3x3部分的行列式
+    单位、平移和刚体变换的行列式总是1
     参看9.1.1
  */
 float determinant(const Matrix4x3& m) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3Determinant);
+    if (m.transformClass <= kTransformRigid) {
+        return 1.0f;
+    }
+    
     return
         m.m11 * (m.m22 * m.m33 - m.m23 * m.m32)
         + m.m12 * (m.m23 * m.m31 - m.m21 * m.m33)
@@ -439,55 +451,103 @@ float determinant(const Matrix4x3& m) {
 }
 
 /*
-    求矩阵的逆，使用经典的伴随矩阵除以行列式的方法
-    参看9.2.1
+    求矩阵的逆，根据变换分类选择代价最小的方法
+    单位矩阵：逆为自身
+    平移：逆为反向平移
+    刚体：3x3部分是正交矩阵，逆为其转置
+    均匀缩放：3x3部分为kR，逆为转置除以k^2，k^2可以由任意一行的长度平方得到
+    一般变换：使用经典的伴随矩阵除以行列式的方法，参看9.2.1
+    所有情况下，平移部分的逆都是-t乘以3x3部分的逆
  */
 Matrix4x3 inverse(const Matrix4x3& m) {
-    // 计算行列式
-    float det = determinant(m);
-    
-    // 如果是奇异的，即行列式为0，没有逆矩阵
-    assert(fabs(det) > .000001f);
-    
-    // 计算1/行列式
-    float oneOverDet = 1.0f / det;
-    
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3Inverse);
     Matrix4x3 r;
     
-    // 计算3x3部分的逆
-    r.m11 = (m.m22 * m.m33 - m.m23 * m.m32) * oneOverDet;
-    r.m12 = (m.m13 * m.m32 - m.m12 * m.m33) * oneOverDet;
-    r.m13 = (m.m12 * m.m23 - m.m13 * m.m22) * oneOverDet;
-    
-    r.m21 = (m.m23 * m.m31 - m.m21 * m.m33) * oneOverDet;
-    r.m22 = (m.m11 * m.m31 - m.m13 * m.m31) * oneOverDet;
-    r.m23 = (m.m13 * m.m21 - m.m11 * m.m23) * oneOverDet;
-    
-    r.m31 = (m.m21 * m.m32 - m.m22 * m.m31) * oneOverDet;
-    r.m32 = (m.m12 * m.m31 - m.m11 * m.m32) * oneOverDet;
-    r.m33 = (m.m11 * m.m22 - m.m12 * m.m21) * oneOverDet;
+    switch (m.transformClass) {
+        case kTransformIdentity:
+            r.identity();
+            return r;
+            
+        case kTransformTranslation:
+            r.setupTranslation(Vector3(-m.tx, -m.ty, -m.tz));
+            return r;
+            
+        case kTransformRigid:
+            // 正交矩阵的逆就是转置
+            r.m11 = m.m11; r.m12 = m.m21; r.m13 = m.m31;
+            r.m21 = m.m12; r.m22 = m.m22; r.m23 = m.m32;
+            r.m31 = m.m13; r.m32 = m.m23; r.m33 = m.m33;
+            break;
+            
+        case kTransformUniformScale: {
+            float scaleSq = m.m11 * m.m11 + m.m12 * m.m12 + m.m13 * m.m13;
+            assert(scaleSq > .000001f);
+            float oneOverScaleSq = 1.0f / scaleSq;
+            
+            r.m11 = m.m11 * oneOverScaleSq; r.m12 = m.m21 * oneOverScaleSq; r.m13 = m.m31 * oneOverScaleSq;
+            r.m21 = m.m12 * oneOverScaleSq; r.m22 = m.m22 * oneOverScaleSq; r.m23 = m.m32 * oneOverScaleSq;
+            r.m31 = m.m13 * oneOverScaleSq; r.m32 = m.m23 * oneOverScaleSq; r.m33 = m.m33 * oneOverScaleSq;
+            break;
+        }
+            
+        default: {
+            // 计算行列式
+            float det = determinant(m);
+            
+            // 如果是奇异的，即行列式为0，没有逆矩阵
+            assert(fabs(det) > .000001f);
+            
+            // 计算1/行列式
+            float oneOverDet = 1.0f / det;
+            
+            // 计算3x3部分的逆
+            r.m11 = (m.m22 * m.m33 - m.m23 * m.m32) * oneOverDet;
+            r.m12 = (m.m13 * m.m32 - m.m12 * m.m33) * oneOverDet;
+            r.m13 = (m.m12 * m.m23 - m.m13 * m.m22) * oneOverDet;
+            
+            r.m21 = (m.m23 * m.m31 - m.m21 * m.m33) * oneOverDet;
+            r.m22 = (m.m11 * m.m33 - m.m13 * m.m31) * oneOverDet;
+            r.m23 = (m.m13 * m.m21 - m.m11 * m.m23) * oneOverDet;
+            
+            r.m31 = (m.m21 * m.m32 - m.m22 * m.m31) * oneOverDet;
+            r.m32 = (m.m12 * m.m31 - m.m11 * m.m32) * oneOverDet;
+            r.m33 = (m.m11 * m.m22 - m.m12 * m.m21) * oneOverDet;
+            break;
+        }
+    }
     
     // 计算平移部分的逆
     r.tx = -(m.tx * r.m11 + m.ty * r.m21 + m.tz * r.m31);
     r.ty = -(m.tx * r.m12 + m.ty * r.m22 + m.tz * r.m32);
     r.tz = -(m.tx * r.m13 + m.ty * r.m23 + m.tz * r.m33);
     
+    // 逆变换与原变换属于同一类
+    r.transformClass = m.transformClass;
+    
     // 这种方法需要调用拷贝构造函数，如果速度非常重要，可能要用单独的函数在期望的地方给出返回值
     return r;
 }
 
-// 以向量的形式返回平移部分
-Vector3 getTranslation(const Matrix4x3& m) {
-    return Vector3(m.tx, m.ty, m.tz);
-}
-
 /*
     从父->局部（如世界->物体）变换矩阵中提取物体的位置
-    假设矩阵代表刚体变换
+    物体的位置就是逆矩阵的平移部分
  */
 Vector3 getPositionFromParentToLocal(const Matrix4x3& m) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3PositionFromParentToLocal);
+    switch (m.transformClass) {
+        case kTransformIdentity:
+            return Vector3(0.0f, 0.0f, 0.0f);
+        case kTransformTranslation:
+            return Vector3(-m.tx, -m.ty, -m.tz);
+        case kTransformRigid:
+            break;
+        default:
+            // 非刚体变换不能用转置代替逆
+            return getTranslation(inverse(m));
+    }
+    
     // 负的平移值乘以3*3部分的转置
-    // 假设矩阵是正交的（该方法不能应用于非刚体变换）
+    // 矩阵是正交的（该方法不能应用于非刚体变换）
     return Vector3(-(m.tx * m.m11 + m.ty * m.m12 + m.tz * m.m13),
                    -(m.tx * m.m21 + m.ty * m.m22 + m.tz * m.m23),
                    -(m.tx * m.m31 + m.ty * m.m32 + m.tz * m.m33));
@@ -497,6 +557,7 @@ Vector3 getPositionFromParentToLocal(const Matrix4x3& m) {
     从局部->父（如物体->世界）变换矩阵中提取物体的位置
  */
 Vector3 getPositionFromLocalToParent(const Matrix4x3& m) {
+    MATH_INSTRUMENT_SAMPLED(Matrix4x3PositionFromLocalToParent);
     // 所需的e位置就是平移部分
     return Vector3(m.tx, m.ty, m.tz);
 }
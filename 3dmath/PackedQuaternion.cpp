@@ -0,0 +1,379 @@
+//
+//  PackedQuaternion.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "PackedQuaternion.hpp"
+
+#include <math.h>
+
+#include "SimdUtil.h"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
+
+// 除最大分量外，其余分量的绝对值不超过1/sqrt(2)
+static const float kPackedRange = 0.707106781f;
+
+/*
+    各格式的位布局，f[0]、f[1]、f[2]是量化后的三个分量，f[3]是最大分量的下标
+    三个分量按下标从小到大排列，跳过最大的一个
+ */
+template <typename Packed>
+struct PackedFormat;
+
+template <>
+struct PackedFormat<PackedQuaternion32> {
+    static const int kBits = 10;
+
+    static void extract(const PackedQuaternion32& p, unsigned int* f) {
+        f[0] = (p.bits >> 20) & 0x3ff;
+        f[1] = (p.bits >> 10) & 0x3ff;
+        f[2] = p.bits & 0x3ff;
+        f[3] = p.bits >> 30;
+    }
+
+    static void insert(PackedQuaternion32& p, const unsigned int* f) {
+        p.bits = (f[3] << 30) | (f[0] << 20) | (f[1] << 10) | f[2];
+    }
+
+#if defined(SIMD_SSE) || defined(SIMD_AVX)
+    static void extract4(const PackedQuaternion32* p, __m128i* f) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i mask = _mm_set1_epi32(0x3ff);
+        f[0] = _mm_and_si128(_mm_srli_epi32(v, 20), mask);
+        f[1] = _mm_and_si128(_mm_srli_epi32(v, 10), mask);
+        f[2] = _mm_and_si128(v, mask);
+        f[3] = _mm_srli_epi32(v, 30);
+    }
+#endif
+};
+
+template <>
+struct PackedFormat<PackedQuaternion48> {
+    static const int kBits = 15;
+
+    static void extract(const PackedQuaternion48& p, unsigned int* f) {
+        f[0] = p.bits[0] & 0x7fff;
+        f[1] = p.bits[1] & 0x7fff;
+        f[2] = p.bits[2] & 0x7fff;
+        f[3] = ((p.bits[0] >> 15) << 1) | (p.bits[1] >> 15);
+    }
+
+    static void insert(PackedQuaternion48& p, const unsigned int* f) {
+        p.bits[0] = (unsigned short)(((f[3] >> 1) << 15) | f[0]);
+        p.bits[1] = (unsigned short)(((f[3] & 1) << 15) | f[1]);
+        p.bits[2] = (unsigned short)f[2];
+    }
+
+#if defined(SIMD_SSE) || defined(SIMD_AVX)
+    // 4个记录共12个16位字，扩展为32位后与4个Vector3的排列相同，用同样的方法转置
+    static void extract4(const PackedQuaternion48* p, __m128i* f) {
+        const unsigned short* words = p->bits;
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words));
+        __m128i hi = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(words + 8));
+        __m128i zero = _mm_setzero_si128();
+        __m128 w0, w1, w2;
+        simdTransposeVector3x4(_mm_castsi128_ps(_mm_unpacklo_epi16(lo, zero)),
+                               _mm_castsi128_ps(_mm_unpackhi_epi16(lo, zero)),
+                               _mm_castsi128_ps(_mm_unpacklo_epi16(hi, zero)), w0, w1, w2);
+        __m128i mask = _mm_set1_epi32(0x7fff);
+        __m128i v0 = _mm_castps_si128(w0), v1 = _mm_castps_si128(w1);
+        f[0] = _mm_and_si128(v0, mask);
+        f[1] = _mm_and_si128(v1, mask);
+        f[2] = _mm_and_si128(_mm_castps_si128(w2), mask);
+        f[3] = _mm_or_si128(_mm_slli_epi32(_mm_srli_epi32(v0, 15), 1), _mm_srli_epi32(v1, 15));
+    }
+#endif
+};
+
+template <>
+struct PackedFormat<PackedQuaternion64> {
+    static const int kBits = 20;
+
+    static void extract(const PackedQuaternion64& p, unsigned int* f) {
+        f[0] = (p.hi >> 8) & 0xfffff;
+        f[1] = (p.lo >> 20) | ((p.hi & 0xff) << 12);
+        f[2] = p.lo & 0xfffff;
+        f[3] = p.hi >> 30;
+    }
+
+    static void insert(PackedQuaternion64& p, const unsigned int* f) {
+        p.lo = (f[1] << 20) | f[2];
+        p.hi = (f[3] << 30) | (f[0] << 8) | (f[1] >> 12);
+    }
+
+#if defined(SIMD_SSE) || defined(SIMD_AVX)
+    static void extract4(const PackedQuaternion64* p, __m128i* f) {
+        const float* words = reinterpret_cast<const float*>(p);
+        __m128 r0 = _mm_loadu_ps(words), r1 = _mm_loadu_ps(words + 4);
+        __m128i lo = _mm_castps_si128(_mm_shuffle_ps(r0, r1, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i hi = _mm_castps_si128(_mm_shuffle_ps(r0, r1, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m128i mask = _mm_set1_epi32(0xfffff);
+        f[0] = _mm_and_si128(_mm_srli_epi32(hi, 8), mask);
+        f[1] = _mm_or_si128(_mm_srli_epi32(lo, 20), _mm_slli_epi32(_mm_and_si128(hi, _mm_set1_epi32(0xff)), 12));
+        f[2] = _mm_and_si128(lo, mask);
+        f[3] = _mm_srli_epi32(hi, 30);
+    }
+#endif
+};
+
+// 量化的最大值和步长，最大值取偶数使0正好落在格点上，单位四元数可以精确还原
+template <typename Packed>
+static inline float packedMax() {
+    return (float)((1 << PackedFormat<Packed>::kBits) - 2);
+}
+
+template <typename Packed>
+static inline float packedStep() {
+    return 2.0f * kPackedRange / packedMax<Packed>();
+}
+
+/*
+    编码：正则化后找出绝对值最大的分量（相等时取下标小的），使它为正，其余三个分量量化
+    零四元数按单位四元数编码
+ */
+template <typename Packed>
+static inline void packQuaternion(const Quaternion& q, Packed& p) {
+    float v[4] = { q.w, q.x, q.y, q.z };
+    float magSq = q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z;
+    float oneOverMag = 1.0f;
+    if (magSq > 0.0f) {
+        oneOverMag = 1.0f / sqrtf(magSq);
+    } else {
+        v[0] = 1.0f;
+    }
+
+    int largest = 0;
+    for (int i = 1; i < 4; ++i) {
+        if (fabsf(v[i]) > fabsf(v[largest])) {
+            largest = i;
+        }
+    }
+    float scale = v[largest] < 0.0f ? -oneOverMag : oneOverMag;
+
+    float maxValue = packedMax<Packed>();
+    float quantize = maxValue / (2.0f * kPackedRange);
+    unsigned int f[4];
+    int k = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (i != largest) {
+            float u = floorf((v[i] * scale + kPackedRange) * quantize + 0.5f);
+            u = u < 0.0f ? 0.0f : (u > maxValue ? maxValue : u);
+            f[k++] = (unsigned int)u;
+        }
+    }
+    f[3] = largest;
+    PackedFormat<Packed>::insert(p, f);
+}
+
+/*
+    解码：量化值减去中点再乘以步长，最大分量 = sqrt(1 - a^2 - b^2 - c^2)，量化误差可能使根号下为负，此时取0
+    放回原来的位置后再正则化一次
+ */
+template <typename Packed>
+static inline Quaternion unpackQuaternion(const Packed& p) {
+    unsigned int f[4];
+    PackedFormat<Packed>::extract(p, f);
+    float step = packedStep<Packed>();
+    float center = 0.5f * packedMax<Packed>();
+    float a = ((float)f[0] - center) * step;
+    float b = ((float)f[1] - center) * step;
+    float c = ((float)f[2] - center) * step;
+    float dSq = 1.0f - a * a - b * b - c * c;
+    float d = dSq > 0.0f ? sqrtf(dSq) : 0.0f;
+
+    Quaternion q;
+    switch (f[3]) {
+        case 0: q.w = d; q.x = a; q.y = b; q.z = c; break;
+        case 1: q.w = a; q.x = d; q.y = b; q.z = c; break;
+        case 2: q.w = a; q.x = b; q.y = d; q.z = c; break;
+        default: q.w = a; q.x = b; q.y = c; q.z = d; break;
+    }
+    float oneOverMag = 1.0f / sqrtf(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+    q.w *= oneOverMag;
+    q.x *= oneOverMag;
+    q.y *= oneOverMag;
+    q.z *= oneOverMag;
+    return q;
+}
+
+void PackedQuaternion32::pack(const Quaternion& q) { packQuaternion(q, *this); }
+void PackedQuaternion48::pack(const Quaternion& q) { packQuaternion(q, *this); }
+void PackedQuaternion64::pack(const Quaternion& q) { packQuaternion(q, *this); }
+
+Quaternion PackedQuaternion32::unpack() const { return unpackQuaternion(*this); }
+Quaternion PackedQuaternion48::unpack() const { return unpackQuaternion(*this); }
+Quaternion PackedQuaternion64::unpack() const { return unpackQuaternion(*this); }
+
+/*
+    读入一组压缩四元数的4个字段，转换为浮点数
+    x86上每4个记录用整数SIMD指令拆分位域，其余情况和数组末尾逐个拆分
+ */
+template <typename Packed>
+static inline void loadPackedGroup(const Packed* p, size_t count, SimdFloat* fields) {
+#if defined(SIMD_AVX)
+    if (count == (size_t)kSimdWidth) {
+        __m128i lo[4], hi[4];
+        PackedFormat<Packed>::extract4(p, lo);
+        PackedFormat<Packed>::extract4(p + 4, hi);
+        for (int k = 0; k < 4; ++k) {
+            fields[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_cvtepi32_ps(lo[k])), _mm_cvtepi32_ps(hi[k]), 1);
+        }
+        return;
+    }
+#elif defined(SIMD_SSE)
+    if (count == (size_t)kSimdWidth) {
+        __m128i f[4];
+        PackedFormat<Packed>::extract4(p, f);
+        for (int k = 0; k < 4; ++k) {
+            fields[k] = _mm_cvtepi32_ps(f[k]);
+        }
+        return;
+    }
+#endif
+    float tmp[4][kSimdWidth];
+    for (int i = 0; i < kSimdWidth; ++i) {
+        unsigned int f[4] = { 0, 0, 0, 0 };
+        if ((size_t)i < count) {
+            PackedFormat<Packed>::extract(p[i], f);
+        }
+        for (int k = 0; k < 4; ++k) {
+            tmp[k][i] = (float)f[k];
+        }
+    }
+    for (int k = 0; k < 4; ++k) {
+        fields[k] = simdLoadU(tmp[k]);
+    }
+}
+
+/*
+    与unpackQuaternion相同的计算，最大分量按下标用掩码放回原位：
+    下标    w  x  y  z
+    0       d  a  b  c
+    1       a  d  b  c
+    2       a  b  d  c
+    3       a  b  c  d
+ */
+template <typename Packed>
+static void unpackQuaternions(const Packed* in, Quaternion* out, size_t n) {
+    float* result = reinterpret_cast<float*>(out);
+    parallelForGroups(n, kSimdWidth, cacheChunk(sizeof(Packed) + sizeof(Quaternion)), [&](size_t i, size_t count) {
+        SimdFloat f[4];
+        loadPackedGroup(in + i, count, f);
+        SimdFloat step = simdSet(packedStep<Packed>());
+        SimdFloat center = simdSet(0.5f * packedMax<Packed>());
+        SimdFloat a = simdMul(simdSub(f[0], center), step);
+        SimdFloat b = simdMul(simdSub(f[1], center), step);
+        SimdFloat c = simdMul(simdSub(f[2], center), step);
+        SimdFloat dSq = simdNmadd(c, c, simdNmadd(b, b, simdNmadd(a, a, simdSet(1.0f))));
+        SimdFloat d = simdSqrt(simdMax(dSq, simdZero()));
+
+        SimdMask ge1 = simdCmpGt(f[3], simdSet(0.5f));
+        SimdMask ge2 = simdCmpGt(f[3], simdSet(1.5f));
+        SimdMask ge3 = simdCmpGt(f[3], simdSet(2.5f));
+        SimdFloat q[4];
+        q[0] = simdSelect(ge1, a, d);
+        q[1] = simdSelect(ge1, simdSelect(ge2, b, d), a);
+        q[2] = simdSelect(ge2, simdSelect(ge3, c, d), b);
+        q[3] = simdSelect(ge3, d, c);
+
+        SimdFloat magSq = simdMadd(q[3], q[3], simdMadd(q[2], q[2], simdMadd(q[1], q[1], simdMul(q[0], q[0]))));
+        SimdFloat oneOverMag = simdRsqrt(magSq);
+        for (int k = 0; k < 4; ++k) {
+            q[k] = simdMul(q[k], oneOverMag);
+        }
+        simdStoreFields(result + 4 * i, 4, 4, count, q);
+    });
+}
+
+/*
+    与packQuaternion相同的计算，找最大分量、取符号和量化都在SIMD寄存器中完成
+    三个分量按下标跳过最大的一个：a = 下标>=1 ? w : x，b = 下标>=2 ? x : y，c = 下标>=3 ? y : z
+    最后逐个记录写入位域
+ */
+template <typename Packed>
+static void packQuaternions(const Quaternion* in, Packed* out, size_t n) {
+    const float* source = reinterpret_cast<const float*>(in);
+    parallelForGroups(n, kSimdWidth, cacheChunk(sizeof(Packed) + sizeof(Quaternion)), [&](size_t i, size_t count) {
+        SimdFloat q[4];
+        simdLoadFields(source + 4 * i, 4, 4, count, q);
+        SimdFloat zero = simdZero();
+        SimdFloat one = simdSet(1.0f);
+
+        SimdFloat magSq = simdMadd(q[3], q[3], simdMadd(q[2], q[2], simdMadd(q[1], q[1], simdMul(q[0], q[0]))));
+        SimdMask nonZero = simdCmpGt(magSq, zero);
+        SimdFloat oneOverMag = simdSelect(nonZero, simdDiv(one, simdSqrt(simdSelect(nonZero, magSq, one))), one);
+        q[0] = simdSelect(nonZero, q[0], one);
+
+        SimdFloat largest = zero;
+        SimdFloat best = simdAbs(q[0]);
+        SimdFloat value = q[0];
+        for (int k = 1; k < 4; ++k) {
+            SimdMask bigger = simdCmpGt(simdAbs(q[k]), best);
+            largest = simdSelect(bigger, simdSet((float)k), largest);
+            best = simdSelect(bigger, simdAbs(q[k]), best);
+            value = simdSelect(bigger, q[k], value);
+        }
+        SimdFloat scale = simdCopySign(oneOverMag, value);
+
+        SimdMask ge1 = simdCmpGt(largest, simdSet(0.5f));
+        SimdMask ge2 = simdCmpGt(largest, simdSet(1.5f));
+        SimdMask ge3 = simdCmpGt(largest, simdSet(2.5f));
+        SimdFloat v[3];
+        v[0] = simdSelect(ge1, q[0], q[1]);
+        v[1] = simdSelect(ge2, q[1], q[2]);
+        v[2] = simdSelect(ge3, q[2], q[3]);
+
+        SimdFloat maxValue = simdSet(packedMax<Packed>());
+        SimdFloat quantize = simdSet(packedMax<Packed>() / (2.0f * kPackedRange));
+        SimdFloat range = simdSet(kPackedRange);
+        SimdFloat half = simdSet(0.5f);
+        float tmp[4][kSimdWidth];
+        for (int k = 0; k < 3; ++k) {
+            SimdFloat u = simdFloor(simdMadd(simdMadd(v[k], scale, range), quantize, half));
+            simdStoreU(tmp[k], simdMin(simdMax(u, zero), maxValue));
+        }
+        simdStoreU(tmp[3], largest);
+
+        for (size_t j = 0; j < count; ++j) {
+            unsigned int f[4];
+            for (int k = 0; k < 4; ++k) {
+                f[k] = (unsigned int)tmp[k][j];
+            }
+            PackedFormat<Packed>::insert(out[i + j], f);
+        }
+    });
+}
+
+void packN(const Quaternion* in, PackedQuaternion32* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(PackN32, n);
+    packQuaternions(in, out, n);
+}
+
+void packN(const Quaternion* in, PackedQuaternion48* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(PackN48, n);
+    packQuaternions(in, out, n);
+}
+
+void packN(const Quaternion* in, PackedQuaternion64* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(PackN64, n);
+    packQuaternions(in, out, n);
+}
+
+void unpackN(const PackedQuaternion32* in, Quaternion* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(UnpackN32, n);
+    unpackQuaternions(in, out, n);
+}
+
+void unpackN(const PackedQuaternion48* in, Quaternion* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(UnpackN48, n);
+    unpackQuaternions(in, out, n);
+}
+
+void unpackN(const PackedQuaternion64* in, Quaternion* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(UnpackN64, n);
+    unpackQuaternions(in, out, n);
+}
@@ -0,0 +1,79 @@
+//
+//  PackedQuaternion.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef PackedQuaternion_hpp
+#define PackedQuaternion_hpp
+
+#include <stddef.h>
+
+#include "Quaternion.hpp"
+
+/*
+    压缩存储的单位四元数，用于动画数据和网络同步，Quaternion本身占16字节
+    采用smallest-three编码：q和-q表示同一个方位，取绝对值最大的分量为正，只保存另外三个分量和它的下标
+    另外三个分量的绝对值都不超过1/sqrt(2)，在[-1/sqrt(2), 1/sqrt(2)]内均匀量化
+    解码时由单位长度求出最大的分量，结果总是重新正则化的单位四元数，单位四元数可以精确还原
+    pack接受非单位四元数，先正则化再编码
+
+    格式           每个分量的位数   实测最大角度误差（弧度）
+    32位             10            PACKED_QUATERNION32_MAX_ERROR
+    48位             15            PACKED_QUATERNION48_MAX_ERROR
+    64位             20            PACKED_QUATERNION64_MAX_ERROR
+
+    最坏的情况是四个分量都接近±0.5：三个分量的量化误差同向累积到解码出的最大分量上，
+    夹角约为2 * sqrt(12)倍的半个量化步长，64位时float的舍入误差也占到约五分之一
+    上限取1亿个输入中的最大值再略微放宽，性能测试程序的--accuracy按它们检查
+ */
+#define PACKED_QUATERNION32_MAX_ERROR 4.8e-3f
+#define PACKED_QUATERNION48_MAX_ERROR 1.51e-4f
+#define PACKED_QUATERNION64_MAX_ERROR 6.1e-6f
+
+// 最高2位为最大分量的下标（0到3依次为w、x、y、z），其下每10位一个分量
+class PackedQuaternion32 {
+
+public:
+    unsigned int bits;
+
+    void pack(const Quaternion& q);
+    Quaternion unpack() const;
+};
+
+// 三个16位字，每个字的低15位是一个分量，前两个字的最高位是最大分量下标的高位和低位
+class PackedQuaternion48 {
+
+public:
+    unsigned short bits[3];
+
+    void pack(const Quaternion& q);
+    Quaternion unpack() const;
+};
+
+// lo的低20位和接下来的12位、hi的低8位各是一个分量，hi的8到27位是第一个分量，最高2位是最大分量的下标
+class PackedQuaternion64 {
+
+public:
+    unsigned int lo;
+    unsigned int hi;
+
+    void pack(const Quaternion& q);
+    Quaternion unpack() const;
+};
+
+/*
+    批量编码和解码，结果与逐个调用pack/unpack相同（在浮点舍入误差内）
+    多个四元数在SIMD寄存器中同时计算，解码不需要分支
+ */
+extern void packN(const Quaternion* in, PackedQuaternion32* out, size_t n);
+extern void packN(const Quaternion* in, PackedQuaternion48* out, size_t n);
+extern void packN(const Quaternion* in, PackedQuaternion64* out, size_t n);
+
+extern void unpackN(const PackedQuaternion32* in, Quaternion* out, size_t n);
+extern void unpackN(const PackedQuaternion48* in, Quaternion* out, size_t n);
+extern void unpackN(const PackedQuaternion64* in, Quaternion* out, size_t n);
+
+#endif /* PackedQuaternion_hpp */
@@ -10,58 +10,61 @@
 
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 #include "MathUtil.h"
 #include "Vector3.hpp"
 #include "EulerAngles.hpp"
-
-// 全剧数据
-
-// 全局单位四元数
-const Quaternion kQuaternion = {1.0f, 0.0f, 0.0f, 0.0f};
+#include "Matrix4x3.hpp"
+#include "Vector3Stream.hpp"
+#include "SimdMath.h"
+#include "ThreadPool.hpp"
+#include "SimdDispatch.hpp"
+#include "Instrument.hpp"
 
 void Quaternion::setToRotateAboutX(float theta) {
+    MATH_INSTRUMENT_SAMPLED(QuaternionSetToRotateAboutX);
     // 计算半角
     float thetaOver2 = theta * .5f;
     
     // 赋值
-    w = cos(thetaOver2);
-    x = sin(thetaOver2);
-    y = 0.0f;
-    z = 0.0f;
+    float sinThetaOver2, cosThetaOver2;
+    sinCos(&sinThetaOver2, &cosThetaOver2, thetaOver2);
+    setToRotateAboutX(sinThetaOver2, cosThetaOver2);
 }
 
 void Quaternion::setToRotateAboutY(float theta) {
+    MATH_INSTRUMENT_SAMPLED(QuaternionSetToRotateAboutY);
     // 计算半角
     float thetaOver2 = theta * .5f;
     
     // 赋值
-    w = cos(thetaOver2);
-    x = 0.0f;
-    y = sin(thetaOver2);
-    z = 0.0f;
+    float sinThetaOver2, cosThetaOver2;
+    sinCos(&sinThetaOver2, &cosThetaOver2, thetaOver2);
+    setToRotateAboutY(sinThetaOver2, cosThetaOver2);
 }
 
 void Quaternion::setToRotateAboutZ(float theta) {
+    MATH_INSTRUMENT_SAMPLED(QuaternionSetToRotateAboutZ);
     // 计算半角
     float thetaOver2 = theta * .5f;
     
     // 赋值
-    w = cos(thetaOver2);
-    x = 0.0f;
-    y = 0.0f;
-    z = sin(thetaOver2);
+    float sinThetaOver2, cosThetaOver2;
+    sinCos(&sinThetaOver2, &cosThetaOver2, thetaOver2);
+    setToRotateAboutZ(sinThetaOver2, cosThetaOver2);
 }
 
 void Quaternion::setToRotateAboutAxis(const Vector3 &axis, float theta) {
+    MATH_INSTRUMENT_SAMPLED(QuaternionSetToRotateAboutAxis);
     // 旋转轴必须标准化
     assert(fabs(vectorMag(axis) - 1.0f) < 0.1f);
     
     // 计算半角和sin值
     float thetaOver2 = theta * 0.5f;
-    float sinThetaOver2 = sin(thetaOver2);
+    float sinThetaOver2;
+    sinCos(&sinThetaOver2, &w, thetaOver2);
     
-    w = cos(thetaOver2);
     x = axis.x * sinThetaOver2;
     y = axis.y * sinThetaOver2;
     z = axis.z * sinThetaOver2;
@@ -69,6 +72,7 @@ void Quaternion::setToRotateAboutAxis(const Vector3 &axis, float theta) {
 
 // 10.6.5
 void Quaternion::setToRotateObjectToInertial(const EulerAngles &orientation) {
+    MATH_INSTRUMENT_SAMPLED(QuaternionSetToRotateObjectToInertial);
     // 计算半角的sin和cos值
     float sp, sb, sh;
     float cp, cb, ch;
@@ -84,6 +88,7 @@ void Quaternion::setToRotateObjectToInertial(const EulerAngles &orientation) {
 
 // 10.6.5
 void Quaternion::setToRotateInertialToObject(const EulerAngles &orientation) {
+    MATH_INSTRUMENT_SAMPLED(QuaternionSetToRotateInertialToObject);
     // 计算半角的sin和cos值
     float sp, sb, sh;
     float cp, cb, ch;
@@ -97,24 +102,105 @@ void Quaternion::setToRotateInertialToObject(const EulerAngles &orientation) {
     z = sh * sp * cb - ch * cp * sb;
 }
 
-// 四元数叉乘（乘法）运算，用以连接多个角位移 10.4.8
-// 乘的顺序从左到右
-Quaternion Quaternion::operator*(const Quaternion &a) const {
-    Quaternion result;
-    result.w = w * a.w - x * a.x - y * a.y - z * a.z;
-    result.x = w * a.x + x * a.w + z * a.y - y * a.z;
-    result.y = w * a.y + y * a.w + x * a.z - z * a.x;
-    result.z = w * a.z + z * a.w + y * a.x - x * a.y;
-    return result;
+/*
+    矩阵->四元数，参看10.6.3
+    先求出w、x、y、z中绝对值最大的一个，再用非对角线元素的和或差求出其余三个，避免除以很小的数
+ */
+void Quaternion::fromMatrix(const Matrix4x3& m) {
+    MATH_INSTRUMENT_SAMPLED(QuaternionFromMatrix);
+    float fourWSquaredMinus1 = m.m11 + m.m22 + m.m33;
+    float fourXSquaredMinus1 = m.m11 - m.m22 - m.m33;
+    float fourYSquaredMinus1 = m.m22 - m.m11 - m.m33;
+    float fourZSquaredMinus1 = m.m33 - m.m11 - m.m22;
+    
+    int biggestIndex = 0;
+    float fourBiggestSquaredMinus1 = fourWSquaredMinus1;
+    if (fourXSquaredMinus1 > fourBiggestSquaredMinus1) {
+        fourBiggestSquaredMinus1 = fourXSquaredMinus1;
+        biggestIndex = 1;
+    }
+    if (fourYSquaredMinus1 > fourBiggestSquaredMinus1) {
+        fourBiggestSquaredMinus1 = fourYSquaredMinus1;
+        biggestIndex = 2;
+    }
+    if (fourZSquaredMinus1 > fourBiggestSquaredMinus1) {
+        fourBiggestSquaredMinus1 = fourZSquaredMinus1;
+        biggestIndex = 3;
+    }
+    
+    float biggestVal = sqrtf(fourBiggestSquaredMinus1 + 1.0f) * 0.5f;
+    float mult = 0.25f / biggestVal;
+    
+    switch (biggestIndex) {
+        case 0:
+            w = biggestVal;
+            x = (m.m23 - m.m32) * mult;
+            y = (m.m31 - m.m13) * mult;
+            z = (m.m12 - m.m21) * mult;
+            break;
+        case 1:
+            x = biggestVal;
+            w = (m.m23 - m.m32) * mult;
+            y = (m.m12 + m.m21) * mult;
+            z = (m.m31 + m.m13) * mult;
+            break;
+        case 2:
+            y = biggestVal;
+            w = (m.m31 - m.m13) * mult;
+            x = (m.m12 + m.m21) * mult;
+            z = (m.m23 + m.m32) * mult;
+            break;
+        case 3:
+            z = biggestVal;
+            w = (m.m12 - m.m21) * mult;
+            x = (m.m31 + m.m13) * mult;
+            y = (m.m23 + m.m32) * mult;
+            break;
+    }
+}
+
+/*
+    批量欧拉角->四元数，参看10.6.5
+    惯性-物体四元数是物体-惯性四元数的共轭，sign为-1时对x、y、z取反
+ */
+static void eulerToQuaternionN(const EulerAngles* orientations, Quaternion* out, size_t n, float sign) {
+    const float* in = reinterpret_cast<const float*>(orientations);
+    float* result = reinterpret_cast<float*>(out);
+    parallelForGroups(n, kSimdWidth, cacheChunk(7 * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat angles[3];
+        simdLoadFields(in + 3 * i, 3, 3, count, angles);
+        
+        SimdFloat half = simdSet(0.5f);
+        SimdFloat sh, ch, sp, cp, sb, cb;
+        simdSinCos(simdMul(angles[0], half), sh, ch);
+        simdSinCos(simdMul(angles[1], half), sp, cp);
+        simdSinCos(simdMul(angles[2], half), sb, cb);
+        
+        SimdFloat chcp = simdMul(ch, cp), shsp = simdMul(sh, sp);
+        SimdFloat chsp = simdMul(ch, sp), shcp = simdMul(sh, cp);
+        SimdFloat s = simdSet(sign);
+        
+        SimdFloat q[4];
+        q[0] = simdMadd(chcp, cb, simdMul(shsp, sb));
+        q[1] = simdMul(s, simdMadd(chsp, cb, simdMul(shcp, sb)));
+        q[2] = simdMul(s, simdNmadd(chsp, sb, simdMul(shcp, cb)));
+        q[3] = simdMul(s, simdNmadd(shsp, cb, simdMul(chcp, sb)));
+        simdStoreFields(result + 4 * i, 4, 4, count, q);
+    });
+}
+
+void setToRotateObjectToInertialN(const EulerAngles* orientations, Quaternion* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(SetToRotateObjectToInertialN, n);
+    eulerToQuaternionN(orientations, out, n, 1.0f);
 }
 
-// 叉乘并赋值
-Quaternion& Quaternion::operator*=(const Quaternion &a) {
-    *this = *this * a;
-    return *this;
+void setToRotateInertialToObjectN(const EulerAngles* orientations, Quaternion* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(SetToRotateInertialToObjectN, n);
+    eulerToQuaternionN(orientations, out, n, -1.0f);
 }
 
 void Quaternion::normalize() {
+    MATH_INSTRUMENT_SAMPLED(QuaternionNormalize);
     float mag = (float)sqrt(w * w + x * x + y * y + z * z);
     if (mag > 0.0f) {
         float oneOverMag = 1.0f / mag;
@@ -130,15 +216,18 @@ void Quaternion::normalize() {
 }
 
 float Quaternion::getRotationAngles() const {
-    float thetaOver2 = safeAcos(w);
+    MATH_INSTRUMENT_SAMPLED(QuaternionGetRotationAngles);
+    // 用atan2而不用acos(w)：w接近±1时acos的误差很大，向量部分仍然保留了完整的精度
+    float thetaOver2 = mathAtan2(sqrt(x * x + y * y + z * z), w);
     
     return thetaOver2 * 2;
 }
 
 Vector3 Quaternion::getRotationAxis() const {
-    // 计算sin^2(theta / 2)，w = cos(theta / 2), sin^2(x) + cos^2(x) = 1
-    // x = axis.x * sin(theta / 2), y = axis.y * sin(theta / 2), z = axis.z * sin(theta / 2)
-    float sinThetaOver2Sq = 1.0 - w * w;
+    MATH_INSTRUMENT_SAMPLED(QuaternionGetRotationAxis);
+    // 计算sin^2(theta / 2)，x = axis.x * sin(theta / 2), y = axis.y * sin(theta / 2), z = axis.z * sin(theta / 2)
+    // 对单位四元数等于1 - w * w，但直接用向量部分计算，接近单位四元数时不会因为相减而失去精度
+    float sinThetaOver2Sq = x * x + y * y + z * z;
     
     // 保证数值精度
     if (sinThetaOver2Sq <= 0.0f) {
@@ -159,13 +248,9 @@ void Quaternion::print() const {
            cout << ss.str();
 }
 
-// 四元数点乘 10.4.10
-float dotProduct(const Quaternion& a, const Quaternion& b) {
-    return a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
-}
-
 // slerp，球面线性插值，10.4.13
 Quaternion slerp(const Quaternion& q0, const Quaternion& q1, float t) {
+    MATH_INSTRUMENT_SCOPE(QuaternionSlerp);
     // 检查参数边界
     if (t < 0.0f) {
         return q0;
@@ -193,8 +278,8 @@ Quaternion slerp(const Quaternion& q0, const Quaternion& q1, float t) {
         cosOmega = -cosOmega;
     }
     
-    // 我们用的是两个单位四元数，所以点乘结果应该<= 1.0f
-    assert(cosOmega < 1.0f);
+    // 我们用的是两个单位四元数，所以点乘结果应该<= 1.0f，允许一定的浮点误差
+    assert(cosOmega < 1.1f);
     
     // 计算插值片，注意检查非常接近的情况
     float k0, k1;
@@ -215,28 +300,38 @@ Quaternion slerp(const Quaternion& q0, const Quaternion& q1, float t) {
     }
     
     Quaternion result;
-    result.x = k0 * q0.x + k1*q1.x;
-    result.y = k0 * q0.y + k1*q1.y;
-    result.z = k0 * q0.z + k1*q1.z;
-    result.w = k0 * q0.w + k1*q1.w;
+    result.x = k0 * q0.x + k1*q1x;
+    result.y = k0 * q0.y + k1*q1y;
+    result.z = k0 * q0.z + k1*q1z;
+    result.w = k0 * q0.w + k1*q1w;
     return result;
 }
 
-// conjugate，四元数共轭，与原四元数旋转方向相反的四元数，10.4.7节
-Quaternion conjugate(const Quaternion& q) {
-    Quaternion result;
-    // 旋转量相同
-    result.w = q.w;
-    // 旋转轴相反
-    result.x = -q.x;
-    result.y = -q.y;
-    result.z = -q.z;
+void slerpN(const Quaternion* a, const Quaternion* b, const float* t, Quaternion* out, size_t n,
+            SlerpAccuracy accuracy) {
+    MATH_INSTRUMENT_BATCH(SlerpN, n);
+    if (accuracy == kSlerpExact) {
+        parallelFor(n, cacheChunk(13 * sizeof(float)), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = slerp(a[i], b[i], t[i]);
+            }
+        });
+        return;
+    }
     
-    return result;
+    // 快速模式的多项式近似在SimdKernels.h中，按运行时检测到的指令集选择
+    const SimdKernels& kernels = simdKernels();
+    const float* pa = reinterpret_cast<const float*>(a);
+    const float* pb = reinterpret_cast<const float*>(b);
+    float* po = reinterpret_cast<float*>(out);
+    parallelFor(n, cacheChunk(13 * sizeof(float)), [&](size_t begin, size_t end) {
+        kernels.slerpFast(pa + 4 * begin, pb + 4 * begin, t + begin, po + 4 * begin, end - begin);
+    });
 }
 
 // inverse，四元数逆，10.4.7
 Quaternion inverse(const Quaternion& q) {
+    MATH_INSTRUMENT_SAMPLED(QuaternionInverse);
     float mag = (float)sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
     Quaternion result = conjugate(q);
     if (mag > 0.0f) {
@@ -254,24 +349,31 @@ Quaternion inverse(const Quaternion& q) {
 }
 
 Quaternion diff(const Quaternion& a, const Quaternion& b) {
+    MATH_INSTRUMENT_SCOPE(QuaternionDiff);
     Quaternion result = inverse(a) * b;
     return result;
 }
 
 // pow，四元数幂，10.4.12节
 Quaternion pow(const Quaternion& q, float exponent) {
-    // 检查单位四元数，防止除零
-    if (fabs(q.w) > .9999f) {
+    MATH_INSTRUMENT_SCOPE(QuaternionPow);
+    /*
+        sin(alpha)就是向量部分的长度，用atan2求半角alpha(alpha = theta / 2)
+        w接近±1时acos(w)的误差很大，atan2在小角度和接近360°的旋转时仍然准确
+     */
+    float sinAlpha = sqrt(q.x * q.x + q.y * q.y + q.z * q.z);
+    
+    // 向量部分为零时没有旋转轴，防止除零
+    if (sinAlpha <= 0.0f) {
         return q;
     }
     
-    // 提取半角alpha(alpha = theta / 2)
-    float alpha = acos(q.w);
+    float alpha = atan2(sinAlpha, q.w);
     // 计算新alpha值
     float newAlpha = alpha * exponent;
     // 计算新w值
     Quaternion result;
-    float mult = sin(newAlpha) / sin(alpha);
+    float mult = sin(newAlpha) / sinAlpha;
     
     result.w = cos(newAlpha);
     result.x = q.x * mult;
@@ -281,9 +383,87 @@ Quaternion pow(const Quaternion& q, float exponent) {
     return result;
 }
 
+/*
+    四元数旋转向量的叉乘形式：q v q*展开后整理为v + w * t + u x t，t = 2 * (u x v)
+    按本库的约定，结果与行向量乘以fromQuaternion构造的矩阵相同
+ */
+Vector3 rotate(const Quaternion& q, const Vector3& v) {
+    MATH_INSTRUMENT_SAMPLED(QuaternionRotate);
+    float tx = 2.0f * (q.y * v.z - q.z * v.y);
+    float ty = 2.0f * (q.z * v.x - q.x * v.z);
+    float tz = 2.0f * (q.x * v.y - q.y * v.x);
+    return Vector3(v.x + q.w * tx + (q.y * tz - q.z * ty),
+                   v.y + q.w * ty + (q.z * tx - q.x * tz),
+                   v.z + q.w * tz + (q.x * ty - q.y * tx));
+}
 
+// 与rotate()相同的计算，每个通道一个向量
+static inline void simdRotate(SimdFloat w, SimdFloat qx, SimdFloat qy, SimdFloat qz,
+                              SimdFloat& x, SimdFloat& y, SimdFloat& z) {
+    SimdFloat two = simdSet(2.0f);
+    SimdFloat tx = simdMul(two, simdNmadd(qz, y, simdMul(qy, z)));
+    SimdFloat ty = simdMul(two, simdNmadd(qx, z, simdMul(qz, x)));
+    SimdFloat tz = simdMul(two, simdNmadd(qy, x, simdMul(qx, y)));
+    x = simdAdd(simdMadd(w, tx, x), simdNmadd(qz, ty, simdMul(qy, tz)));
+    y = simdAdd(simdMadd(w, ty, y), simdNmadd(qx, tz, simdMul(qz, tx)));
+    z = simdAdd(simdMadd(w, tz, z), simdNmadd(qy, tx, simdMul(qx, ty)));
+}
 
+/*
+    四元数的4个分量各广播到一个寄存器中，AoS数组在寄存器中转置为x、y、z三组
+    不足一组的尾部逐个计算
+ */
+void rotateN(const Quaternion& q, const Vector3* in, Vector3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(RotateN, n);
+    SimdFloat w = simdSet(q.w), qx = simdSet(q.x), qy = simdSet(q.y), qz = simdSet(q.z);
+    const float* src = reinterpret_cast<const float*>(in);
+    float* dst = reinterpret_cast<float*>(out);
+    parallelFor(n, cacheChunk(6 * sizeof(float)), [&](size_t begin, size_t end) {
+        size_t i = begin;
+        for (; i + kSimdWidth <= end; i += kSimdWidth) {
+            SimdFloat x, y, z;
+            simdLoadVector3(src + 3 * i, x, y, z);
+            simdRotate(w, qx, qy, qz, x, y, z);
+            simdStoreVector3(dst + 3 * i, x, y, z);
+        }
+        for (; i < end; ++i) {
+            out[i] = rotate(q, in[i]);
+        }
+    });
+}
 
+// SoA形式，补齐部分为0，旋转后仍为0，可以整组计算
+void rotateN(const Quaternion& q, const Vector3Stream& in, Vector3Stream& out) {
+    MATH_INSTRUMENT_BATCH(RotateNStream, in.size());
+    out.resize(in.size());
+    SimdFloat w = simdSet(q.w), qx = simdSet(q.x), qy = simdSet(q.y), qz = simdSet(q.z);
+    parallelFor(in.size(), cacheChunk(6 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            SimdFloat x = simdLoad(in.x() + i), y = simdLoad(in.y() + i), z = simdLoad(in.z() + i);
+            simdRotate(w, qx, qy, qz, x, y, z);
+            simdStore(out.x() + i, x);
+            simdStore(out.y() + i, y);
+            simdStore(out.z() + i, z);
+        }
+    });
+}
 
-
-
+void rotateN(const Quaternion* q, const Vector3* in, Vector3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(RotateNPerVector, n);
+    const float* pq = reinterpret_cast<const float*>(q);
+    const float* src = reinterpret_cast<const float*>(in);
+    float* dst = reinterpret_cast<float*>(out);
+    parallelFor(n, cacheChunk(10 * sizeof(float)), [&](size_t begin, size_t end) {
+        size_t i = begin;
+        for (; i + kSimdWidth <= end; i += kSimdWidth) {
+            SimdFloat w, qx, qy, qz, x, y, z;
+            simdLoadFloat4(pq + 4 * i, w, qx, qy, qz);
+            simdLoadVector3(src + 3 * i, x, y, z);
+            simdRotate(w, qx, qy, qz, x, y, z);
+            simdStoreVector3(dst + 3 * i, x, y, z);
+        }
+        for (; i < end; ++i) {
+            out[i] = rotate(q[i], in[i]);
+        }
+    });
+}
@@ -9,16 +9,27 @@
 #ifndef Quaternion_hpp
 #define Quaternion_hpp
 
+#include <stddef.h>
+
 class Vector3;
+class Vector3Stream;
 class EulerAngles;
+class Matrix4x3;
 
-// 实现在3D中表示角位移的四元数
+/*
+    实现在3D中表示角位移的四元数
+    默认构造不初始化分量，与原来的聚合类型一样可以用{w, x, y, z}初始化
+    构造、乘法、点乘、共轭和绕坐标轴旋转是constexpr，可以在编译时得到常量四元数
+ */
 class Quaternion {
     
 public:
     float w, x, y, z;
     
-    void identity() {
+    Quaternion() = default;
+    constexpr Quaternion(float nw, float nx, float ny, float nz) : w(nw), x(nx), y(ny), z(nz) {}
+    
+    constexpr void identity() {
         w = 1.0f;
         x = y = z = 0.0f;
     }
@@ -27,17 +38,54 @@ public:
     void setToRotateAboutX(float theta);
     void setToRotateAboutY(float theta);
     void setToRotateAboutZ(float theta);
+    
+    /*
+        同上，直接给出半角的sin和cos值，参看10.4.3
+        用constexprSin、constexprCos（参看MathUtil.h）计算时可以在编译时构造，
+        例如绕y轴旋转45度：q.setToRotateAboutY(constexprSin(kPi / 8.0f), constexprCos(kPi / 8.0f))
+     */
+    constexpr void setToRotateAboutX(float sinThetaOver2, float cosThetaOver2) {
+        w = cosThetaOver2;
+        x = sinThetaOver2;
+        y = 0.0f;
+        z = 0.0f;
+    }
+    constexpr void setToRotateAboutY(float sinThetaOver2, float cosThetaOver2) {
+        w = cosThetaOver2;
+        x = 0.0f;
+        y = sinThetaOver2;
+        z = 0.0f;
+    }
+    constexpr void setToRotateAboutZ(float sinThetaOver2, float cosThetaOver2) {
+        w = cosThetaOver2;
+        x = 0.0f;
+        y = 0.0f;
+        z = sinThetaOver2;
+    }
+    
     void setToRotateAboutAxis(const Vector3& axis, float theta);
     
     // 构造执行物体-惯性旋转的四元数，方位参数用欧拉角形式给出
     void setToRotateObjectToInertial(const EulerAngles& orientation);
     void setToRotateInertialToObject(const EulerAngles& orientation);
     
-    // 叉乘（乘法）
-    Quaternion operator* (const Quaternion& a) const;
+    // 从矩阵的3x3旋转部分提取四元数，与Matrix4x3::fromQuaternion互逆，假设矩阵是正交的
+    void fromMatrix(const Matrix4x3& m);
+    
+    // 四元数叉乘（乘法）运算，用以连接多个角位移 10.4.8
+    // 乘的顺序从左到右
+    constexpr Quaternion operator* (const Quaternion& a) const {
+        return Quaternion(w * a.w - x * a.x - y * a.y - z * a.z,
+                          w * a.x + x * a.w + z * a.y - y * a.z,
+                          w * a.y + y * a.w + x * a.z - z * a.x,
+                          w * a.z + z * a.w + y * a.x - x * a.y);
+    }
     
     // 赋值乘法
-    Quaternion& operator*= (const Quaternion& a);
+    constexpr Quaternion& operator*= (const Quaternion& a) {
+        *this = *this * a;
+        return *this;
+    }
     
     // 将四元数正则化
     void normalize();
@@ -50,16 +98,45 @@ public:
 };
 
 // 全局单位四元数
-extern const Quaternion kQuaternionIdentity;
+constexpr Quaternion kQuaternionIdentity(1.0f, 0.0f, 0.0f, 0.0f);
 
-// 四元数点乘
-extern float dotProduct(const Quaternion& a, const Quaternion& b);
+// 四元数点乘 10.4.10
+constexpr float dotProduct(const Quaternion& a, const Quaternion& b) {
+    return a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+}
 
 // 球面线性插值
 extern Quaternion slerp(const Quaternion& p, const Quaternion& q, float t);
 
-// 四元数共轭
-extern Quaternion conjugate(const Quaternion& q);
+/*
+    批量slerp的精度模式
+    kSlerpExact：逐个调用slerp()，结果与之完全相同
+    kSlerpFast：SIMD多项式近似，不使用三角函数，对单位四元数的最大角度误差不超过SLERP_FAST_MAX_ERROR，结果的模与1的误差约3e-5
+ */
+enum SlerpAccuracy {
+    kSlerpExact,
+    kSlerpFast
+};
+
+// 快速模式实测的最大角度误差（弧度）
+#define SLERP_FAST_MAX_ERROR 2e-5f
+
+// 批量球面线性插值，out[i] = slerp(a[i], b[i], t[i])，out可以与a或b是同一个数组
+extern void slerpN(const Quaternion* a, const Quaternion* b, const float* t, Quaternion* out, size_t n,
+                   SlerpAccuracy accuracy = kSlerpFast);
+
+/*
+    批量把欧拉角转换为四元数，结果与逐个调用setToRotateObjectToInertial/setToRotateInertialToObject相同（在MATH_ACCURACY的精度内）
+    多个元素在SIMD寄存器中同时计算，三组sin和cos也一起计算
+    每个元素的时间几乎都花在三组sin和cos上，默认精度下AVX2约为逐个调用的2.6倍，达不到4倍的目标
+ */
+extern void setToRotateObjectToInertialN(const EulerAngles* orientations, Quaternion* out, size_t n);
+extern void setToRotateInertialToObjectN(const EulerAngles* orientations, Quaternion* out, size_t n);
+
+// 四元数共轭，与原四元数旋转方向相反的四元数，10.4.7节：旋转量相同，旋转轴相反
+constexpr Quaternion conjugate(const Quaternion& q) {
+    return Quaternion(q.w, -q.x, -q.y, -q.z);
+}
 
 // 四元数逆
 extern Quaternion inverse(const Quaternion& q);
@@ -70,4 +147,21 @@ extern Quaternion diff(const Quaternion& a, const Quaternion& b);
 // 四元数幂
 extern Quaternion pow(const Quaternion& q, float exponent);
 
+/*
+    用单位四元数直接旋转向量，结果与v * m相同，其中m由Matrix4x3::fromQuaternion(q)构造
+    v' = v + w * t + u x t，其中u为q的向量部分，t = 2 * (u x v)，只需要两次叉乘，约15次乘加
+    每个方位只旋转少数几个向量时，比先构造矩阵再相乘便宜
+ */
+extern Vector3 rotate(const Quaternion& q, const Vector3& v);
+
+/*
+    批量：同一个方位旋转n个向量，out可以与in是同一个数组
+    每个向量的乘加比矩阵多，向量较多时先构造矩阵再用transformDirections更快，向量只有几个时用这里的版本
+ */
+extern void rotateN(const Quaternion& q, const Vector3* in, Vector3* out, size_t n);
+extern void rotateN(const Quaternion& q, const Vector3Stream& in, Vector3Stream& out);
+
+// 批量：out[i] = rotate(q[i], in[i])，每个方位旋转一个向量
+extern void rotateN(const Quaternion* q, const Vector3* in, Vector3* out, size_t n);
+
 #endif /* Quaternion_hpp */
@@ -0,0 +1,220 @@
+//
+//  QuaternionBlend.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "QuaternionBlend.hpp"
+
+#include <assert.h>
+
+#include "Quaternion.hpp"
+#include "SimdMath.h"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
+
+/*
+    对M反复平方，直到所有通道都收敛为秩1的矩阵，最多kBlendMaxSquarings次
+    M的迹为1时trace(M^2) = sum(mu^2)，mu是特征值，收敛时第二大的特征值mu2按mu2^2缩小，
+    1 - trace(M^2)约为2 * mu2，小于kBlendConverged时其余特征向量对结果的影响已在float的精度以下
+    lambda2 / lambda1 = 0.99时约需11次，最多次数对应lambda2 / lambda1 = 1 - 1e-8，两个特征值更接近时平均值本身没有意义
+ */
+static const int kBlendMaxSquarings = 32;
+static const float kBlendConverged = 2e-7f;
+
+static inline void loadQuaternions(const Quaternion* q, size_t count, SimdFloat* f) {
+    simdLoadFields(reinterpret_cast<const float*>(q), 4, 4, count, f);
+}
+
+static inline void storeQuaternions(Quaternion* q, size_t count, const SimdFloat* f) {
+    simdStoreFields(reinterpret_cast<float*>(q), 4, 4, count, f);
+}
+
+static inline SimdFloat dot4(const SimdFloat* a, const SimdFloat* b) {
+    return simdMadd(a[3], b[3], simdMadd(a[2], b[2], simdMadd(a[1], b[1], simdMul(a[0], b[0]))));
+}
+
+// 正则化，模为0的通道置为单位四元数
+static inline void normalizeOrIdentity(SimdFloat* q) {
+    SimdFloat magSq = dot4(q, q);
+    SimdMask valid = simdCmpGt(magSq, simdSet(1e-30f));
+    SimdFloat oneOverMag = simdRsqrt(simdSelect(valid, magSq, simdSet(1.0f)));
+    for (int k = 0; k < 4; ++k) {
+        q[k] = simdSelect(valid, simdMul(q[k], oneOverMag), simdSet(k == 0 ? 1.0f : 0.0f));
+    }
+}
+
+// 本库的四元数乘法a * b（先a后b），参看10.4.8
+static inline void multiply(const SimdFloat* a, const SimdFloat* b, SimdFloat* r) {
+    r[0] = simdNmadd(a[3], b[3], simdNmadd(a[2], b[2], simdNmadd(a[1], b[1], simdMul(a[0], b[0]))));
+    r[1] = simdNmadd(a[2], b[3], simdMadd(a[3], b[2], simdMadd(a[1], b[0], simdMul(a[0], b[1]))));
+    r[2] = simdNmadd(a[3], b[1], simdMadd(a[1], b[3], simdMadd(a[2], b[0], simdMul(a[0], b[2]))));
+    r[3] = simdNmadd(a[1], b[2], simdMadd(a[2], b[1], simdMadd(a[3], b[0], simdMul(a[0], b[3]))));
+}
+
+/*
+    对称矩阵平方后除以迹，防止反复平方后上溢或下溢，返回平方后的迹
+    迹为0（所有权重为0）时结果为0
+ */
+static inline SimdFloat squareSymmetric(SimdFloat (&m)[4][4]) {
+    SimdFloat p[4][4];
+    for (int a = 0; a < 4; ++a) {
+        for (int b = a; b < 4; ++b) {
+            SimdFloat s = simdMadd(m[a][3], m[3][b], simdMadd(m[a][2], m[2][b], simdMadd(m[a][1], m[1][b], simdMul(m[a][0], m[0][b]))));
+            p[a][b] = p[b][a] = s;
+        }
+    }
+    SimdFloat trace = simdAdd(simdAdd(p[0][0], p[1][1]), simdAdd(p[2][2], p[3][3]));
+    SimdMask valid = simdCmpGt(trace, simdZero());
+    SimdFloat scale = simdSelect(valid, simdDiv(simdSet(1.0f), simdSelect(valid, trace, simdSet(1.0f))), simdZero());
+    for (int a = 0; a < 4; ++a) {
+        for (int b = 0; b < 4; ++b) {
+            m[a][b] = simdMul(p[a][b], scale);
+        }
+    }
+    return trace;
+}
+
+/*
+    快速模式：每个姿态与当前累加结果点乘，为负时取-q，再按权重累加
+    精确模式：另外累加M = sum(w * q * q^T)，q和-q的贡献相同，所以M与符号无关
+    M的最大特征值对应的特征向量就是加权平均四元数：M除以迹后反复平方直到收敛为秩1的矩阵v * v^T，
+    取对角元最大的一列除以该对角元的平方根就是v，不依赖初值，各姿态相差很大时也收敛；
+    v的符号取与快速模式的结果同一个半球
+ */
+void blendN(const Quaternion* const* poses, const float* weights, int poseCount,
+            Quaternion* out, size_t boneCount, BlendAccuracy accuracy) {
+    MATH_INSTRUMENT_BATCH(BlendN, boneCount);
+    assert(poseCount >= 0);
+    parallelForGroups(boneCount, kSimdWidth, cacheChunk((poseCount + 1) * sizeof(Quaternion)), [&](size_t i, size_t count) {
+        SimdFloat zero = simdZero();
+        SimdFloat acc[4] = { zero, zero, zero, zero };
+        SimdFloat m[4][4];
+        for (int a = 0; a < 4; ++a) {
+            for (int b = 0; b < 4; ++b) {
+                m[a][b] = zero;
+            }
+        }
+
+        for (int k = 0; k < poseCount; ++k) {
+            assert(weights[k] >= 0.0f);
+            if (weights[k] == 0.0f) {
+                continue;
+            }
+            SimdFloat q[4];
+            loadQuaternions(poses[k] + i, count, q);
+            SimdFloat w = simdSet(weights[k]);
+            SimdFloat signedW = simdSelect(simdCmpLt(dot4(acc, q), zero), simdNeg(w), w);
+            for (int c = 0; c < 4; ++c) {
+                acc[c] = simdMadd(signedW, q[c], acc[c]);
+            }
+
+            if (accuracy == kBlendAccurate) {
+                for (int a = 0; a < 4; ++a) {
+                    SimdFloat wq = simdMul(w, q[a]);
+                    for (int b = a; b < 4; ++b) {
+                        m[a][b] = simdMadd(wq, q[b], m[a][b]);
+                    }
+                }
+            }
+        }
+
+        if (accuracy == kBlendAccurate) {
+            for (int a = 0; a < 4; ++a) {
+                for (int b = 0; b < a; ++b) {
+                    m[a][b] = m[b][a];
+                }
+            }
+            SimdFloat trace = simdAdd(simdAdd(m[0][0], m[1][1]), simdAdd(m[2][2], m[3][3]));
+            SimdMask valid = simdCmpGt(trace, zero);
+            SimdFloat scale = simdDiv(simdSet(1.0f), simdSelect(valid, trace, simdSet(1.0f)));
+            for (int a = 0; a < 4; ++a) {
+                for (int b = 0; b < 4; ++b) {
+                    m[a][b] = simdMul(m[a][b], scale);
+                }
+            }
+            SimdFloat converged = simdSet(1.0f - kBlendConverged);
+            for (int s = 0; s < kBlendMaxSquarings; ++s) {
+                SimdFloat squaredTrace = squareSymmetric(m);
+                if (simdMoveMask(simdMaskAnd(valid, simdCmpLt(squaredTrace, converged))) == 0) {
+                    break;
+                }
+            }
+
+            SimdFloat best = m[0][0];
+            SimdFloat v[4] = { m[0][0], m[1][0], m[2][0], m[3][0] };
+            for (int c = 1; c < 4; ++c) {
+                SimdMask larger = simdCmpGt(m[c][c], best);
+                best = simdSelect(larger, m[c][c], best);
+                for (int a = 0; a < 4; ++a) {
+                    v[a] = simdSelect(larger, m[a][c], v[a]);
+                }
+            }
+            // 全部权重为0的通道v为0，正则化后是单位四元数
+            SimdFloat sign = simdSelect(simdCmpLt(dot4(v, acc), zero), simdSet(-1.0f), simdSet(1.0f));
+            for (int a = 0; a < 4; ++a) {
+                acc[a] = simdMul(v[a], sign);
+            }
+        }
+
+        normalizeOrIdentity(acc);
+        storeQuaternions(out + i, count, acc);
+    });
+}
+
+/*
+    diff(a, b) = inverse(a) * b，a为单位四元数时逆就是共轭
+    展开共轭后直接相乘，结果正则化以消除输入的舍入误差
+ */
+void additiveDeltaN(const Quaternion* reference, const Quaternion* pose, Quaternion* delta, size_t n) {
+    MATH_INSTRUMENT_BATCH(AdditiveDeltaN, n);
+    parallelForGroups(n, kSimdWidth, cacheChunk(3 * sizeof(Quaternion)), [&](size_t i, size_t count) {
+        SimdFloat a[4], b[4], d[4];
+        loadQuaternions(reference + i, count, a);
+        loadQuaternions(pose + i, count, b);
+        a[1] = simdNeg(a[1]);
+        a[2] = simdNeg(a[2]);
+        a[3] = simdNeg(a[3]);
+        multiply(a, b, d);
+
+        // w为负时取-d，表示同一个角位移
+        SimdFloat sign = simdCopySign(simdSet(1.0f), d[0]);
+        for (int k = 0; k < 4; ++k) {
+            d[k] = simdMul(d[k], sign);
+        }
+        normalizeOrIdentity(d);
+        storeQuaternions(delta + i, count, d);
+    });
+}
+
+/*
+    pow(delta, weight)，参看10.4.12：半角alpha由atan2(|v|, w)求出，小角度时也准确
+    新四元数为(cos(weight * alpha), v * sin(weight * alpha) / sin(alpha))，sin(alpha) = |v|
+    |v|接近0时sin(weight * alpha) / sin(alpha)的极限为weight
+ */
+void blendAdditiveN(const Quaternion* base, const Quaternion* delta, float weight,
+                    Quaternion* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(BlendAdditiveN, n);
+    parallelForGroups(n, kSimdWidth, cacheChunk(3 * sizeof(Quaternion)), [&](size_t i, size_t count) {
+        SimdFloat b[4], d[4], p[4], r[4];
+        loadQuaternions(base + i, count, b);
+        loadQuaternions(delta + i, count, d);
+
+        SimdFloat t = simdSet(weight);
+        SimdFloat sinAlpha = simdSqrt(simdMadd(d[3], d[3], simdMadd(d[2], d[2], simdMul(d[1], d[1]))));
+        SimdFloat alpha = simdAtan2(sinAlpha, d[0]);
+        SimdFloat s, c;
+        simdSinCos(simdMul(t, alpha), s, c);
+        SimdMask small = simdCmpLt(sinAlpha, simdSet(1e-6f));
+        SimdFloat mult = simdSelect(small, t, simdDiv(s, simdSelect(small, simdSet(1.0f), sinAlpha)));
+        p[0] = c;
+        p[1] = simdMul(d[1], mult);
+        p[2] = simdMul(d[2], mult);
+        p[3] = simdMul(d[3], mult);
+
+        multiply(b, p, r);
+        storeQuaternions(out + i, count, r);
+    });
+}
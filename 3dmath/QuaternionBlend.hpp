@@ -0,0 +1,59 @@
+//
+//  QuaternionBlend.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef QuaternionBlend_hpp
+#define QuaternionBlend_hpp
+
+#include <stddef.h>
+
+class Quaternion;
+
+/*
+    动画混合树用的多姿态四元数混合，所有函数都按骨骼批量计算，多个骨骼在SIMD寄存器中同时计算
+    两两调用slerp()和pow()时每个混合节点都要计算三角函数，这里的快速模式只需要乘加和一次开方
+ */
+
+/*
+    混合的精度模式
+    kBlendFast：正则化线性插值（nlerp），各姿态先翻转到与已累加结果同一个半球，再按权重相加后正则化
+                姿态之间夹角较小时（同一个动作的不同变体）结果与精确平均几乎相同
+    kBlendAccurate：加权平均四元数，即矩阵M = sum(w * q * q^T)的最大特征向量（Markley方法）
+                对M反复平方直到收敛，不依赖初值，各姿态相差很大时也收敛，结果与q的符号无关
+                特征向量本身的条件数为1 / (1 - lambda2 / lambda1)，lambda1、lambda2是M最大的两个特征值，
+                实测与双精度求出的特征向量的角度误差不超过约7e-7 / (1 - lambda2 / lambda1)弧度，
+                lambda2 / lambda1不超过0.99时不超过BLEND_ACCURATE_MAX_ERROR；两个特征值几乎相等时平均值本身没有意义
+ */
+enum BlendAccuracy {
+    kBlendFast,
+    kBlendAccurate
+};
+
+#define BLEND_ACCURATE_MAX_ERROR 1e-4f
+
+/*
+    混合poseCount个姿态，poses[k]是第k个姿态的boneCount个骨骼方位，weights[k]是它的权重
+    权重不必归一化，不能为负，全部为0时结果为单位四元数
+    out可以与某个姿态是同一个数组
+ */
+extern void blendN(const Quaternion* const* poses, const float* weights, int poseCount,
+                   Quaternion* out, size_t boneCount, BlendAccuracy accuracy = kBlendFast);
+
+/*
+    叠加（additive）层的差量：delta[i] = diff(reference[i], pose[i])，即reference[i] * delta[i] = pose[i]
+    结果的w不为负，使叠加时沿最短路径缩放
+ */
+extern void additiveDeltaN(const Quaternion* reference, const Quaternion* pose, Quaternion* delta, size_t n);
+
+/*
+    叠加差量：out[i] = base[i] * pow(delta[i], weight)，weight为0时结果就是base，为1时叠加完整的差量
+    out可以与base是同一个数组
+ */
+extern void blendAdditiveN(const Quaternion* base, const Quaternion* delta, float weight,
+                           Quaternion* out, size_t n);
+
+#endif /* QuaternionBlend_hpp */
@@ -0,0 +1,286 @@
+//
+//  QuaternionStream.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "QuaternionStream.hpp"
+
+#include <assert.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+
+#include "Quaternion.hpp"
+#include "Vector3Stream.hpp"
+#include "SimdMath.h"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
+
+/*
+    四个分量数组放在同一块内存中，依次为w、x、y、z，每段长度为补齐后的容量
+    与Vector3Stream相同，每段的起始地址都是对齐的
+ */
+QuaternionStream::QuaternionStream() : ws(NULL), xs(NULL), ys(NULL), zs(NULL), count(0), padded(0) {}
+
+QuaternionStream::QuaternionStream(size_t n) : ws(NULL), xs(NULL), ys(NULL), zs(NULL), count(0), padded(0) {
+    allocate(n);
+}
+
+QuaternionStream::QuaternionStream(const QuaternionStream& a) : ws(NULL), xs(NULL), ys(NULL), zs(NULL), count(0), padded(0) {
+    allocate(a.count);
+    copyComponents(a);
+}
+
+QuaternionStream::~QuaternionStream() {
+    release();
+}
+
+QuaternionStream& QuaternionStream::operator =(const QuaternionStream& a) {
+    if (this != &a) {
+        if (padded != paddedSize(a.count)) {
+            release();
+            allocate(a.count);
+        }
+        count = a.count;
+        copyComponents(a);
+    }
+    return *this;
+}
+
+// 与Vector3Stream相同，a缩小过时分量数组的间隔不同，要分别复制；a在size()之后的部分都是单位四元数
+void QuaternionStream::copyComponents(const QuaternionStream& a) {
+    if (padded > 0) {
+        memcpy(ws, a.ws, padded * sizeof(float));
+        memcpy(xs, a.xs, padded * sizeof(float));
+        memcpy(ys, a.ys, padded * sizeof(float));
+        memcpy(zs, a.zs, padded * sizeof(float));
+    }
+}
+
+void QuaternionStream::allocate(size_t n) {
+    count = n;
+    padded = paddedSize(n);
+    if (padded == 0) {
+        return;
+    }
+    ws = (float*)alignedAlloc(4 * padded * sizeof(float));
+    if (ws == NULL) {
+        throw std::bad_alloc();
+    }
+    xs = ws + padded;
+    ys = xs + padded;
+    zs = ys + padded;
+    identity();
+}
+
+void QuaternionStream::release() {
+    alignedFree(ws);
+    ws = xs = ys = zs = NULL;
+    count = padded = 0;
+}
+
+void QuaternionStream::resize(size_t n) {
+    if (n <= padded) {
+        // 容量足够，只需把被截掉的部分置为单位四元数，保证补齐部分始终为单位四元数
+        for (size_t i = n; i < count; ++i) {
+            ws[i] = 1.0f;
+            xs[i] = ys[i] = zs[i] = 0.0f;
+        }
+        count = n;
+        return;
+    }
+
+    QuaternionStream grown(n);
+    if (count > 0) {
+        memcpy(grown.ws, ws, count * sizeof(float));
+        memcpy(grown.xs, xs, count * sizeof(float));
+        memcpy(grown.ys, ys, count * sizeof(float));
+        memcpy(grown.zs, zs, count * sizeof(float));
+    }
+
+    // 交换两者的存储，旧的内存由grown析构时释放
+    float* oldWs = ws;
+    ws = grown.ws; xs = grown.xs; ys = grown.ys; zs = grown.zs;
+    padded = grown.padded;
+    count = n;
+    grown.ws = oldWs;
+}
+
+void QuaternionStream::identity() {
+    if (padded > 0) {
+        for (size_t i = 0; i < padded; ++i) {
+            ws[i] = 1.0f;
+        }
+        memset(xs, 0, 3 * padded * sizeof(float));
+    }
+}
+
+Quaternion QuaternionStream::get(size_t i) const {
+    assert(i < count);
+    Quaternion q;
+    q.w = ws[i];
+    q.x = xs[i];
+    q.y = ys[i];
+    q.z = zs[i];
+    return q;
+}
+
+void QuaternionStream::set(size_t i, const Quaternion& q) {
+    assert(i < count);
+    ws[i] = q.w;
+    xs[i] = q.x;
+    ys[i] = q.y;
+    zs[i] = q.z;
+}
+
+/*
+    AoS -> SoA
+    Quaternion的成员依次为w、x、y、z，每次读入kSimdWidth个，在寄存器中转置后分别写入四个数组
+ */
+void QuaternionStream::fromQuaternionArray(const Quaternion* q, size_t n) {
+    resize(n);
+    const float* p = reinterpret_cast<const float*>(q);
+    size_t i = 0;
+    for (; i + kSimdWidth <= n; i += kSimdWidth) {
+        SimdFloat qw, qx, qy, qz;
+        simdLoadFloat4(p + 4 * i, qw, qx, qy, qz);
+        simdStore(ws + i, qw);
+        simdStore(xs + i, qx);
+        simdStore(ys + i, qy);
+        simdStore(zs + i, qz);
+    }
+    for (; i < n; ++i) {
+        ws[i] = q[i].w;
+        xs[i] = q[i].x;
+        ys[i] = q[i].y;
+        zs[i] = q[i].z;
+    }
+}
+
+// SoA -> AoS
+void QuaternionStream::toQuaternionArray(Quaternion* q) const {
+    float* p = reinterpret_cast<float*>(q);
+    size_t i = 0;
+    for (; i + kSimdWidth <= count; i += kSimdWidth) {
+        simdStoreFloat4(p + 4 * i, simdLoad(ws + i), simdLoad(xs + i), simdLoad(ys + i), simdLoad(zs + i));
+    }
+    for (; i < count; ++i) {
+        q[i].w = ws[i];
+        q[i].x = xs[i];
+        q[i].y = ys[i];
+        q[i].z = zs[i];
+    }
+}
+
+// 掩码中为1的通道数
+static inline size_t countLanes(int mask) {
+    size_t n = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        ++n;
+    }
+    return n;
+}
+
+/*
+    模的平方与1相差超过tolerance的通道乘以1/|q|，其余通道的系数为1
+    单位四元数附近|q|^2 - 1约等于2(|q| - 1)，所以tolerance可以看作模长允许误差的两倍
+ */
+static inline SimdMask renormalizeLanes(SimdFloat& w, SimdFloat& x, SimdFloat& y, SimdFloat& z, SimdFloat tolerance) {
+    SimdFloat magSq = simdMadd(z, z, simdMadd(y, y, simdMadd(x, x, simdMul(w, w))));
+    SimdFloat one = simdSet(1.0f);
+    SimdMask drifted = simdMaskAnd(simdCmpGt(simdAbs(simdSub(magSq, one)), tolerance), simdCmpGt(magSq, simdZero()));
+    SimdFloat oneOverMag = simdSelect(drifted, simdRsqrt(simdSelect(drifted, magSq, one)), one);
+    w = simdMul(w, oneOverMag);
+    x = simdMul(x, oneOverMag);
+    y = simdMul(y, oneOverMag);
+    z = simdMul(z, oneOverMag);
+    return drifted;
+}
+
+/*
+    批量运算与Vector3Stream一样通过parallelFor分块执行到paddedSize()
+    补齐部分为单位四元数、角速度为0，计算后仍是单位四元数
+ */
+void normalize(QuaternionStream& q) {
+    renormalize(q, -1.0f);
+}
+
+size_t renormalize(QuaternionStream& q, float tolerance) {
+    MATH_INSTRUMENT_BATCH(QuaternionStreamRenormalize, q.size());
+    std::atomic<size_t> total(0);
+    SimdFloat vTolerance = simdSet(tolerance);
+    parallelFor(q.paddedSize(), cacheChunk(8 * sizeof(float)), [&](size_t begin, size_t end) {
+        size_t fixed = 0;
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            SimdFloat w = simdLoad(q.w() + i), x = simdLoad(q.x() + i), y = simdLoad(q.y() + i), z = simdLoad(q.z() + i);
+            int mask = simdMoveMask(renormalizeLanes(w, x, y, z, vTolerance));
+            if (mask == 0) {
+                // 没有通道需要修正，不必写回，已经正则化的数据只读不写
+                continue;
+            }
+            fixed += countLanes(mask);
+            simdStore(q.w() + i, w);
+            simdStore(q.x() + i, x);
+            simdStore(q.y() + i, y);
+            simdStore(q.z() + i, z);
+        }
+        total += fixed;
+    });
+    return total;
+}
+
+/*
+    角速度为w时方位的导数为dq/dt = 0.5 * w * q（Hamilton乘积，w看作实部为0的四元数）
+    一阶积分直接加上dt倍的导数：
+        w * q的实部为-dot(w, v)，虚部为qw * w + cross(w, v)，其中v为q的虚部
+    指数映射积分先求出增量四元数p = exp(0.5 * dt * w) = (cos(theta), sin(theta) * w / |w|)，theta = 0.5 * |w| * dt
+    参看10.4.10，再计算p * q（Hamilton乘积，即本库的q * p）：
+        实部为pw * qw - dot(pv, v)，虚部为pw * v + qw * pv + cross(pv, v)
+    |w|接近0时sin(theta) / |w|的极限为0.5 * dt
+ */
+void integrateOrientations(QuaternionStream& orientations, const Vector3Stream& angularVelocity, float dt,
+                           OrientationIntegration method, float tolerance) {
+    MATH_INSTRUMENT_BATCH(IntegrateOrientations, orientations.size());
+    assert(orientations.size() == angularVelocity.size());
+    QuaternionStream& q = orientations;
+    const Vector3Stream& omega = angularVelocity;
+    SimdFloat halfDt = simdSet(0.5f * dt);
+    SimdFloat vTolerance = simdSet(tolerance);
+    parallelFor(q.paddedSize(), cacheChunk(11 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            SimdFloat qw = simdLoad(q.w() + i), qx = simdLoad(q.x() + i), qy = simdLoad(q.y() + i), qz = simdLoad(q.z() + i);
+            SimdFloat ox = simdLoad(omega.x() + i), oy = simdLoad(omega.y() + i), oz = simdLoad(omega.z() + i);
+            SimdFloat rw, rx, ry, rz;
+            if (method == kIntegrateFirstOrder) {
+                SimdFloat dw = simdNeg(simdMadd(oz, qz, simdMadd(oy, qy, simdMul(ox, qx))));
+                SimdFloat dx = simdMadd(qw, ox, simdNmadd(oz, qy, simdMul(oy, qz)));
+                SimdFloat dy = simdMadd(qw, oy, simdNmadd(ox, qz, simdMul(oz, qx)));
+                SimdFloat dz = simdMadd(qw, oz, simdNmadd(oy, qx, simdMul(ox, qy)));
+                rw = simdMadd(halfDt, dw, qw);
+                rx = simdMadd(halfDt, dx, qx);
+                ry = simdMadd(halfDt, dy, qy);
+                rz = simdMadd(halfDt, dz, qz);
+            } else {
+                SimdFloat magSq = simdMadd(oz, oz, simdMadd(oy, oy, simdMul(ox, ox)));
+                SimdFloat mag = simdSqrt(magSq);
+                SimdFloat s, c;
+                simdSinCos(simdMul(mag, halfDt), s, c);
+                SimdMask small = simdCmpLt(mag, simdSet(1e-6f));
+                SimdFloat k = simdSelect(small, halfDt, simdDiv(s, simdSelect(small, simdSet(1.0f), mag)));
+                SimdFloat px = simdMul(ox, k), py = simdMul(oy, k), pz = simdMul(oz, k);
+                rw = simdNmadd(pz, qz, simdNmadd(py, qy, simdNmadd(px, qx, simdMul(c, qw))));
+                rx = simdMadd(qw, px, simdMadd(c, qx, simdNmadd(pz, qy, simdMul(py, qz))));
+                ry = simdMadd(qw, py, simdMadd(c, qy, simdNmadd(px, qz, simdMul(pz, qx))));
+                rz = simdMadd(qw, pz, simdMadd(c, qz, simdNmadd(py, qx, simdMul(px, qy))));
+            }
+            renormalizeLanes(rw, rx, ry, rz, vTolerance);
+            simdStore(q.w() + i, rw);
+            simdStore(q.x() + i, rx);
+            simdStore(q.y() + i, ry);
+            simdStore(q.z() + i, rz);
+        }
+    });
+}
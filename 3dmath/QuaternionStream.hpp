@@ -0,0 +1,110 @@
+//
+//  QuaternionStream.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef QuaternionStream_hpp
+#define QuaternionStream_hpp
+
+#include <stddef.h>
+
+class Quaternion;
+class Vector3Stream;
+
+/*
+    QuaternionStream类
+    以SoA方式存储一组四元数：w、x、y、z各占一个连续数组，与Vector3Stream的布局相同
+    四个数组都按kSimdAlignment对齐，容量补齐到kStreamPadding的整数倍，补齐部分始终为单位四元数
+    这样正则化等批量运算可以直接按SIMD宽度处理到paddedSize()，补齐部分不会出现除以0
+ */
+class QuaternionStream {
+
+public:
+    // 容量补齐的粒度，与Vector3Stream相同，同样个数的两种流可以按同一下标一起处理
+    static const size_t kStreamPadding = 16;
+
+    QuaternionStream();
+    explicit QuaternionStream(size_t n);
+    QuaternionStream(const QuaternionStream& a);
+    ~QuaternionStream();
+
+    QuaternionStream& operator =(const QuaternionStream& a);
+
+    // 四元数个数，以及补齐后的容量
+    size_t size() const { return count; }
+    size_t capacity() const { return padded; }
+
+    // 四元数个数补齐到kStreamPadding的整数倍，批量运算处理到这里为止，参看Vector3Stream::paddedSize
+    size_t paddedSize() const { return paddedSize(count); }
+    static size_t paddedSize(size_t n) { return (n + kStreamPadding - 1) / kStreamPadding * kStreamPadding; }
+
+    // 改变四元数个数，原有数据保留，新增部分置为单位四元数
+    void resize(size_t n);
+
+    // 所有四元数置为单位四元数
+    void identity();
+
+    // 分量数组
+    float* w() { return ws; }
+    float* x() { return xs; }
+    float* y() { return ys; }
+    float* z() { return zs; }
+    const float* w() const { return ws; }
+    const float* x() const { return xs; }
+    const float* y() const { return ys; }
+    const float* z() const { return zs; }
+
+    // 单个四元数的读写
+    Quaternion get(size_t i) const;
+    void set(size_t i, const Quaternion& q);
+
+    // 和AoS形式的Quaternion数组互相转换
+    void fromQuaternionArray(const Quaternion* q, size_t n);
+    void toQuaternionArray(Quaternion* q) const;
+
+private:
+    float* ws;
+    float* xs;
+    float* ys;
+    float* zs;
+    size_t count;
+    size_t padded;
+
+    void allocate(size_t n);
+    void release();
+    void copyComponents(const QuaternionStream& a);
+};
+
+// 就地正则化，用rsqrt加一次牛顿迭代代替sqrt和除法
+extern void normalize(QuaternionStream& q);
+
+/*
+    漂移修正：只有模的平方与1相差超过tolerance的四元数才重新正则化，其余保持不变
+    积分等运算每步只带来很小的误差，大部分四元数不需要改写，一组都不需要时整组跳过
+    返回重新正则化的个数
+ */
+extern size_t renormalize(QuaternionStream& q, float tolerance = 1e-5f);
+
+/*
+    刚体方位积分的方法
+    kIntegrateFirstOrder：一阶（显式欧拉）q' = q + 0.5 * dt * w * q，只需乘加，每步后模略大于1
+    kIntegrateExponential：指数映射q' = exp(0.5 * dt * w) * q，对常角速度是精确的，结果保持单位长度
+ */
+enum OrientationIntegration {
+    kIntegrateFirstOrder,
+    kIntegrateExponential
+};
+
+/*
+    按世界坐标系中的角速度angularVelocity（弧度/秒）积分dt时间，orientations[i]表示物体->惯性的旋转
+    “w * q”按通常写法（Hamilton乘积），即本库的q * w，先执行原方位再旋转增量
+    积分后按renormalize()的规则修正模长，tolerance为0时全部重新正则化
+    两个流的个数必须相同
+ */
+extern void integrateOrientations(QuaternionStream& orientations, const Vector3Stream& angularVelocity, float dt,
+                                  OrientationIntegration method = kIntegrateFirstOrder, float tolerance = 1e-5f);
+
+#endif /* QuaternionStream_hpp */
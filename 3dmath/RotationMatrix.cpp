@@ -12,6 +12,10 @@
 #include "MathUtil.h"
 #include "Quaternion.hpp"
 #include "EulerAngles.hpp"
+#include "SimdMath.h"
+#include "ThreadPool.hpp"
+#include "Vector3Stream.hpp"
+#include "Instrument.hpp"
 
 // 置为单位矩阵
 void RotationMatrix::identity() {
@@ -22,6 +26,7 @@ void RotationMatrix::identity() {
 
 // 用欧拉角参数构造矩阵，10.6.1节
 void RotationMatrix::setup(const EulerAngles &orientation) {
+    MATH_INSTRUMENT_SAMPLED(RotationMatrixSetup);
     // 计算角度的sin和cos值head-pitch-bank
     float sh, ch, sp, cp, sb, cb;
     sinCos(&sh, &ch, orientation.heading);
@@ -45,6 +50,7 @@ void RotationMatrix::setup(const EulerAngles &orientation) {
 
 // 根据惯性-物体旋转四元数构造矩阵，10.6.3节
 void RotationMatrix::fromInertialToObjectQuaternion(const Quaternion &q) {
+    MATH_INSTRUMENT_SAMPLED(RotationMatrixFromInertialToObjectQuaternion);
     // 优化空间：相同子表达式计算一遍即可
     m11 = 1.0f -2.0f * (q.y * q.y + q.z * q.z);
     m12 = 2.0f * (q.x * q.y + q.w * q.z);
@@ -61,6 +67,7 @@ void RotationMatrix::fromInertialToObjectQuaternion(const Quaternion &q) {
 
 // 根据物体-惯性旋转的四元数构造矩阵，10.6.3节
 void RotationMatrix::fromObjectToInertialQuaternion(const Quaternion &q) {
+    MATH_INSTRUMENT_SAMPLED(RotationMatrixFromObjectToInertialQuaternion);
     // 优化空间：相同子表达式计算一遍即可
     m11 = 1.0f -2.0f * (q.y * q.y + q.z * q.z);
     m12 = 2.0f * (q.x * q.y - q.w * q.z);
@@ -108,5 +115,248 @@ Vector3 RotationMatrix::inertialToObject(const Vector3 &v) const {
 Vector3 RotationMatrix::objectToInertial(const Vector3 &v) const {
     return Vector3(m11 * v.x + m12 * v.y + m13 * v.z,
                    m21 * v.x + m22 * v.y + m23 * v.z,
-                   m31 * v.x + m32 * v.z + m33 * v.z);
+                   m31 * v.x + m32 * v.y + m33 * v.z);
+}
+
+// 批量用欧拉角构造矩阵，10.6.1节
+void setupN(const EulerAngles* orientations, RotationMatrix* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(RotationMatrixSetupN, n);
+    const float* in = reinterpret_cast<const float*>(orientations);
+    float* result = reinterpret_cast<float*>(out);
+    const size_t stride = sizeof(RotationMatrix) / sizeof(float);
+    parallelForGroups(n, kSimdWidth, cacheChunk(12 * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat angles[3];
+        simdLoadFields(in + 3 * i, 3, 3, count, angles);
+        
+        SimdFloat sh, ch, sp, cp, sb, cb;
+        simdSinCos(angles[0], sh, ch);
+        simdSinCos(angles[1], sp, cp);
+        simdSinCos(angles[2], sb, cb);
+        
+        SimdFloat shsp = simdMul(sh, sp), chsp = simdMul(ch, sp);
+        SimdFloat m[9];
+        m[0] = simdMadd(ch, cb, simdMul(shsp, sb));
+        m[1] = simdNmadd(ch, sb, simdMul(shsp, cb));
+        m[2] = simdMul(sh, cp);
+        m[3] = simdMul(sb, cp);
+        m[4] = simdMul(cb, cp);
+        m[5] = simdNeg(sp);
+        m[6] = simdNmadd(sh, cb, simdMul(chsp, sb));
+        m[7] = simdMadd(sb, sh, simdMul(chsp, cb));
+        m[8] = simdMul(ch, cp);
+        simdStoreFields(result + stride * i, stride, 9, count, m);
+    });
+}
+
+/*
+    批量用四元数构造矩阵，10.6.3节
+    物体-惯性矩阵是惯性-物体矩阵的转置，transpose为true时交换行列写出
+ */
+static void quaternionToRotationMatrixN(const Quaternion* q, RotationMatrix* out, size_t n, bool transpose) {
+    const float* in = reinterpret_cast<const float*>(q);
+    float* result = reinterpret_cast<float*>(out);
+    const size_t stride = sizeof(RotationMatrix) / sizeof(float);
+    parallelForGroups(n, kSimdWidth, cacheChunk(13 * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat f[4];
+        simdLoadFields(in + 4 * i, 4, 4, count, f);
+        
+        // 公共子表达式只计算一次
+        SimdFloat two = simdSet(2.0f), one = simdSet(1.0f);
+        SimdFloat w2 = simdMul(two, f[0]), x2 = simdMul(two, f[1]), y2 = simdMul(two, f[2]), z2 = simdMul(two, f[3]);
+        SimdFloat xx = simdMul(x2, f[1]), yy = simdMul(y2, f[2]), zz = simdMul(z2, f[3]);
+        SimdFloat xy = simdMul(x2, f[2]), xz = simdMul(x2, f[3]), yz = simdMul(y2, f[3]);
+        SimdFloat wx = simdMul(w2, f[1]), wy = simdMul(w2, f[2]), wz = simdMul(w2, f[3]);
+        
+        SimdFloat m[9];
+        m[0] = simdSub(simdSub(one, yy), zz);
+        m[4] = simdSub(simdSub(one, xx), zz);
+        m[8] = simdSub(simdSub(one, xx), yy);
+        m[1] = simdAdd(xy, wz);
+        m[2] = simdSub(xz, wy);
+        m[3] = simdSub(xy, wz);
+        m[5] = simdAdd(yz, wx);
+        m[6] = simdAdd(xz, wy);
+        m[7] = simdSub(yz, wx);
+        if (transpose) {
+            SimdFloat t;
+            t = m[1]; m[1] = m[3]; m[3] = t;
+            t = m[2]; m[2] = m[6]; m[6] = t;
+            t = m[5]; m[5] = m[7]; m[7] = t;
+        }
+        simdStoreFields(result + stride * i, stride, 9, count, m);
+    });
+}
+
+void fromInertialToObjectQuaternionN(const Quaternion* q, RotationMatrix* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(RotationMatrixFromInertialToObjectQuaternionN, n);
+    quaternionToRotationMatrixN(q, out, n, false);
+}
+
+void fromObjectToInertialQuaternionN(const Quaternion* q, RotationMatrix* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(RotationMatrixFromObjectToInertialQuaternionN, n);
+    quaternionToRotationMatrixN(q, out, n, true);
+}
+
+/*
+    重新正交化，参看9.3.3
+    书中的Gram-Schmidt方法以第一行为基准，误差都集中到后两行上
+    这里r1和r2对称地各减去一半的投影：e = r1 . r2，r1' = r1 - e/2 * r2，r2' = r2 - e/2 * r1
+    r3由叉乘得到，最后用rsqrt加一次牛顿迭代正则化三行
+ */
+static inline void normalizeRow(SimdFloat& x, SimdFloat& y, SimdFloat& z) {
+    SimdFloat oneOverMag = simdRsqrt(simdMadd(z, z, simdMadd(y, y, simdMul(x, x))));
+    x = simdMul(x, oneOverMag);
+    y = simdMul(y, oneOverMag);
+    z = simdMul(z, oneOverMag);
+}
+
+void orthonormalizeN(RotationMatrix* m, size_t n) {
+    MATH_INSTRUMENT_BATCH(OrthonormalizeN, n);
+    float* data = reinterpret_cast<float*>(m);
+    const size_t stride = sizeof(RotationMatrix) / sizeof(float);
+    parallelForGroups(n, kSimdWidth, cacheChunk(18 * sizeof(float)), [&](size_t i, size_t count) {
+        SimdFloat r[9];
+        simdLoadFields(data + stride * i, stride, 9, count, r);
+        
+        SimdFloat halfError = simdMul(simdSet(0.5f), simdMadd(r[2], r[5], simdMadd(r[1], r[4], simdMul(r[0], r[3]))));
+        SimdFloat x1 = simdNmadd(halfError, r[3], r[0]);
+        SimdFloat y1 = simdNmadd(halfError, r[4], r[1]);
+        SimdFloat z1 = simdNmadd(halfError, r[5], r[2]);
+        SimdFloat x2 = simdNmadd(halfError, r[0], r[3]);
+        SimdFloat y2 = simdNmadd(halfError, r[1], r[4]);
+        SimdFloat z2 = simdNmadd(halfError, r[2], r[5]);
+        normalizeRow(x1, y1, z1);
+        normalizeRow(x2, y2, z2);
+        
+        SimdFloat x3 = simdNmadd(z1, y2, simdMul(y1, z2));
+        SimdFloat y3 = simdNmadd(x1, z2, simdMul(z1, x2));
+        SimdFloat z3 = simdNmadd(y1, x2, simdMul(x1, y2));
+        normalizeRow(x3, y3, z3);
+        
+        r[0] = x1; r[1] = y1; r[2] = z1;
+        r[3] = x2; r[4] = y2; r[5] = z2;
+        r[6] = x3; r[7] = y3; r[8] = z3;
+        simdStoreFields(data + stride * i, stride, 9, count, r);
+    });
+}
+
+/*
+    批量旋转向量
+    物体-惯性变换用矩阵的行与向量点乘，惯性-物体变换用矩阵的列，即转置
+    r按结果的x、y、z依次存放3个系数，两种变换共用同一个计算，只是读入矩阵的顺序不同
+ */
+static const int kRowOrder[9] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+static const int kColumnOrder[9] = { 0, 3, 6, 1, 4, 7, 2, 5, 8 };
+
+static inline void simdTransform(const SimdFloat* r, SimdFloat& x, SimdFloat& y, SimdFloat& z) {
+    SimdFloat ox = simdMadd(r[2], z, simdMadd(r[1], y, simdMul(r[0], x)));
+    SimdFloat oy = simdMadd(r[5], z, simdMadd(r[4], y, simdMul(r[3], x)));
+    SimdFloat oz = simdMadd(r[8], z, simdMadd(r[7], y, simdMul(r[6], x)));
+    x = ox;
+    y = oy;
+    z = oz;
+}
+
+// 矩阵的每个元素广播到一个寄存器中，AoS数组在寄存器中转置为x、y、z三组，不足一组的尾部逐个计算
+static void transformN(const RotationMatrix& m, const Vector3* in, Vector3* out, size_t n, bool transpose) {
+    const float* e = &m.m11;
+    const int* order = transpose ? kColumnOrder : kRowOrder;
+    SimdFloat r[9];
+    for (int k = 0; k < 9; ++k) {
+        r[k] = simdSet(e[order[k]]);
+    }
+    const float* src = reinterpret_cast<const float*>(in);
+    float* dst = reinterpret_cast<float*>(out);
+    parallelFor(n, cacheChunk(6 * sizeof(float)), [&](size_t begin, size_t end) {
+        size_t i = begin;
+        for (; i + kSimdWidth <= end; i += kSimdWidth) {
+            SimdFloat x, y, z;
+            simdLoadVector3(src + 3 * i, x, y, z);
+            simdTransform(r, x, y, z);
+            simdStoreVector3(dst + 3 * i, x, y, z);
+        }
+        for (; i < end; ++i) {
+            out[i] = transpose ? m.inertialToObject(in[i]) : m.objectToInertial(in[i]);
+        }
+    });
+}
+
+// SoA形式，补齐部分为0，旋转后仍为0，可以整组计算
+static void transformN(const RotationMatrix& m, const Vector3Stream& in, Vector3Stream& out, bool transpose) {
+    out.resize(in.size());
+    const float* e = &m.m11;
+    const int* order = transpose ? kColumnOrder : kRowOrder;
+    SimdFloat r[9];
+    for (int k = 0; k < 9; ++k) {
+        r[k] = simdSet(e[order[k]]);
+    }
+    parallelFor(in.size(), cacheChunk(6 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            SimdFloat x = simdLoad(in.x() + i), y = simdLoad(in.y() + i), z = simdLoad(in.z() + i);
+            simdTransform(r, x, y, z);
+            simdStore(out.x() + i, x);
+            simdStore(out.y() + i, y);
+            simdStore(out.z() + i, z);
+        }
+    });
+}
+
+/*
+    每个通道读入各自的矩阵，矩阵数组按9个float的步长转置到寄存器中
+    惯性-物体变换在寄存器中交换行列，不需要重新读取
+ */
+static void transformN(const RotationMatrix* m, const Vector3* in, Vector3* out, size_t n, bool transpose) {
+    const float* matrices = reinterpret_cast<const float*>(m);
+    const float* src = reinterpret_cast<const float*>(in);
+    float* dst = reinterpret_cast<float*>(out);
+    const size_t stride = sizeof(RotationMatrix) / sizeof(float);
+    parallelFor(n, cacheChunk(15 * sizeof(float)), [&](size_t begin, size_t end) {
+        size_t i = begin;
+        for (; i + kSimdWidth <= end; i += kSimdWidth) {
+            SimdFloat r[9], x, y, z;
+            simdLoadFields(matrices + stride * i, stride, 9, kSimdWidth, r);
+            if (transpose) {
+                SimdFloat t;
+                t = r[1]; r[1] = r[3]; r[3] = t;
+                t = r[2]; r[2] = r[6]; r[6] = t;
+                t = r[5]; r[5] = r[7]; r[7] = t;
+            }
+            simdLoadVector3(src + 3 * i, x, y, z);
+            simdTransform(r, x, y, z);
+            simdStoreVector3(dst + 3 * i, x, y, z);
+        }
+        for (; i < end; ++i) {
+            out[i] = transpose ? m[i].inertialToObject(in[i]) : m[i].objectToInertial(in[i]);
+        }
+    });
+}
+
+void inertialToObjectN(const RotationMatrix& m, const Vector3* in, Vector3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(InertialToObjectN, n);
+    transformN(m, in, out, n, true);
+}
+
+void objectToInertialN(const RotationMatrix& m, const Vector3* in, Vector3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(ObjectToInertialN, n);
+    transformN(m, in, out, n, false);
+}
+
+void inertialToObjectN(const RotationMatrix& m, const Vector3Stream& in, Vector3Stream& out) {
+    MATH_INSTRUMENT_BATCH(InertialToObjectNStream, in.size());
+    transformN(m, in, out, true);
+}
+
+void objectToInertialN(const RotationMatrix& m, const Vector3Stream& in, Vector3Stream& out) {
+    MATH_INSTRUMENT_BATCH(ObjectToInertialNStream, in.size());
+    transformN(m, in, out, false);
+}
+
+void inertialToObjectN(const RotationMatrix* m, const Vector3* in, Vector3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(InertialToObjectNPerVector, n);
+    transformN(m, in, out, n, true);
+}
+
+void objectToInertialN(const RotationMatrix* m, const Vector3* in, Vector3* out, size_t n) {
+    MATH_INSTRUMENT_BATCH(ObjectToInertialNPerVector, n);
+    transformN(m, in, out, n, false);
 }
@@ -9,9 +9,12 @@
 #ifndef RotationMatrix_hpp
 #define RotationMatrix_hpp
 
+#include <stddef.h>
+
 class Vector3;
 class EulerAngles;
 class Quaternion;
+class Vector3Stream;
 
 // RotationMatrix类
 // 实现了一个3x3的举证， 仅用作旋转矩阵。矩阵假设为正教的，在变换时指定方向。
@@ -38,4 +41,33 @@ public:
     Vector3 objectToInertial(const Vector3& v) const;
 };
 
+/*
+    批量构造旋转矩阵，结果与逐个调用setup/fromInertialToObjectQuaternion/fromObjectToInertialQuaternion相同
+    多个元素在SIMD寄存器中同时计算
+    与setToRotateObjectToInertialN一样受三组sin和cos限制，默认精度下AVX2约为逐个调用的2.7倍，达不到4倍的目标
+ */
+extern void setupN(const EulerAngles* orientations, RotationMatrix* out, size_t n);
+extern void fromInertialToObjectQuaternionN(const Quaternion* q, RotationMatrix* out, size_t n);
+extern void fromObjectToInertialQuaternionN(const Quaternion* q, RotationMatrix* out, size_t n);
+
+/*
+    批量重新正交化，参看9.3.3
+    矩阵经过多次相乘或积分后会偏离正交，前两行各减去对方投影的一半，第三行取前两行的叉乘，三行再各自正则化
+    结果保持原来的手性，误差较大时可以多调用几次
+ */
+extern void orthonormalizeN(RotationMatrix* m, size_t n);
+
+/*
+    批量旋转向量，结果与逐个调用inertialToObject/objectToInertial相同
+    矩阵的9个元素只读入寄存器一次，多个向量同时计算，in和out可以是同一个数组
+ */
+extern void inertialToObjectN(const RotationMatrix& m, const Vector3* in, Vector3* out, size_t n);
+extern void objectToInertialN(const RotationMatrix& m, const Vector3* in, Vector3* out, size_t n);
+extern void inertialToObjectN(const RotationMatrix& m, const Vector3Stream& in, Vector3Stream& out);
+extern void objectToInertialN(const RotationMatrix& m, const Vector3Stream& in, Vector3Stream& out);
+
+// 批量：每个矩阵旋转一个向量，如out[i] = m[i].inertialToObject(in[i])
+extern void inertialToObjectN(const RotationMatrix* m, const Vector3* in, Vector3* out, size_t n);
+extern void objectToInertialN(const RotationMatrix* m, const Vector3* in, Vector3* out, size_t n);
+
 #endif /* RotationMatrix_hpp */
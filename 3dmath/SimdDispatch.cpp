@@ -0,0 +1,226 @@
+//
+//  SimdDispatch.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "SimdDispatch.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#if defined(SIMD_DISPATCH_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+static const char* const kSimdTierNames[kSimdTierCount] = {"scalar", "sse2", "avx2", "avx512", "neon"};
+
+const char* simdTierName(SimdTier tier) {
+    return tier >= 0 && tier < kSimdTierCount ? kSimdTierNames[tier] : "unknown";
+}
+
+bool parseSimdTier(const char* name, SimdTier& tier) {
+    for (int i = 0; i < kSimdTierCount; ++i) {
+        if (strcmp(name, kSimdTierNames[i]) == 0) {
+            tier = (SimdTier)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// CPU检测
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#if defined(SIMD_DISPATCH_X86)
+
+// 执行CPUID，结果依次为eax、ebx、ecx、edx
+static void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; ++i) {
+        regs[i] = (unsigned)r[i];
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// 读XCR0，其中的位表示操作系统在上下文切换时保存哪些寄存器
+static unsigned long long readXcr0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+/*
+    CPU支持某个指令集还不够，操作系统也要保存对应的寄存器，否则线程切换后寄存器的内容会丢失：
+    AVX需要XCR0的第1、2位（XMM、YMM），AVX-512还需要第5、6、7位（掩码寄存器和ZMM）
+    读XCR0之前要先确认OSXSAVE位，否则xgetbv指令本身就是非法的
+ */
+static SimdTier detectX86() {
+    unsigned regs[4];
+    cpuid(0, 0, regs);
+    unsigned maxLeaf = regs[0];
+    if (maxLeaf < 1) {
+        return kSimdTierScalar;
+    }
+
+    cpuid(1, 0, regs);
+    bool sse2 = (regs[3] & (1u << 26)) != 0;
+    bool fma = (regs[2] & (1u << 12)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+    if (!sse2) {
+        return kSimdTierScalar;
+    }
+    if (!fma || !osxsave || !avx || maxLeaf < 7) {
+        return kSimdTierSSE2;
+    }
+
+    unsigned long long xcr0 = readXcr0();
+    if ((xcr0 & 0x6) != 0x6) {
+        return kSimdTierSSE2;
+    }
+
+    cpuid(7, 0, regs);
+    bool avx2 = (regs[1] & (1u << 5)) != 0;
+    bool avx512f = (regs[1] & (1u << 16)) != 0;
+    bool avx512dq = (regs[1] & (1u << 17)) != 0;
+    if (!avx2) {
+        return kSimdTierSSE2;
+    }
+    if (!avx512f || !avx512dq || (xcr0 & 0xe6) != 0xe6) {
+        return kSimdTierAVX2;
+    }
+    return kSimdTierAVX512;
+}
+
+#endif
+
+SimdTier detectSimdTier() {
+#if defined(SIMD_DISPATCH_X86)
+    static const SimdTier detected = detectX86();
+    return detected;
+#elif defined(SIMD_DISPATCH_NEON)
+    return kSimdTierNEON;
+#else
+    return kSimdTierScalar;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// 核函数表
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// tier对应的核函数表，没有编译进程序时返回NULL
+static const SimdKernels* kernelTable(SimdTier tier) {
+    switch (tier) {
+        case kSimdTierScalar:
+            return &kSimdKernelsScalar;
+#if defined(SIMD_DISPATCH_X86)
+        case kSimdTierSSE2:
+            return &kSimdKernelsSSE2;
+        case kSimdTierAVX2:
+            return &kSimdKernelsAVX2;
+        case kSimdTierAVX512:
+            return &kSimdKernelsAVX512;
+#elif defined(SIMD_DISPATCH_NEON)
+        case kSimdTierNEON:
+            return &kSimdKernelsNEON;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+bool simdTierSupported(SimdTier tier) {
+    if (kernelTable(tier) == NULL) {
+        return false;
+    }
+    // x86的各级依次包含前一级，NEON只在AArch64上编译
+    return tier <= detectSimdTier();
+}
+
+// tier是否属于编译目标的架构，只按标量编译时只有标量一级
+static bool nativeTier(SimdTier tier) {
+#if defined(SIMD_DISPATCH_X86)
+    return tier >= kSimdTierScalar && tier <= kSimdTierAVX512;
+#elif defined(SIMD_DISPATCH_NEON)
+    return tier == kSimdTierScalar || tier == kSimdTierNEON;
+#else
+    return tier == kSimdTierScalar;
+#endif
+}
+
+/*
+    不超过tier的最高一级，标量版本总是支持的
+    枚举中NEON排在AVX-512之后，但两者不是包含关系：其他架构的一级直接使用标量版本，
+    否则x86上指定neon会落到avx512
+ */
+static SimdTier supportedTier(SimdTier tier) {
+    if (!nativeTier(tier)) {
+        return kSimdTierScalar;
+    }
+    for (int t = tier; t > kSimdTierScalar; --t) {
+        if (simdTierSupported((SimdTier)t)) {
+            return (SimdTier)t;
+        }
+    }
+    return kSimdTierScalar;
+}
+
+// 正在使用的核函数表，第一次使用前为NULL
+static std::atomic<const SimdKernels*> activeKernels(NULL);
+
+// 检测CPU，再按环境变量调整
+static const SimdKernels* initialKernels() {
+    SimdTier tier = detectSimdTier();
+    const char* name = getenv(SIMD_TIER_ENVIRONMENT);
+    SimdTier requested;
+    if (name != NULL && parseSimdTier(name, requested)) {
+        tier = supportedTier(requested);
+    }
+    return kernelTable(tier);
+}
+
+const SimdKernels& simdKernels() {
+    const SimdKernels* kernels = activeKernels.load(std::memory_order_acquire);
+    if (kernels == NULL) {
+        // 局部静态变量的初始化只执行一次，多个线程同时第一次调用时也是安全的
+        static const SimdKernels* initial = initialKernels();
+        const SimdKernels* expected = NULL;
+        activeKernels.compare_exchange_strong(expected, initial, std::memory_order_acq_rel);
+        kernels = activeKernels.load(std::memory_order_acquire);
+    }
+    return *kernels;
+}
+
+SimdTier activeSimdTier() {
+    return simdKernels().tier;
+}
+
+SimdTier setSimdTier(SimdTier tier) {
+    // 先完成初始化，之后不会再被环境变量覆盖
+    simdKernels();
+    const SimdKernels* kernels = kernelTable(supportedTier(tier));
+    activeKernels.store(kernels, std::memory_order_release);
+    return kernels->tier;
+}
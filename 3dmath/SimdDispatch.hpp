@@ -0,0 +1,106 @@
+//
+//  SimdDispatch.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef SimdDispatch_hpp
+#define SimdDispatch_hpp
+
+#include <stddef.h>
+
+/*
+    批量核函数的运行时指令集分派
+    SimdUtil.h在编译时选择指令集，整个程序只能按一种-march编译：选低了用不上新CPU的指令，选高了在旧CPU上崩溃
+    最常用的几个批量核函数（点和方向的变换、四元数到矩阵的转换、快速slerp、SoA向量的标准化）
+    按每一级指令集各编译一份（SimdKernelsXXX.cpp），第一次使用时用CPUID检测CPU和操作系统支持的指令集，
+    选出最高的一级，之后所有调用都通过同一张函数表
+    标量版本与Vector3、Matrix4x3的逐个计算使用相同的公式和运算次序
+    定义SIMD_FORCE_SCALAR时只有标量版本
+ */
+
+#if !defined(SIMD_FORCE_SCALAR) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define SIMD_DISPATCH_X86 1
+#elif !defined(SIMD_FORCE_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+#define SIMD_DISPATCH_NEON 1
+#endif
+
+// 指令集的级别，x86上的各级依次包含前一级；NEON是另一种架构，与x86的各级没有高低关系
+enum SimdTier {
+    kSimdTierScalar,
+    kSimdTierSSE2,
+    // AVX2和FMA
+    kSimdTierAVX2,
+    // AVX-512F和AVX-512DQ
+    kSimdTierAVX512,
+    kSimdTierNEON,
+    kSimdTierCount
+};
+
+/*
+    指定使用的指令集的环境变量，取值为scalar、sse2、avx2、avx512、neon，用于测试和对比
+    指定的一级不受支持时使用同一架构中不超过它的最高一级，其他架构的一级（如x86上的neon）使用标量版本，
+    无法识别的取值被忽略
+ */
+#define SIMD_TIER_ENVIRONMENT "MATH3D_SIMD"
+
+// 名字和级别互相转换，名字就是环境变量的取值
+extern const char* simdTierName(SimdTier tier);
+extern bool parseSimdTier(const char* name, SimdTier& tier);
+
+// 当前CPU支持并且编译进了程序的指令集
+extern bool simdTierSupported(SimdTier tier);
+
+// 支持的最高一级，只在第一次调用时检测
+extern SimdTier detectSimdTier();
+
+// 正在使用的一级
+extern SimdTier activeSimdTier();
+
+/*
+    改为使用tier，不支持时使用同一架构中不超过它的最高一级，其他架构的一级使用标量版本
+    返回实际使用的一级，调用者可以据此判断是否如愿；不要在批量运算进行时调用
+ */
+extern SimdTier setSimdTier(SimdTier tier);
+
+/*
+    一级指令集的核函数表
+    矩阵参数m是Matrix4x3开头的12个float（m11到m33，tx、ty、tz），向量和四元数数组都是紧密排列的float
+    SoA的分量数组要按kSimdAlignment对齐，并且可以读写到n补齐到16的整数倍为止（参看Vector3Stream）
+ */
+struct SimdKernels {
+    SimdTier tier;
+
+    // AoS数组中的n个点或方向向量乘以矩阵，translate为false时忽略平移，out可以与in相同
+    void (*transformVector3)(const float* m, const float* in, float* out, size_t n, bool translate);
+
+    // SoA形式，补齐部分也会被写入
+    void (*transformStream)(const float* m, const float* x, const float* y, const float* z,
+                            float* outX, float* outY, float* outZ, size_t n, bool translate);
+
+    // 四元数（w,x,y,z）转换为矩阵，写入每个矩阵开头的12个float，矩阵之间相隔stride个float
+    void (*fromQuaternion)(const float* q, float* out, size_t stride, size_t n);
+
+    // slerpN的快速模式，四元数为w,x,y,z
+    void (*slerpFast)(const float* a, const float* b, const float* t, float* out, size_t n);
+
+    // SoA向量就地标准化，零向量保持不变
+    void (*normalizeStream)(float* x, float* y, float* z, size_t n);
+};
+
+// 正在使用的核函数表
+extern const SimdKernels& simdKernels();
+
+// 各级的核函数表，只在对应的平台上定义
+extern const SimdKernels kSimdKernelsScalar;
+#if defined(SIMD_DISPATCH_X86)
+extern const SimdKernels kSimdKernelsSSE2;
+extern const SimdKernels kSimdKernelsAVX2;
+extern const SimdKernels kSimdKernelsAVX512;
+#elif defined(SIMD_DISPATCH_NEON)
+extern const SimdKernels kSimdKernelsNEON;
+#endif
+
+#endif /* SimdDispatch_hpp */
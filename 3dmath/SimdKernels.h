@@ -0,0 +1,236 @@
+//
+//  SimdKernels.h
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef SimdKernels_h
+#define SimdKernels_h
+
+#include "SimdDispatch.hpp"
+#include "SimdUtil.h"
+
+/*
+    运行时分派的批量核函数的实现，参看SimdDispatch.hpp
+    每个SimdKernelsXXX.cpp选定指令集后包含一次，按该指令集的kSimdWidth编译出一份，再填入自己的核函数表
+    这里只能使用SimdUtil.h：其他头文件中的内联函数在这里会按更高的指令集编译，
+    链接时可能被选作整个程序共用的版本，在不支持该指令集的CPU上执行到非法指令
+    同样的原因，包含它的源文件要在打开指令集之前先包含SimdUtil.h用到的标准库头文件
+ */
+
+/*
+    批量变换点或方向向量
+    矩阵的12个元素各广播到一个寄存器中，只读一次，之后每次处理kSimdWidth个向量
+    AoS数组在寄存器中转置为x、y、z三组，不足一组的尾部逐个变换
+    运算次序与Vector3 * Matrix4x3相同：(x * m11 + y * m21 + z * m31) + tx，编译器不把乘加合并为FMA时，标量版本的结果与它逐位相同
+ */
+static void transformVector3Kernel(const float* m, const float* in, float* out, size_t n, bool translate) {
+    SimdFloat m11 = simdSet(m[0]), m12 = simdSet(m[1]), m13 = simdSet(m[2]);
+    SimdFloat m21 = simdSet(m[3]), m22 = simdSet(m[4]), m23 = simdSet(m[5]);
+    SimdFloat m31 = simdSet(m[6]), m32 = simdSet(m[7]), m33 = simdSet(m[8]);
+    SimdFloat tx = simdSet(translate ? m[9] : 0.0f);
+    SimdFloat ty = simdSet(translate ? m[10] : 0.0f);
+    SimdFloat tz = simdSet(translate ? m[11] : 0.0f);
+
+    size_t i = 0;
+    for (; i + kSimdWidth <= n; i += kSimdWidth) {
+        SimdFloat x, y, z;
+        simdLoadVector3(in + 3 * i, x, y, z);
+        SimdFloat rx = simdAdd(simdMadd(z, m31, simdMadd(y, m21, simdMul(x, m11))), tx);
+        SimdFloat ry = simdAdd(simdMadd(z, m32, simdMadd(y, m22, simdMul(x, m12))), ty);
+        SimdFloat rz = simdAdd(simdMadd(z, m33, simdMadd(y, m23, simdMul(x, m13))), tz);
+        simdStoreVector3(out + 3 * i, rx, ry, rz);
+    }
+
+    for (; i < n; ++i) {
+        const float* p = in + 3 * i;
+        float x = p[0] * m[0] + p[1] * m[3] + p[2] * m[6];
+        float y = p[0] * m[1] + p[1] * m[4] + p[2] * m[7];
+        float z = p[0] * m[2] + p[1] * m[5] + p[2] * m[8];
+        if (translate) {
+            x += m[9];
+            y += m[10];
+            z += m[11];
+        }
+        out[3 * i] = x;
+        out[3 * i + 1] = y;
+        out[3 * i + 2] = z;
+    }
+}
+
+// SoA形式，分量数组已经对齐并补齐，可以直接按整个寄存器处理
+static void transformStreamKernel(const float* m, const float* x, const float* y, const float* z,
+                                  float* outX, float* outY, float* outZ, size_t n, bool translate) {
+    SimdFloat m11 = simdSet(m[0]), m12 = simdSet(m[1]), m13 = simdSet(m[2]);
+    SimdFloat m21 = simdSet(m[3]), m22 = simdSet(m[4]), m23 = simdSet(m[5]);
+    SimdFloat m31 = simdSet(m[6]), m32 = simdSet(m[7]), m33 = simdSet(m[8]);
+    SimdFloat tx = simdSet(translate ? m[9] : 0.0f);
+    SimdFloat ty = simdSet(translate ? m[10] : 0.0f);
+    SimdFloat tz = simdSet(translate ? m[11] : 0.0f);
+
+    for (size_t i = 0; i < n; i += kSimdWidth) {
+        SimdFloat vx = simdLoad(x + i), vy = simdLoad(y + i), vz = simdLoad(z + i);
+        simdStore(outX + i, simdAdd(simdMadd(vz, m31, simdMadd(vy, m21, simdMul(vx, m11))), tx));
+        simdStore(outY + i, simdAdd(simdMadd(vz, m32, simdMadd(vy, m22, simdMul(vx, m12))), ty));
+        simdStore(outZ + i, simdAdd(simdMadd(vz, m33, simdMadd(vy, m23, simdMul(vx, m13))), tz));
+    }
+}
+
+/*
+    从四元数构造矩阵，参看10.6.3
+    公式和运算次序与Matrix4x3::fromQuaternion相同，3x3部分和平移一起写出
+ */
+template <typename V, typename Madd, typename Nmadd, typename Mul>
+static inline void fromQuaternionFields(const V* f, V one, V two, V zero, V* m, Madd madd, Nmadd nmadd, Mul mul) {
+    V ww = mul(two, f[0]), xx = mul(two, f[1]), yy = mul(two, f[2]), zz = mul(two, f[3]);
+    m[0] = nmadd(zz, f[3], nmadd(yy, f[2], one));
+    m[1] = madd(ww, f[3], mul(xx, f[2]));
+    m[2] = nmadd(ww, f[2], mul(xx, f[3]));
+    m[3] = nmadd(ww, f[3], mul(xx, f[2]));
+    m[4] = nmadd(zz, f[3], nmadd(xx, f[1], one));
+    m[5] = madd(ww, f[1], mul(yy, f[3]));
+    m[6] = madd(ww, f[2], mul(xx, f[3]));
+    m[7] = nmadd(ww, f[1], mul(yy, f[3]));
+    m[8] = nmadd(yy, f[2], nmadd(xx, f[1], one));
+    m[9] = m[10] = m[11] = zero;
+}
+
+static void fromQuaternionKernel(const float* q, float* out, size_t stride, size_t n) {
+    size_t i = 0;
+#if defined(SIMD_AVX) || defined(SIMD_AVX512)
+    /*
+        计算只有十几条乘加，时间几乎都花在AoS的转置上
+        8路和16路要先拆成4个一组再转置，拆分与转置争用同一个执行端口，整组按8路处理时比SSE2还慢约35%，
+        所以这里按4路转置和计算，只比SSE2多用FMA
+     */
+    __m128 one4 = _mm_set1_ps(1.0f), two4 = _mm_set1_ps(2.0f), zero4 = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 f[4], m[12];
+        simdLoadFieldsx4(q + 4 * i, 4, 4, f);
+        fromQuaternionFields(f, one4, two4, zero4, m,
+                             [](__m128 a, __m128 b, __m128 c) { return _mm_fmadd_ps(a, b, c); },
+                             [](__m128 a, __m128 b, __m128 c) { return _mm_fnmadd_ps(a, b, c); },
+                             [](__m128 a, __m128 b) { return _mm_mul_ps(a, b); });
+        simdStoreFieldsx4(out + stride * i, stride, 12, m);
+    }
+#endif
+    for (; i < n; i += kSimdWidth) {
+        size_t count = n - i < (size_t)kSimdWidth ? n - i : (size_t)kSimdWidth;
+        SimdFloat f[4], m[12];
+        simdLoadFields(q + 4 * i, 4, 4, count, f);
+        fromQuaternionFields(f, simdSet(1.0f), simdSet(2.0f), simdZero(), m, simdMadd, simdNmadd, simdMul);
+        simdStoreFields(out + stride * i, stride, 12, count, m);
+    }
+}
+
+/*
+    快速slerp，参看David Eberly, "A Fast and Accurate Algorithm for Computing SLERP"
+    令x = cos(omega)，则插值系数sin(t * omega) / sin(omega)可以展开为关于(x - 1)的级数：
+    t * (1 + b1 * (1 + b2 * (1 + ...)))，其中bi = (ui * t^2 - vi) * (x - 1)
+    ui = 1 / (i * (2i + 1))，vi = i / (2i + 1)，取前8项，最后一项乘以修正系数mu以补偿截断误差
+    只需要乘加运算，没有三角函数、开方和除法，适合SIMD
+ */
+static const float kSlerpMu = 1.85298109240830f;
+static const float kSlerpU[8] = {
+    1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9),
+    1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15), kSlerpMu / (8 * 17)
+};
+static const float kSlerpV[8] = {
+    1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9,
+    5.0f / 11, 6.0f / 13, 7.0f / 15, kSlerpMu * 8 / 17
+};
+
+// 计算多项式系数t * (1 + b1 * (1 + b2 * (...)))
+static inline SimdFloat slerpCoefficient(SimdFloat t, SimdFloat xm1) {
+    SimdFloat sqrT = simdMul(t, t);
+    SimdFloat one = simdSet(1.0f);
+    SimdFloat f = one;
+    for (int i = 7; i >= 0; --i) {
+        SimdFloat b = simdMul(simdSub(simdMul(simdSet(kSlerpU[i]), sqrT), simdSet(kSlerpV[i])), xm1);
+        f = simdMadd(b, f, one);
+    }
+    return simdMul(t, f);
+}
+
+/*
+    处理kSimdWidth个插值，四元数在寄存器中转置为w、x、y、z四组
+    边界和接近的情况与slerp()一致：t < 0返回q0，t >= 1返回q1，夹角cos > 0.9999时使用线性插值
+ */
+static inline void slerpFastBlock(const float* q0, const float* q1, const float* tp, float* out) {
+    SimdFloat aw, ax, ay, az, bw, bx, by, bz;
+    simdLoadFloat4(q0, aw, ax, ay, az);
+    simdLoadFloat4(q1, bw, bx, by, bz);
+    SimdFloat t = simdLoadU(tp);
+    SimdFloat one = simdSet(1.0f);
+    SimdFloat zero = simdZero();
+
+    // 点乘为负时使用-q1，沿锐角插值
+    SimdFloat cosOmega = simdMadd(az, bz, simdMadd(ay, by, simdMadd(ax, bx, simdMul(aw, bw))));
+    SimdMask negative = simdCmpLt(cosOmega, zero);
+    SimdFloat sign = simdSelect(negative, simdNeg(one), one);
+    cosOmega = simdAbs(cosOmega);
+
+    SimdFloat xm1 = simdSub(cosOmega, one);
+    SimdFloat d = simdSub(one, t);
+    SimdFloat k0 = slerpCoefficient(d, xm1);
+    SimdFloat k1 = slerpCoefficient(t, xm1);
+
+    // 非常接近时使用线性插值
+    SimdMask near = simdCmpGt(cosOmega, simdSet(0.9999f));
+    k0 = simdSelect(near, d, k0);
+    k1 = simdMul(simdSelect(near, t, k1), sign);
+
+    SimdFloat rw = simdMadd(k1, bw, simdMul(k0, aw));
+    SimdFloat rx = simdMadd(k1, bx, simdMul(k0, ax));
+    SimdFloat ry = simdMadd(k1, by, simdMul(k0, ay));
+    SimdFloat rz = simdMadd(k1, bz, simdMul(k0, az));
+
+    // 参数边界
+    SimdMask before = simdCmpLt(t, zero);
+    SimdMask after = simdCmpGe(t, one);
+    rw = simdSelect(after, bw, simdSelect(before, aw, rw));
+    rx = simdSelect(after, bx, simdSelect(before, ax, rx));
+    ry = simdSelect(after, by, simdSelect(before, ay, ry));
+    rz = simdSelect(after, bz, simdSelect(before, az, rz));
+
+    simdStoreFloat4(out, rw, rx, ry, rz);
+}
+
+static void slerpFastKernel(const float* a, const float* b, const float* t, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + kSimdWidth <= n; i += kSimdWidth) {
+        slerpFastBlock(a + 4 * i, b + 4 * i, t + i, out + 4 * i);
+    }
+
+    // 尾部复制到临时缓冲中，补齐一组后用同样的方法计算
+    if (i < n) {
+        size_t rest = n - i;
+        float ta[4 * kSimdWidth] = {0}, tb[4 * kSimdWidth] = {0}, tt[kSimdWidth] = {0}, tr[4 * kSimdWidth];
+        memcpy(ta, a + 4 * i, rest * 4 * sizeof(float));
+        memcpy(tb, b + 4 * i, rest * 4 * sizeof(float));
+        memcpy(tt, t + i, rest * sizeof(float));
+        slerpFastBlock(ta, tb, tt, tr);
+        memcpy(out + 4 * i, tr, rest * 4 * sizeof(float));
+    }
+}
+
+/*
+    SoA向量标准化，用rsqrt加一次牛顿迭代代替1/sqrt（标量版本就是1/sqrt，与Vector3::normalize相同）
+    模为0的通道（包括补齐部分）保持原值不变
+ */
+static void normalizeStreamKernel(float* x, float* y, float* z, size_t n) {
+    SimdFloat zero = simdZero();
+    for (size_t i = 0; i < n; i += kSimdWidth) {
+        SimdFloat vx = simdLoad(x + i), vy = simdLoad(y + i), vz = simdLoad(z + i);
+        SimdFloat magSq = simdMadd(vz, vz, simdMadd(vy, vy, simdMul(vx, vx)));
+        SimdMask nonZero = simdCmpGt(magSq, zero);
+        SimdFloat oneOverMag = simdSelect(nonZero, simdRsqrt(magSq), simdSet(1.0f));
+        simdStore(x + i, simdMul(vx, oneOverMag));
+        simdStore(y + i, simdMul(vy, oneOverMag));
+        simdStore(z + i, simdMul(vz, oneOverMag));
+    }
+}
+
+#endif /* SimdKernels_h */
@@ -0,0 +1,45 @@
+//
+//  SimdKernelsAVX2.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "SimdDispatch.hpp"
+
+#if defined(SIMD_DISPATCH_X86)
+
+// AVX2和FMA版本，8路
+#include <stddef.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+#define SIMD_TARGET_AVX2 1
+#include "SimdKernels.h"
+
+const SimdKernels kSimdKernelsAVX2 = {
+    kSimdTierAVX2,
+    transformVector3Kernel,
+    transformStreamKernel,
+    fromQuaternionKernel,
+    slerpFastKernel,
+    normalizeStreamKernel
+};
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
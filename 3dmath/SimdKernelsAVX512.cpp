@@ -0,0 +1,45 @@
+//
+//  SimdKernelsAVX512.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "SimdDispatch.hpp"
+
+#if defined(SIMD_DISPATCH_X86)
+
+// AVX-512版本，16路，需要AVX-512F和AVX-512DQ
+#include <stddef.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f,avx512dq,avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq,avx2,fma")
+#endif
+
+#define SIMD_TARGET_AVX512 1
+#include "SimdKernels.h"
+
+const SimdKernels kSimdKernelsAVX512 = {
+    kSimdTierAVX512,
+    transformVector3Kernel,
+    transformStreamKernel,
+    fromQuaternionKernel,
+    slerpFastKernel,
+    normalizeStreamKernel
+};
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+//
+//  SimdKernelsNEON.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "SimdDispatch.hpp"
+
+#if defined(SIMD_DISPATCH_NEON)
+
+// NEON版本，4路，AArch64上NEON总是可用，按编译选项编译即可
+#include "SimdKernels.h"
+
+const SimdKernels kSimdKernelsNEON = {
+    kSimdTierNEON,
+    transformVector3Kernel,
+    transformStreamKernel,
+    fromQuaternionKernel,
+    slerpFastKernel,
+    normalizeStreamKernel
+};
+
+#endif
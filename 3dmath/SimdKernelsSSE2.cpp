@@ -0,0 +1,45 @@
+//
+//  SimdKernelsSSE2.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "SimdDispatch.hpp"
+
+#if defined(SIMD_DISPATCH_X86)
+
+// SSE2版本，4路
+#include <stddef.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+#define SIMD_TARGET_SSE2 1
+#include "SimdKernels.h"
+
+const SimdKernels kSimdKernelsSSE2 = {
+    kSimdTierSSE2,
+    transformVector3Kernel,
+    transformStreamKernel,
+    fromQuaternionKernel,
+    slerpFastKernel,
+    normalizeStreamKernel
+};
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
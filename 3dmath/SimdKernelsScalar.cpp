@@ -0,0 +1,22 @@
+//
+//  SimdKernelsScalar.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "SimdDispatch.hpp"
+
+// 标量版本，SimdUtil.h退化为1路，结果与Vector3、Matrix4x3的逐个计算相同
+#define SIMD_FORCE_SCALAR 1
+#include "SimdKernels.h"
+
+const SimdKernels kSimdKernelsScalar = {
+    kSimdTierScalar,
+    transformVector3Kernel,
+    transformStreamKernel,
+    fromQuaternionKernel,
+    slerpFastKernel,
+    normalizeStreamKernel
+};
@@ -0,0 +1,323 @@
+//
+//  SimdMath.h
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef SimdMath_h
+#define SimdMath_h
+
+#include <float.h>
+#include "MathUtil.h"
+#include "SimdUtil.h"
+
+/*
+    SIMD版本的三角函数和开方，一次计算kSimdWidth个值
+    与MathUtil.h中的标量版本使用相同的多项式和精度等级（MATH_ACCURACY）
+    MATH_ACCURACY_FULL时标量版本调用标准库函数，这里借助double计算：sin和cos在double中约简后求float多项式，
+    与正确舍入的结果最多相差2 ulp；asin、acos和atan2全部在double中计算，最后舍入一次，最多相差1 ulp
+ */
+
+// 求值多项式，coef按从高到低的次序排列
+template <size_t N>
+static inline SimdFloat simdPolyEval(const float (&coef)[N], SimdFloat x) {
+    SimdFloat r = simdSet(coef[0]);
+    for (size_t i = 1; i < N; ++i) {
+        r = simdMadd(r, x, simdSet(coef[i]));
+    }
+    return r;
+}
+
+// 逐个通道调用标量函数
+template <typename F>
+static inline SimdFloat simdPerLane(SimdFloat a, F f) {
+    float v[kSimdWidth];
+    simdStoreU(v, a);
+    for (int i = 0; i < kSimdWidth; ++i) {
+        v[i] = f(v[i]);
+    }
+    return simdLoadU(v);
+}
+
+// 舍入到最接近的整数，|a| < 2^22时有效，参看kRoundMagic
+static inline SimdFloat simdRoundSmall(SimdFloat a) {
+    SimdFloat magic = simdSet(kRoundMagic);
+    return simdSub(simdAdd(a, magic), magic);
+}
+
+// 通过增加适当的2pi倍数将角度限制在-pi到pi的区间内
+static inline SimdFloat simdWrapPi(SimdFloat theta) {
+    SimdFloat pi = simdSet(kPi);
+    theta = simdAdd(theta, pi);
+    theta = simdNmadd(simdFloor(simdMul(theta, simdSet(k1Over2Pi))), simdSet(k2Pi), theta);
+    return simdSub(theta, pi);
+}
+
+#if MATH_ACCURACY == MATH_ACCURACY_FULL && !defined(SIMD_SCALAR)
+/*
+    MATH_ACCURACY_FULL的区间约简在double中进行，得到的r只在转换回float时舍入一次
+    pi/2分成两部分（fdlibm的pio2_1和pio2_1t），第一部分只有33位有效数字，|q| < 2^20时q * kPiOver2High没有舍入误差
+    float的三段约简在|theta|约500以上、theta接近pi/2的倍数时误差达到上百ulp，这里与|theta|无关
+ */
+const double kPiOver2High = 1.57079632673412561417e+00;
+const double kPiOver2Low = 6.07710050650619224932e-11;
+
+static inline SimdDouble simdReducePiOver2D(SimdDouble theta, SimdDouble q) {
+    SimdDouble r = simdMaddD(q, simdSetD(-kPiOver2High), theta);
+    return simdMaddD(q, simdSetD(-kPiOver2Low), r);
+}
+
+/*
+    MATH_ACCURACY_FULL的asin、acos和atan2在double中求泰勒级数，最后舍入一次，与正确舍入的结果最多相差1 ulp
+    asin的参数约简到[0, 0.5]，atan约简到[-tan(pi/8), tan(pi/8)]，截断误差都在float的0.1 ulp以下
+    走哪个分支在float中用比较决定，再把掩码转换为0或1的系数在double中相乘，乘以0或1没有舍入误差
+ */
+const double kPiD = 3.14159265358979323846;
+const double kPiOver2D = 1.57079632679489661923;
+const double kPiOver4D = 0.78539816339744830962;
+const double kAsinCoefFull[] = {
+    88179.0 / 12058624.0, 46189.0 / 5505024.0, 12155.0 / 1245184.0, 6435.0 / 557056.0,
+    143.0 / 10240.0, 231.0 / 13312.0, 63.0 / 2816.0, 35.0 / 1152.0, 5.0 / 112.0, 3.0 / 40.0, 1.0 / 6.0
+};
+const double kAtanCoefFull[] = {
+    -1.0 / 19.0, 1.0 / 17.0, -1.0 / 15.0, 1.0 / 13.0, -1.0 / 11.0, 1.0 / 9.0, -1.0 / 7.0, 1.0 / 5.0, -1.0 / 3.0
+};
+
+template <size_t N>
+static inline SimdDouble simdPolyEvalD(const double (&coef)[N], SimdDouble x) {
+    SimdDouble r = simdSetD(coef[0]);
+    for (size_t i = 1; i < N; ++i) {
+        r = simdMaddD(r, x, simdSetD(coef[i]));
+    }
+    return r;
+}
+
+// 掩码为真的通道为1，否则为0
+static inline void simdMaskToUnitD(SimdMask mask, SimdDouble& lo, SimdDouble& hi) {
+    simdWiden(simdSelect(mask, simdSet(1.0f), simdZero()), lo, hi);
+}
+
+// 1 - 2k，k为0或1
+static inline SimdDouble simdUnitToSignD(SimdDouble k) {
+    return simdMaddD(k, simdSetD(-2.0), simdSetD(1.0));
+}
+
+/*
+    asin(w)或pi/2 - 2 * asin(sqrt(w))，k为1时是后者
+    |x| > 0.5时w = (1 - |x|) / 2，否则w = |x|，两种情况下w在float中都是精确的
+ */
+static inline SimdDouble simdAsinReducedD(SimdDouble w, SimdDouble k) {
+    SimdDouble notK = simdMaddD(k, simdSetD(-1.0), simdSetD(1.0));
+    SimdDouble u = simdMaddD(simdMulD(w, notK), w, simdMulD(k, w));
+    SimdDouble t = simdMaddD(k, simdSqrtD(w), simdMulD(notK, w));
+    SimdDouble p = simdMaddD(simdMulD(t, u), simdPolyEvalD(kAsinCoefFull, u), t);
+    return simdMaddD(p, simdMaddD(k, simdSetD(-3.0), simdSetD(1.0)), simdMulD(k, simdSetD(kPiOver2D)));
+}
+
+// asin(|x|)的前后两半，|x| > 1时为NaN
+static inline void simdAsinAbsD(SimdFloat x, SimdDouble& lo, SimdDouble& hi) {
+    SimdFloat a = simdAbs(x);
+    SimdMask big = simdCmpGt(a, simdSet(0.5f));
+    SimdDouble wLo, wHi, kLo, kHi;
+    simdWiden(simdSelect(big, simdMul(simdSub(simdSet(1.0f), a), simdSet(0.5f)), a), wLo, wHi);
+    simdMaskToUnitD(big, kLo, kHi);
+    lo = simdAsinReducedD(wLo, kLo);
+    hi = simdAsinReducedD(wHi, kHi);
+}
+
+/*
+    atan2的一半：先求较小边与较大边之比的反正切，reduce为1时比值先变换为(a - 1) / (a + 1)再加上pi/4，
+    然后按swap（|y| > |x|）和negative（x < 0）还原到第一、二象限
+ */
+static inline SimdDouble simdAtan2ReducedD(SimdDouble small, SimdDouble big, SimdDouble reduce,
+                                           SimdDouble swap, SimdDouble negative) {
+    SimdDouble num = simdMaddD(simdMulD(reduce, simdSetD(-1.0)), big, small);
+    SimdDouble den = simdMaddD(reduce, small, big);
+    SimdDouble a = simdDivD(num, den);
+    SimdDouble a2 = simdMulD(a, a);
+    SimdDouble angle = simdMaddD(simdMulD(a, a2), simdPolyEvalD(kAtanCoefFull, a2), simdMaddD(reduce, simdSetD(kPiOver4D), a));
+    angle = simdMaddD(angle, simdUnitToSignD(swap), simdMulD(swap, simdSetD(kPiOver2D)));
+    return simdMaddD(angle, simdUnitToSignD(negative), simdMulD(negative, simdSetD(kPiD)));
+}
+#endif
+
+/*
+    同时计算sin和cos：约简到[-pi/4, pi/4]后求多项式，再按象限交换和取反
+    MATH_ACCURACY_FULL用double约简，之后与HIGH共用同一组多项式，|theta| <= kSinCosFullLimit时与正确舍入的结果最多相差2 ulp，
+    更大的角度、无穷大和NaN逐个通道调用标准库函数
+    1路时直接调用标量版本
+ */
+static inline void simdSinCos(SimdFloat theta, SimdFloat& returnSin, SimdFloat& returnCos) {
+#if defined(SIMD_SCALAR)
+    sinCos(&returnSin, &returnCos, theta);
+#else
+    SimdFloat q = simdRoundSmall(simdMul(theta, simdSet(k2OverPi)));
+#if MATH_ACCURACY == MATH_ACCURACY_FULL
+    SimdDouble thetaLo, thetaHi, qLo, qHi;
+    simdWiden(theta, thetaLo, thetaHi);
+    simdWiden(q, qLo, qHi);
+    SimdFloat r = simdNarrow(simdReducePiOver2D(thetaLo, qLo), simdReducePiOver2D(thetaHi, qHi));
+#else
+    SimdFloat r = simdNmadd(q, simdSet(kPiOver2Part1), theta);
+    r = simdNmadd(q, simdSet(kPiOver2Part2), r);
+    r = simdNmadd(q, simdSet(kPiOver2Part3), r);
+#endif
+    SimdFloat r2 = simdMul(r, r);
+    SimdFloat s = simdMadd(simdMul(r, r2), simdPolyEval(kSinCoef, r2), r);
+    SimdFloat c = simdMadd(r2, simdPolyEval(kCosCoef, r2), simdSet(1.0f));
+
+    /*
+        象限用浮点数计算，quadrant = q mod 4，取值为0到3
+        q是整数，q / 4 - 0.375舍入后正好是floor(q / 4)，同理求quadrant的奇偶
+     */
+    SimdFloat quadrant = simdNmadd(simdRoundSmall(simdMadd(q, simdSet(0.25f), simdSet(-0.375f))), simdSet(4.0f), q);
+    SimdFloat half = simdSet(0.5f);
+    SimdFloat odd = simdNmadd(simdRoundSmall(simdMadd(quadrant, half, simdSet(-0.25f))), simdSet(2.0f), quadrant);
+    SimdMask swap = simdCmpGt(odd, half);
+    SimdMask negateSin = simdCmpGt(quadrant, simdSet(1.5f));
+    SimdMask negateCos = simdMaskAnd(simdCmpGt(quadrant, half), simdCmpLt(quadrant, simdSet(2.5f)));
+
+    SimdFloat sinValue = simdSelect(swap, c, s);
+    SimdFloat cosValue = simdSelect(swap, s, c);
+    returnSin = simdSelect(negateSin, simdNeg(sinValue), sinValue);
+    returnCos = simdSelect(negateCos, simdNeg(cosValue), cosValue);
+
+#if MATH_ACCURACY == MATH_ACCURACY_FULL
+    // 比较对NaN不成立，NaN也交给标准库
+    SimdMask inRange = simdCmpLe(simdAbs(theta), simdSet(kSinCosFullLimit));
+    if (simdMoveMask(inRange) != kSimdAllLanes) {
+        float t[kSimdWidth], sv[kSimdWidth], cv[kSimdWidth];
+        simdStoreU(t, theta);
+        simdStoreU(sv, returnSin);
+        simdStoreU(cv, returnCos);
+        for (int i = 0; i < kSimdWidth; ++i) {
+            if (!(fabsf(t[i]) <= kSinCosFullLimit)) {
+                sinCos(&sv[i], &cv[i], t[i]);
+            }
+        }
+        returnSin = simdLoadU(sv);
+        returnCos = simdLoadU(cv);
+    }
+#endif
+#endif
+}
+
+// x必须在[-1, 1]之间
+static inline SimdFloat simdAcos(SimdFloat x) {
+#if MATH_ACCURACY == MATH_ACCURACY_FULL && defined(SIMD_SCALAR)
+    return (float)acos(x);
+#elif MATH_ACCURACY == MATH_ACCURACY_FULL
+    // acos(x) = pi/2 - asin(x)，在double中相减
+    SimdDouble lo, hi, signLo, signHi;
+    simdAsinAbsD(x, lo, hi);
+    simdWiden(simdSelect(simdCmpLt(x, simdZero()), simdSet(1.0f), simdSet(-1.0f)), signLo, signHi);
+    return simdNarrow(simdMaddD(lo, signLo, simdSetD(kPiOver2D)), simdMaddD(hi, signHi, simdSetD(kPiOver2D)));
+#else
+    SimdFloat one = simdSet(1.0f);
+    SimdFloat a = simdAbs(x);
+    SimdFloat r = simdMul(simdSqrt(simdSub(one, a)), simdPolyEval(kAcosCoef, a));
+    return simdSelect(simdCmpLt(x, simdZero()), simdSub(simdSet(kPi), r), r);
+#endif
+}
+
+static inline SimdFloat simdAsin(SimdFloat x) {
+#if MATH_ACCURACY == MATH_ACCURACY_FULL && defined(SIMD_SCALAR)
+    return (float)asin(x);
+#elif MATH_ACCURACY == MATH_ACCURACY_FULL
+    SimdDouble lo, hi;
+    simdAsinAbsD(x, lo, hi);
+    return simdCopySign(simdNarrow(lo, hi), x);
+#else
+    return simdSub(simdSet(KPiOver2), simdAcos(x));
+#endif
+}
+
+// 超出[-1, 1]的值取最接近的有效值
+static inline SimdFloat simdSafeAcos(SimdFloat x) {
+    return simdAcos(simdMin(simdMax(x, simdSet(-1.0f)), simdSet(1.0f)));
+}
+
+static inline SimdFloat simdAtan2(SimdFloat y, SimdFloat x) {
+#if MATH_ACCURACY == MATH_ACCURACY_FULL && defined(SIMD_SCALAR)
+    return (float)atan2(y, x);
+#elif MATH_ACCURACY == MATH_ACCURACY_FULL
+    SimdFloat ax = simdAbs(x);
+    SimdFloat ay = simdAbs(y);
+    SimdFloat big = simdMax(ax, ay);
+    SimdFloat small = simdMin(ax, ay);
+    SimdDouble smallLo, smallHi, bigLo, bigHi, reduceLo, reduceHi, swapLo, swapHi, negativeLo, negativeHi;
+    simdWiden(small, smallLo, smallHi);
+    simdWiden(big, bigLo, bigHi);
+    simdMaskToUnitD(simdCmpGt(small, simdMul(big, simdSet(0.414213562f))), reduceLo, reduceHi);
+    simdMaskToUnitD(simdCmpGt(ay, ax), swapLo, swapHi);
+    simdMaskToUnitD(simdCmpLt(x, simdZero()), negativeLo, negativeHi);
+    SimdFloat angle = simdNarrow(simdAtan2ReducedD(smallLo, bigLo, reduceLo, swapLo, negativeLo),
+                                 simdAtan2ReducedD(smallHi, bigHi, reduceHi, swapHi, negativeHi));
+    angle = simdCopySign(angle, y);
+
+    // 两者都为0（结果取决于0的符号）、无穷大和NaN交给标准库，比较对NaN不成立
+    SimdFloat maxFinite = simdSet(FLT_MAX);
+    SimdMask ordinary = simdMaskAnd(simdMaskAnd(simdCmpLe(ax, maxFinite), simdCmpLe(ay, maxFinite)), simdCmpGt(big, simdZero()));
+    if (simdMoveMask(ordinary) != kSimdAllLanes) {
+        float ys[kSimdWidth], xs[kSimdWidth], r[kSimdWidth];
+        simdStoreU(ys, y);
+        simdStoreU(xs, x);
+        simdStoreU(r, angle);
+        for (int i = 0; i < kSimdWidth; ++i) {
+            if (!(fabsf(xs[i]) <= FLT_MAX && fabsf(ys[i]) <= FLT_MAX && (xs[i] != 0.0f || ys[i] != 0.0f))) {
+                r[i] = atan2(ys[i], xs[i]);
+            }
+        }
+        angle = simdLoadU(r);
+    }
+    return angle;
+#else
+    // 先求第一象限中较小边与较大边之比的反正切，两者都为0时结果为0
+    SimdFloat zero = simdZero();
+    SimdFloat ax = simdAbs(x);
+    SimdFloat ay = simdAbs(y);
+    SimdFloat big = simdMax(ax, ay);
+    SimdFloat small = simdMin(ax, ay);
+    SimdFloat a = simdDiv(small, simdSelect(simdCmpGt(big, zero), big, simdSet(1.0f)));
+
+    SimdFloat base = zero;
+    if (kAtanReduce) {
+        SimdFloat one = simdSet(1.0f);
+        SimdMask reduce = simdCmpGt(a, simdSet(0.414213562f));
+        a = simdSelect(reduce, simdDiv(simdSub(a, one), simdAdd(a, one)), a);
+        base = simdSelect(reduce, simdSet(kPi * 0.25f), zero);
+    }
+    SimdFloat angle = simdMadd(a, simdPolyEval(kAtanCoef, simdMul(a, a)), base);
+
+    // 还原到原来的象限
+    angle = simdSelect(simdCmpGt(ay, ax), simdSub(simdSet(KPiOver2), angle), angle);
+    angle = simdSelect(simdCmpLt(x, zero), simdSub(simdSet(kPi), angle), angle);
+    return simdCopySign(angle, y);
+#endif
+}
+
+/*
+    开方和平方根倒数
+    HIGH和FAST等级都在硬件估计值上做一次牛顿迭代，与标量的mathRsqrt一样不直接返回近似值
+    x86上估计值有12位以上，迭代后误差约3 ulp，在FAST等级标量版本约5e-6（约80 ulp）的上限以内
+ */
+static inline SimdFloat simdMathSqrt(SimdFloat x) {
+#if MATH_ACCURACY == MATH_ACCURACY_FAST
+    SimdFloat r = simdMul(x, simdRsqrt(x));
+    return simdSelect(simdCmpGt(x, simdZero()), r, simdZero());
+#else
+    return simdSqrt(x);
+#endif
+}
+
+static inline SimdFloat simdMathRsqrt(SimdFloat x) {
+#if MATH_ACCURACY == MATH_ACCURACY_FULL
+    return simdDiv(simdSet(1.0f), simdSqrt(x));
+#else
+    return simdRsqrt(x);
+#endif
+}
+
+#endif /* SimdMath_h */
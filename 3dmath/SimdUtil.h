@@ -0,0 +1,760 @@
+//
+//  SimdUtil.h
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef SimdUtil_h
+#define SimdUtil_h
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+/*
+    批量运算使用的SIMD抽象层
+    编译时根据目标指令集选择最宽的寄存器：AVX为8路，SSE2/NEON为4路，其余退化为1路标量
+    所有批量核函数只依赖这里的函数，按kSimdWidth为步长处理数据，不必关心具体指令集
+    定义SIMD_FORCE_SCALAR可以强制使用标量版本，便于和逐个计算的结果对照
+
+    定义SIMD_TARGET_SSE2、SIMD_TARGET_AVX2或SIMD_TARGET_AVX512时不看编译选项，直接使用对应的指令集，
+    只用于运行时分派的核函数源文件，这些文件自己打开对应的指令集（参看SimdDispatch.hpp）
+    AVX-512的16路版本只在SIMD_TARGET_AVX512时使用，编译时选择最多到AVX
+    这里的函数都是static的，各源文件按不同指令集编译出的同名函数不会在链接时互相替换
+ */
+
+#if defined(SIMD_TARGET_AVX512)
+#define SIMD_AVX512 1
+#include <immintrin.h>
+#elif defined(SIMD_TARGET_AVX2) || (!defined(SIMD_TARGET_SSE2) && !defined(SIMD_FORCE_SCALAR) && defined(__AVX__))
+#define SIMD_AVX 1
+#include <immintrin.h>
+#elif defined(SIMD_TARGET_SSE2) || (!defined(SIMD_FORCE_SCALAR) && (defined(__SSE2__) || defined(_M_X64)))
+#define SIMD_SSE 1
+#include <emmintrin.h>
+#elif !defined(SIMD_FORCE_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define SIMD_SCALAR 1
+#endif
+
+// 批量数据的对齐字节数，按缓存行对齐，同时满足AVX的32字节和AVX-512的64字节要求
+const size_t kSimdAlignment = 64;
+
+// 分配和释放按kSimdAlignment对齐的内存
+static inline void* alignedAlloc(size_t bytes) {
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, kSimdAlignment);
+#else
+    void* p = NULL;
+    if (posix_memalign(&p, kSimdAlignment, bytes) != 0) {
+        return NULL;
+    }
+    return p;
+#endif
+}
+
+static inline void alignedFree(void* p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+#if defined(SIMD_AVX512)
+
+// 比较的结果是每个通道一位的掩码寄存器，按位运算就是通道的与、或
+typedef __m512 SimdFloat;
+typedef __mmask16 SimdMask;
+const int kSimdWidth = 16;
+
+static inline SimdFloat simdZero() { return _mm512_setzero_ps(); }
+static inline SimdFloat simdSet(float a) { return _mm512_set1_ps(a); }
+static inline SimdFloat simdLoad(const float* p) { return _mm512_load_ps(p); }
+static inline SimdFloat simdLoadU(const float* p) { return _mm512_loadu_ps(p); }
+static inline void simdStore(float* p, SimdFloat a) { _mm512_store_ps(p, a); }
+static inline void simdStoreU(float* p, SimdFloat a) { _mm512_storeu_ps(p, a); }
+
+static inline SimdFloat simdAdd(SimdFloat a, SimdFloat b) { return _mm512_add_ps(a, b); }
+static inline SimdFloat simdSub(SimdFloat a, SimdFloat b) { return _mm512_sub_ps(a, b); }
+static inline SimdFloat simdMul(SimdFloat a, SimdFloat b) { return _mm512_mul_ps(a, b); }
+static inline SimdFloat simdDiv(SimdFloat a, SimdFloat b) { return _mm512_div_ps(a, b); }
+static inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return _mm512_min_ps(a, b); }
+static inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return _mm512_max_ps(a, b); }
+static inline SimdFloat simdSqrt(SimdFloat a) { return _mm512_sqrt_ps(a); }
+// 相对误差2^-14，比SSE/AVX的估计值更准
+// 这里和simdPart4用带零掩码的形式，GCC头文件中不带掩码的版本以未初始化的变量作为来源，会引起警告
+static inline SimdFloat simdRsqrtEst(SimdFloat a) { return _mm512_maskz_rsqrt14_ps((__mmask16)0xffff, a); }
+static inline SimdFloat simdMadd(SimdFloat a, SimdFloat b, SimdFloat c) { return _mm512_fmadd_ps(a, b, c); }
+static inline SimdFloat simdNmadd(SimdFloat a, SimdFloat b, SimdFloat c) { return _mm512_fnmadd_ps(a, b, c); }
+
+// 浮点数的按位运算需要AVX-512DQ
+static inline SimdFloat simdAbs(SimdFloat a) { return _mm512_andnot_ps(_mm512_set1_ps(-0.0f), a); }
+static inline SimdFloat simdNeg(SimdFloat a) { return _mm512_xor_ps(a, _mm512_set1_ps(-0.0f)); }
+static inline SimdFloat simdCopySign(SimdFloat a, SimdFloat b) {
+    SimdFloat signMask = _mm512_set1_ps(-0.0f);
+    return _mm512_or_ps(_mm512_andnot_ps(signMask, a), _mm512_and_ps(signMask, b));
+}
+static inline SimdFloat simdRound(SimdFloat a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+static inline SimdFloat simdFloor(SimdFloat a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+static inline SimdMask simdCmpLt(SimdFloat a, SimdFloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+static inline SimdMask simdCmpLe(SimdFloat a, SimdFloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+static inline SimdMask simdCmpGt(SimdFloat a, SimdFloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+static inline SimdMask simdCmpGe(SimdFloat a, SimdFloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+static inline SimdMask simdCmpEq(SimdFloat a, SimdFloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+static inline SimdMask simdMaskAnd(SimdMask a, SimdMask b) { return (SimdMask)(a & b); }
+static inline SimdMask simdMaskOr(SimdMask a, SimdMask b) { return (SimdMask)(a | b); }
+static inline SimdMask simdMaskAndNot(SimdMask a, SimdMask b) { return (SimdMask)(a & ~b); }
+static inline SimdFloat simdSelect(SimdMask mask, SimdFloat a, SimdFloat b) { return _mm512_mask_blend_ps(mask, b, a); }
+static inline int simdMoveMask(SimdMask mask) { return (int)mask; }
+
+// 一半宽度的double，SimdFloat的前后两半各转换为一个，参看simdSinCos
+typedef __m512d SimdDouble;
+
+static inline SimdDouble simdSetD(double a) { return _mm512_set1_pd(a); }
+static inline SimdDouble simdMulD(SimdDouble a, SimdDouble b) { return _mm512_mul_pd(a, b); }
+static inline SimdDouble simdDivD(SimdDouble a, SimdDouble b) { return _mm512_div_pd(a, b); }
+static inline SimdDouble simdSqrtD(SimdDouble a) { return _mm512_maskz_sqrt_pd((__mmask8)0xff, a); }
+static inline SimdDouble simdMaddD(SimdDouble a, SimdDouble b, SimdDouble c) { return _mm512_fmadd_pd(a, b, c); }
+// 与simdRsqrtEst一样用带零掩码的形式
+static inline void simdWiden(SimdFloat a, SimdDouble& lo, SimdDouble& hi) {
+    __m512d d = _mm512_castps_pd(a);
+    lo = _mm512_maskz_cvtps_pd((__mmask8)0xff, _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd((__mmask8)0xf, d, 0)));
+    hi = _mm512_maskz_cvtps_pd((__mmask8)0xff, _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd((__mmask8)0xf, d, 1)));
+}
+static inline SimdFloat simdNarrow(SimdDouble lo, SimdDouble hi) {
+    __m256 a = _mm512_maskz_cvtpd_ps((__mmask8)0xff, lo), b = _mm512_maskz_cvtpd_ps((__mmask8)0xff, hi);
+    return _mm512_castpd_ps(_mm512_maskz_insertf64x4((__mmask8)0xff, _mm512_castpd256_pd512(_mm256_castps_pd(a)), _mm256_castps_pd(b), 1));
+}
+
+// 依次把4个128位寄存器拼成一个512位寄存器
+static inline __m512 simdCombine4(__m128 a, __m128 b, __m128 c, __m128 d) {
+    __m512 r = _mm512_castps128_ps512(a);
+    r = _mm512_insertf32x4(r, b, 1);
+    r = _mm512_insertf32x4(r, c, 2);
+    return _mm512_insertf32x4(r, d, 3);
+}
+
+// 取出第I个128位部分
+template <int I>
+static inline __m128 simdPart4(__m512 a) { return _mm512_maskz_extractf32x4_ps((__mmask8)0xf, a, I); }
+
+#elif defined(SIMD_AVX)
+
+typedef __m256 SimdFloat;
+typedef __m256 SimdMask;
+const int kSimdWidth = 8;
+
+static inline SimdFloat simdZero() { return _mm256_setzero_ps(); }
+static inline SimdFloat simdSet(float a) { return _mm256_set1_ps(a); }
+static inline SimdFloat simdLoad(const float* p) { return _mm256_load_ps(p); }
+static inline SimdFloat simdLoadU(const float* p) { return _mm256_loadu_ps(p); }
+static inline void simdStore(float* p, SimdFloat a) { _mm256_store_ps(p, a); }
+static inline void simdStoreU(float* p, SimdFloat a) { _mm256_storeu_ps(p, a); }
+
+static inline SimdFloat simdAdd(SimdFloat a, SimdFloat b) { return _mm256_add_ps(a, b); }
+static inline SimdFloat simdSub(SimdFloat a, SimdFloat b) { return _mm256_sub_ps(a, b); }
+static inline SimdFloat simdMul(SimdFloat a, SimdFloat b) { return _mm256_mul_ps(a, b); }
+static inline SimdFloat simdDiv(SimdFloat a, SimdFloat b) { return _mm256_div_ps(a, b); }
+static inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return _mm256_min_ps(a, b); }
+static inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return _mm256_max_ps(a, b); }
+static inline SimdFloat simdSqrt(SimdFloat a) { return _mm256_sqrt_ps(a); }
+static inline SimdFloat simdRsqrtEst(SimdFloat a) { return _mm256_rsqrt_ps(a); }
+
+// a * b + c
+static inline SimdFloat simdMadd(SimdFloat a, SimdFloat b, SimdFloat c) {
+#if defined(__FMA__) || defined(SIMD_TARGET_AVX2)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+// c - a * b
+static inline SimdFloat simdNmadd(SimdFloat a, SimdFloat b, SimdFloat c) {
+#if defined(__FMA__) || defined(SIMD_TARGET_AVX2)
+    return _mm256_fnmadd_ps(a, b, c);
+#else
+    return _mm256_sub_ps(c, _mm256_mul_ps(a, b));
+#endif
+}
+
+static inline SimdFloat simdAbs(SimdFloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+static inline SimdFloat simdNeg(SimdFloat a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+// 取a的绝对值和b的符号
+static inline SimdFloat simdCopySign(SimdFloat a, SimdFloat b) {
+    SimdFloat signMask = _mm256_set1_ps(-0.0f);
+    return _mm256_or_ps(_mm256_andnot_ps(signMask, a), _mm256_and_ps(signMask, b));
+}
+// 四舍五入到整数（ties to even）和向下取整
+static inline SimdFloat simdRound(SimdFloat a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+static inline SimdFloat simdFloor(SimdFloat a) { return _mm256_floor_ps(a); }
+
+static inline SimdMask simdCmpLt(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline SimdMask simdCmpLe(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline SimdMask simdCmpGt(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline SimdMask simdCmpGe(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline SimdMask simdCmpEq(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+static inline SimdMask simdMaskAnd(SimdMask a, SimdMask b) { return _mm256_and_ps(a, b); }
+static inline SimdMask simdMaskOr(SimdMask a, SimdMask b) { return _mm256_or_ps(a, b); }
+static inline SimdMask simdMaskAndNot(SimdMask a, SimdMask b) { return _mm256_andnot_ps(b, a); }
+// mask为真的通道取a，否则取b
+static inline SimdFloat simdSelect(SimdMask mask, SimdFloat a, SimdFloat b) { return _mm256_blendv_ps(b, a, mask); }
+// 每个通道一位，第i位对应第i个通道
+static inline int simdMoveMask(SimdMask mask) { return _mm256_movemask_ps(mask); }
+
+typedef __m256d SimdDouble;
+
+static inline SimdDouble simdSetD(double a) { return _mm256_set1_pd(a); }
+static inline SimdDouble simdMulD(SimdDouble a, SimdDouble b) { return _mm256_mul_pd(a, b); }
+static inline SimdDouble simdDivD(SimdDouble a, SimdDouble b) { return _mm256_div_pd(a, b); }
+static inline SimdDouble simdSqrtD(SimdDouble a) { return _mm256_sqrt_pd(a); }
+static inline SimdDouble simdMaddD(SimdDouble a, SimdDouble b, SimdDouble c) {
+#if defined(__FMA__) || defined(SIMD_TARGET_AVX2)
+    return _mm256_fmadd_pd(a, b, c);
+#else
+    return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+}
+static inline void simdWiden(SimdFloat a, SimdDouble& lo, SimdDouble& hi) {
+    lo = _mm256_cvtps_pd(_mm256_castps256_ps128(a));
+    hi = _mm256_cvtps_pd(_mm256_extractf128_ps(a, 1));
+}
+static inline SimdFloat simdNarrow(SimdDouble lo, SimdDouble hi) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1);
+}
+
+#elif defined(SIMD_SSE)
+
+typedef __m128 SimdFloat;
+typedef __m128 SimdMask;
+const int kSimdWidth = 4;
+
+static inline SimdFloat simdZero() { return _mm_setzero_ps(); }
+static inline SimdFloat simdSet(float a) { return _mm_set1_ps(a); }
+static inline SimdFloat simdLoad(const float* p) { return _mm_load_ps(p); }
+static inline SimdFloat simdLoadU(const float* p) { return _mm_loadu_ps(p); }
+static inline void simdStore(float* p, SimdFloat a) { _mm_store_ps(p, a); }
+static inline void simdStoreU(float* p, SimdFloat a) { _mm_storeu_ps(p, a); }
+
+static inline SimdFloat simdAdd(SimdFloat a, SimdFloat b) { return _mm_add_ps(a, b); }
+static inline SimdFloat simdSub(SimdFloat a, SimdFloat b) { return _mm_sub_ps(a, b); }
+static inline SimdFloat simdMul(SimdFloat a, SimdFloat b) { return _mm_mul_ps(a, b); }
+static inline SimdFloat simdDiv(SimdFloat a, SimdFloat b) { return _mm_div_ps(a, b); }
+static inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return _mm_min_ps(a, b); }
+static inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return _mm_max_ps(a, b); }
+static inline SimdFloat simdSqrt(SimdFloat a) { return _mm_sqrt_ps(a); }
+static inline SimdFloat simdRsqrtEst(SimdFloat a) { return _mm_rsqrt_ps(a); }
+static inline SimdFloat simdMadd(SimdFloat a, SimdFloat b, SimdFloat c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+static inline SimdFloat simdNmadd(SimdFloat a, SimdFloat b, SimdFloat c) { return _mm_sub_ps(c, _mm_mul_ps(a, b)); }
+
+static inline SimdFloat simdAbs(SimdFloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline SimdFloat simdNeg(SimdFloat a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+static inline SimdFloat simdCopySign(SimdFloat a, SimdFloat b) {
+    SimdFloat signMask = _mm_set1_ps(-0.0f);
+    return _mm_or_ps(_mm_andnot_ps(signMask, a), _mm_and_ps(signMask, b));
+}
+// SSE2没有round指令，借助默认舍入模式下的整数转换，输入需在int范围内
+static inline SimdFloat simdRound(SimdFloat a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+static inline SimdFloat simdFloor(SimdFloat a) {
+    SimdFloat r = simdRound(a);
+    return _mm_sub_ps(r, _mm_and_ps(_mm_cmpgt_ps(r, a), _mm_set1_ps(1.0f)));
+}
+
+static inline SimdMask simdCmpLt(SimdFloat a, SimdFloat b) { return _mm_cmplt_ps(a, b); }
+static inline SimdMask simdCmpLe(SimdFloat a, SimdFloat b) { return _mm_cmple_ps(a, b); }
+static inline SimdMask simdCmpGt(SimdFloat a, SimdFloat b) { return _mm_cmpgt_ps(a, b); }
+static inline SimdMask simdCmpGe(SimdFloat a, SimdFloat b) { return _mm_cmpge_ps(a, b); }
+static inline SimdMask simdCmpEq(SimdFloat a, SimdFloat b) { return _mm_cmpeq_ps(a, b); }
+static inline SimdMask simdMaskAnd(SimdMask a, SimdMask b) { return _mm_and_ps(a, b); }
+static inline SimdMask simdMaskOr(SimdMask a, SimdMask b) { return _mm_or_ps(a, b); }
+static inline SimdMask simdMaskAndNot(SimdMask a, SimdMask b) { return _mm_andnot_ps(b, a); }
+static inline SimdFloat simdSelect(SimdMask mask, SimdFloat a, SimdFloat b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+static inline int simdMoveMask(SimdMask mask) { return _mm_movemask_ps(mask); }
+
+typedef __m128d SimdDouble;
+
+static inline SimdDouble simdSetD(double a) { return _mm_set1_pd(a); }
+static inline SimdDouble simdMulD(SimdDouble a, SimdDouble b) { return _mm_mul_pd(a, b); }
+static inline SimdDouble simdDivD(SimdDouble a, SimdDouble b) { return _mm_div_pd(a, b); }
+static inline SimdDouble simdSqrtD(SimdDouble a) { return _mm_sqrt_pd(a); }
+static inline SimdDouble simdMaddD(SimdDouble a, SimdDouble b, SimdDouble c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+static inline void simdWiden(SimdFloat a, SimdDouble& lo, SimdDouble& hi) {
+    lo = _mm_cvtps_pd(a);
+    hi = _mm_cvtps_pd(_mm_movehl_ps(a, a));
+}
+static inline SimdFloat simdNarrow(SimdDouble lo, SimdDouble hi) { return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)); }
+
+#elif defined(SIMD_NEON)
+
+typedef float32x4_t SimdFloat;
+typedef uint32x4_t SimdMask;
+const int kSimdWidth = 4;
+
+static inline SimdFloat simdZero() { return vdupq_n_f32(0.0f); }
+static inline SimdFloat simdSet(float a) { return vdupq_n_f32(a); }
+static inline SimdFloat simdLoad(const float* p) { return vld1q_f32(p); }
+static inline SimdFloat simdLoadU(const float* p) { return vld1q_f32(p); }
+static inline void simdStore(float* p, SimdFloat a) { vst1q_f32(p, a); }
+static inline void simdStoreU(float* p, SimdFloat a) { vst1q_f32(p, a); }
+
+static inline SimdFloat simdAdd(SimdFloat a, SimdFloat b) { return vaddq_f32(a, b); }
+static inline SimdFloat simdSub(SimdFloat a, SimdFloat b) { return vsubq_f32(a, b); }
+static inline SimdFloat simdMul(SimdFloat a, SimdFloat b) { return vmulq_f32(a, b); }
+static inline SimdFloat simdDiv(SimdFloat a, SimdFloat b) { return vdivq_f32(a, b); }
+static inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return vminq_f32(a, b); }
+static inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return vmaxq_f32(a, b); }
+static inline SimdFloat simdSqrt(SimdFloat a) { return vsqrtq_f32(a); }
+static inline SimdFloat simdRsqrtEst(SimdFloat a) { return vrsqrteq_f32(a); }
+static inline SimdFloat simdMadd(SimdFloat a, SimdFloat b, SimdFloat c) { return vfmaq_f32(c, a, b); }
+static inline SimdFloat simdNmadd(SimdFloat a, SimdFloat b, SimdFloat c) { return vfmsq_f32(c, a, b); }
+
+static inline SimdFloat simdAbs(SimdFloat a) { return vabsq_f32(a); }
+static inline SimdFloat simdNeg(SimdFloat a) { return vnegq_f32(a); }
+static inline SimdFloat simdCopySign(SimdFloat a, SimdFloat b) {
+    return vbslq_f32(vdupq_n_u32(0x80000000u), b, a);
+}
+static inline SimdFloat simdRound(SimdFloat a) { return vrndnq_f32(a); }
+static inline SimdFloat simdFloor(SimdFloat a) { return vrndmq_f32(a); }
+
+static inline SimdMask simdCmpLt(SimdFloat a, SimdFloat b) { return vcltq_f32(a, b); }
+static inline SimdMask simdCmpLe(SimdFloat a, SimdFloat b) { return vcleq_f32(a, b); }
+static inline SimdMask simdCmpGt(SimdFloat a, SimdFloat b) { return vcgtq_f32(a, b); }
+static inline SimdMask simdCmpGe(SimdFloat a, SimdFloat b) { return vcgeq_f32(a, b); }
+static inline SimdMask simdCmpEq(SimdFloat a, SimdFloat b) { return vceqq_f32(a, b); }
+static inline SimdMask simdMaskAnd(SimdMask a, SimdMask b) { return vandq_u32(a, b); }
+static inline SimdMask simdMaskOr(SimdMask a, SimdMask b) { return vorrq_u32(a, b); }
+static inline SimdMask simdMaskAndNot(SimdMask a, SimdMask b) { return vbicq_u32(a, b); }
+static inline SimdFloat simdSelect(SimdMask mask, SimdFloat a, SimdFloat b) { return vbslq_f32(mask, a, b); }
+static inline int simdMoveMask(SimdMask mask) {
+    uint32_t bits[4];
+    vst1q_u32(bits, vshrq_n_u32(mask, 31));
+    return (int)(bits[0] | (bits[1] << 1) | (bits[2] << 2) | (bits[3] << 3));
+}
+
+typedef float64x2_t SimdDouble;
+
+static inline SimdDouble simdSetD(double a) { return vdupq_n_f64(a); }
+static inline SimdDouble simdMulD(SimdDouble a, SimdDouble b) { return vmulq_f64(a, b); }
+static inline SimdDouble simdDivD(SimdDouble a, SimdDouble b) { return vdivq_f64(a, b); }
+static inline SimdDouble simdSqrtD(SimdDouble a) { return vsqrtq_f64(a); }
+static inline SimdDouble simdMaddD(SimdDouble a, SimdDouble b, SimdDouble c) { return vfmaq_f64(c, a, b); }
+static inline void simdWiden(SimdFloat a, SimdDouble& lo, SimdDouble& hi) {
+    lo = vcvt_f64_f32(vget_low_f32(a));
+    hi = vcvt_high_f64_f32(a);
+}
+static inline SimdFloat simdNarrow(SimdDouble lo, SimdDouble hi) { return vcvt_high_f32_f64(vcvt_f32_f64(lo), hi); }
+
+#else
+
+typedef float SimdFloat;
+typedef bool SimdMask;
+const int kSimdWidth = 1;
+
+static inline SimdFloat simdZero() { return 0.0f; }
+static inline SimdFloat simdSet(float a) { return a; }
+static inline SimdFloat simdLoad(const float* p) { return *p; }
+static inline SimdFloat simdLoadU(const float* p) { return *p; }
+static inline void simdStore(float* p, SimdFloat a) { *p = a; }
+static inline void simdStoreU(float* p, SimdFloat a) { *p = a; }
+
+static inline SimdFloat simdAdd(SimdFloat a, SimdFloat b) { return a + b; }
+static inline SimdFloat simdSub(SimdFloat a, SimdFloat b) { return a - b; }
+static inline SimdFloat simdMul(SimdFloat a, SimdFloat b) { return a * b; }
+static inline SimdFloat simdDiv(SimdFloat a, SimdFloat b) { return a / b; }
+static inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return a < b ? a : b; }
+static inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return a > b ? a : b; }
+static inline SimdFloat simdSqrt(SimdFloat a) { return sqrtf(a); }
+static inline SimdFloat simdRsqrtEst(SimdFloat a) { return 1.0f / sqrtf(a); }
+static inline SimdFloat simdMadd(SimdFloat a, SimdFloat b, SimdFloat c) { return a * b + c; }
+static inline SimdFloat simdNmadd(SimdFloat a, SimdFloat b, SimdFloat c) { return c - a * b; }
+
+static inline SimdFloat simdAbs(SimdFloat a) { return fabsf(a); }
+static inline SimdFloat simdNeg(SimdFloat a) { return -a; }
+static inline SimdFloat simdCopySign(SimdFloat a, SimdFloat b) { return copysignf(a, b); }
+static inline SimdFloat simdRound(SimdFloat a) { return nearbyintf(a); }
+static inline SimdFloat simdFloor(SimdFloat a) { return floorf(a); }
+
+static inline SimdMask simdCmpLt(SimdFloat a, SimdFloat b) { return a < b; }
+static inline SimdMask simdCmpLe(SimdFloat a, SimdFloat b) { return a <= b; }
+static inline SimdMask simdCmpGt(SimdFloat a, SimdFloat b) { return a > b; }
+static inline SimdMask simdCmpGe(SimdFloat a, SimdFloat b) { return a >= b; }
+static inline SimdMask simdCmpEq(SimdFloat a, SimdFloat b) { return a == b; }
+static inline SimdMask simdMaskAnd(SimdMask a, SimdMask b) { return a && b; }
+static inline SimdMask simdMaskOr(SimdMask a, SimdMask b) { return a || b; }
+static inline SimdMask simdMaskAndNot(SimdMask a, SimdMask b) { return a && !b; }
+static inline SimdFloat simdSelect(SimdMask mask, SimdFloat a, SimdFloat b) { return mask ? a : b; }
+static inline int simdMoveMask(SimdMask mask) { return mask ? 1 : 0; }
+
+#endif
+
+// 所有通道都为1的位掩码
+const int kSimdAllLanes = (1 << kSimdWidth) - 1;
+
+/*
+    1/sqrt(a)，硬件估计值再做一次牛顿迭代，相对误差约1e-7量级
+    y' = y * (1.5 - 0.5 * a * y * y)
+ */
+static inline SimdFloat simdRsqrt(SimdFloat a) {
+#if defined(SIMD_SCALAR)
+    return 1.0f / sqrtf(a);
+#else
+    SimdFloat y = simdRsqrtEst(a);
+    SimdFloat halfA = simdMul(a, simdSet(0.5f));
+    return simdMul(y, simdNmadd(halfA, simdMul(y, y), simdSet(1.5f)));
+#endif
+}
+
+/*
+    一次读入kSimdWidth个紧密排列的Vector3（x,y,z交错存放），拆分为x、y、z三个寄存器
+    写出时做相反的操作，p不要求对齐
+ */
+#if defined(SIMD_SSE) || defined(SIMD_AVX) || defined(SIMD_AVX512)
+// a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3，也可以用于按位转换的整数数据
+static inline void simdTransposeVector3x4(__m128 a, __m128 b, __m128 c, __m128& x, __m128& y, __m128& z) {
+    __m128 t = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+    x = _mm_shuffle_ps(a, t, _MM_SHUFFLE(2, 0, 3, 0));
+    __m128 u = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+    __m128 v = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+    y = _mm_shuffle_ps(u, v, _MM_SHUFFLE(2, 0, 2, 0));
+    u = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+    v = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 3, 0));
+    z = _mm_shuffle_ps(u, v, _MM_SHUFFLE(1, 0, 2, 0));
+}
+
+static inline void simdLoadVector3x4(const float* p, __m128& x, __m128& y, __m128& z) {
+    simdTransposeVector3x4(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), _mm_loadu_ps(p + 8), x, y, z);
+}
+
+static inline void simdStoreVector3x4(float* p, __m128 x, __m128 y, __m128 z) {
+    __m128 xy = _mm_unpacklo_ps(x, y);
+    __m128 xyHi = _mm_unpackhi_ps(x, y);
+    __m128 t = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));
+    _mm_storeu_ps(p, _mm_shuffle_ps(xy, t, _MM_SHUFFLE(2, 0, 1, 0)));
+    t = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));
+    _mm_storeu_ps(p + 4, _mm_shuffle_ps(t, xyHi, _MM_SHUFFLE(1, 0, 2, 0)));
+    t = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));
+    __m128 s = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm_storeu_ps(p + 8, _mm_shuffle_ps(t, s, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+#endif
+
+static inline void simdLoadVector3(const float* p, SimdFloat& x, SimdFloat& y, SimdFloat& z) {
+#if defined(SIMD_AVX512)
+    __m128 x0, y0, z0, x1, y1, z1, x2, y2, z2, x3, y3, z3;
+    simdLoadVector3x4(p, x0, y0, z0);
+    simdLoadVector3x4(p + 12, x1, y1, z1);
+    simdLoadVector3x4(p + 24, x2, y2, z2);
+    simdLoadVector3x4(p + 36, x3, y3, z3);
+    x = simdCombine4(x0, x1, x2, x3);
+    y = simdCombine4(y0, y1, y2, y3);
+    z = simdCombine4(z0, z1, z2, z3);
+#elif defined(SIMD_AVX)
+    __m128 x0, y0, z0, x1, y1, z1;
+    simdLoadVector3x4(p, x0, y0, z0);
+    simdLoadVector3x4(p + 12, x1, y1, z1);
+    x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+    y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+    z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+#elif defined(SIMD_SSE)
+    simdLoadVector3x4(p, x, y, z);
+#elif defined(SIMD_NEON)
+    float32x4x3_t v = vld3q_f32(p);
+    x = v.val[0];
+    y = v.val[1];
+    z = v.val[2];
+#else
+    x = p[0];
+    y = p[1];
+    z = p[2];
+#endif
+}
+
+static inline void simdStoreVector3(float* p, SimdFloat x, SimdFloat y, SimdFloat z) {
+#if defined(SIMD_AVX512)
+    simdStoreVector3x4(p, simdPart4<0>(x), simdPart4<0>(y), simdPart4<0>(z));
+    simdStoreVector3x4(p + 12, simdPart4<1>(x), simdPart4<1>(y), simdPart4<1>(z));
+    simdStoreVector3x4(p + 24, simdPart4<2>(x), simdPart4<2>(y), simdPart4<2>(z));
+    simdStoreVector3x4(p + 36, simdPart4<3>(x), simdPart4<3>(y), simdPart4<3>(z));
+#elif defined(SIMD_AVX)
+    simdStoreVector3x4(p, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z));
+    simdStoreVector3x4(p + 12, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1));
+#elif defined(SIMD_SSE)
+    simdStoreVector3x4(p, x, y, z);
+#elif defined(SIMD_NEON)
+    float32x4x3_t v;
+    v.val[0] = x;
+    v.val[1] = y;
+    v.val[2] = z;
+    vst3q_f32(p, v);
+#else
+    p[0] = x;
+    p[1] = y;
+    p[2] = z;
+#endif
+}
+
+/*
+    一次读入kSimdWidth个紧密排列的4分量记录（如四元数的w,x,y,z），拆分为4个寄存器
+    写出时做相反的操作，p不要求对齐
+ */
+static inline void simdLoadFloat4(const float* p, SimdFloat& a, SimdFloat& b, SimdFloat& c, SimdFloat& d) {
+#if defined(SIMD_AVX512)
+    __m128 r[16];
+    for (int k = 0; k < 16; ++k) {
+        r[k] = _mm_loadu_ps(p + 4 * k);
+    }
+    _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+    _MM_TRANSPOSE4_PS(r[4], r[5], r[6], r[7]);
+    _MM_TRANSPOSE4_PS(r[8], r[9], r[10], r[11]);
+    _MM_TRANSPOSE4_PS(r[12], r[13], r[14], r[15]);
+    a = simdCombine4(r[0], r[4], r[8], r[12]);
+    b = simdCombine4(r[1], r[5], r[9], r[13]);
+    c = simdCombine4(r[2], r[6], r[10], r[14]);
+    d = simdCombine4(r[3], r[7], r[11], r[15]);
+#elif defined(SIMD_AVX)
+    __m128 r0 = _mm_loadu_ps(p), r1 = _mm_loadu_ps(p + 4), r2 = _mm_loadu_ps(p + 8), r3 = _mm_loadu_ps(p + 12);
+    __m128 r4 = _mm_loadu_ps(p + 16), r5 = _mm_loadu_ps(p + 20), r6 = _mm_loadu_ps(p + 24), r7 = _mm_loadu_ps(p + 28);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+    a = _mm256_insertf128_ps(_mm256_castps128_ps256(r0), r4, 1);
+    b = _mm256_insertf128_ps(_mm256_castps128_ps256(r1), r5, 1);
+    c = _mm256_insertf128_ps(_mm256_castps128_ps256(r2), r6, 1);
+    d = _mm256_insertf128_ps(_mm256_castps128_ps256(r3), r7, 1);
+#elif defined(SIMD_SSE)
+    a = _mm_loadu_ps(p);
+    b = _mm_loadu_ps(p + 4);
+    c = _mm_loadu_ps(p + 8);
+    d = _mm_loadu_ps(p + 12);
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+#elif defined(SIMD_NEON)
+    float32x4x4_t v = vld4q_f32(p);
+    a = v.val[0];
+    b = v.val[1];
+    c = v.val[2];
+    d = v.val[3];
+#else
+    a = p[0];
+    b = p[1];
+    c = p[2];
+    d = p[3];
+#endif
+}
+
+static inline void simdStoreFloat4(float* p, SimdFloat a, SimdFloat b, SimdFloat c, SimdFloat d) {
+#if defined(SIMD_AVX512)
+    __m128 r[16];
+    r[0] = simdPart4<0>(a); r[4] = simdPart4<1>(a);
+    r[8] = simdPart4<2>(a); r[12] = simdPart4<3>(a);
+    r[1] = simdPart4<0>(b); r[5] = simdPart4<1>(b);
+    r[9] = simdPart4<2>(b); r[13] = simdPart4<3>(b);
+    r[2] = simdPart4<0>(c); r[6] = simdPart4<1>(c);
+    r[10] = simdPart4<2>(c); r[14] = simdPart4<3>(c);
+    r[3] = simdPart4<0>(d); r[7] = simdPart4<1>(d);
+    r[11] = simdPart4<2>(d); r[15] = simdPart4<3>(d);
+    _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+    _MM_TRANSPOSE4_PS(r[4], r[5], r[6], r[7]);
+    _MM_TRANSPOSE4_PS(r[8], r[9], r[10], r[11]);
+    _MM_TRANSPOSE4_PS(r[12], r[13], r[14], r[15]);
+    for (int k = 0; k < 16; ++k) {
+        _mm_storeu_ps(p + 4 * k, r[k]);
+    }
+#elif defined(SIMD_AVX)
+    __m128 r0 = _mm256_castps256_ps128(a), r1 = _mm256_castps256_ps128(b);
+    __m128 r2 = _mm256_castps256_ps128(c), r3 = _mm256_castps256_ps128(d);
+    __m128 r4 = _mm256_extractf128_ps(a, 1), r5 = _mm256_extractf128_ps(b, 1);
+    __m128 r6 = _mm256_extractf128_ps(c, 1), r7 = _mm256_extractf128_ps(d, 1);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+    _mm_storeu_ps(p, r0); _mm_storeu_ps(p + 4, r1); _mm_storeu_ps(p + 8, r2); _mm_storeu_ps(p + 12, r3);
+    _mm_storeu_ps(p + 16, r4); _mm_storeu_ps(p + 20, r5); _mm_storeu_ps(p + 24, r6); _mm_storeu_ps(p + 28, r7);
+#elif defined(SIMD_SSE)
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps(p, a);
+    _mm_storeu_ps(p + 4, b);
+    _mm_storeu_ps(p + 8, c);
+    _mm_storeu_ps(p + 12, d);
+#elif defined(SIMD_NEON)
+    float32x4x4_t v;
+    v.val[0] = a;
+    v.val[1] = b;
+    v.val[2] = c;
+    v.val[3] = d;
+    vst4q_f32(p, v);
+#else
+    p[0] = a;
+    p[1] = b;
+    p[2] = c;
+    p[3] = d;
+#endif
+}
+
+/*
+    读写数组末尾不足kSimdWidth个的元素
+    读入时缺少的通道填充fill，写出时只写count个元素
+ */
+static inline SimdFloat simdLoadPartial(const float* p, size_t count, float fill) {
+    float tmp[kSimdWidth];
+    for (int i = 0; i < kSimdWidth; ++i) {
+        tmp[i] = fill;
+    }
+    memcpy(tmp, p, count * sizeof(float));
+    return simdLoadU(tmp);
+}
+
+static inline void simdStorePartial(float* p, size_t count, SimdFloat a) {
+    float tmp[kSimdWidth];
+    simdStoreU(tmp, a);
+    memcpy(p, tmp, count * sizeof(float));
+}
+
+#if defined(SIMD_SSE) || defined(SIMD_AVX) || defined(SIMD_AVX512)
+/*
+    4个结构体的字段转置，每4个字段用4次非对齐读写和一次4x4转置完成
+    剩下不足4个的字段逐个通道拼装，不会读写fieldCount之外的内存
+ */
+static inline void simdLoadFieldsx4(const float* p, size_t stride, int fieldCount, __m128* fields) {
+    int k = 0;
+    for (; k + 4 <= fieldCount; k += 4) {
+        __m128 r0 = _mm_loadu_ps(p + k);
+        __m128 r1 = _mm_loadu_ps(p + stride + k);
+        __m128 r2 = _mm_loadu_ps(p + 2 * stride + k);
+        __m128 r3 = _mm_loadu_ps(p + 3 * stride + k);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        fields[k] = r0;
+        fields[k + 1] = r1;
+        fields[k + 2] = r2;
+        fields[k + 3] = r3;
+    }
+    for (; k < fieldCount; ++k) {
+        fields[k] = _mm_set_ps(p[3 * stride + k], p[2 * stride + k], p[stride + k], p[k]);
+    }
+}
+
+static inline void simdStoreFieldsx4(float* p, size_t stride, int fieldCount, const __m128* fields) {
+    int k = 0;
+    for (; k + 4 <= fieldCount; k += 4) {
+        __m128 r0 = fields[k], r1 = fields[k + 1], r2 = fields[k + 2], r3 = fields[k + 3];
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(p + k, r0);
+        _mm_storeu_ps(p + stride + k, r1);
+        _mm_storeu_ps(p + 2 * stride + k, r2);
+        _mm_storeu_ps(p + 3 * stride + k, r3);
+    }
+    for (; k < fieldCount; ++k) {
+        __m128 f = fields[k];
+        _mm_store_ss(p + k, f);
+        _mm_store_ss(p + stride + k, _mm_shuffle_ps(f, f, _MM_SHUFFLE(1, 1, 1, 1)));
+        _mm_store_ss(p + 2 * stride + k, _mm_shuffle_ps(f, f, _MM_SHUFFLE(2, 2, 2, 2)));
+        _mm_store_ss(p + 3 * stride + k, _mm_shuffle_ps(f, f, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+}
+#endif
+
+/*
+    读写连续存放的结构体数组，每个结构体占stride个float，要处理的是开头的fieldCount个float
+    fields[k]的第i个通道对应第i个结构体的第k个字段
+    count < kSimdWidth时缺少的通道填0，写出时只写count个结构体，其余字段保持不变
+    整组时在寄存器中转置，数组末尾不足一组时经过栈上的临时数组
+ */
+const int kSimdMaxFields = 16;
+
+static inline void simdLoadFields(const float* p, size_t stride, int fieldCount, size_t count, SimdFloat* fields) {
+    if (count == (size_t)kSimdWidth) {
+        if (stride == 3 && fieldCount == 3) {
+            simdLoadVector3(p, fields[0], fields[1], fields[2]);
+            return;
+        }
+#if defined(SIMD_AVX512)
+        __m128 part[4][kSimdMaxFields];
+        for (int g = 0; g < 4; ++g) {
+            simdLoadFieldsx4(p + 4 * g * stride, stride, fieldCount, part[g]);
+        }
+        for (int k = 0; k < fieldCount; ++k) {
+            fields[k] = simdCombine4(part[0][k], part[1][k], part[2][k], part[3][k]);
+        }
+        return;
+#elif defined(SIMD_AVX)
+        __m128 lo[kSimdMaxFields], hi[kSimdMaxFields];
+        simdLoadFieldsx4(p, stride, fieldCount, lo);
+        simdLoadFieldsx4(p + 4 * stride, stride, fieldCount, hi);
+        for (int k = 0; k < fieldCount; ++k) {
+            fields[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo[k]), hi[k], 1);
+        }
+        return;
+#elif defined(SIMD_SSE)
+        simdLoadFieldsx4(p, stride, fieldCount, fields);
+        return;
+#elif defined(SIMD_SCALAR)
+        for (int k = 0; k < fieldCount; ++k) {
+            fields[k] = p[k];
+        }
+        return;
+#endif
+    }
+    float tmp[kSimdMaxFields][kSimdWidth];
+    for (int k = 0; k < fieldCount; ++k) {
+        for (int i = 0; i < kSimdWidth; ++i) {
+            tmp[k][i] = (size_t)i < count ? p[i * stride + k] : 0.0f;
+        }
+        fields[k] = simdLoadU(tmp[k]);
+    }
+}
+
+static inline void simdStoreFields(float* p, size_t stride, int fieldCount, size_t count, const SimdFloat* fields) {
+    if (count == (size_t)kSimdWidth) {
+        if (stride == 3 && fieldCount == 3) {
+            simdStoreVector3(p, fields[0], fields[1], fields[2]);
+            return;
+        }
+#if defined(SIMD_AVX512)
+        __m128 part[4][kSimdMaxFields];
+        for (int k = 0; k < fieldCount; ++k) {
+            part[0][k] = simdPart4<0>(fields[k]);
+            part[1][k] = simdPart4<1>(fields[k]);
+            part[2][k] = simdPart4<2>(fields[k]);
+            part[3][k] = simdPart4<3>(fields[k]);
+        }
+        for (int g = 0; g < 4; ++g) {
+            simdStoreFieldsx4(p + 4 * g * stride, stride, fieldCount, part[g]);
+        }
+        return;
+#elif defined(SIMD_AVX)
+        __m128 lo[kSimdMaxFields], hi[kSimdMaxFields];
+        for (int k = 0; k < fieldCount; ++k) {
+            lo[k] = _mm256_castps256_ps128(fields[k]);
+            hi[k] = _mm256_extractf128_ps(fields[k], 1);
+        }
+        simdStoreFieldsx4(p, stride, fieldCount, lo);
+        simdStoreFieldsx4(p + 4 * stride, stride, fieldCount, hi);
+        return;
+#elif defined(SIMD_SSE)
+        simdStoreFieldsx4(p, stride, fieldCount, fields);
+        return;
+#elif defined(SIMD_SCALAR)
+        for (int k = 0; k < fieldCount; ++k) {
+            p[k] = fields[k];
+        }
+        return;
+#endif
+    }
+    float tmp[kSimdMaxFields][kSimdWidth];
+    for (int k = 0; k < fieldCount; ++k) {
+        simdStoreU(tmp[k], fields[k]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        for (int k = 0; k < fieldCount; ++k) {
+            p[i * stride + k] = tmp[k][i];
+        }
+    }
+}
+
+#endif /* SimdUtil_h */
@@ -0,0 +1,407 @@
+//
+//  Skinning.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "Skinning.hpp"
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include "Vector3.hpp"
+#include "Matrix4x3.hpp"
+#include "DualQuaternion.hpp"
+#include "SimdUtil.h"
+#include "ThreadPool.hpp"
+#include "Instrument.hpp"
+
+/*
+    权重和骨骼下标放在同一块内存中：先是influenceCount个权重数组，再是influenceCount个下标数组
+    每个数组的长度都是补齐后的容量（16的整数倍），所以每个数组的起始地址都是对齐的
+ */
+SkinnedMesh::SkinnedMesh(int influenceCount)
+    : weightData(NULL), boneData(NULL), influences(influenceCount), largestBone(-1) {
+    assert(influenceCount > 0 && influenceCount <= kMaxInfluences);
+}
+
+SkinnedMesh::SkinnedMesh(const SkinnedMesh& a)
+    : bindPositions(a.bindPositions), bindNormals(a.bindNormals), weightData(NULL), boneData(NULL),
+      influences(a.influences), largestBone(a.largestBone) {
+    allocate(capacity());
+    copyInfluences(a);
+}
+
+SkinnedMesh::~SkinnedMesh() {
+    release();
+}
+
+SkinnedMesh& SkinnedMesh::operator =(const SkinnedMesh& a) {
+    if (this != &a) {
+        release();
+        bindPositions = a.bindPositions;
+        bindNormals = a.bindNormals;
+        influences = a.influences;
+        largestBone = a.largestBone;
+        allocate(capacity());
+        copyInfluences(a);
+    }
+    return *this;
+}
+
+/*
+    复制后的绑定姿态按a.size()重新分配，a缩小过时容量比a的小，每个数组的间隔不同，要逐个复制
+    a在size()之后的权重都是0，复制到补齐后的容量为止
+ */
+void SkinnedMesh::copyInfluences(const SkinnedMesh& a) {
+    size_t padded = capacity();
+    for (int k = 0; k < influences && padded > 0; ++k) {
+        memcpy(weightData + k * padded, a.weights(k), padded * sizeof(float));
+        memcpy(boneData + k * padded, a.bones(k), padded * sizeof(unsigned short));
+    }
+}
+
+void SkinnedMesh::allocate(size_t padded) {
+    if (padded == 0) {
+        return;
+    }
+    size_t bytes = influences * padded * (sizeof(float) + sizeof(unsigned short));
+    weightData = (float*)alignedAlloc(bytes);
+    if (weightData == NULL) {
+        throw std::bad_alloc();
+    }
+    boneData = reinterpret_cast<unsigned short*>(weightData + influences * padded);
+    memset(weightData, 0, bytes);
+}
+
+void SkinnedMesh::release() {
+    alignedFree(weightData);
+    weightData = NULL;
+    boneData = NULL;
+}
+
+void SkinnedMesh::resize(size_t n) {
+    size_t oldSize = size();
+    size_t oldCapacity = capacity();
+    bindPositions.resize(n);
+    bindNormals.resize(n);
+    size_t padded = capacity();
+
+    if (padded == oldCapacity) {
+        // 容量不变，只需把被截掉的顶点清零，保证补齐部分的权重为0
+        for (int k = 0; k < influences; ++k) {
+            for (size_t i = n; i < oldSize; ++i) {
+                weightData[k * padded + i] = 0.0f;
+                boneData[k * padded + i] = 0;
+            }
+        }
+        return;
+    }
+
+    float* oldWeights = weightData;
+    unsigned short* oldBones = boneData;
+    weightData = NULL;
+    boneData = NULL;
+    allocate(padded);
+    size_t keep = std::min(oldSize, n);
+    for (int k = 0; k < influences && keep > 0; ++k) {
+        memcpy(weightData + k * padded, oldWeights + k * oldCapacity, keep * sizeof(float));
+        memcpy(boneData + k * padded, oldBones + k * oldCapacity, keep * sizeof(unsigned short));
+    }
+    alignedFree(oldWeights);
+}
+
+void SkinnedMesh::setVertex(size_t i, const Vector3& position, const Vector3& normal,
+                            const int* bones, const float* weights, int count) {
+    assert(i < size());
+    bindPositions.set(i, position);
+    bindNormals.set(i, normal);
+
+    // 按权重从大到小排序，蒙皮时遇到一组顶点的权重全为0就可以提前结束
+    int order[kMaxInfluences * 4];
+    assert(count <= kMaxInfluences * 4);
+    for (int j = 0; j < count; ++j) {
+        order[j] = j;
+    }
+    std::sort(order, order + count, [&](int a, int b) { return weights[a] > weights[b]; });
+
+    int used = std::min(count, influences);
+    float sum = 0.0f;
+    for (int j = 0; j < used; ++j) {
+        sum += weights[order[j]];
+    }
+    float oneOverSum = sum > 0.0f ? 1.0f / sum : 0.0f;
+
+    size_t padded = capacity();
+    for (int k = 0; k < influences; ++k) {
+        float w = 0.0f;
+        int bone = 0;
+        if (k < used && weights[order[k]] > 0.0f) {
+            w = weights[order[k]] * oneOverSum;
+            bone = bones[order[k]];
+            assert(bone >= 0 && bone <= 0xffff);
+            largestBone = std::max(largestBone, bone);
+        }
+        weightData[k * padded + i] = w;
+        boneData[k * padded + i] = (unsigned short)bone;
+    }
+}
+
+/*
+    按权重混合一个顶点的骨骼矩阵，结果为12个float：m11 m12 m13 m21 m22 m23 m31 m32 m33 tx ty tz
+    矩阵的前12个float正好按这个顺序排列，每个影响只需3次4路读取和乘加，不需要转置
+    used之后的影响对这一组顶点都为0；之前的影响即使权重为0也照常计算，避免难以预测的分支
+ */
+static inline void blendMatrix(const SkinnedMesh& mesh, const float* palette, size_t i, int used, float* out) {
+    const size_t stride = sizeof(Matrix4x3) / sizeof(float);
+#if defined(SIMD_SSE) || defined(SIMD_AVX)
+    __m128 r0 = _mm_setzero_ps(), r1 = _mm_setzero_ps(), r2 = _mm_setzero_ps();
+    for (int k = 0; k < used; ++k) {
+        const float* m = palette + mesh.bones(k)[i] * stride;
+        __m128 w = _mm_set1_ps(mesh.weights(k)[i]);
+        r0 = _mm_add_ps(r0, _mm_mul_ps(w, _mm_loadu_ps(m)));
+        r1 = _mm_add_ps(r1, _mm_mul_ps(w, _mm_loadu_ps(m + 4)));
+        r2 = _mm_add_ps(r2, _mm_mul_ps(w, _mm_loadu_ps(m + 8)));
+    }
+    _mm_storeu_ps(out, r0);
+    _mm_storeu_ps(out + 4, r1);
+    _mm_storeu_ps(out + 8, r2);
+#else
+    for (int f = 0; f < 12; ++f) {
+        out[f] = 0.0f;
+    }
+    for (int k = 0; k < used; ++k) {
+        const float* m = palette + mesh.bones(k)[i] * stride;
+        float w = mesh.weights(k)[i];
+        for (int f = 0; f < 12; ++f) {
+            out[f] += w * m[f];
+        }
+    }
+#endif
+}
+
+/*
+    按权重混合一个顶点的骨骼对偶四元数，结果为8个float：real的w x y z，dual的w x y z
+    q和-q表示同一个变换，与第一个影响（权重最大）的real点乘为负时取反，沿最短路径混合
+ */
+static inline void blendDualQuaternion(const SkinnedMesh& mesh, const float* palette, size_t i, int used, float* out) {
+    const size_t stride = sizeof(DualQuaternion) / sizeof(float);
+#if defined(SIMD_SSE) || defined(SIMD_AVX)
+    __m128 r = _mm_setzero_ps(), d = _mm_setzero_ps();
+    __m128 pivot = used > 0 ? _mm_loadu_ps(palette + mesh.bones(0)[i] * stride) : r;
+    __m128 signBit = _mm_set1_ps(-0.0f);
+    for (int k = 0; k < used; ++k) {
+        const float* q = palette + mesh.bones(k)[i] * stride;
+        __m128 qr = _mm_loadu_ps(q);
+        __m128 dot = _mm_mul_ps(qr, pivot);
+        dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(2, 3, 0, 1)));
+        dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(1, 0, 3, 2)));
+        // 把点乘的符号位异或到权重上
+        __m128 w = _mm_xor_ps(_mm_set1_ps(mesh.weights(k)[i]), _mm_and_ps(dot, signBit));
+        r = _mm_add_ps(r, _mm_mul_ps(w, qr));
+        d = _mm_add_ps(d, _mm_mul_ps(w, _mm_loadu_ps(q + 4)));
+    }
+    _mm_storeu_ps(out, r);
+    _mm_storeu_ps(out + 4, d);
+#else
+    for (int f = 0; f < 8; ++f) {
+        out[f] = 0.0f;
+    }
+    const float* pivot = used > 0 ? palette + mesh.bones(0)[i] * stride : NULL;
+    for (int k = 0; k < used; ++k) {
+        const float* q = palette + mesh.bones(k)[i] * stride;
+        float dot = q[0] * pivot[0] + q[1] * pivot[1] + q[2] * pivot[2] + q[3] * pivot[3];
+        float w = dot < 0.0f ? -mesh.weights(k)[i] : mesh.weights(k)[i];
+        for (int f = 0; f < 8; ++f) {
+            out[f] += w * q[f];
+        }
+    }
+#endif
+}
+
+// 一组顶点用到的影响个数：影响按权重从大到小存放，第k个影响的权重全为0时，后面的影响也都为0
+static inline int groupInfluences(const SkinnedMesh& mesh, size_t i) {
+    int used = 0;
+    while (used < mesh.influenceCount() &&
+           simdMoveMask(simdCmpGt(simdLoad(mesh.weights(used) + i), simdZero())) != 0) {
+        ++used;
+    }
+    return used;
+}
+
+// a x b
+static inline void simdCross(SimdFloat ax, SimdFloat ay, SimdFloat az, SimdFloat bx, SimdFloat by, SimdFloat bz,
+                             SimdFloat& cx, SimdFloat& cy, SimdFloat& cz) {
+    cx = simdNmadd(az, by, simdMul(ay, bz));
+    cy = simdNmadd(ax, bz, simdMul(az, bx));
+    cz = simdNmadd(ay, bx, simdMul(ax, by));
+}
+
+/*
+    计算[begin, end)中的顶点，begin和end都是kSimdWidth的整数倍
+    每组kSimdWidth个顶点先逐个混合骨骼矩阵，再转置成12个SoA字段，用混合后的矩阵变换位置和法线
+ */
+static void skinRangeLinear(const SkinningJob& job, size_t begin, size_t end) {
+    const SkinnedMesh& mesh = *job.mesh;
+    const float* palette = reinterpret_cast<const float*>(job.palette);
+    const Vector3Stream& p = mesh.positions();
+    const Vector3Stream& n = mesh.normals();
+    Vector3Stream& outP = *job.positions;
+    Vector3Stream* outN = job.normals;
+    SimdFloat zero = simdZero();
+
+    for (size_t i = begin; i < end; i += kSimdWidth) {
+        int used = groupInfluences(mesh, i);
+        float blended[kSimdWidth * 12];
+        for (int lane = 0; lane < kSimdWidth; ++lane) {
+            blendMatrix(mesh, palette, i + lane, used, blended + 12 * lane);
+        }
+        SimdFloat blend[12];
+        simdLoadFields(blended, 12, 12, kSimdWidth, blend);
+
+        // p' = p * M，blend依次为m11 m12 m13 m21 m22 m23 m31 m32 m33 tx ty tz
+        SimdFloat x = simdLoad(p.x() + i), y = simdLoad(p.y() + i), z = simdLoad(p.z() + i);
+        simdStore(outP.x() + i, simdMadd(z, blend[6], simdMadd(y, blend[3], simdMadd(x, blend[0], blend[9]))));
+        simdStore(outP.y() + i, simdMadd(z, blend[7], simdMadd(y, blend[4], simdMadd(x, blend[1], blend[10]))));
+        simdStore(outP.z() + i, simdMadd(z, blend[8], simdMadd(y, blend[5], simdMadd(x, blend[2], blend[11]))));
+
+        if (outN != NULL) {
+            x = simdLoad(n.x() + i);
+            y = simdLoad(n.y() + i);
+            z = simdLoad(n.z() + i);
+            SimdFloat nx = simdMadd(z, blend[6], simdMadd(y, blend[3], simdMul(x, blend[0])));
+            SimdFloat ny = simdMadd(z, blend[7], simdMadd(y, blend[4], simdMul(x, blend[1])));
+            SimdFloat nz = simdMadd(z, blend[8], simdMadd(y, blend[5], simdMul(x, blend[2])));
+
+            // 补齐部分的权重为0，结果为零向量，正则化时保持不变
+            SimdFloat magSq = simdMadd(nz, nz, simdMadd(ny, ny, simdMul(nx, nx)));
+            SimdMask nonZero = simdCmpGt(magSq, zero);
+            SimdFloat oneOverMag = simdSelect(nonZero, simdRsqrt(magSq), simdSet(1.0f));
+            simdStore(outN->x() + i, simdMul(nx, oneOverMag));
+            simdStore(outN->y() + i, simdMul(ny, oneOverMag));
+            simdStore(outN->z() + i, simdMul(nz, oneOverMag));
+        }
+    }
+}
+
+/*
+    对偶四元数版本：混合后的8个字段转置为SoA，除以real的模完成正则化
+    旋转用v' = v + w * t + u x t，t = 2 * (u x v)，平移为2 * (w * d - dw * u + u x d)，参看DualQuaternion.cpp
+    旋转不改变长度，法线不需要再正则化
+    补齐部分和没有影响的顶点混合结果为0，按单位变换处理
+ */
+static void skinRangeDual(const SkinningJob& job, size_t begin, size_t end) {
+    const SkinnedMesh& mesh = *job.mesh;
+    const float* palette = reinterpret_cast<const float*>(job.dualPalette);
+    const Vector3Stream& p = mesh.positions();
+    const Vector3Stream& n = mesh.normals();
+    Vector3Stream& outP = *job.positions;
+    Vector3Stream* outN = job.normals;
+    SimdFloat zero = simdZero();
+    SimdFloat two = simdSet(2.0f);
+
+    for (size_t i = begin; i < end; i += kSimdWidth) {
+        int used = groupInfluences(mesh, i);
+        float blended[kSimdWidth * 8];
+        for (int lane = 0; lane < kSimdWidth; ++lane) {
+            blendDualQuaternion(mesh, palette, i + lane, used, blended + 8 * lane);
+        }
+        SimdFloat q[8];
+        simdLoadFields(blended, 8, 8, kSimdWidth, q);
+
+        SimdFloat magSq = simdMadd(q[3], q[3], simdMadd(q[2], q[2], simdMadd(q[1], q[1], simdMul(q[0], q[0]))));
+        SimdFloat oneOverMag = simdSelect(simdCmpGt(magSq, zero), simdRsqrt(magSq), zero);
+        SimdFloat rw = simdMul(q[0], oneOverMag), ux = simdMul(q[1], oneOverMag);
+        SimdFloat uy = simdMul(q[2], oneOverMag), uz = simdMul(q[3], oneOverMag);
+        SimdFloat dw = simdMul(q[4], oneOverMag), dx = simdMul(q[5], oneOverMag);
+        SimdFloat dy = simdMul(q[6], oneOverMag), dz = simdMul(q[7], oneOverMag);
+
+        // 平移
+        SimdFloat cx, cy, cz;
+        simdCross(ux, uy, uz, dx, dy, dz, cx, cy, cz);
+        SimdFloat tx = simdMul(two, simdNmadd(dw, ux, simdMadd(rw, dx, cx)));
+        SimdFloat ty = simdMul(two, simdNmadd(dw, uy, simdMadd(rw, dy, cy)));
+        SimdFloat tz = simdMul(two, simdNmadd(dw, uz, simdMadd(rw, dz, cz)));
+
+        SimdFloat x = simdLoad(p.x() + i), y = simdLoad(p.y() + i), z = simdLoad(p.z() + i);
+        simdCross(ux, uy, uz, x, y, z, cx, cy, cz);
+        cx = simdMul(cx, two);
+        cy = simdMul(cy, two);
+        cz = simdMul(cz, two);
+        SimdFloat ex, ey, ez;
+        simdCross(ux, uy, uz, cx, cy, cz, ex, ey, ez);
+        simdStore(outP.x() + i, simdAdd(simdMadd(rw, cx, simdAdd(x, ex)), tx));
+        simdStore(outP.y() + i, simdAdd(simdMadd(rw, cy, simdAdd(y, ey)), ty));
+        simdStore(outP.z() + i, simdAdd(simdMadd(rw, cz, simdAdd(z, ez)), tz));
+
+        if (outN != NULL) {
+            x = simdLoad(n.x() + i);
+            y = simdLoad(n.y() + i);
+            z = simdLoad(n.z() + i);
+            simdCross(ux, uy, uz, x, y, z, cx, cy, cz);
+            cx = simdMul(cx, two);
+            cy = simdMul(cy, two);
+            cz = simdMul(cz, two);
+            simdCross(ux, uy, uz, cx, cy, cz, ex, ey, ez);
+            simdStore(outN->x() + i, simdMadd(rw, cx, simdAdd(x, ex)));
+            simdStore(outN->y() + i, simdMadd(rw, cy, simdAdd(y, ey)));
+            simdStore(outN->z() + i, simdMadd(rw, cz, simdAdd(z, ez)));
+        }
+    }
+}
+
+void skinVertices(const SkinnedMesh& mesh, const Matrix4x3* palette, size_t boneCount,
+                  Vector3Stream& positions, Vector3Stream* normals) {
+    SkinningJob job = { &mesh, palette, NULL, boneCount, &positions, normals };
+    skinVertices(&job, 1);
+}
+
+void skinVertices(const SkinnedMesh& mesh, const DualQuaternion* palette, size_t boneCount,
+                  Vector3Stream& positions, Vector3Stream* normals) {
+    SkinningJob job = { &mesh, NULL, palette, boneCount, &positions, normals };
+    skinVertices(&job, 1);
+}
+
+/*
+    各网格补齐后的顶点个数首尾相接，组成一个总的顶点区间，parallelFor按这个区间分块
+    输出按mesh.size()分配，只保证到paddedSize()，网格缩小过时不能按容量计算
+    补齐后的个数和块大小都是16的整数倍，所以每块的边界都落在某个网格的整组顶点上
+ */
+void skinVertices(const SkinningJob* jobs, size_t jobCount) {
+    std::vector<size_t> offsets(jobCount + 1);
+    offsets[0] = 0;
+    int influences = 0;
+    for (size_t j = 0; j < jobCount; ++j) {
+        const SkinningJob& job = jobs[j];
+        assert(job.mesh->maxBone() < (int)job.boneCount);
+        assert((job.palette == NULL) != (job.dualPalette == NULL));
+        job.positions->resize(job.mesh->size());
+        if (job.normals != NULL) {
+            job.normals->resize(job.mesh->size());
+        }
+        offsets[j + 1] = offsets[j] + job.mesh->paddedSize();
+        influences = std::max(influences, job.mesh->influenceCount());
+    }
+
+    // 按顶点计数，从这里开始计时，前面只是检查和分配输出
+    MATH_INSTRUMENT_BATCH(SkinVertices, offsets[jobCount]);
+    size_t bytesPerVertex = 12 * sizeof(float) + influences * (sizeof(float) + sizeof(unsigned short));
+    parallelFor(offsets[jobCount], cacheChunk(bytesPerVertex), [&](size_t begin, size_t end) {
+        size_t j = std::upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin() - 1;
+        while (begin < end) {
+            size_t jobEnd = std::min(end, offsets[j + 1]);
+            if (jobs[j].dualPalette != NULL) {
+                skinRangeDual(jobs[j], begin - offsets[j], jobEnd - offsets[j]);
+            } else {
+                skinRangeLinear(jobs[j], begin - offsets[j], jobEnd - offsets[j]);
+            }
+            begin = jobEnd;
+            ++j;
+        }
+    });
+}
@@ -0,0 +1,113 @@
+//
+//  Skinning.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef Skinning_hpp
+#define Skinning_hpp
+
+#include <stddef.h>
+
+#include "Vector3Stream.hpp"
+
+class Vector3;
+class Matrix4x3;
+class DualQuaternion;
+
+/*
+    SkinnedMesh类
+    蒙皮网格的顶点数据，每个顶点受最多influenceCount个骨骼影响
+    绑定姿态的位置和法线用Vector3Stream存放
+    第k个影响的权重和骨骼下标也各自是一个连续数组（SoA），长度与Vector3Stream的容量相同
+    补齐部分以及未使用的影响，权重为0、骨骼下标为0
+ */
+class SkinnedMesh {
+
+public:
+    // 每个顶点最多的影响个数
+    static const int kMaxInfluences = 8;
+
+    // influenceCount为每个顶点的影响个数，一般为4，需要更平滑的变形时用8
+    explicit SkinnedMesh(int influenceCount = 4);
+    SkinnedMesh(const SkinnedMesh& a);
+    ~SkinnedMesh();
+
+    SkinnedMesh& operator =(const SkinnedMesh& a);
+
+    size_t size() const { return bindPositions.size(); }
+    size_t capacity() const { return bindPositions.capacity(); }
+    // 顶点个数补齐到16的整数倍，蒙皮计算到这里为止；resize缩小后capacity()可能更大，参看Vector3Stream::paddedSize
+    size_t paddedSize() const { return bindPositions.paddedSize(); }
+    int influenceCount() const { return influences; }
+
+    // 改变顶点个数，原有数据保留，新增顶点的权重全部为0
+    void resize(size_t n);
+
+    /*
+        设置顶点的绑定姿态和骨骼影响，count可以超过influenceCount，此时只保留权重最大的几个
+        保留的权重重新正则化，使其和为1
+     */
+    void setVertex(size_t i, const Vector3& position, const Vector3& normal,
+                   const int* bones, const float* weights, int count);
+
+    // 绑定姿态
+    const Vector3Stream& positions() const { return bindPositions; }
+    const Vector3Stream& normals() const { return bindNormals; }
+
+    // 第k个影响的权重和骨骼下标数组
+    const float* weights(int k) const { return weightData + k * capacity(); }
+    const unsigned short* bones(int k) const { return boneData + k * capacity(); }
+
+    // 用到的最大骨骼下标，骨骼矩阵数组至少要有maxBone() + 1个元素
+    int maxBone() const { return largestBone; }
+
+private:
+    Vector3Stream bindPositions;
+    Vector3Stream bindNormals;
+    float* weightData;
+    unsigned short* boneData;
+    int influences;
+    int largestBone;
+
+    void allocate(size_t padded);
+    void release();
+    void copyInfluences(const SkinnedMesh& a);
+};
+
+/*
+    计算蒙皮后的顶点：p' = sum(weight[k] * (p * palette[bone[k]]))
+    palette是每个骨骼从绑定姿态到当前姿态的变换（即绑定姿态的逆乘以骨骼的当前矩阵）
+    法线用混合后矩阵的3x3部分变换再正则化，骨骼矩阵含非均匀缩放时结果只是近似值
+    normals为NULL时只计算位置，输出的向量个数与mesh相同
+ */
+extern void skinVertices(const SkinnedMesh& mesh, const Matrix4x3* palette, size_t boneCount,
+                         Vector3Stream& positions, Vector3Stream* normals);
+
+/*
+    对偶四元数蒙皮（dual quaternion skinning）：按权重混合骨骼的对偶四元数，正则化后变换位置和法线
+    混合结果始终是刚体变换，关节大角度扭转时不会像线性混合蒙皮那样收缩（candy-wrapper）
+    每个骨骼只需8个float，骨骼变换必须是刚体变换，不支持缩放
+ */
+extern void skinVertices(const SkinnedMesh& mesh, const DualQuaternion* palette, size_t boneCount,
+                         Vector3Stream& positions, Vector3Stream* normals);
+
+/*
+    一次计算多个网格的蒙皮，比如同屏的一群角色
+    所有网格的顶点合在一起按顶点区间分给各线程，每个网格顶点不多时也能充分并行
+    palette和dualPalette只设置其中一个，另一个为NULL，分别使用线性混合蒙皮和对偶四元数蒙皮
+ */
+struct SkinningJob {
+    const SkinnedMesh* mesh;
+    const Matrix4x3* palette;
+    const DualQuaternion* dualPalette;
+    size_t boneCount;
+    Vector3Stream* positions;
+    Vector3Stream* normals;
+};
+
+extern void skinVertices(const SkinningJob* jobs, size_t jobCount);
+
+#endif /* Skinning_hpp */
@@ -0,0 +1,218 @@
+//
+//  ThreadPool.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "ThreadPool.hpp"
+
+#include <assert.h>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+/*
+    一次parallelFor调用的共享状态
+    块按参与线程数平均分成若干段，每段有自己的原子计数器
+    线程先从自己的段取块，取完后依次到其他线程的段中窃取，窃取和自取用同一个计数器，不需要加锁
+    处理函数抛出异常时记下第一个异常并取消还没开始的块，等所有线程离开后在调用线程中重新抛出
+ */
+struct ThreadPool::Job {
+    // 每段补齐到一个缓存行的大小，避免不同线程的计数器互相干扰
+    struct Range {
+        std::atomic<size_t> next;
+        size_t end;
+        char padding[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    };
+
+    const RangeFunction* body;
+    size_t n;
+    size_t grain;
+    int participants;
+    std::unique_ptr<Range[]> ranges;
+    std::atomic<int> pending;
+    std::atomic<bool> cancelled;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+};
+
+// 当前线程是否正在执行某个块，用于把嵌套的parallelFor改为串行
+static thread_local bool tlsInsideParallelFor = false;
+
+ThreadPool::ThreadPool(int threadCount) : job(NULL), generation(0), quit(false) {
+    start(threadCount);
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::setThreadCount(int threadCount) {
+    std::lock_guard<std::mutex> lock(submitMutex);
+    stop();
+    start(threadCount);
+}
+
+void ThreadPool::start(int threadCount) {
+    if (threadCount <= 0) {
+        threadCount = (int)std::thread::hardware_concurrency();
+    }
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+
+    quit = false;
+    // 调用线程也参与计算，所以只需要创建threadCount - 1个工作线程
+    for (int i = 1; i < threadCount; ++i) {
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, i, generation));
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    workers.clear();
+}
+
+// seen为线程创建时的任务代数，只响应之后提交的任务
+void ThreadPool::workerLoop(int index, unsigned seen) {
+    for (;;) {
+        Job* j;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit) {
+                return;
+            }
+            seen = generation;
+            j = job;
+        }
+
+        runChunks(*j, index);
+
+        if (j->pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runChunks(Job& j, int participant) {
+    tlsInsideParallelFor = true;
+    for (int k = 0; k < j.participants; ++k) {
+        Job::Range& r = j.ranges[(participant + k) % j.participants];
+        for (;;) {
+            size_t chunk = r.next.fetch_add(1);
+            if (chunk >= r.end) {
+                break;
+            }
+            if (j.cancelled.load(std::memory_order_relaxed)) {
+                break;
+            }
+            size_t begin = chunk * j.grain;
+            size_t end = begin + j.grain < j.n ? begin + j.grain : j.n;
+            try {
+                (*j.body)(begin, end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(j.errorMutex);
+                if (!j.error) {
+                    j.error = std::current_exception();
+                }
+                j.cancelled = true;
+            }
+        }
+    }
+    tlsInsideParallelFor = false;
+}
+
+void ThreadPool::parallelFor(size_t n, size_t grain, const RangeFunction& body) {
+    if (n == 0) {
+        return;
+    }
+
+    int threads = threadCount();
+    if (grain == 0) {
+        // 自动分块：每个线程大约分到4块，给窃取留出余地
+        size_t target = (size_t)threads * 4;
+        grain = (n + target - 1) / target;
+        grain = (grain + 15) / 16 * 16;
+    }
+    size_t chunkCount = (n + grain - 1) / grain;
+
+    // 单线程、只有一块或者嵌套调用时，在当前线程按块顺序执行
+    if (threads == 1 || chunkCount == 1 || tlsInsideParallelFor) {
+        for (size_t begin = 0; begin < n; begin += grain) {
+            body(begin, begin + grain < n ? begin + grain : n);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> submitLock(submitMutex);
+
+    Job j;
+    j.body = &body;
+    j.n = n;
+    j.grain = grain;
+    j.participants = threadCount();
+    j.ranges.reset(new Job::Range[j.participants]);
+    for (int p = 0; p < j.participants; ++p) {
+        j.ranges[p].next = chunkCount * p / j.participants;
+        j.ranges[p].end = chunkCount * (p + 1) / j.participants;
+    }
+    j.pending = j.participants - 1;
+    j.cancelled = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &j;
+        ++generation;
+    }
+    wake.notify_all();
+
+    runChunks(j, 0);
+
+    // 等待所有工作线程离开这次任务，之后j才能销毁
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return j.pending.load() == 0; });
+        job = NULL;
+    }
+    if (j.error) {
+        std::rethrow_exception(j.error);
+    }
+}
+
+size_t cacheChunk(size_t bytesPerElement) {
+    assert(bytesPerElement > 0);
+    size_t chunk = kParallelChunkBytes / bytesPerElement;
+    chunk = chunk / 16 * 16;
+    return chunk > 16 ? chunk : 16;
+}
+
+void parallelFor(size_t n, size_t grain, const ThreadPool::RangeFunction& body) {
+    if (n < kParallelThreshold) {
+        // 数据量小时不唤醒线程池，但仍按相同的块边界执行，保证结果与并行时一致
+        if (grain == 0) {
+            body(0, n);
+            return;
+        }
+        for (size_t begin = 0; begin < n; begin += grain) {
+            body(begin, begin + grain < n ? begin + grain : n);
+        }
+        return;
+    }
+    ThreadPool::instance().parallelFor(n, grain, body);
+}
@@ -0,0 +1,99 @@
+//
+//  ThreadPool.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <stddef.h>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+/*
+    ThreadPool类
+    批量运算使用的线程池，parallelFor把[0, n)切成若干块分给各线程执行
+    每个线程先按顺序处理分给自己的一段连续块，做完后从其他线程的剩余部分窃取
+    调用线程也参与计算，在一个工作线程中再次调用parallelFor会直接串行执行
+ */
+class ThreadPool {
+
+public:
+    // 块的处理函数，参数为块的起止下标[begin, end)
+    typedef std::function<void(size_t begin, size_t end)> RangeFunction;
+
+    // threadCount为参与计算的线程总数（包括调用线程），0表示使用硬件线程数
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    // 全局线程池，第一次使用时创建
+    static ThreadPool& instance();
+
+    int threadCount() const { return (int)workers.size() + 1; }
+
+    // 重新设置线程总数，1表示完全串行执行
+    void setThreadCount(int threadCount);
+
+    /*
+        把[0, n)按grain个元素一块切分并行执行
+        grain非0时块的边界只由n和grain决定，与线程数和调度顺序无关，
+        逐块归约的结果因此可以复现（确定性分块）
+        grain为0时根据线程数自动选择块大小
+        body抛出异常时不再开始新的块，等已经开始的块结束后把第一个异常抛给调用者
+     */
+    void parallelFor(size_t n, size_t grain, const RangeFunction& body);
+
+private:
+    struct Job;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::mutex submitMutex;
+    Job* job;
+    unsigned generation;
+    bool quit;
+
+    void start(int threadCount);
+    void stop();
+    void workerLoop(int index, unsigned seen);
+    void runChunks(Job& j, int participant);
+};
+
+// 批量运算开始使用多线程的最小元素个数，小于它时线程调度的开销超过收益
+const size_t kParallelThreshold = 1 << 16;
+
+// 每块数据的目标字节数，使一块数据能放进L2缓存
+const size_t kParallelChunkBytes = 128 * 1024;
+
+// 每个元素读写bytesPerElement字节时，一块包含的元素个数，是16的整数倍
+extern size_t cacheChunk(size_t bytesPerElement);
+
+// 使用全局线程池的parallelFor，n小于kParallelThreshold时直接在当前线程执行
+extern void parallelFor(size_t n, size_t grain, const ThreadPool::RangeFunction& body);
+
+/*
+    在parallelFor的每一块内部再按group个元素一组调用kernel(begin, count)，用于SIMD批量运算
+    grain需要是group的整数倍（cacheChunk的结果是16的整数倍），这样只有整个数组的最后一组可能不足group个
+ */
+template <typename Kernel>
+inline void parallelForGroups(size_t n, size_t group, size_t grain, const Kernel& kernel) {
+    parallelFor(n, grain, [&](size_t begin, size_t end) {
+        size_t i = begin;
+        for (; i + group <= end; i += group) {
+            kernel(i, group);
+        }
+        if (i < end) {
+            kernel(i, end - i);
+        }
+    });
+}
+
+#endif /* ThreadPool_hpp */
@@ -0,0 +1,338 @@
+//
+//  TransformHierarchy.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "TransformHierarchy.hpp"
+
+#include <assert.h>
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+#include "SimdUtil.h"
+#include "Instrument.hpp"
+
+const int TransformHierarchy::kNoParent;
+
+// 一层中至少有这么多节点要计算时才交给线程池
+const size_t kLevelParallelThreshold = 4096;
+
+/*
+    被修改的节点达到总数的1/kFullUpdateFraction时不再逐层合并区间，直接按层计算全部节点
+    10万个节点的基准（benchHierarchy）中，移动5%的节点时逐层合并快10%到50%，移动10%时慢约15%
+ */
+const size_t kFullUpdateFraction = 16;
+
+TransformHierarchy::TransformHierarchy() : layoutDirty(false) {}
+
+void TransformHierarchy::reserve(size_t n) {
+    slots.reserve(n);
+    parents.reserve(n);
+    depths.reserve(n);
+    firstChild.reserve(n);
+    nextSibling.reserve(n);
+    localMatrices.reserve(n);
+    worldMatrices.reserve(n);
+    parentSlots.reserve(n);
+    childBegin.reserve(n);
+    childEnd.reserve(n);
+    dirtyFlags.reserve(n);
+}
+
+/*
+    新节点先放在最后一个槽位，父节点仍在子节点之前，所以updateAll()照样可以按槽位顺序计算
+    下次update()时重新按深度排列
+ */
+int TransformHierarchy::addNode(int parent, const Matrix4x3& local) {
+    int node = (int)slots.size();
+    assert(parent == kNoParent || (parent >= 0 && parent < node));
+
+    slots.push_back(node);
+    parents.push_back(parent);
+    depths.push_back(parent == kNoParent ? 0 : depths[parent] + 1);
+    firstChild.push_back(kNoParent);
+
+    // 加到父节点子链表的头部
+    if (parent != kNoParent) {
+        nextSibling.push_back(firstChild[parent]);
+        firstChild[parent] = node;
+    } else {
+        nextSibling.push_back(kNoParent);
+    }
+
+    localMatrices.push_back(local);
+    worldMatrices.push_back(local);
+    parentSlots.push_back(parent == kNoParent ? kNoParent : slots[parent]);
+    childBegin.push_back(0);
+    childEnd.push_back(0);
+    dirtyFlags.push_back(0);
+
+    layoutDirty = true;
+    return node;
+}
+
+void TransformHierarchy::setLocal(int node, const Matrix4x3& local) {
+    int slot = slots[node];
+    localMatrices[slot] = local;
+    markDirty(slot);
+}
+
+void TransformHierarchy::markDirty(int slot) {
+    if (!dirtyFlags[slot]) {
+        dirtyFlags[slot] = 1;
+        dirtySlots.push_back(slot);
+    }
+}
+
+/*
+    按层重新分配槽位：第0层是所有根节点，之后每一层依次放上一层各节点的子节点
+    子节点紧跟着排在一起，所以childBegin/childEnd随槽位单调不减，
+    一段连续槽位的子节点也是下一层的一段连续槽位
+ */
+void TransformHierarchy::rebuildLayout() {
+    size_t n = slots.size();
+    std::vector<int> order;
+    order.reserve(n);
+    for (size_t node = 0; node < n; ++node) {
+        if (parents[node] == kNoParent) {
+            order.push_back((int)node);
+        }
+    }
+
+    levelStart.clear();
+    levelStart.push_back(0);
+    size_t begin = 0;
+    while (begin < order.size()) {
+        size_t end = order.size();
+        levelStart.push_back((int)end);
+        for (size_t i = begin; i < end; ++i) {
+            childBegin[i] = (int)order.size();
+            for (int child = firstChild[order[i]]; child != kNoParent; child = nextSibling[child]) {
+                order.push_back(child);
+            }
+            childEnd[i] = (int)order.size();
+        }
+        begin = end;
+    }
+    assert(order.size() == n);
+
+    std::vector<Matrix4x3> local(n);
+    for (size_t i = 0; i < n; ++i) {
+        local[i] = localMatrices[slots[order[i]]];
+    }
+    localMatrices.swap(local);
+    for (size_t i = 0; i < n; ++i) {
+        slots[order[i]] = (int)i;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        int parent = parents[order[i]];
+        parentSlots[i] = parent == kNoParent ? kNoParent : slots[parent];
+    }
+
+    // 旧的标记指向旧槽位，重新排列后计算全部节点
+    dirtySlots.clear();
+    dirtyFlags.assign(n, 0);
+    layoutDirty = false;
+}
+
+/*
+    计算槽位[begin, end)的世界矩阵：world = local * parentWorld
+    父矩阵的每一行用一次4路读取，局部矩阵的元素广播后乘加，每个节点只需12次乘法和9次加法（4路）
+    运算次序与concatenate()相同，结果逐位相同
+    矩阵的前12个float按行排列，行之间相隔3个float：前三行各用一次4路写入，后一次写入覆盖前一行多写的通道；
+    平移行与第三行的最后一个元素拼在一起写入，不会碰到transformClass
+ */
+static inline void updateRange(const Matrix4x3* local, const int* parent, Matrix4x3* world, int begin, int end) {
+    for (int slot = begin; slot < end; ++slot) {
+        int p = parent[slot];
+        if (p == TransformHierarchy::kNoParent) {
+            world[slot] = local[slot];
+            continue;
+        }
+#if defined(SIMD_SSE) || defined(SIMD_AVX)
+        const float* a = reinterpret_cast<const float*>(&local[slot]);
+        const float* b = reinterpret_cast<const float*>(&world[p]);
+        float* r = reinterpret_cast<float*>(&world[slot]);
+        __m128 b0 = _mm_loadu_ps(b);
+        __m128 b1 = _mm_loadu_ps(b + 3);
+        __m128 b2 = _mm_loadu_ps(b + 6);
+        __m128 bt = _mm_loadu_ps(b + 8);
+        bt = _mm_shuffle_ps(bt, bt, _MM_SHUFFLE(0, 3, 2, 1));
+
+        __m128 row[4];
+        for (int k = 0; k < 4; ++k) {
+            row[k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[3 * k]), b0),
+                                           _mm_mul_ps(_mm_set1_ps(a[3 * k + 1]), b1)),
+                                _mm_mul_ps(_mm_set1_ps(a[3 * k + 2]), b2));
+        }
+        row[3] = _mm_add_ps(row[3], bt);
+
+        _mm_storeu_ps(r, row[0]);
+        _mm_storeu_ps(r + 3, row[1]);
+        _mm_storeu_ps(r + 6, row[2]);
+        __m128 last = _mm_shuffle_ps(row[2], row[3], _MM_SHUFFLE(0, 0, 2, 2));
+        _mm_storeu_ps(r + 8, _mm_shuffle_ps(last, row[3], _MM_SHUFFLE(2, 1, 2, 0)));
+        world[slot].transformClass = concatenateClass(local[slot].transformClass, world[p].transformClass);
+#else
+        concatenate(local[slot], world[p], world[slot]);
+#endif
+    }
+}
+
+/*
+    计算一层中若干区间的世界矩阵
+    同一层的节点只依赖上一层的结果，可以按任意顺序并行计算
+ */
+size_t TransformHierarchy::updateSpans(const std::vector<Span>& levelSpans) {
+    const Matrix4x3* local = &localMatrices[0];
+    const int* parent = &parentSlots[0];
+    Matrix4x3* world = &worldMatrices[0];
+
+    size_t total = 0;
+    for (size_t i = 0; i < levelSpans.size(); ++i) {
+        total += (size_t)(levelSpans[i].end - levelSpans[i].begin);
+    }
+    if (total < kLevelParallelThreshold) {
+        for (size_t i = 0; i < levelSpans.size(); ++i) {
+            updateRange(local, parent, world, levelSpans[i].begin, levelSpans[i].end);
+        }
+        return total;
+    }
+
+    spanOffsets.resize(levelSpans.size() + 1);
+    spanOffsets[0] = 0;
+    for (size_t i = 0; i < levelSpans.size(); ++i) {
+        spanOffsets[i + 1] = spanOffsets[i] + (size_t)(levelSpans[i].end - levelSpans[i].begin);
+    }
+
+    // 把[begin, end)映射回区间内的槽位
+    const Span* spanData = &levelSpans[0];
+    const size_t* offsets = &spanOffsets[0];
+    const size_t* offsetsEnd = offsets + spanOffsets.size();
+    ThreadPool::instance().parallelFor(total, 0, [&](size_t begin, size_t end) {
+        size_t s = std::upper_bound(offsets, offsetsEnd, begin) - offsets - 1;
+        while (begin < end) {
+            size_t count = std::min(end, offsets[s + 1]) - begin;
+            int slot = spanData[s].begin + (int)(begin - offsets[s]);
+            updateRange(local, parent, world, slot, slot + (int)count);
+            begin += count;
+            ++s;
+        }
+    });
+    return total;
+}
+
+/*
+    按字节做基数排序，被标记的槽位很多时比std::sort快数倍
+    passes取决于最大的槽位，10万个节点只需要3遍
+ */
+static void radixSort(std::vector<int>& keys, std::vector<int>& scratch, int maxKey) {
+    scratch.resize(keys.size());
+    for (int shift = 0; (maxKey >> shift) > 0; shift += 8) {
+        size_t counts[257] = {0};
+        for (size_t i = 0; i < keys.size(); ++i) {
+            ++counts[((keys[i] >> shift) & 0xff) + 1];
+        }
+        for (int b = 0; b < 256; ++b) {
+            counts[b + 1] += counts[b];
+        }
+        for (size_t i = 0; i < keys.size(); ++i) {
+            scratch[counts[(keys[i] >> shift) & 0xff]++] = keys[i];
+        }
+        keys.swap(scratch);
+    }
+}
+
+/*
+    被标记的槽位排序后按层处理：当前层要计算的区间是上一层区间的子节点区间加上本层被标记的槽位，
+    合并相邻的区间后批量计算，再把它们的子节点区间传给下一层
+    没有待计算的区间时直接跳到下一个被标记槽位所在的层
+ */
+size_t TransformHierarchy::update() {
+    MATH_INSTRUMENT_BATCH(TransformHierarchyUpdate, dirtySlots.size());
+    if (layoutDirty || dirtySlots.size() * kFullUpdateFraction >= size()) {
+        updateLevels();
+        return size();
+    }
+    if (dirtySlots.empty()) {
+        return 0;
+    }
+
+    radixSort(dirtySlots, sortScratch, (int)size() - 1);
+    for (size_t i = 0; i < dirtySlots.size(); ++i) {
+        dirtyFlags[dirtySlots[i]] = 0;
+    }
+
+    size_t count = 0;
+    size_t next = 0;
+    size_t levels = levelStart.size() - 1;
+    spans.clear();
+    size_t d = 0;
+    while (d < levels && (!spans.empty() || next < dirtySlots.size())) {
+        if (spans.empty()) {
+            d = std::upper_bound(levelStart.begin(), levelStart.end(), dirtySlots[next]) - levelStart.begin() - 1;
+        }
+
+        // 把本层被标记的槽位并入继承下来的区间，两者都已按槽位排序
+        childSpans.clear();
+        size_t s = 0;
+        int levelEnd = levelStart[d + 1];
+        while (s < spans.size() || (next < dirtySlots.size() && dirtySlots[next] < levelEnd)) {
+            Span span;
+            if (s < spans.size() && (next >= dirtySlots.size() || dirtySlots[next] >= spans[s].begin)) {
+                span = spans[s++];
+            } else {
+                span.begin = dirtySlots[next++];
+                span.end = span.begin + 1;
+            }
+            if (!childSpans.empty() && childSpans.back().end >= span.begin) {
+                childSpans.back().end = std::max(childSpans.back().end, span.end);
+            } else {
+                childSpans.push_back(span);
+            }
+        }
+        count += updateSpans(childSpans);
+
+        // 下一层的区间：childBegin/childEnd单调不减，结果仍然有序
+        spans.clear();
+        for (size_t i = 0; i < childSpans.size(); ++i) {
+            Span children = {childBegin[childSpans[i].begin], childEnd[childSpans[i].end - 1]};
+            if (children.begin == children.end) {
+                continue;
+            }
+            if (!spans.empty() && spans.back().end >= children.begin) {
+                spans.back().end = children.end;
+            } else {
+                spans.push_back(children);
+            }
+        }
+        ++d;
+    }
+    dirtySlots.clear();
+    return count;
+}
+
+void TransformHierarchy::updateAll() {
+    MATH_INSTRUMENT_BATCH(TransformHierarchyUpdateAll, localMatrices.size());
+    updateLevels();
+}
+
+// 需要时先重新排列槽位，再从浅到深逐层计算全部节点
+void TransformHierarchy::updateLevels() {
+    if (layoutDirty) {
+        rebuildLayout();
+    }
+    for (size_t i = 0; i < dirtySlots.size(); ++i) {
+        dirtyFlags[dirtySlots[i]] = 0;
+    }
+    dirtySlots.clear();
+
+    for (size_t d = 0; d + 1 < levelStart.size(); ++d) {
+        Span level = {levelStart[d], levelStart[d + 1]};
+        spans.assign(1, level);
+        updateSpans(spans);
+    }
+}
@@ -0,0 +1,107 @@
+//
+//  TransformHierarchy.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef TransformHierarchy_hpp
+#define TransformHierarchy_hpp
+
+#include <stddef.h>
+#include <vector>
+
+#include "Matrix4x3.hpp"
+
+/*
+    TransformHierarchy类
+    变换层次（场景图），每个节点保存局部->父空间的变换矩阵，update()计算局部->世界的矩阵
+    节点下标按加入顺序分配，内部按深度优先级存放：同一深度的节点占一段连续的槽位，
+    每层内按父节点的槽位排序，所以一个节点的子节点在下一层也是一段连续的槽位
+    修改局部矩阵只会标记该节点，update()逐层把被标记的区间传给下一层的子节点区间，
+    只对这些区间批量连接矩阵，较大的层交给线程池，开销与受影响的节点数成正比
+    被修改的节点很多时（1/16以上）合并区间的开销超过收益，改为计算全部节点
+    加入节点后下一次update()会重新排列槽位并计算全部节点
+ */
+class TransformHierarchy {
+
+public:
+    // 根节点的父节点下标
+    static const int kNoParent = -1;
+
+    TransformHierarchy();
+
+    // 节点个数
+    size_t size() const { return localMatrices.size(); }
+
+    // 预留节点空间
+    void reserve(size_t n);
+
+    // 加入节点，parent必须是已有节点或kNoParent，返回新节点的下标
+    int addNode(int parent, const Matrix4x3& local);
+
+    // 局部->父变换，修改后该节点及其子树会在下次update()时重新计算
+    const Matrix4x3& getLocal(int node) const { return localMatrices[slots[node]]; }
+    void setLocal(int node, const Matrix4x3& local);
+
+    // 局部->世界变换，在update()之后有效
+    const Matrix4x3& getWorld(int node) const { return worldMatrices[slots[node]]; }
+
+    // 按槽位存放的世界矩阵，节点node在getSlot(node)处，槽位在加入节点后的下一次update()时改变
+    const Matrix4x3* getWorldMatrices() const { return worldMatrices.empty() ? NULL : &worldMatrices[0]; }
+    int getSlot(int node) const { return slots[node]; }
+
+    int getParent(int node) const { return parents[node]; }
+    int getDepth(int node) const { return depths[node]; }
+
+    // 重新计算所有被修改节点子树的世界矩阵，返回本次重新计算的节点数
+    size_t update();
+
+    // 逐层重新计算全部节点
+    void updateAll();
+
+private:
+    // 槽位区间[begin, end)
+    struct Span {
+        int begin;
+        int end;
+    };
+
+    // 按节点下标：所在槽位、父节点、深度，以及子节点链表（第一个子节点和下一个兄弟节点）
+    std::vector<int> slots;
+    std::vector<int> parents;
+    std::vector<int> depths;
+    std::vector<int> firstChild;
+    std::vector<int> nextSibling;
+
+    // 按槽位：局部和世界矩阵、父节点的槽位、子节点在下一层的槽位区间[childBegin, childEnd)
+    std::vector<Matrix4x3> localMatrices;
+    std::vector<Matrix4x3> worldMatrices;
+    std::vector<int> parentSlots;
+    std::vector<int> childBegin;
+    std::vector<int> childEnd;
+
+    // 第d层的槽位区间为[levelStart[d], levelStart[d + 1])
+    std::vector<int> levelStart;
+
+    // 加入节点后槽位不再按深度排列，需要在下次更新时重新排列
+    bool layoutDirty;
+
+    // 本帧被修改节点的槽位，以及对应的标记
+    std::vector<int> dirtySlots;
+    std::vector<unsigned char> dirtyFlags;
+    std::vector<int> sortScratch;
+
+    // update()时当前层和下一层待计算的区间，以及并行计算时各区间的起始位置
+    std::vector<Span> spans;
+    std::vector<Span> childSpans;
+    std::vector<size_t> spanOffsets;
+
+    void markDirty(int slot);
+    void rebuildLayout();
+    size_t updateSpans(const std::vector<Span>& levelSpans);
+    void updateLevels();
+};
+
+#endif /* TransformHierarchy_hpp */
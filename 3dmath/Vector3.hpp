@@ -10,10 +10,15 @@
 #define Vector3_hpp
 
 #include <math.h>
+#include <assert.h>
 #include <iostream>
 #include <sstream>
 using namespace std;
 
+/*
+    三维向量
+    构造、比较和不涉及开方的运算都是constexpr，可以在编译时计算常量
+ */
 class Vector3 {
     
 public:
@@ -22,80 +27,76 @@ public:
     float z;
     
     // 默认构造s函数
-    Vector3() : x(0.0f), y(0.0f), z(0.0f) {}
-    // 拷贝构造函数
-    Vector3(const Vector3& a) : x(a.x), y(a.y), z(a.z) {}
+    constexpr Vector3() : x(0.0f), y(0.0f), z(0.0f) {}
+    // 拷贝构造函数和赋值，使用编译器生成的版本才能在constexpr中使用
+    Vector3(const Vector3& a) = default;
     // 带参数构造函数
-    Vector3(float nx, float ny, float nz) : x(nx), y(ny), z(nz) {}
+    constexpr Vector3(float nx, float ny, float nz) : x(nx), y(ny), z(nz) {}
     
-    Vector3& operator =(const Vector3& a) {
-        x = a.x;
-        y = a.y;
-        z = a.z;
-        return *this;
-    }
+    Vector3& operator =(const Vector3& a) = default;
     
-    bool operator ==(const Vector3& a) const {
+    constexpr bool operator ==(const Vector3& a) const {
         return x == a.x && y == a.y && z == a.z;
     }
     
-    bool operator !=(const Vector3& a) const {
-        return x != a.x && y != a.y && z != a.z;
+    // 任何一个分量不同就不相等
+    constexpr bool operator !=(const Vector3& a) const {
+        return !(*this == a);
     }
     
     // 置为零向量
-    void zero() {
+    constexpr void zero() {
         x = 0.0f;
         y = 0.0f;
         z = 0.0f;
     }
     
     // 一元负运算符
-    Vector3 operator -() const {
+    constexpr Vector3 operator -() const {
         return Vector3(-x, -y, -z);
     }
     
-    Vector3 operator +(const Vector3& a) const {
+    constexpr Vector3 operator +(const Vector3& a) const {
         return Vector3(x + a.x, y + a.y, z + a.z);
     }
     
-    Vector3 operator -(const Vector3& a) const {
+    constexpr Vector3 operator -(const Vector3& a) const {
         return Vector3(x - a.x, y - a.y, z - a.z);
     }
     
     // 与标量的乘除法
-    Vector3 operator *(float a) const {
+    constexpr Vector3 operator *(float a) const {
         return Vector3(x * a, y * a, z * a);
     }
     
-    Vector3 operator /(float a) const {
+    constexpr Vector3 operator /(float a) const {
         assert( a != 0.0f);
         float oneOverA = 1.0f / a;
         return Vector3(x * oneOverA, y * oneOverA, z * oneOverA);
     }
     
-    Vector3& operator +=(const Vector3& a) {
+    constexpr Vector3& operator +=(const Vector3& a) {
         x += a.x;
         y += a.y;
         z += a.z;
         return *this;
     }
     
-    Vector3& operator -=(const Vector3& a) {
+    constexpr Vector3& operator -=(const Vector3& a) {
         x -= a.x;
         y -= a.y;
         z -= a.z;
         return *this;
     }
     
-    Vector3& operator *=(const float a) {
+    constexpr Vector3& operator *=(const float a) {
         x *= a;
         y *= a;
         z *= a;
         return *this;
     }
     
-    Vector3& operator /=(const float a) {
+    constexpr Vector3& operator /=(const float a) {
         assert(a != 0.0f);
         float oneOverA = 1.0f / a;
         x *= oneOverA;
@@ -116,7 +117,7 @@ public:
     }
     
     // 向量点乘
-    float operator *(const Vector3& a) const {
+    constexpr float operator *(const Vector3& a) const {
         return x * a.x + y * a.y + z * a.z;
     }
     
@@ -133,7 +134,7 @@ inline float vectorMag(const Vector3& a) {
 }
 
 // 向量叉乘
-inline Vector3 crossProduct(const Vector3& a, const Vector3& b) {
+constexpr Vector3 crossProduct(const Vector3& a, const Vector3& b) {
     return Vector3(
        a.y * b.z - a.z * b.y,
        a.z * b.x - a.x * b.z,
@@ -141,7 +142,7 @@ inline Vector3 crossProduct(const Vector3& a, const Vector3& b) {
 }
 
 // 标量左乘
-inline Vector3 operator *(float k, const Vector3& v) {
+constexpr Vector3 operator *(float k, const Vector3& v) {
     return Vector3(k * v.x, k * v.y, k * v.z);
 }
 
@@ -153,8 +154,8 @@ inline float distance(const Vector3& a, const Vector3& b) {
     return sqrt(dx * dx + dy * dy + dz * dz);
 }
 
-// 全局零向量
-extern const Vector3 kZeroVector;
+// 全局零向量，在编译时构造，每个翻译单元有自己的一份
+constexpr Vector3 kZeroVector(0.0f, 0.0f, 0.0f);
 
 
 #endif /* Vector3_hpp */
@@ -0,0 +1,286 @@
+//
+//  Vector3Stream.cpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#include "Vector3Stream.hpp"
+
+#include <assert.h>
+#include <string.h>
+#include <new>
+
+#include "Vector3.hpp"
+#include "SimdUtil.h"
+#include "ThreadPool.hpp"
+#include "SimdDispatch.hpp"
+#include "Instrument.hpp"
+
+/*
+    三个分量数组放在同一块内存中，依次为x、y、z，每段长度为补齐后的容量
+    因为容量是kStreamPadding（16个float，64字节）的整数倍，所以每段的起始地址都是对齐的
+ */
+Vector3Stream::Vector3Stream() : xs(NULL), ys(NULL), zs(NULL), count(0), padded(0) {}
+
+Vector3Stream::Vector3Stream(size_t n) : xs(NULL), ys(NULL), zs(NULL), count(0), padded(0) {
+    allocate(n);
+}
+
+Vector3Stream::Vector3Stream(const Vector3Stream& a) : xs(NULL), ys(NULL), zs(NULL), count(0), padded(0) {
+    allocate(a.count);
+    copyComponents(a);
+}
+
+Vector3Stream::~Vector3Stream() {
+    release();
+}
+
+Vector3Stream& Vector3Stream::operator =(const Vector3Stream& a) {
+    if (this != &a) {
+        if (padded != paddedSize(a.count)) {
+            release();
+            allocate(a.count);
+        }
+        count = a.count;
+        copyComponents(a);
+    }
+    return *this;
+}
+
+/*
+    a缩小过时容量大于这里，两者的分量数组间隔不同，要分别复制
+    a在size()之后的部分都是0，复制到补齐后的容量为止，补齐部分仍然为0
+ */
+void Vector3Stream::copyComponents(const Vector3Stream& a) {
+    if (padded > 0) {
+        memcpy(xs, a.xs, padded * sizeof(float));
+        memcpy(ys, a.ys, padded * sizeof(float));
+        memcpy(zs, a.zs, padded * sizeof(float));
+    }
+}
+
+void Vector3Stream::allocate(size_t n) {
+    count = n;
+    padded = paddedSize(n);
+    if (padded == 0) {
+        return;
+    }
+    xs = (float*)alignedAlloc(3 * padded * sizeof(float));
+    if (xs == NULL) {
+        throw std::bad_alloc();
+    }
+    ys = xs + padded;
+    zs = ys + padded;
+    memset(xs, 0, 3 * padded * sizeof(float));
+}
+
+void Vector3Stream::release() {
+    alignedFree(xs);
+    xs = ys = zs = NULL;
+    count = padded = 0;
+}
+
+void Vector3Stream::resize(size_t n) {
+    if (n <= padded) {
+        // 容量足够，只需把被截掉的部分清零，保证补齐部分始终为0
+        for (size_t i = n; i < count; ++i) {
+            xs[i] = ys[i] = zs[i] = 0.0f;
+        }
+        count = n;
+        return;
+    }
+
+    Vector3Stream grown(n);
+    if (count > 0) {
+        memcpy(grown.xs, xs, count * sizeof(float));
+        memcpy(grown.ys, ys, count * sizeof(float));
+        memcpy(grown.zs, zs, count * sizeof(float));
+    }
+
+    // 交换两者的存储，旧的内存由grown析构时释放
+    float* oldXs = xs;
+    xs = grown.xs; ys = grown.ys; zs = grown.zs;
+    padded = grown.padded;
+    count = n;
+    grown.xs = oldXs;
+}
+
+void Vector3Stream::zero() {
+    if (padded > 0) {
+        memset(xs, 0, 3 * padded * sizeof(float));
+    }
+}
+
+Vector3 Vector3Stream::get(size_t i) const {
+    assert(i < count);
+    return Vector3(xs[i], ys[i], zs[i]);
+}
+
+void Vector3Stream::set(size_t i, const Vector3& v) {
+    assert(i < count);
+    xs[i] = v.x;
+    ys[i] = v.y;
+    zs[i] = v.z;
+}
+
+/*
+    AoS -> SoA
+    每次读入kSimdWidth个Vector3，在寄存器中转置后分别写入三个数组
+ */
+void Vector3Stream::fromVector3Array(const Vector3* v, size_t n) {
+    resize(n);
+    const float* p = reinterpret_cast<const float*>(v);
+    size_t i = 0;
+    for (; i + kSimdWidth <= n; i += kSimdWidth) {
+        SimdFloat vx, vy, vz;
+        simdLoadVector3(p + 3 * i, vx, vy, vz);
+        simdStore(xs + i, vx);
+        simdStore(ys + i, vy);
+        simdStore(zs + i, vz);
+    }
+    for (; i < n; ++i) {
+        xs[i] = v[i].x;
+        ys[i] = v[i].y;
+        zs[i] = v[i].z;
+    }
+}
+
+// SoA -> AoS
+void Vector3Stream::toVector3Array(Vector3* v) const {
+    float* p = reinterpret_cast<float*>(v);
+    size_t i = 0;
+    for (; i + kSimdWidth <= count; i += kSimdWidth) {
+        simdStoreVector3(p + 3 * i, simdLoad(xs + i), simdLoad(ys + i), simdLoad(zs + i));
+    }
+    for (; i < count; ++i) {
+        v[i].x = xs[i];
+        v[i].y = ys[i];
+        v[i].z = zs[i];
+    }
+}
+
+/*
+    把整寄存器的结果写入长度为n的float数组
+    最后一组可能越过n，先写入临时缓冲，再复制有效部分
+ */
+static inline void storeResult(float* out, size_t i, size_t n, SimdFloat r) {
+    if (i + kSimdWidth <= n) {
+        simdStoreU(out + i, r);
+    } else {
+        float tmp[kSimdWidth];
+        simdStoreU(tmp, r);
+        memcpy(out + i, tmp, (n - i) * sizeof(float));
+    }
+}
+
+/*
+    以下批量运算都通过parallelFor分块执行，每块的大小按读写的字节数选取，使一块数据能放进L2缓存
+    块的边界是16的整数倍，每块内部仍然可以使用对齐读写
+    逐元素运算处理到paddedSize()：a缩小过时capacity()更大，超出b和out分配的范围
+ */
+void add(const Vector3Stream& a, const Vector3Stream& b, Vector3Stream& out) {
+    MATH_INSTRUMENT_BATCH(Vector3StreamAdd, a.size());
+    assert(a.size() == b.size());
+    out.resize(a.size());
+    parallelFor(a.paddedSize(), cacheChunk(9 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            simdStore(out.x() + i, simdAdd(simdLoad(a.x() + i), simdLoad(b.x() + i)));
+            simdStore(out.y() + i, simdAdd(simdLoad(a.y() + i), simdLoad(b.y() + i)));
+            simdStore(out.z() + i, simdAdd(simdLoad(a.z() + i), simdLoad(b.z() + i)));
+        }
+    });
+}
+
+void sub(const Vector3Stream& a, const Vector3Stream& b, Vector3Stream& out) {
+    MATH_INSTRUMENT_BATCH(Vector3StreamSub, a.size());
+    assert(a.size() == b.size());
+    out.resize(a.size());
+    parallelFor(a.paddedSize(), cacheChunk(9 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            simdStore(out.x() + i, simdSub(simdLoad(a.x() + i), simdLoad(b.x() + i)));
+            simdStore(out.y() + i, simdSub(simdLoad(a.y() + i), simdLoad(b.y() + i)));
+            simdStore(out.z() + i, simdSub(simdLoad(a.z() + i), simdLoad(b.z() + i)));
+        }
+    });
+}
+
+void scale(const Vector3Stream& a, float k, Vector3Stream& out) {
+    MATH_INSTRUMENT_BATCH(Vector3StreamScale, a.size());
+    out.resize(a.size());
+    SimdFloat vk = simdSet(k);
+    parallelFor(a.paddedSize(), cacheChunk(6 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            simdStore(out.x() + i, simdMul(simdLoad(a.x() + i), vk));
+            simdStore(out.y() + i, simdMul(simdLoad(a.y() + i), vk));
+            simdStore(out.z() + i, simdMul(simdLoad(a.z() + i), vk));
+        }
+    });
+}
+
+void crossProduct(const Vector3Stream& a, const Vector3Stream& b, Vector3Stream& out) {
+    MATH_INSTRUMENT_BATCH(Vector3StreamCrossProduct, a.size());
+    assert(a.size() == b.size());
+    out.resize(a.size());
+    parallelFor(a.paddedSize(), cacheChunk(9 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            SimdFloat ax = simdLoad(a.x() + i), ay = simdLoad(a.y() + i), az = simdLoad(a.z() + i);
+            SimdFloat bx = simdLoad(b.x() + i), by = simdLoad(b.y() + i), bz = simdLoad(b.z() + i);
+            // 先读入全部分量，out与a或b是同一对象时也是安全的
+            simdStore(out.x() + i, simdNmadd(az, by, simdMul(ay, bz)));
+            simdStore(out.y() + i, simdNmadd(ax, bz, simdMul(az, bx)));
+            simdStore(out.z() + i, simdNmadd(ay, bx, simdMul(ax, by)));
+        }
+    });
+}
+
+void dotProduct(const Vector3Stream& a, const Vector3Stream& b, float* out) {
+    MATH_INSTRUMENT_BATCH(Vector3StreamDotProduct, a.size());
+    assert(a.size() == b.size());
+    parallelFor(a.size(), cacheChunk(7 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            SimdFloat d = simdMul(simdLoad(a.x() + i), simdLoad(b.x() + i));
+            d = simdMadd(simdLoad(a.y() + i), simdLoad(b.y() + i), d);
+            d = simdMadd(simdLoad(a.z() + i), simdLoad(b.z() + i), d);
+            storeResult(out, i, end, d);
+        }
+    });
+}
+
+void vectorMag(const Vector3Stream& a, float* out) {
+    MATH_INSTRUMENT_BATCH(Vector3StreamVectorMag, a.size());
+    parallelFor(a.size(), cacheChunk(4 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            SimdFloat x = simdLoad(a.x() + i), y = simdLoad(a.y() + i), z = simdLoad(a.z() + i);
+            SimdFloat magSq = simdMadd(z, z, simdMadd(y, y, simdMul(x, x)));
+            storeResult(out, i, end, simdSqrt(magSq));
+        }
+    });
+}
+
+void distance(const Vector3Stream& a, const Vector3Stream& b, float* out) {
+    MATH_INSTRUMENT_BATCH(Vector3StreamDistance, a.size());
+    assert(a.size() == b.size());
+    parallelFor(a.size(), cacheChunk(7 * sizeof(float)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += kSimdWidth) {
+            SimdFloat dx = simdSub(simdLoad(a.x() + i), simdLoad(b.x() + i));
+            SimdFloat dy = simdSub(simdLoad(a.y() + i), simdLoad(b.y() + i));
+            SimdFloat dz = simdSub(simdLoad(a.z() + i), simdLoad(b.z() + i));
+            SimdFloat distSq = simdMadd(dz, dz, simdMadd(dy, dy, simdMul(dx, dx)));
+            storeResult(out, i, end, simdSqrt(distSq));
+        }
+    });
+}
+
+/*
+    用rsqrt加一次牛顿迭代代替1/sqrt，核函数按运行时检测到的指令集选择（参看SimdDispatch.hpp）
+    模为0的通道（包括补齐部分）保持原值不变
+ */
+void normalize(Vector3Stream& a) {
+    MATH_INSTRUMENT_BATCH(Vector3StreamNormalize, a.size());
+    const SimdKernels& kernels = simdKernels();
+    parallelFor(a.paddedSize(), cacheChunk(6 * sizeof(float)), [&](size_t begin, size_t end) {
+        kernels.normalizeStream(a.x() + begin, a.y() + begin, a.z() + begin, end - begin);
+    });
+}
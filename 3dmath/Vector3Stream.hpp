@@ -0,0 +1,97 @@
+//
+//  Vector3Stream.hpp
+//  3dmath
+//
+//  Created by xiaoxiangzi on 2026/10/16.
+//  Copyright © 2026 xiaoxiangzi. All rights reserved.
+//
+
+#ifndef Vector3Stream_hpp
+#define Vector3Stream_hpp
+
+#include <stddef.h>
+
+class Vector3;
+
+/*
+    Vector3Stream类
+    以SoA（structure of arrays）方式存储一组向量：x、y、z各占一个连续数组
+    三个数组都按kSimdAlignment对齐，容量补齐到kStreamPadding的整数倍，补齐部分始终为0
+    批量运算可以直接按SIMD宽度处理到paddedSize()，不需要单独处理尾部
+ */
+class Vector3Stream {
+
+public:
+    // 容量补齐的粒度，按一个缓存行的float个数对齐
+    static const size_t kStreamPadding = 16;
+
+    Vector3Stream();
+    explicit Vector3Stream(size_t n);
+    Vector3Stream(const Vector3Stream& a);
+    ~Vector3Stream();
+
+    Vector3Stream& operator =(const Vector3Stream& a);
+
+    // 向量个数，以及补齐后的容量
+    size_t size() const { return count; }
+    size_t capacity() const { return padded; }
+
+    /*
+        向量个数补齐到kStreamPadding的整数倍，批量运算处理到这里为止
+        resize缩小后容量不变，可能大于paddedSize()，而同样个数的另一个Vector3Stream只分配到paddedSize()
+     */
+    size_t paddedSize() const { return paddedSize(count); }
+    static size_t paddedSize(size_t n) { return (n + kStreamPadding - 1) / kStreamPadding * kStreamPadding; }
+
+    // 改变向量个数，原有数据保留，新增部分置为零向量
+    void resize(size_t n);
+
+    // 所有向量置为零向量
+    void zero();
+
+    // 分量数组
+    float* x() { return xs; }
+    float* y() { return ys; }
+    float* z() { return zs; }
+    const float* x() const { return xs; }
+    const float* y() const { return ys; }
+    const float* z() const { return zs; }
+
+    // 单个向量的读写
+    Vector3 get(size_t i) const;
+    void set(size_t i, const Vector3& v);
+
+    // 和AoS形式的Vector3数组互相转换，一次遍历完成转置
+    void fromVector3Array(const Vector3* v, size_t n);
+    void toVector3Array(Vector3* v) const;
+
+private:
+    float* xs;
+    float* ys;
+    float* zs;
+    size_t count;
+    size_t padded;
+
+    void allocate(size_t n);
+    void release();
+    void copyComponents(const Vector3Stream& a);
+};
+
+/*
+    批量运算，对每个下标i执行与Vector3相同的运算
+    输入输出的向量个数必须相同，输出可以与输入是同一个对象
+ */
+extern void add(const Vector3Stream& a, const Vector3Stream& b, Vector3Stream& out);
+extern void sub(const Vector3Stream& a, const Vector3Stream& b, Vector3Stream& out);
+extern void scale(const Vector3Stream& a, float k, Vector3Stream& out);
+extern void crossProduct(const Vector3Stream& a, const Vector3Stream& b, Vector3Stream& out);
+
+// 结果写入长度为size()的float数组
+extern void dotProduct(const Vector3Stream& a, const Vector3Stream& b, float* out);
+extern void vectorMag(const Vector3Stream& a, float* out);
+extern void distance(const Vector3Stream& a, const Vector3Stream& b, float* out);
+
+// 就地标准化，零向量保持不变
+extern void normalize(Vector3Stream& a);
+
+#endif /* Vector3Stream_hpp */